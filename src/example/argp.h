@@ -10,12 +10,12 @@
 
 struct Config {
     std::string generator = "h2-k2";
-    bool generator_dyn = false;
     size_t maxQueries{};
     size_t readLength{};
     std::filesystem::path saveOutput;
     size_t minK{0}, maxK{6}, k_stepSize{1};
     bool reverse{true};
+    bool rcIndex{false};
     bool help{false};
     bool partialBuildUp{false};
     size_t threads{1};
@@ -53,9 +53,12 @@ auto loadConfig(int argc, char const* const* argv) {
         } else if (argv[i] == std::string{"--gen"} and i+1 < argc) {
             ++i;
             config.generator = argv[i];
+            // the expansion with the lowest weighted node count is chosen automatically, "_dyn" is accepted for compatibility
             if (config.generator.size() > 4 and config.generator.substr(config.generator.size()-4) == "_dyn") {
                 config.generator = config.generator.substr(0, config.generator.size()-4);
-                config.generator_dyn = true;
+            }
+            if (config.generator == "auto") {
+                config.generator = ""; // generator with the lowest weighted node count
             }
         } else if (argv[i] == std::string{"--queries"} and i+1 < argc) {
             ++i;
@@ -80,6 +83,8 @@ auto loadConfig(int argc, char const* const* argv) {
             config.k_stepSize = std::stod(argv[i]);
         } else if (argv[i] == std::string{"--no-reverse"}) {
             config.reverse = false;
+        } else if (argv[i] == std::string{"--rc"}) {
+            config.rcIndex = true;
         } else if (argv[i] == std::string{"--help"}) {
             config.help = true;
         } else if (argv[i] == std::string{"--partialBuildUp"}) {
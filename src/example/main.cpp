@@ -42,10 +42,9 @@ int main(int argc, char const* const* argv) {
         for (auto iter = ++count.begin(); iter != count.end(); ++iter) {
             ext += ", " + iter->first;
         }
-        std::string gens = search_schemes::generator::all.begin()->first;
-        gens = gens + "|" + gens + "_dyn";
-        for (auto iter = ++search_schemes::generator::all.begin(); iter != search_schemes::generator::all.end(); ++iter) {
-            gens += "|" + iter->first + "|" + iter->first + "_dyn";
+        std::string gens = "auto";
+        for (auto const& [name, entry] : search_schemes::generator::all) {
+            gens += "|" + name;
         }
         fmt::print("Usage:\n"
                     "./example --index somefile.fasta\n"
@@ -63,19 +62,115 @@ int main(int argc, char const* const* argv) {
                     "          --max_k <int> (maximal number of errors)\\\n"
                     "          --stepSize_k <int> (steps of errors)\\\n"
                     "          --no-reverse (don't use reverse compliment)\\\n"
+                    "          --rc (searches each query once in a RCBiFMIndex, reverse complement hits are reported via reverseComplement(), only ng21)\\\n"
                     "          --mode [all, besthits] (all: all hits with k errors (default), besthits: all hits with the lowest hit)\\\n"
                     "          --maxhitsperquery <int> (some int, 0 = infinit hits)\n"
         , ext, gens);
         return 0;
     }
-    auto const [queries, queryInfos] = loadQueries<Sigma>(config.queryPath, config.reverse, config.convertUnknownChar);
+    // a RCBiFMIndex covers both strands, the queries are not doubled by their reverse complements
+    auto const [queries, queryInfos] = loadQueries<Sigma>(config.queryPath, config.reverse and not config.rcIndex, config.convertUnknownChar);
 
     if (!queries.empty()) {
-        fmt::print("loaded {} queries (incl reverse complements)\n", queries.size());
+        fmt::print("loaded {} queries ({})\n", queries.size(), config.rcIndex?"reverse complements via RCBiFMIndex":"incl reverse complements");
         fmt::print("{:15}: {:>10}  ({:>10} +{:>10} ) {:>10}    - results: {:>10}/{:>10}/{:>10}/{:>10} - mem: {:>13}\n", "name", "time_search + time_locate", "time_search", "time_locate", "(time_search+time_locate)/queries.size()", "resultCt", "results.size()", "uniqueResults.size()", "readIds.size()", "memory");
     }
 
 
+    if (config.rcIndex) {
+        visitAllTables<Sigma>([&, &queries=queries]<typename Table>() {
+            std::string name = Table::extension();
+            if (config.extensions.count(name) == 0) return;
+
+            fmt::print("start loading {} ...", name);
+            fflush(stdout);
+            size_t samplingRate = 16;
+            auto index = loadRCIndex<Table>(config.indexPath, samplingRate, config.threads, config.convertUnknownChar);
+            fmt::print("done\n");
+            // sequence ids >= refCount are the reverse complements of the references
+            size_t refCount = index.csa.seqCount / 2;
+            auto schemeCache = SearchSchemeCache{index};
+            for (auto const& algorithm : config.algorithms) {
+                if (algorithm != "ng21") {
+                    throw std::runtime_error("algorithm \"" + algorithm + "\" is not supported by --rc, must be \"ng21\"");
+                }
+                fmt::print("using algorithm {}\n", algorithm);
+
+                auto mut_queries = queries;
+                if (config.maxQueries != 0) {
+                    mut_queries.resize(std::min(mut_queries.size(), config.maxQueries));
+                }
+                if (config.readLength != 0) {
+                    for (auto& q : mut_queries) {
+                        q.resize(std::min(config.readLength, q.size()));
+                    }
+                }
+
+                auto memory = [&] () -> size_t {
+                    if constexpr (OccTableMemoryUsage<Table>) {
+                        return index.memoryUsage();
+                    } else {
+                        return 0ull;
+                    }
+                }();
+                for (size_t k{config.minK}; k <= config.maxK; k = k + config.k_stepSize) {
+                    auto cachedScheme = schemeCache.scheme(config.generator, 0, k);
+
+                    size_t resultCt{};
+                    StopWatch sw;
+                    auto results       = std::vector<std::tuple<size_t, bool, size_t, size_t, size_t>>{};
+                    auto resultCursors = std::vector<std::tuple<size_t, RCBiFMIndexCursor<decltype(index)>, size_t>>{};
+
+                    auto res_cb = [&](size_t queryId, auto cursor, size_t errors) {
+                        resultCursors.emplace_back(queryId, cursor, errors);
+                    };
+                    if (config.mode == Config::Mode::All) {
+                        if (config.maxHitsPerQuery == 0) search_ng21::search(index, mut_queries, cachedScheme, res_cb);
+                        else                             search_ng21::search_n(index, mut_queries, cachedScheme, config.maxHitsPerQuery, res_cb);
+                    } else if (config.mode == Config::Mode::BestHits) {
+                        if (config.maxHitsPerQuery == 0) search_ng21::search_best(index, mut_queries, cachedScheme, res_cb);
+                        else                             search_ng21::search_best_n(index, mut_queries, cachedScheme, config.maxHitsPerQuery, res_cb);
+                    }
+                    auto time_search = sw.reset();
+
+                    // Each hit is found on both strands. Only the hits on the references are
+                    // reported, the cursor for the query itself and reverseComplement() for the
+                    // reverse complement of the query, which no longer has to be searched.
+                    for (auto const& [queryId, cursor, e] : resultCursors) {
+                        for (auto [seqId, pos] : LocateLinear{index, cursor}) {
+                            if (seqId < refCount) results.emplace_back(queryId, false, seqId, pos, e);
+                        }
+                        for (auto [seqId, pos] : LocateLinear{index, cursor.reverseComplement()}) {
+                            if (seqId < refCount) results.emplace_back(queryId, true, seqId, pos, e);
+                        }
+                        resultCt += cursor.len;
+                    }
+                    auto time_locate = sw.reset();
+
+                    auto uniqueResults = [](auto list) {
+                        std::sort(begin(list), end(list));
+                        list.erase(std::unique(begin(list), end(list)), list.end());
+                        return list;
+                    }(results);
+                    std::unordered_set<size_t> readIds;
+                    for (auto const& [queryId, cursor, e] : resultCursors) {
+                        readIds.insert(queryId);
+                    }
+
+                    fmt::print("{:15} {:3}: {:>10.3}s ({:>10.3}s+{:>10.3}s) {:>10.3}q/s - results: {:>10}/{:>10}/{:>10}/{:>10} - mem: {:>13}\n", name, k, time_search + time_locate, time_search, time_locate, mut_queries.size() / (time_search+time_locate), resultCt, results.size(), uniqueResults.size(), readIds.size(), memory);
+                    if (!config.saveOutput.empty()) {
+                        auto ofs = fopen(config.saveOutput.string().c_str(), "w");
+                        for (auto const& [queryId, reverse, seqId, pos, e] : results) {
+                            fmt::print(ofs, "{} {} {} {}\n", queryId, reverse?'-':'+', seqId, pos);
+                        }
+                        fclose(ofs);
+                    }
+                }
+            }
+        });
+        return 0;
+    }
+
     visitAllTables<Sigma>([&, &queries=queries]<typename Table>() {
         std::string name = Table::extension();
         if (config.extensions.count(name) == 0) return;
@@ -92,6 +187,7 @@ int main(int argc, char const* const* argv) {
         size_t samplingRate = 16;
         auto index = loadDenseIndex<CSA, Table>(config.indexPath, samplingRate, config.threads, config.partialBuildUp, config.convertUnknownChar);
         fmt::print("done\n");
+        auto schemeCache = SearchSchemeCache{index};
         for (auto const& algorithm : config.algorithms) {
             fmt::print("using algorithm {}\n", algorithm);
 
@@ -118,43 +214,21 @@ int main(int argc, char const* const* argv) {
                 /*if (k >= 4 and k != 6) {
                     mut_queries.resize(mut_queries.size() / 10);
                 }*/
+                // search schemes are expanded to the length of the first query, except for ng21 which supports any length
+                auto queryLength = mut_queries[0].size();
                 auto search_scheme = [&]() {
-                    auto iter = search_schemes::generator::all.find(config.generator);
-                    if (iter == search_schemes::generator::all.end()) {
-                        throw std::runtime_error("unknown search scheme generetaror \"" + config.generator + "\"");
-                    }
-                    auto len = mut_queries[0].size();
-                    auto oss = iter->second.generator(0, k, 0, 0); //!TODO last two parameters of second are not being used
-                    auto ess = search_schemes::expand(oss, len);
-                    auto dss = search_schemes::expandByWNC</*Edit=*/true>(oss, len, 4, 3'000'000'000); //!TODO use correct Sigma and text size
-                    fmt::print("ss diff: {} to {}, using dyn: {}\n", search_schemes::weightedNodeCount</*Edit=*/false>(ess, 4, 3'000'000'000), search_schemes::weightedNodeCount</*Edit=*/false>(dss, 4, 3'000'000'000), config.generator_dyn);
-                    if (!config.generator_dyn) {
-                        return ess;
-                    } else {
-                        return dss;
-                    }
+                    auto const& entry = schemeCache.get(config.generator, 0, k, queryLength);
+                    fmt::print("search scheme {}, weighted node count: {}\n", entry.generator, entry.weightedNodeCount);
+                    return entry.scheme;
                 }();
                 auto search_schemes = [&]() {
                     auto r = std::vector<decltype(search_scheme)>{};
                     for (size_t j{0}; j<=k; ++j) {
-                        r.emplace_back([&]() {
-                            auto iter = search_schemes::generator::all.find(config.generator);
-                            if (iter == search_schemes::generator::all.end()) {
-                                throw std::runtime_error("unknown search scheme generetaror \"" + config.generator + "\"");
-                            }
-                            auto len = mut_queries[0].size();
-                            auto oss = iter->second.generator(j, j, 0, 0); //!TODO last two parameters of second are not being used
-                            auto ess = search_schemes::expand(oss, len);
-                            auto dss = search_schemes::expandByWNC</*Edit=*/true>(oss, len, 4, 3'000'000'000); //!TODO use correct Sigma and text size
-                            if (!config.generator_dyn) {
-                                return ess;
-                            } else {
-                                return dss;
-                            }
-                        }());
+                        r.emplace_back(schemeCache.get(config.generator, j, j, queryLength).scheme);
                     }
                     return r;
                 }();
+                auto cachedScheme = schemeCache.scheme(config.generator, 0, k);
 
                 size_t resultCt{};
                 StopWatch sw;
@@ -189,13 +263,22 @@ int main(int argc, char const* const* argv) {
                     else if (algorithm == "ng20") search_ng20::search(index, mut_queries, search_scheme, res_cb);
                     else if (algorithm == "ng21") {
                         if (config.mode == Config::Mode::All) {
-                            if (config.maxHitsPerQuery == 0) search_ng21::search(index, mut_queries, search_scheme, res_cb);
-                            else                             search_ng21::search_n(index, mut_queries, search_scheme, config.maxHitsPerQuery, res_cb);
+                            if (config.maxHitsPerQuery == 0) search_ng21::search(index, mut_queries, cachedScheme, res_cb);
+                            else                             search_ng21::search_n(index, mut_queries, cachedScheme, config.maxHitsPerQuery, res_cb);
+                        } else if (config.mode == Config::Mode::BestHits) {
+                            if (config.maxHitsPerQuery == 0) search_ng21::search_best(index, mut_queries, cachedScheme, res_cb);
+                            else                             search_ng21::search_best_n(index, mut_queries, cachedScheme, config.maxHitsPerQuery, res_cb);
+                        }
+                    }
+                    else if (algorithm == "ng21stratified") {
+                        if (config.mode == Config::Mode::All) {
+                            search_ng21::search_stratified(index, mut_queries, search_scheme, res_cb);
                         } else if (config.mode == Config::Mode::BestHits) {
-                            if (config.maxHitsPerQuery == 0) search_ng21::search_best(index, mut_queries, search_schemes, res_cb);
-                            else                             search_ng21::search_best_n(index, mut_queries, search_schemes, config.maxHitsPerQuery, res_cb);
+                            if (config.maxHitsPerQuery == 0) search_ng21::search_best_stratified(index, mut_queries, search_scheme, res_cb);
+                            else                             search_ng21::search_best_n_stratified(index, mut_queries, search_scheme, config.maxHitsPerQuery, res_cb);
                         }
                     }
+                    else if (algorithm == "ng21batch") search_ng21::search_batch(index, mut_queries, search_scheme, res_cb);
                     else if (algorithm == "ng21v2") search_ng21V2::search(index, mut_queries, search_scheme, res_cb);
                     else if (algorithm == "ng21v3") search_ng21V3::search(index, mut_queries, search_scheme, res_cb);
                     else if (algorithm == "ng21v4") search_ng21V4::search(index, mut_queries, search_scheme, res_cb);
@@ -218,6 +301,7 @@ int main(int argc, char const* const* argv) {
                             else                             search_ng21V7::search_best_n(index, mut_queries, search_scheme, config.maxHitsPerQuery, res_cb);
                         }
                     }
+                    else if (algorithm == "ng21v8") search_ng21V8::search(index, mut_queries, search_scheme, res_cb);
                     else if (algorithm == "ng22") search_ng22::search(index, mut_queries, search_scheme, res_cb2);
                     else if (algorithm == "noerror") search_no_errors::search(index, mut_queries, [&](size_t queryId, auto cursor) {
                         res_cb(queryId, cursor, 0);
@@ -142,6 +142,28 @@ auto loadIndex(std::string path, size_t samplingRate, size_t threadNbr, bool con
     }
 }
 
+template <typename Table>
+auto loadRCIndex(std::string path, size_t samplingRate, size_t threadNbr, bool convertUnknownChar) {
+    auto sw = StopWatch{};
+    auto indexPath = path + "." + Table::extension() + ".rc.index";
+    if (!std::filesystem::exists(indexPath)) {
+        auto [ref, refInfo] = loadQueries<Table::Sigma>(path, false, convertUnknownChar);
+        auto index = fmindex_collection::RCBiFMIndex<Table>{ref, samplingRate, threadNbr};
+        // save index here
+        auto ofs     = std::ofstream{indexPath, std::ios::binary};
+        auto archive = cereal::BinaryOutputArchive{ofs};
+        archive(index);
+        return index;
+    } else {
+        auto ifs     = std::ifstream{indexPath, std::ios::binary};
+        auto archive = cereal::BinaryInputArchive{ifs};
+        auto index = fmindex_collection::RCBiFMIndex<Table>{};
+        archive(index);
+        std::cout << "loading took " << sw.peek() << "s\n";
+        return index;
+    }
+}
+
 template <typename CSA, typename Table>
 auto loadDenseIndex(std::string path, size_t samplingRate, size_t threadNbr, bool partialBuildUp, bool convertUnknownChar) {
     auto sw = StopWatch{};
@@ -175,17 +197,21 @@ auto loadDenseIndex(std::string path, size_t samplingRate, size_t threadNbr, boo
             return std::move(*index);
             #elif 1
             auto refs = std::vector<std::vector<uint8_t>>{};
-            auto index = std::optional<Index>{};
+            auto indices = std::vector<Index>{};
             size_t acc = 0;
+            auto mergeIndices = [&]() {
+                if (indices.size() < 2) return;
+                std::cout << "merging " << indices.size() << " indices\n";
+                auto newIndex = merge(indices, threadNbr);
+                indices.clear();
+                indices.emplace_back(std::move(newIndex));
+            };
             auto makePartialIndex = [&]() {
                 if (refs.empty()) return;
                 std::cout << "indexing " << acc << "\n";
-                auto newIndex = Index{refs, samplingRate, threadNbr};
-                if (!index) {
-                    index = std::move(newIndex);
-                } else {
-                    std::cout << "merging " << index->size() << " + " << acc << "\n";
-                    index = merge(*index, newIndex);
+                indices.emplace_back(refs, samplingRate, threadNbr);
+                if (indices.size() == 256) { // limit of a single k-way merge
+                    mergeIndices();
                 }
 
                 acc = 0;
@@ -199,7 +225,8 @@ auto loadDenseIndex(std::string path, size_t samplingRate, size_t threadNbr, boo
                 acc += refs.back().size();
             }
             makePartialIndex();
-            return std::move(*index);
+            mergeIndices();
+            return std::move(indices.back());
 
             #else
             auto refs = std::vector<std::vector<uint8_t>>{};
@@ -268,6 +295,7 @@ void visitAllTables(CB cb) {
     cb.template operator()<fmindex_collection::occtable::compactBitvectorPrefix::OccTable<Sigma>>();
     cb.template operator()<fmindex_collection::occtable::interleaved8::OccTable<Sigma>>();*/
     cb.template operator()<fmindex_collection::occtable::Interleaved_16<Sigma>>();
+    cb.template operator()<fmindex_collection::occtable::SampleMarked<fmindex_collection::occtable::Interleaved_16<Sigma>>>();
     cb.template operator()<fmindex_collection::occtable::L1Bitvector<Sigma>>();
 /*    cb.template operator()<fmindex_collection::occtable::interleaved32::OccTable<Sigma>>();
     cb.template operator()<fmindex_collection::occtable::interleaved8Aligned::OccTable<Sigma>>();
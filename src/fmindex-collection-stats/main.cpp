@@ -79,6 +79,7 @@ static void analyse_bitvectors() {
         analyse_bitvector<SparseBLEBitvector<2, Bitvector, SparseBLEBitvector<1>>>("SparseBLEBitvector  4/-2", text);
         analyse_bitvector<SparseBLEBitvector<3, Bitvector, SparseBLEBitvector<1>>>("SparseBLEBitvector  8/-2", text);
         analyse_bitvector<SparseBLEBitvector<3, Bitvector, SparseBLEBitvector<2>>>("SparseBLEBitvector  8/-4", text);
+        analyse_bitvector<fmindex_collection::bitvector::SparseBitvector>("SparseBitvector", text);
 
     };
 
@@ -178,10 +179,42 @@ static void analyse_rankvectors() {
     }
 }
 
+/* Generates a string consisting of runs with an average length of `avgRunLength`
+ */
+template <size_t Sigma>
+static auto generateRuns(size_t l, size_t avgRunLength) {
+    auto buffer = std::vector<uint8_t>{};
+    buffer.reserve(l);
+    while (buffer.size() < l) {
+        auto symb = rand() % Sigma;
+        auto len  = 1 + rand() % (2 * avgRunLength - 1);
+        for (size_t i{0}; i < len and buffer.size() < l; ++i) {
+            buffer.push_back(symb);
+        }
+    }
+    return buffer;
+}
+
+static void analyse_runlength_rankvectors() {
+    using namespace fmindex_collection::rankvector;
+    constexpr static size_t Sigma = 5;
+    for (auto avgRunLength : {1, 4, 16, 64, 256}) {
+        auto text = generateRuns<Sigma>(my_pow10(7), avgRunLength);
+        auto runs = RLEBwt<Sigma>{text}.runCount();
+        fmt::print("length: {}, runs: {}, average run length: {:.2f}\n", text.size(), runs, double(text.size()) / runs);
+        analyse_rankvector<InterleavedBitvector16<Sigma>>("InterleavedBitvector16", text);
+        analyse_rankvector<RBBwt<Sigma, 4>>("RBBwt 4", text);
+        analyse_rankvector<RLEBwt<Sigma>>("RLEBwt", text);
+    }
+}
+
 int main() {
     fmt::print("analyse bitvectors:\n");
     analyse_bitvectors();
 
     fmt::print("\nanalyse rankvectors:\n");
     analyse_rankvectors();
+
+    fmt::print("\nanalyse run length encoded rankvectors:\n");
+    analyse_runlength_rankvectors();
 }
@@ -3,6 +3,9 @@
 // SPDX-License-Identifier: BSD-3-Clause
 #pragma once
 
+#include "MMapAllocator.h"
+#include "builtins.h"
+
 #include <cassert>
 #include <cmath>
 #include <cstddef>
@@ -20,7 +23,7 @@ namespace fmindex_collection {
  *
  */
 struct DenseVector {
-    std::vector<uint64_t> data; // buffer where the data is being stored
+    MMapVector<uint64_t> data; // buffer where the data is being stored
     size_t bitCount{};          // numbers of used bits
     size_t bits{};              // number of bits per entry
 
@@ -120,6 +123,12 @@ struct DenseVector {
         return (p1 | p2) & mask;
     }
 
+    /** Prefetch the memory of the integer at a certain position
+     */
+    void prefetch(size_t i) const {
+        __builtin_prefetch(reinterpret_cast<void const*>(&data[(i * bits) / 64]), 0, 0);
+    }
+
     size_t size() const {
         return bitCount / bits; // Always a whole number
     }
@@ -0,0 +1,339 @@
+// SPDX-FileCopyrightText: 2006-2023, Knut Reinert & Freie Universität Berlin
+// SPDX-FileCopyrightText: 2016-2023, Knut Reinert & MPI für molekulare Genetik
+// SPDX-License-Identifier: BSD-3-Clause
+#pragma once
+
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+#if __has_include(<sys/mman.h>)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define FMC_MMAP 1
+#endif
+
+#if FMC_MMAP && defined(__linux__)
+#define FMC_HUGE_PAGES 1
+#endif
+
+namespace fmindex_collection {
+
+/**!\brief A read only memory mapped file
+ *
+ * The file is mapped as shared memory, multiple processes mapping the same
+ * file share the same pages of the page cache.
+ * On platforms without mmap (e.g. windows) creating a MMapFile throws.
+ */
+struct MMapFile {
+    void const* data{};
+    size_t      size{};
+
+#if FMC_MMAP
+    MMapFile(std::filesystem::path const& path) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd == -1) {
+            throw std::runtime_error{"fmindex-collection - could not open file " + path.string()};
+        }
+        struct stat st{};
+        if (::fstat(fd, &st) == -1) {
+            ::close(fd);
+            throw std::runtime_error{"fmindex-collection - could not read size of file " + path.string()};
+        }
+        size = st.st_size;
+        if (size > 0) {
+            auto ptr = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+            if (ptr == MAP_FAILED) {
+                ::close(fd);
+                throw std::runtime_error{"fmindex-collection - could not mmap file " + path.string()};
+            }
+            data = ptr;
+        }
+        ::close(fd);
+    }
+    MMapFile(MMapFile const&) = delete;
+    MMapFile(MMapFile&&) = delete;
+    auto operator=(MMapFile const&) -> MMapFile& = delete;
+    auto operator=(MMapFile&&) -> MMapFile& = delete;
+
+    ~MMapFile() {
+        if (data) {
+            ::munmap(const_cast<void*>(data), size);
+        }
+    }
+#else
+    MMapFile(std::filesystem::path const&) {
+        throw std::runtime_error{"fmindex-collection - mmap unsupported on this platform"};
+    }
+    MMapFile(MMapFile const&) = delete;
+    MMapFile(MMapFile&&) = delete;
+    auto operator=(MMapFile const&) -> MMapFile& = delete;
+    auto operator=(MMapFile&&) -> MMapFile& = delete;
+#endif
+};
+
+/**!\brief Page policy of large allocations of all index containers (MMapVector)
+ *
+ * Random rank queries over large indices are dominated by TLB misses. Backing the
+ * containers with huge pages reduces the number of required TLB entries by a factor
+ * of 512 (2MB pages) or 512*512 (1GB pages).
+ * Huge pages are only supported on linux, on other platforms all policies behave like `Default`.
+ */
+enum class PagePolicy : uint8_t {
+    Default,     // std::allocator
+    Transparent, // 2MB aligned anonymous memory, marked with madvise(MADV_HUGEPAGE)
+    Huge2MB,     // explicit 2MB huge pages (see /proc/sys/vm/nr_hugepages), falls back to Transparent
+    Huge1GB,     // explicit 1GB huge pages, falls back to Transparent
+};
+
+namespace huge_pages {
+
+inline constexpr size_t PageSize2MB = size_t{1} << 21;
+inline constexpr size_t PageSize1GB = size_t{1} << 30;
+
+inline auto name(PagePolicy policy) -> std::string_view {
+    switch (policy) {
+    case PagePolicy::Default:     return "default";
+    case PagePolicy::Transparent: return "transparent";
+    case PagePolicy::Huge2MB:     return "huge 2MB";
+    case PagePolicy::Huge1GB:     return "huge 1GB";
+    }
+    return "unknown";
+}
+
+/**!\brief Policy in use for new allocations
+ *
+ * Can be changed at any time, memory that is already allocated is not affected.
+ */
+inline std::atomic<PagePolicy> active{PagePolicy::Default};
+
+/**!\brief Allocations smaller than this are never placed on huge pages
+ *
+ * Same as `active`, only affects new allocations.
+ */
+inline std::atomic<size_t> minSize{PageSize2MB};
+
+/**!\brief Selects the page policy of new allocations, memory that is already allocated is not affected
+ */
+inline void select(PagePolicy policy) {
+    active.store(policy, std::memory_order_relaxed);
+}
+
+namespace detail {
+
+#if FMC_HUGE_PAGES
+// number of mappings that are currently in use, allows deallocate to skip the registry
+inline std::atomic<size_t> mappingCount{0};
+
+// start and length of all mappings that are currently in use
+inline auto registry() -> std::tuple<std::mutex&, std::unordered_map<void*, size_t>&> {
+    static auto mutex    = std::mutex{};
+    static auto mappings = std::unordered_map<void*, size_t>{};
+    return {mutex, mappings};
+}
+
+inline auto roundUp(size_t v, size_t alignment) -> size_t {
+    return (v + alignment - 1) / alignment * alignment;
+}
+
+inline auto mapHugeTLB([[maybe_unused]] size_t bytes, [[maybe_unused]] size_t pageSize) -> std::tuple<void*, size_t> {
+#if defined(MAP_HUGETLB) && defined(MAP_HUGE_SHIFT)
+    auto len   = roundUp(bytes, pageSize);
+    int  flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | (std::countr_zero(pageSize) << MAP_HUGE_SHIFT);
+    auto ptr   = ::mmap(nullptr, len, PROT_READ | PROT_WRITE, flags, -1, 0);
+    if (ptr != MAP_FAILED) {
+        return {ptr, len};
+    }
+#endif
+    return {nullptr, 0};
+}
+
+inline auto mapTransparent(size_t bytes) -> std::tuple<void*, size_t> {
+    auto len = roundUp(bytes, PageSize2MB);
+    // over allocate, so the mapping can be trimmed to a 2MB aligned region
+    auto ptr = ::mmap(nullptr, len + PageSize2MB, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ptr == MAP_FAILED) {
+        throw std::bad_alloc{};
+    }
+    auto start   = reinterpret_cast<uintptr_t>(ptr);
+    auto aligned = roundUp(start, PageSize2MB);
+    if (aligned > start) {
+        ::munmap(ptr, aligned - start);
+    }
+    if (auto tail = start + len + PageSize2MB - (aligned + len); tail > 0) {
+        ::munmap(reinterpret_cast<void*>(aligned + len), tail);
+    }
+#ifdef MADV_HUGEPAGE
+    ::madvise(reinterpret_cast<void*>(aligned), len, MADV_HUGEPAGE);
+#endif
+    return {reinterpret_cast<void*>(aligned), len};
+}
+#endif
+
+}
+
+/**!\brief Allocates memory according to the active policy
+ *
+ * \return nullptr, if the allocation should be done by std::allocator
+ */
+inline auto allocate([[maybe_unused]] size_t bytes) -> void* {
+#if FMC_HUGE_PAGES
+    auto policy = active.load(std::memory_order_relaxed);
+    if (policy == PagePolicy::Default || bytes < minSize.load(std::memory_order_relaxed)) {
+        return nullptr;
+    }
+    void*  ptr{};
+    size_t len{};
+    if (policy == PagePolicy::Huge1GB) {
+        std::tie(ptr, len) = detail::mapHugeTLB(bytes, PageSize1GB);
+    } else if (policy == PagePolicy::Huge2MB) {
+        std::tie(ptr, len) = detail::mapHugeTLB(bytes, PageSize2MB);
+    }
+    if (!ptr) {
+        std::tie(ptr, len) = detail::mapTransparent(bytes);
+    }
+    auto [mutex, mappings] = detail::registry();
+    auto g = std::lock_guard{mutex};
+    mappings.try_emplace(ptr, len);
+    detail::mappingCount.fetch_add(1, std::memory_order_release);
+    return ptr;
+#else
+    return nullptr;
+#endif
+}
+
+/**!\brief Releases memory that was allocated by `allocate`
+ *
+ * Ownership is decided by the registry only, `minSize` and `active` might have changed since
+ * the memory was allocated.
+ * \return false, if the memory was not allocated by `allocate`
+ */
+inline bool deallocate([[maybe_unused]] void* ptr) noexcept {
+#if FMC_HUGE_PAGES
+    if (detail::mappingCount.load(std::memory_order_acquire) == 0) {
+        return false;
+    }
+    auto [mutex, mappings] = detail::registry();
+    auto g = std::lock_guard{mutex};
+    auto iter = mappings.find(ptr);
+    if (iter == mappings.end()) {
+        return false;
+    }
+    ::munmap(ptr, iter->second);
+    mappings.erase(iter);
+    detail::mappingCount.fetch_sub(1, std::memory_order_relaxed);
+    return true;
+#else
+    return false;
+#endif
+}
+
+}
+
+/**!\brief Allocator that can adopt memory of a memory mapped file
+ *
+ * Behaves like std::allocator (respecting `huge_pages::active`), unless it was created with `adopt`.
+ * In that case the first allocation returns the memory mapped region and
+ * constructing or destroying elements inside of it is a no-op. The allocator
+ * keeps the memory mapping alive.
+ *
+ * Memory that was adopted is read only, vectors using it must not be modified.
+ */
+template <typename T>
+struct MMapAllocator {
+    using value_type = T;
+
+    using propagate_on_container_copy_assignment = std::true_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap            = std::true_type;
+
+    std::shared_ptr<MMapFile const> file{};
+    T*     adopted{};
+    size_t adoptedSize{};
+
+    MMapAllocator() noexcept = default;
+    template <typename U>
+    MMapAllocator(MMapAllocator<U> const&) noexcept {}
+
+    static auto adopt(std::shared_ptr<MMapFile const> file, T const* ptr, size_t size) -> MMapAllocator {
+        auto alloc = MMapAllocator{};
+        alloc.file        = std::move(file);
+        alloc.adopted     = const_cast<T*>(ptr);
+        alloc.adoptedSize = size;
+        return alloc;
+    }
+
+    auto select_on_container_copy_construction() const -> MMapAllocator {
+        return MMapAllocator{};
+    }
+
+    bool isAdopted(void const* p) const noexcept {
+        return adopted
+            && static_cast<T const*>(p) >= adopted
+            && static_cast<T const*>(p) < adopted + adoptedSize;
+    }
+
+    auto allocate(size_t n) -> T* {
+        if (adopted && n == adoptedSize && !inUse) {
+            inUse = true;
+            return adopted;
+        }
+        if (auto ptr = huge_pages::allocate(n * sizeof(T))) {
+            return static_cast<T*>(ptr);
+        }
+        return std::allocator<T>{}.allocate(n);
+    }
+
+    void deallocate(T* p, size_t n) noexcept {
+        if (p == adopted) {
+            return;
+        }
+        if (huge_pages::deallocate(p)) {
+            return;
+        }
+        std::allocator<T>{}.deallocate(p, n);
+    }
+
+    template <typename U, typename ...Args>
+    void construct(U* p, Args&&... args) {
+        if (isAdopted(p)) {
+            return;
+        }
+        std::construct_at(p, std::forward<Args>(args)...);
+    }
+
+    template <typename U>
+    void destroy(U* p) {
+        if (isAdopted(p)) {
+            return;
+        }
+        std::destroy_at(p);
+    }
+
+    friend bool operator==(MMapAllocator const& lhs, MMapAllocator const& rhs) noexcept {
+        return lhs.adopted == rhs.adopted;
+    }
+
+private:
+    bool inUse{};
+};
+
+/**!\brief A std::vector, that can be loaded without copying from a memory mapped file
+ */
+template <typename T>
+using MMapVector = std::vector<T, MMapAllocator<T>>;
+
+}
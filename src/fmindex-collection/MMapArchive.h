@@ -0,0 +1,353 @@
+// SPDX-FileCopyrightText: 2006-2023, Knut Reinert & Freie Universität Berlin
+// SPDX-FileCopyrightText: 2016-2023, Knut Reinert & MPI für molekulare Genetik
+// SPDX-License-Identifier: BSD-3-Clause
+#pragma once
+
+#include "MMapAllocator.h"
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+/**
+ * A binary format, that can be memory mapped.
+ *
+ * The format is written by the same `serialize`, `save` and `load` functions
+ * that are used by cereal. The content of vectors over trivially copyable types
+ * are stored 64 byte aligned, when loading they are not copied but point
+ * directly into the memory mapped file (if the vector is a `MMapVector`).
+ *
+ * The format is not portable, it depends on the layout of the types in memory.
+ * A header with a format version, the endianness and a signature of the type
+ * guards against loading incompatible files.
+ */
+namespace fmindex_collection {
+
+namespace mmap_detail {
+
+template <typename T>
+struct is_vector : std::false_type {};
+template <typename T, typename A>
+struct is_vector<std::vector<T, A>> : std::true_type {};
+
+template <typename T>
+struct is_array : std::false_type {};
+template <typename T, size_t N>
+struct is_array<std::array<T, N>> : std::true_type {};
+
+template <typename T, typename Archive>
+concept HasSerialize = requires(T& t, Archive& ar) {
+    t.serialize(ar);
+};
+
+template <typename T, typename Archive>
+concept HasSave = requires(T const& t, Archive& ar) {
+    t.save(ar);
+};
+
+template <typename T, typename Archive>
+concept HasLoad = requires(T& t, Archive& ar) {
+    t.load(ar);
+};
+
+template <typename T>
+concept RawVector = is_vector<T>::value
+                    && std::is_trivially_copyable_v<typename T::value_type>
+                    && !std::same_as<typename T::value_type, bool>;
+
+template <typename T>
+concept ElementwiseArray = is_array<T>::value && !std::is_trivially_copyable_v<T>;
+
+template <typename>
+inline constexpr bool dependent_false = false;
+
+inline constexpr size_t   VectorAlignment = 64;
+inline constexpr uint64_t FormatVersion   = 1;
+inline constexpr uint64_t Endianness      = 0x0102030405060708ull;
+inline constexpr std::array<char, 8> Magic{'F', 'M', 'C', 'M', 'M', 'A', 'P', '\0'};
+
+}
+
+/**!\brief Computes a signature over the serialized structure of a type
+ *
+ * Walks through the `serialize`/`save` functions of a default constructed object
+ * and hashes the size and alignment of every stored value.
+ */
+class MMapSignatureArchive {
+    uint64_t hash{0xcbf29ce484222325ull};
+
+    void mix(uint64_t v) {
+        hash = (hash ^ v) * 0x100000001b3ull;
+    }
+
+public:
+    template <typename ...Ts>
+    void operator()(Ts const&... ts) {
+        (visit(ts), ...);
+    }
+
+    auto value() const -> uint64_t {
+        return hash;
+    }
+
+    template <typename T>
+    void visit(T const& t) {
+        using namespace mmap_detail;
+        if constexpr (RawVector<T>) {
+            using V = typename T::value_type;
+            mix('v');
+            mix(sizeof(V));
+            mix(alignof(V));
+        } else if constexpr (is_vector<T>::value) {
+            mix('V');
+            visit(typename T::value_type{});
+        } else if constexpr (ElementwiseArray<T>) {
+            mix('a');
+            mix(std::tuple_size_v<T>);
+            visit(typename T::value_type{});
+        } else if constexpr (HasSerialize<T, MMapSignatureArchive>) {
+            mix('s');
+            const_cast<T&>(t).serialize(*this);
+            mix('e');
+        } else if constexpr (HasSave<T, MMapSignatureArchive>) {
+            mix('s');
+            t.save(*this);
+            mix('e');
+        } else if constexpr (std::is_trivially_copyable_v<T>) {
+            mix(sizeof(T));
+            mix(alignof(T));
+        } else {
+            static_assert(dependent_false<T>, "type can not be stored in mmap format");
+        }
+    }
+};
+
+/**!\brief Archive writing the mmap format into a stream
+ */
+class MMapOutputArchive {
+    std::ostream& ostr;
+    uint64_t      offset{};
+
+public:
+    explicit MMapOutputArchive(std::ostream& _ostr)
+        : ostr{_ostr}
+    {}
+
+    template <typename ...Ts>
+    void operator()(Ts const&... ts) {
+        (write(ts), ...);
+    }
+
+    void align(size_t alignment) {
+        static constexpr auto zeros = std::array<char, mmap_detail::VectorAlignment>{};
+        auto padding = (alignment - offset % alignment) % alignment;
+        writeBytes(zeros.data(), padding);
+    }
+
+    void writeBytes(void const* data, size_t size) {
+        ostr.write(reinterpret_cast<char const*>(data), size);
+        offset += size;
+    }
+
+    template <typename T>
+    void write(T const& t) {
+        using namespace mmap_detail;
+        if constexpr (RawVector<T>) {
+            using V = typename T::value_type;
+            write(uint64_t{t.size()});
+            align(VectorAlignment);
+            writeBytes(t.data(), t.size() * sizeof(V));
+        } else if constexpr (is_vector<T>::value) {
+            write(uint64_t{t.size()});
+            for (auto const& v : t) {
+                write(v);
+            }
+        } else if constexpr (ElementwiseArray<T>) {
+            for (auto const& v : t) {
+                write(v);
+            }
+        } else if constexpr (HasSerialize<T, MMapOutputArchive>) {
+            const_cast<T&>(t).serialize(*this);
+        } else if constexpr (HasSave<T, MMapOutputArchive>) {
+            t.save(*this);
+        } else if constexpr (std::is_trivially_copyable_v<T>) {
+            align(alignof(T));
+            writeBytes(&t, sizeof(T));
+        } else {
+            static_assert(dependent_false<T>, "type can not be stored in mmap format");
+        }
+    }
+};
+
+/**!\brief Archive reading the mmap format from a memory mapped file
+ *
+ * Vectors of type `MMapVector` over trivially copyable types point
+ * directly into the mapped memory, all other types are copied.
+ */
+class MMapInputArchive {
+    std::shared_ptr<MMapFile const> file;
+    uint64_t                        offset{};
+
+    auto base() const -> uint8_t const* {
+        return static_cast<uint8_t const*>(file->data);
+    }
+
+public:
+    explicit MMapInputArchive(std::shared_ptr<MMapFile const> _file)
+        : file{std::move(_file)}
+    {}
+
+    template <typename ...Ts>
+    void operator()(Ts&&... ts) {
+        (read(ts), ...);
+    }
+
+    auto remaining() const -> size_t {
+        return file->size - offset;
+    }
+
+    void align(size_t alignment) {
+        auto padding = (alignment - offset % alignment) % alignment;
+        skip(padding);
+    }
+
+    auto skip(size_t size) -> void const* {
+        if (remaining() < size) {
+            throw std::runtime_error{"fmindex-collection - mmap file is truncated"};
+        }
+        auto ptr = base() + offset;
+        offset += size;
+        return ptr;
+    }
+
+    template <typename T>
+    void read(T& t) {
+        using namespace mmap_detail;
+        if constexpr (RawVector<T>) {
+            using V = typename T::value_type;
+            using A = typename T::allocator_type;
+            auto size = uint64_t{};
+            read(size);
+            align(VectorAlignment);
+            if (size > remaining() / sizeof(V)) {
+                throw std::runtime_error{"fmindex-collection - mmap file is truncated"};
+            }
+            auto ptr = static_cast<V const*>(skip(size * sizeof(V)));
+            if constexpr (std::same_as<A, MMapAllocator<V>>) {
+                if (size == 0) {
+                    t = T{};
+                } else {
+                    t = T(size, MMapAllocator<V>::adopt(file, ptr, size));
+                }
+            } else {
+                t.assign(ptr, ptr + size);
+            }
+        } else if constexpr (is_vector<T>::value) {
+            auto size = uint64_t{};
+            read(size);
+            if (size > remaining()) {
+                throw std::runtime_error{"fmindex-collection - mmap file is truncated"};
+            }
+            t.clear();
+            t.resize(size);
+            for (auto& v : t) {
+                read(v);
+            }
+        } else if constexpr (ElementwiseArray<T>) {
+            for (auto& v : t) {
+                read(v);
+            }
+        } else if constexpr (HasSerialize<T, MMapInputArchive>) {
+            t.serialize(*this);
+        } else if constexpr (HasLoad<T, MMapInputArchive>) {
+            t.load(*this);
+        } else if constexpr (std::is_trivially_copyable_v<T>) {
+            align(alignof(T));
+            std::memcpy(&t, skip(sizeof(T)), sizeof(T));
+        } else {
+            static_assert(dependent_false<T>, "type can not be loaded from mmap format");
+        }
+    }
+};
+
+/**!\brief Signature of the stored structure of type T
+ */
+template <typename T>
+auto mmapSignature() -> uint64_t {
+    auto ar = MMapSignatureArchive{};
+    ar(uint64_t{sizeof(T)});
+    ar(T{});
+    return ar.value();
+}
+
+/**!\brief Saves an object (e.g. an FMIndex or BiFMIndex) in the mmap format
+ *
+ * \param t object to store
+ * \param path file to write
+ */
+template <typename T>
+void saveMMap(T const& t, std::filesystem::path const& path) {
+    auto ofs = std::ofstream{path, std::ios::binary};
+    if (!ofs) {
+        throw std::runtime_error{"fmindex-collection - could not open file " + path.string()};
+    }
+    auto ar = MMapOutputArchive{ofs};
+    ar(mmap_detail::Magic, mmap_detail::FormatVersion, mmap_detail::Endianness, mmapSignature<T>());
+    ar(t);
+    if (!ofs) {
+        throw std::runtime_error{"fmindex-collection - failed writing file " + path.string()};
+    }
+}
+
+/**!\brief Loads an object, that was stored with `saveMMap`
+ *
+ * The file is memory mapped. Large parts of the object are not copied,
+ * but are read on demand from the file (shared between multiple processes).
+ * The file stays mapped until the object is destroyed.
+ * Throws on platforms without mmap support.
+ *
+ * \param path file to read
+ * \return the loaded object
+ */
+template <typename T>
+auto loadMMap(std::filesystem::path const& path) -> T {
+#if !FMC_MMAP
+    throw std::runtime_error{"fmindex-collection - mmap unsupported on this platform, can not load " + path.string()};
+#else
+    auto ar = MMapInputArchive{std::make_shared<MMapFile const>(path)};
+    auto magic      = std::array<char, 8>{};
+    auto version    = uint64_t{};
+    auto endianness = uint64_t{};
+    auto signature  = uint64_t{};
+    ar(magic);
+    if (magic != mmap_detail::Magic) {
+        throw std::runtime_error{"fmindex-collection - not a mmap index file " + path.string()};
+    }
+    ar(version, endianness, signature);
+    if (version != mmap_detail::FormatVersion) {
+        throw std::runtime_error{"fmindex-collection - unsupported mmap format version " + std::to_string(version)};
+    }
+    if (endianness != mmap_detail::Endianness) {
+        throw std::runtime_error{"fmindex-collection - mmap file was written on a machine with different endianness"};
+    }
+    if (signature != mmapSignature<T>()) {
+        throw std::runtime_error{"fmindex-collection - mmap file stores a different type"};
+    }
+    auto t = T{};
+    ar(t);
+    if (ar.remaining() != 0) {
+        throw std::runtime_error{"fmindex-collection - mmap file has unexpected trailing data"};
+    }
+    return t;
+#endif
+}
+
+}
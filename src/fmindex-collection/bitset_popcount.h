@@ -2,6 +2,8 @@
 //SPDX-License-Identifier: BSD-3-Clause
 #pragma once
 
+#include "cpu_dispatch.h"
+
 #include <array>
 #include <bitset>
 #include <cstdint>
@@ -45,22 +47,137 @@ std::array<std::bitset<N>, N*2+1> const signed_rightshift_masks = []() {
     return m;
 }();
 
+namespace bitset_detail {
+/* Wide bitsets are counted by the kernels of `cpu_dispatch`, unless the build already targets
+ * a fast popcount. Bitsets of one or two words are always counted inline, a call costs more
+ * than the count (see `with_popcnt`). The kernels read the words of std::bitset directly.
+ */
+template <size_t N>
+constexpr bool hasWordLayout = N % 64 == 0 && sizeof(std::bitset<N>) == N/8;
+
+template <size_t N>
+constexpr bool useDispatch = []() {
+#if !FMC_CPU_DISPATCH || __AVX512VPOPCNTDQ__
+    return false;
+#else
+    return hasWordLayout<N> && N >= 256;
+#endif
+}();
+
+template <size_t N>
+auto words(std::bitset<N> const& b) -> uint64_t const* {
+    return reinterpret_cast<uint64_t const*>(&b);
+}
+
+#if FMC_CPU_DISPATCH && !__POPCNT__
+// everything called by `f` is inlined and compiled with the popcnt instruction
+template <typename F>
+[[gnu::target("popcnt"), gnu::flatten]]
+auto call_popcnt(F const& f) {
+    return f();
+}
+#endif
+}
+
+/**!\brief Calls `f`, compiled with the popcnt instruction if `kernels` supports it
+ *
+ * Popcounts of one or two words are computed inline, a kernel call costs more than the count.
+ * Instead, rank vectors wrap each query into this function, it is compiled a second time for
+ * the popcnt instruction and picked by the kernels that the rank vector selected.
+ */
+template <typename F>
+[[gnu::always_inline]]
+inline auto with_popcnt(cpu_dispatch::Kernels const* kernels, F const& f) {
+#if FMC_CPU_DISPATCH && !__POPCNT__
+    if (kernels && kernels->level >= cpu_dispatch::Level::Popcnt) {
+        return bitset_detail::call_popcnt(f);
+    }
+#else
+    (void)kernels;
+#endif
+    return f();
+}
+
+/**!\brief Number of set bits
+ *
+ * \param kernels kernels selected by the rank vector (see `cpu_dispatch::current`), nullptr counts inline
+ */
+template <size_t N>
+size_t popcount(std::bitset<N> const& b, cpu_dispatch::Kernels const* kernels = nullptr) {
+    if constexpr (bitset_detail::useDispatch<N>) {
+        if (kernels) {
+            return kernels->popcount(bitset_detail::words(b), N/64);
+        }
+    }
+    return b.count();
+}
+
+/**!\brief Number of bits set in `a` and `b`
+ */
+template <size_t N>
+size_t popcount_and(std::bitset<N> const& a, std::bitset<N> const& b, cpu_dispatch::Kernels const* kernels = nullptr) {
+    if constexpr (bitset_detail::useDispatch<N>) {
+        if (kernels) {
+            return kernels->popcount_and(bitset_detail::words(a), bitset_detail::words(b), N/64);
+        }
+    }
+    return (a & b).count();
+}
+
+/**!\brief Occurrences of each symbol encoded by up to three bit planes, only bits set in `mask` are counted
+ *
+ * Computes all symbols in a single call of `cpu_dispatch::Kernels::symbol_counts3`, or inline if `kernels` is nullptr.
+ * \return the occurrences of symbol `symb` are at `[symb]`
+ */
+template <size_t Planes>
+auto symbol_counts3(std::array<uint64_t, Planes> const& planes, uint64_t mask, cpu_dispatch::Kernels const* kernels = nullptr) -> std::array<uint64_t, 8> {
+    static_assert(Planes <= 3);
+    auto p = std::array<uint64_t, 3>{};
+    for (size_t i{0}; i < Planes; ++i) {
+        p[i] = planes[i];
+    }
+    auto r = std::array<uint64_t, 8>{};
+    if (kernels) {
+        kernels->symbol_counts3(&p[0], &p[1], &p[2], &mask, 1, r.data());
+    } else {
+        cpu_dispatch::kernels::symbol_counts3_impl(&p[0], &p[1], &p[2], &mask, 1, r.data());
+    }
+    return r;
+}
+
+template <size_t N, size_t Planes>
+auto symbol_counts3(std::array<std::bitset<N>, Planes> const& planes, std::bitset<N> const& mask, cpu_dispatch::Kernels const* kernels = nullptr) -> std::array<uint64_t, 8> {
+    static_assert(Planes <= 3);
+    static_assert(bitset_detail::hasWordLayout<N>);
+    static auto const zero = std::bitset<N>{};
+    auto p = [&](size_t i) {
+        return bitset_detail::words(i < Planes ? planes[i] : zero);
+    };
+    auto r = std::array<uint64_t, 8>{};
+    if (kernels) {
+        kernels->symbol_counts3(p(0), p(1), p(2), bitset_detail::words(mask), N/64, r.data());
+    } else {
+        cpu_dispatch::kernels::symbol_counts3_impl(p(0), p(1), p(2), bitset_detail::words(mask), N/64, r.data());
+    }
+    return r;
+}
+
 template <size_t N>
-size_t lshift_and_count(std::bitset<N> const& b, size_t shift) {
+size_t lshift_and_count(std::bitset<N> const& b, size_t shift, cpu_dispatch::Kernels const* kernels = nullptr) {
     auto const& mask = leftshift_masks<N>[shift];
-    return (b & mask).count();
+    return popcount_and(b, mask, kernels);
 }
 
 template <size_t N>
-size_t rshift_and_count(std::bitset<N> const& b, size_t shift) {
+size_t rshift_and_count(std::bitset<N> const& b, size_t shift, cpu_dispatch::Kernels const* kernels = nullptr) {
     auto const& mask = rightshift_masks<N>[shift];
-    return (b & mask).count();
+    return popcount_and(b, mask, kernels);
 }
 
 template <size_t N>
-size_t signed_rshift_and_count(std::bitset<N> const& b, size_t shift) {
+size_t signed_rshift_and_count(std::bitset<N> const& b, size_t shift, cpu_dispatch::Kernels const* kernels = nullptr) {
     auto const& mask = signed_rightshift_masks<N>[shift];
-    return (b & mask).count();
+    return popcount_and(b, mask, kernels);
 }
 
 
@@ -3,6 +3,8 @@
 // SPDX-License-Identifier: BSD-3-Clause
 #pragma once
 
+#include "../MMapAllocator.h"
+#include "../builtins.h"
 #include "concepts.h"
 
 #include <bitset>
@@ -64,7 +66,7 @@ struct CompactBitvector {
 
     static constexpr size_t Sigma = 2;
 
-    std::vector<Superblock> superblocks{Superblock{}};
+    MMapVector<Superblock> superblocks{Superblock{}};
     size_t                  totalLength{};
 
     template <typename CB>
@@ -134,6 +136,11 @@ struct CompactBitvector {
         return superblocks[superblockId].symbol(bitId);
     }
 
+    void prefetch(size_t idx) const noexcept {
+        auto superblockId = idx / 384;
+        __builtin_prefetch(reinterpret_cast<void const*>(&superblocks[superblockId]), 0, 0);
+    }
+
     uint64_t rank(size_t idx) const noexcept {
         assert(idx <= size());
         auto superblockId = idx / 384;
@@ -3,6 +3,7 @@
 // SPDX-License-Identifier: BSD-3-Clause
 #pragma once
 
+#include "../MMapAllocator.h"
 #include "concepts.h"
 
 #include <array>
@@ -60,7 +61,7 @@ struct CompactBitvector4Blocks {
         }
     };
 
-    std::vector<Superblock> superblocks{};
+    MMapVector<Superblock> superblocks{};
     size_t totalLength{};
 
     template <std::ranges::sized_range range_t>
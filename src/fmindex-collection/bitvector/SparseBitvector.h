@@ -0,0 +1,113 @@
+// SPDX-FileCopyrightText: 2006-2023, Knut Reinert & Freie Universität Berlin
+// SPDX-FileCopyrightText: 2016-2023, Knut Reinert & MPI für molekulare Genetik
+// SPDX-License-Identifier: BSD-3-Clause
+#pragma once
+
+#include "../MMapAllocator.h"
+#include "../builtins.h"
+#include "concepts.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <ranges>
+#include <vector>
+
+namespace fmindex_collection::bitvector {
+
+/**
+ * SparseBitvector stores the positions of the ones.
+ *
+ * The bitvector is divided into buckets of 2^16 bits. For each bucket the
+ * number of ones in front of it is stored, for each one its lower 16bits.
+ * Requires 16bits per one plus 64bits per bucket.
+ *
+ * - rank: binary search over the ones of a single bucket
+ * - select: binary search over the buckets
+ */
+struct SparseBitvector {
+    static constexpr size_t BucketBits = 16;
+
+    MMapVector<uint64_t> buckets{0}; // buckets[i] number of ones in front of bucket i, last entry counts all ones
+    MMapVector<uint16_t> lowBits;    // lower bits of the positions of all ones
+    size_t totalLength{};
+
+    template <typename CB>
+    SparseBitvector(size_t length, CB cb)
+        : SparseBitvector{std::views::iota(size_t{}, length) | std::views::transform([&](size_t i) {
+            return cb(i);
+        })}
+    {}
+
+    template <std::ranges::sized_range range_t>
+        requires std::convertible_to<std::ranges::range_value_t<range_t>, uint8_t>
+    SparseBitvector(range_t&& _range) {
+        buckets.reserve((_range.size() >> BucketBits) + 2);
+        for (auto v : _range) {
+            push_back(v);
+        }
+    }
+
+    SparseBitvector() = default;
+    SparseBitvector(SparseBitvector const&) = default;
+    SparseBitvector(SparseBitvector&&) noexcept = default;
+    auto operator=(SparseBitvector const&) -> SparseBitvector& = default;
+    auto operator=(SparseBitvector&&) noexcept -> SparseBitvector& = default;
+
+    void push_back(bool _value) {
+        auto bucketId = totalLength >> BucketBits;
+        while (buckets.size() < bucketId + 2) {
+            buckets.push_back(lowBits.size());
+        }
+        if (_value) {
+            lowBits.push_back(totalLength & ((1ull << BucketBits) - 1));
+            buckets.back() += 1;
+        }
+        totalLength += 1;
+    }
+
+    size_t size() const noexcept {
+        return totalLength;
+    }
+
+    bool symbol(size_t idx) const noexcept {
+        assert(idx < size());
+        auto bucketId = idx >> BucketBits;
+        auto low      = uint16_t(idx & ((1ull << BucketBits) - 1));
+        return std::binary_search(lowBits.begin() + buckets[bucketId], lowBits.begin() + buckets[bucketId+1], low);
+    }
+
+    void prefetch(size_t idx) const noexcept {
+        auto bucketId = idx >> BucketBits;
+        __builtin_prefetch(reinterpret_cast<void const*>(&buckets[bucketId]), 0, 0);
+    }
+
+    uint64_t rank(size_t idx) const noexcept {
+        assert(idx <= size());
+        auto bucketId = idx >> BucketBits;
+        if (bucketId + 1 >= buckets.size()) {
+            return buckets.back();
+        }
+        auto low   = uint16_t(idx & ((1ull << BucketBits) - 1));
+        auto begin = lowBits.begin() + buckets[bucketId];
+        auto iter  = std::lower_bound(begin, lowBits.begin() + buckets[bucketId+1], low);
+        return buckets[bucketId] + std::distance(begin, iter);
+    }
+
+    /**!\brief position of the nth one, counting from zero
+     */
+    uint64_t select(size_t nth) const noexcept {
+        assert(nth < lowBits.size());
+        auto iter     = std::upper_bound(buckets.begin(), buckets.end(), nth);
+        auto bucketId = std::distance(buckets.begin(), iter) - 1;
+        return (uint64_t(bucketId) << BucketBits) | lowBits[nth];
+    }
+
+    template <typename Archive>
+    void serialize(Archive& ar) {
+        ar(buckets, lowBits, totalLength);
+    }
+};
+static_assert(BitVector_c<SparseBitvector>);
+
+}
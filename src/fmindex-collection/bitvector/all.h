@@ -12,3 +12,4 @@
 #include "DoubleL1_NBitvector.h"
 #include "DoubleL1L2_NBitvector.h"
 #include "SparseBLEBitvector.h"
+#include "SparseBitvector.h"
@@ -3,8 +3,10 @@
 // SPDX-License-Identifier: BSD-3-Clause
 #pragma once
 
+#include <concepts>
 #include <cstdint>
 #include <ranges>
+#include <tuple>
 
 namespace fmindex_collection {
 
@@ -46,5 +48,21 @@ concept Sequences_32 = std::ranges::sized_range<T>
                         {*t.begin()} -> Sequence_32;
                     };
 
+/**!\brief Rank of the symbol at position idx together with the symbol itself
+ *
+ * Works for rank vectors and occ tables. Calls `t.rank_and_symbol(idx)` if available,
+ * which decodes the block only once, otherwise `t.symbol(idx)` and `t.rank(idx, symb)`.
+ *
+ * \return tuple {rank(idx, symbol(idx)), symbol(idx)}
+ */
+template <typename T>
+auto rankAndSymbol(T const& t, uint64_t idx) -> std::tuple<uint64_t, uint64_t> {
+    if constexpr (requires() { { t.rank_and_symbol(idx) } -> std::same_as<std::tuple<uint64_t, uint64_t>>; }) {
+        return t.rank_and_symbol(idx);
+    } else {
+        uint64_t symb = t.symbol(idx);
+        return {t.rank(idx, symb), symb};
+    }
+}
 
 }
@@ -0,0 +1,315 @@
+// SPDX-FileCopyrightText: 2006-2023, Knut Reinert & Freie Universität Berlin
+// SPDX-FileCopyrightText: 2016-2023, Knut Reinert & MPI für molekulare Genetik
+// SPDX-License-Identifier: BSD-3-Clause
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define FMC_CPU_DISPATCH 1
+#include <immintrin.h>
+#endif
+
+/**!\brief Runtime dispatch of the popcount kernels used by the rank vectors
+ *
+ * Binaries are usually compiled for the lowest common instruction set of all
+ * machines they run on. The popcount kernels are compiled for several instruction
+ * sets (`Level`). Each rank vector picks the best kernels supported by the cpu
+ * once, when it is created or loaded, queries never consult global state.
+ * `select` restricts the kernels to a lower level, e.g. for benchmarking each variant.
+ */
+namespace fmindex_collection::cpu_dispatch {
+
+enum class Level : uint8_t {
+    Generic,  // no special instructions
+    Popcnt,   // popcnt instruction
+    AVX2,     // 256bit vectors, popcount via nibble lookup table
+    AVX512,   // 512bit vectors with vpopcntq (AVX512F + AVX512VPOPCNTDQ)
+};
+
+inline auto name(Level level) -> std::string_view {
+    switch (level) {
+    case Level::Generic: return "generic";
+    case Level::Popcnt:  return "popcnt";
+    case Level::AVX2:    return "avx2";
+    case Level::AVX512:  return "avx512";
+    }
+    return "unknown";
+}
+
+/**!\brief Highest level supported by the cpu
+ */
+inline auto detect() -> Level {
+#if FMC_CPU_DISPATCH
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512vpopcntdq")) {
+        return Level::AVX512;
+    }
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt")) {
+        return Level::AVX2;
+    }
+    if (__builtin_cpu_supports("popcnt")) {
+        return Level::Popcnt;
+    }
+#endif
+    return Level::Generic;
+}
+
+namespace kernels {
+
+// Each kernel computes the number of set bits in `a[0..n)`, or in `a[i] & b[i]`.
+
+inline size_t popcount_generic(uint64_t const* a, size_t n) {
+    size_t ct{};
+    for (size_t i{0}; i < n; ++i) {
+        ct += std::popcount(a[i]);
+    }
+    return ct;
+}
+
+inline size_t popcount_and_generic(uint64_t const* a, uint64_t const* b, size_t n) {
+    size_t ct{};
+    for (size_t i{0}; i < n; ++i) {
+        ct += std::popcount(a[i] & b[i]);
+    }
+    return ct;
+}
+
+/* Counts the occurrences of all 8 symbols encoded by three bit planes (symbol bit 0 in `p0`),
+ * counting only bits set in `mask`. `out[symb]` is the count of symbol `symb`.
+ */
+[[gnu::always_inline]]
+inline void symbol_counts3_impl(uint64_t const* p0, uint64_t const* p1, uint64_t const* p2, uint64_t const* mask, size_t n, uint64_t* out) {
+    for (size_t symb{0}; symb < 8; ++symb) {
+        out[symb] = 0;
+    }
+    for (size_t i{0}; i < n; ++i) {
+        auto m = mask[i];
+        uint64_t const x[4] = {~p1[i] & ~p2[i] & m, p1[i] & ~p2[i] & m, ~p1[i] & p2[i] & m, p1[i] & p2[i] & m};
+        for (size_t k{0}; k < 4; ++k) {
+            out[2*k]   += std::popcount(x[k] & ~p0[i]);
+            out[2*k+1] += std::popcount(x[k] & p0[i]);
+        }
+    }
+}
+
+inline void symbol_counts3_generic(uint64_t const* p0, uint64_t const* p1, uint64_t const* p2, uint64_t const* mask, size_t n, uint64_t* out) {
+    symbol_counts3_impl(p0, p1, p2, mask, n, out);
+}
+
+#if FMC_CPU_DISPATCH
+[[gnu::target("popcnt")]]
+inline void symbol_counts3_popcnt(uint64_t const* p0, uint64_t const* p1, uint64_t const* p2, uint64_t const* mask, size_t n, uint64_t* out) {
+    symbol_counts3_impl(p0, p1, p2, mask, n, out);
+}
+
+[[gnu::target("popcnt")]]
+inline size_t popcount_popcnt(uint64_t const* a, size_t n) {
+    size_t ct{};
+    for (size_t i{0}; i < n; ++i) {
+        ct += __builtin_popcountll(a[i]);
+    }
+    return ct;
+}
+
+[[gnu::target("popcnt")]]
+inline size_t popcount_and_popcnt(uint64_t const* a, uint64_t const* b, size_t n) {
+    size_t ct{};
+    for (size_t i{0}; i < n; ++i) {
+        ct += __builtin_popcountll(a[i] & b[i]);
+    }
+    return ct;
+}
+
+// nibble lookup popcount (Muła et al.), counts of each 64bit lane are summed with vpsadbw
+[[gnu::target("avx2,popcnt")]]
+inline auto popcount_avx2_lanes(__m256i v) -> __m256i {
+    auto const lut  = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                       0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    auto const low  = _mm256_set1_epi8(0x0f);
+    auto lo = _mm256_shuffle_epi8(lut, _mm256_and_si256(v, low));
+    auto hi = _mm256_shuffle_epi8(lut, _mm256_and_si256(_mm256_srli_epi16(v, 4), low));
+    return _mm256_sad_epu8(_mm256_add_epi8(lo, hi), _mm256_setzero_si256());
+}
+
+[[gnu::target("avx2,popcnt")]]
+inline size_t popcount_avx2_reduce(__m256i acc) {
+    auto s = _mm_add_epi64(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+    return _mm_cvtsi128_si64(s) + _mm_extract_epi64(s, 1);
+}
+
+[[gnu::target("avx2,popcnt")]]
+inline size_t popcount_avx2(uint64_t const* a, size_t n) {
+    if (n < 4) {
+        return popcount_popcnt(a, n);
+    }
+    auto acc = _mm256_setzero_si256();
+    size_t i{0};
+    for (; i+4 <= n; i += 4) {
+        auto v = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(a + i));
+        acc = _mm256_add_epi64(acc, popcount_avx2_lanes(v));
+    }
+    size_t ct = popcount_avx2_reduce(acc);
+    for (; i < n; ++i) {
+        ct += __builtin_popcountll(a[i]);
+    }
+    return ct;
+}
+
+[[gnu::target("avx2,popcnt")]]
+inline size_t popcount_and_avx2(uint64_t const* a, uint64_t const* b, size_t n) {
+    if (n < 4) {
+        return popcount_and_popcnt(a, b, n);
+    }
+    auto acc = _mm256_setzero_si256();
+    size_t i{0};
+    for (; i+4 <= n; i += 4) {
+        auto va = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(a + i));
+        auto vb = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(b + i));
+        acc = _mm256_add_epi64(acc, popcount_avx2_lanes(_mm256_and_si256(va, vb)));
+    }
+    size_t ct = popcount_avx2_reduce(acc);
+    for (; i < n; ++i) {
+        ct += __builtin_popcountll(a[i] & b[i]);
+    }
+    return ct;
+}
+
+// each 64bit lane handles one symbol, symbols 0-3 in `lo` and 4-7 in `hi`
+[[gnu::target("avx2,popcnt")]]
+inline void symbol_counts3_avx2(uint64_t const* p0, uint64_t const* p1, uint64_t const* p2, uint64_t const* mask, size_t n, uint64_t* out) {
+    auto const f0 = _mm256_setr_epi64x(-1, 0, -1, 0);
+    auto const f1 = _mm256_setr_epi64x(-1, -1, 0, 0);
+    auto lo = _mm256_setzero_si256();
+    auto hi = _mm256_setzero_si256();
+    for (size_t i{0}; i < n; ++i) {
+        auto a  = _mm256_xor_si256(_mm256_set1_epi64x(p0[i]), f0);
+        auto b  = _mm256_xor_si256(_mm256_set1_epi64x(p1[i]), f1);
+        auto ab = _mm256_and_si256(_mm256_and_si256(a, b), _mm256_set1_epi64x(mask[i]));
+        auto c  = _mm256_set1_epi64x(p2[i]);
+        lo = _mm256_add_epi64(lo, popcount_avx2_lanes(_mm256_andnot_si256(c, ab)));
+        hi = _mm256_add_epi64(hi, popcount_avx2_lanes(_mm256_and_si256(c, ab)));
+    }
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), lo);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + 4), hi);
+}
+
+[[gnu::target("avx512f,avx512vpopcntdq,popcnt")]]
+inline size_t popcount_avx512_reduce(__m512i acc) {
+    // not using _mm512_reduce_add_epi64, gcc 12 reports its undefined vectors as uninitialized
+    uint64_t lanes[8];
+    _mm512_storeu_si512(lanes, acc);
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3] + lanes[4] + lanes[5] + lanes[6] + lanes[7];
+}
+
+[[gnu::target("avx512f,avx512vpopcntdq,popcnt")]]
+inline size_t popcount_avx512(uint64_t const* a, size_t n) {
+    if (n == 1) {
+        return __builtin_popcountll(a[0]);
+    }
+    auto acc = _mm512_setzero_si512();
+    for (size_t i{0}; i < n; i += 8) {
+        auto m = static_cast<__mmask8>(n-i >= 8 ? 0xff : (1u << (n-i)) - 1);
+        auto v = _mm512_maskz_loadu_epi64(m, a + i);
+        acc = _mm512_add_epi64(acc, _mm512_popcnt_epi64(v));
+    }
+    return popcount_avx512_reduce(acc);
+}
+
+[[gnu::target("avx512f,avx512vpopcntdq,popcnt")]]
+inline size_t popcount_and_avx512(uint64_t const* a, uint64_t const* b, size_t n) {
+    if (n == 1) {
+        return __builtin_popcountll(a[0] & b[0]);
+    }
+    auto acc = _mm512_setzero_si512();
+    for (size_t i{0}; i < n; i += 8) {
+        auto m  = static_cast<__mmask8>(n-i >= 8 ? 0xff : (1u << (n-i)) - 1);
+        auto va = _mm512_maskz_loadu_epi64(m, a + i);
+        auto vb = _mm512_maskz_loadu_epi64(m, b + i);
+        acc = _mm512_add_epi64(acc, _mm512_popcnt_epi64(_mm512_and_si512(va, vb)));
+    }
+    return popcount_avx512_reduce(acc);
+}
+// each 64bit lane handles one symbol
+[[gnu::target("avx512f,avx512vpopcntdq,popcnt")]]
+inline void symbol_counts3_avx512(uint64_t const* p0, uint64_t const* p1, uint64_t const* p2, uint64_t const* mask, size_t n, uint64_t* out) {
+    auto const f0 = _mm512_setr_epi64(-1, 0, -1, 0, -1, 0, -1, 0);
+    auto const f1 = _mm512_setr_epi64(-1, -1, 0, 0, -1, -1, 0, 0);
+    auto const f2 = _mm512_setr_epi64(-1, -1, -1, -1, 0, 0, 0, 0);
+    auto acc = _mm512_setzero_si512();
+    for (size_t i{0}; i < n; ++i) {
+        auto a = _mm512_xor_si512(_mm512_set1_epi64(p0[i]), f0);
+        auto b = _mm512_xor_si512(_mm512_set1_epi64(p1[i]), f1);
+        auto c = _mm512_xor_si512(_mm512_set1_epi64(p2[i]), f2);
+        auto v = _mm512_and_si512(_mm512_ternarylogic_epi64(a, b, c, 0x80), _mm512_set1_epi64(mask[i]));
+        acc = _mm512_add_epi64(acc, _mm512_popcnt_epi64(v));
+    }
+    _mm512_storeu_si512(out, acc);
+}
+#endif
+
+}
+
+struct Kernels {
+    Level level;
+    size_t (*popcount)(uint64_t const* a, size_t n);
+    size_t (*popcount_and)(uint64_t const* a, uint64_t const* b, size_t n);
+    void   (*symbol_counts3)(uint64_t const* p0, uint64_t const* p1, uint64_t const* p2, uint64_t const* mask, size_t n, uint64_t* out);
+};
+
+namespace detail {
+// indexed by Level, constant initialized
+inline constexpr std::array<Kernels, 4> table = {{
+    {Level::Generic, &kernels::popcount_generic, &kernels::popcount_and_generic, &kernels::symbol_counts3_generic},
+#if FMC_CPU_DISPATCH
+    {Level::Popcnt,  &kernels::popcount_popcnt,  &kernels::popcount_and_popcnt,  &kernels::symbol_counts3_popcnt},
+    {Level::AVX2,    &kernels::popcount_avx2,    &kernels::popcount_and_avx2,    &kernels::symbol_counts3_avx2},
+    {Level::AVX512,  &kernels::popcount_avx512,  &kernels::popcount_and_avx512,  &kernels::symbol_counts3_avx512},
+#else
+    {Level::Generic, &kernels::popcount_generic, &kernels::popcount_and_generic, &kernels::symbol_counts3_generic},
+    {Level::Generic, &kernels::popcount_generic, &kernels::popcount_and_generic, &kernels::symbol_counts3_generic},
+    {Level::Generic, &kernels::popcount_generic, &kernels::popcount_and_generic, &kernels::symbol_counts3_generic},
+#endif
+}};
+
+// upper limit set by `select`
+inline constinit std::atomic<Level> limit{Level::AVX512};
+}
+
+inline auto kernelsFor(Level level) -> Kernels const& {
+    return detail::table[static_cast<size_t>(level)];
+}
+
+/**!\brief Highest level supported by the cpu, detected on first use
+ */
+inline auto detected() -> Level {
+    static Level const level = detect();
+    return level;
+}
+
+/**!\brief Best kernels of this cpu, limited by `select`
+ *
+ * Rank vectors call this once, when they are created or loaded, and keep the result.
+ * A query does not go through this function.
+ */
+inline auto current() -> Kernels const& {
+    return kernelsFor(std::min(detail::limit.load(std::memory_order_relaxed), detected()));
+}
+
+/**!\brief Limits the kernels to `level`
+ *
+ * Only rank vectors created or loaded afterwards are affected.
+ * \return the level actually selected
+ */
+inline auto select(Level level) -> Level {
+    detail::limit.store(level, std::memory_order_relaxed);
+    return current().level;
+}
+
+}
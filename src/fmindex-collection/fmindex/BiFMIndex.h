@@ -3,11 +3,14 @@
 // SPDX-License-Identifier: BSD-3-Clause
 #pragma once
 
+#include "../locate.h"
 #include "../occtable/concepts.h"
 #include "../suffixarray/CSA.h"
 #include "../utils.h"
 
 #include <algorithm>
+#include <exception>
+#include <thread>
 
 namespace fmindex_collection {
 
@@ -15,110 +18,52 @@ template <OccTable Table, SuffixArray_c TCSA = CSA>
 struct BiFMIndex {
     static size_t constexpr Sigma = Table::Sigma;
 
-    Table  occ;
-    Table  occRev;
-    TCSA   csa;
+    using TableRev = occ_unmarked_t<Table>; // sample markers are only needed on the forward table
+
+    Table    occ;
+    TableRev occRev;
+    TCSA     csa;
 
     BiFMIndex() = default;
     BiFMIndex(BiFMIndex&&) noexcept = default;
 
-    BiFMIndex(std::span<uint8_t const> bwt, std::span<uint8_t const> bwtRev, TCSA _csa)
-        : occ{bwt}
-        , occRev{bwtRev}
+    BiFMIndex(std::span<uint8_t const> bwt, std::span<uint8_t const> bwtRev, TCSA _csa, size_t threadNbr = 1)
+        : occ{createOccTable<Table>(bwt, threadNbr)}
+        , occRev{createOccTable<TableRev>(bwtRev, threadNbr)}
         , csa{std::move(_csa)}
     {
         assert(bwt.size() == bwtRev.size());
-        assert(occ.size() == occRev.size());
         if (bwt.size() != bwtRev.size()) {
             throw std::runtime_error("bwt don't have the same size: " + std::to_string(bwt.size()) + " " + std::to_string(bwtRev.size()));
         }
-        if (occ.size() != occRev.size()) {
-            throw std::runtime_error("occ don't have the same size: " + std::to_string(occ.size()) + " " + std::to_string(occRev.size()));
-        }
-        // compute last row
-        auto ct = std::array<uint64_t, Sigma>{};
-        for (auto v : bwt) {
-            ct[v] += 1;
-        }
-        for (size_t i{1}; i < ct.size(); ++i) {
-            ct[i] = ct[i-1] + ct[i];
-        }
-        // check last row is correct
-        for (size_t sym{0}; sym < Sigma; ++sym) {
-            if (occ.rank(occ.size(), sym) != ct[sym]) {
-                auto e = std::string{"Wrong rank for the last entry."}
-                    + " Got different values for forward index."
-                    + " sym: " + std::to_string(sym)
-                    + " got: " + std::to_string(occ.rank(occ.size(), sym))
-                    + " expected: " + std::to_string(ct[sym]);
-                throw std::runtime_error(e);
-            }
-            if (occRev.rank(occRev.size(), sym) != ct[sym]) {
-                auto e = std::string{"Wrong rank for the last entry."}
-                    + " Got different values for reverse index."
-                    + " sym: " + std::to_string(sym)
-                    + " got: " + std::to_string(occRev.rank(occRev.size(), sym))
-                    + " expected: " + std::to_string(ct[sym]);
-                throw std::runtime_error(e);
-            }
-        }
-        if constexpr (requires(Table t) {{ t.hasValue(size_t{}) }; }) {
-            for (size_t i{0}; i < occ.size(); ++i) {
-                if (csa.value(i).has_value()) {
-                    occ.setValue(i);
-                }
-            }
-        }
+        checkAndSetValues(countSymbols(bwt));
     }
 
     /**!\brief Creates a BiFMIndex with a specified sampling rate
+     *
+     * The forward occ table is build on a separate thread, while the bwt of the
+     * reversed text is computed. The bwt of the reversed text is written
+     * into the memory of its suffix array. At most one suffix array is alive.
+     *
+     * During this phase the threads are split, half of them construct the forward
+     * occ table, the others the suffix array and the occ table of the reversed text.
+     * At most `threadNbr` threads are used, with a single thread both are done one after another.
+     *
+     * Peak memory is about (w+2) bytes per input character plus the size of the
+     * forward occ table and the csa, with w = 4 for inputs shorter than 2^31 characters
+     * and w = 8 otherwise (text + suffix array + bwt).
      *
      * \param _input a list of sequences
      * \param samplingRate rate of the sampling
+     * \param threadNbr number of threads used to construct the suffix arrays and occ tables
      */
     BiFMIndex(Sequences auto const& _input, size_t samplingRate, size_t threadNbr) {
         auto [totalSize, inputText, inputSizes] = createSequences(_input);
 
         if (totalSize < std::numeric_limits<int32_t>::max()) { // only 32bit SA required
-            // create BurrowsWheelerTransform and CompressedSuffixArray
-            auto [bwt, csa] = [&, &inputText=inputText, &inputSizes=inputSizes] () {
-                auto sa  = createSA32(inputText, threadNbr);
-                auto bwt = createBWT32(inputText, sa);
-                auto csa = TCSA(std::move(sa), samplingRate, inputSizes);
-                return std::make_tuple(std::move(bwt), std::move(csa));
-            }();
-
-            // create BurrowsWheelerTransform on reversed text
-            auto bwtRev = [&, &inputText=inputText]() {
-                std::ranges::reverse(inputText);
-                auto saRev  = createSA32(inputText, threadNbr);
-                auto bwtRev = createBWT32(inputText, saRev);
-                return bwtRev;
-            }();
-
-            decltype(inputText){}.swap(inputText); // inputText memory can be deleted
-
-            *this = BiFMIndex{bwt, bwtRev, std::move(csa)};
+            construct<uint32_t>(std::move(inputText), inputSizes, samplingRate, threadNbr);
         } else { // required 64bit SA required
-            // create BurrowsWheelerTransform and CompressedSuffixArray
-            auto [bwt, csa] = [&, &inputText=inputText, &inputSizes=inputSizes] () {
-                auto sa  = createSA64(inputText, threadNbr);
-                auto bwt = createBWT64(inputText, sa);
-                auto csa = TCSA(std::move(sa), samplingRate, inputSizes);
-                return std::make_tuple(std::move(bwt), std::move(csa));
-            }();
-
-            // create BurrowsWheelerTransform on reversed text
-            auto bwtRev = [&, &inputText=inputText]() {
-                std::ranges::reverse(inputText);
-                auto saRev  = createSA64(inputText, threadNbr);
-                auto bwtRev = createBWT64(inputText, saRev);
-                return bwtRev;
-            }();
-
-            decltype(inputText){}.swap(inputText); // inputText memory can be deleted
-
-            *this = BiFMIndex{bwt, bwtRev, std::move(csa)};
+            construct<uint64_t>(std::move(inputText), inputSizes, samplingRate, threadNbr);
         }
     }
 
@@ -134,26 +79,21 @@ struct BiFMIndex {
     }
 
     auto locate(size_t idx) const -> std::tuple<size_t, size_t> {
-        if constexpr (requires(Table t) {{ t.hasValue(size_t{}) }; }) {
-            bool v = occ.hasValue(idx);
+        if constexpr (OccTableSampleMarker<Table> && SuffixArraySampleValue<TCSA>) {
+            // sample marker is stored inside the occ table, csa is only accessed for the final value
             uint64_t steps{};
-            while(!v) {
+            while(!occ.hasValue(idx)) {
                 idx = occ.rank_symbol(idx);
                 steps += 1;
-                v = occ.hasValue(idx);
             }
-            auto [chr, pos] = csa.value(idx);
+            auto [chr, pos] = csa.sampleValue(occ.sampleRank(idx));
             return {chr, pos+steps};
 
         } else {
             auto opt = csa.value(idx);
             uint64_t steps{};
             while(!opt) {
-                if constexpr (requires(Table t) { { t.rank_symbol(size_t{}) }; }) {
-                    idx = occ.rank_symbol(idx);
-                } else {
-                    idx = occ.rank(idx, occ.symbol(idx));
-                }
+                idx = occ.rank_symbol(idx);
                 steps += 1;
                 opt = csa.value(idx);
             }
@@ -166,11 +106,142 @@ struct BiFMIndex {
         return csa.value(idx);
     }
 
+    /**!\brief Locates multiple rows at once, see `fmindex_collection::locateBatch`
+     *
+     * \param rows rows that should be located
+     * \param out  out[i] receives the same value as `locate(rows[i])`
+     */
+    void locateBatch(std::span<size_t const> rows, std::span<std::tuple<size_t, size_t>> out, size_t batchSize = 32) const {
+        fmindex_collection::locateBatch(*this, rows, out, batchSize);
+    }
+
 
     template <typename Archive>
     void serialize(Archive& ar) {
         ar(occ, occRev, csa);
     }
+
+private:
+    static auto countSymbols(std::span<uint8_t const> bwt) -> std::array<uint64_t, Sigma> {
+        auto ct = std::array<uint64_t, Sigma>{};
+        for (auto v : bwt) {
+            ct[v] += 1;
+        }
+        return ct;
+    }
+
+    template <typename T>
+    static auto createSA(std::span<uint8_t const> inputText, size_t threadNbr) -> std::vector<T> {
+        if constexpr (sizeof(T) == 4) {
+            return createSA32(inputText, threadNbr);
+        } else {
+            return createSA64(inputText, threadNbr);
+        }
+    }
+
+    template <typename T>
+    static auto createBWT(std::span<uint8_t const> inputText, std::span<T const> sa) -> std::vector<uint8_t> {
+        if constexpr (sizeof(T) == 4) {
+            return createBWT32(inputText, sa);
+        } else {
+            return createBWT64(inputText, sa);
+        }
+    }
+
+    template <typename T>
+    void construct(std::vector<uint8_t> inputText, std::span<size_t const> inputSizes, size_t samplingRate, size_t threadNbr) {
+        // create BurrowsWheelerTransform and CompressedSuffixArray
+        auto bwt = [&]() {
+            auto sa = createSA<T>(inputText, threadNbr);
+            csa = TCSA(sa, samplingRate, inputSizes);
+            return createBWT<T>(inputText, sa);
+        }();
+
+        // forward occ table is build while the reversed text is processed, the threads are split between both
+        auto occThreadNbr = threadNbr / 2;
+        auto revThreadNbr = std::max(threadNbr - occThreadNbr, size_t{1});
+
+        auto ct    = std::array<uint64_t, Sigma>{};
+        auto error = std::exception_ptr{};
+        auto buildOcc = [&]() {
+            try {
+                ct  = countSymbols(bwt);
+                occ = createOccTable<Table>(bwt, std::max(occThreadNbr, size_t{1}));
+                decltype(bwt){}.swap(bwt); // bwt memory can be deleted
+            } catch(...) {
+                error = std::current_exception();
+            }
+        };
+        auto occThread = std::thread{};
+        if (occThreadNbr > 0) {
+            occThread = std::thread{buildOcc};
+        } else {
+            buildOcc(); // single thread, no concurrency
+            if (error) {
+                std::rethrow_exception(error);
+            }
+        }
+
+        try {
+            // create BurrowsWheelerTransform on reversed text, reusing the memory of the suffix array
+            std::ranges::reverse(inputText);
+            auto saRev  = createSA<T>(inputText, revThreadNbr);
+            auto bwtRev = createBWTInplace<T>(inputText, saRev);
+            decltype(inputText){}.swap(inputText); // inputText memory can be deleted
+            occRev = createOccTable<TableRev>(bwtRev, revThreadNbr);
+        } catch(...) {
+            if (occThread.joinable()) occThread.join();
+            throw;
+        }
+        if (occThread.joinable()) occThread.join();
+        if (error) {
+            std::rethrow_exception(error);
+        }
+        checkAndSetValues(ct);
+    }
+
+    /**!\brief checks the last row of both occ tables and marks sampled rows
+     *
+     * \param ct number of occurrences of each symbol in the bwt
+     */
+    void checkAndSetValues(std::array<uint64_t, Sigma> ct) {
+        assert(occ.size() == occRev.size());
+        if (occ.size() != occRev.size()) {
+            throw std::runtime_error("occ don't have the same size: " + std::to_string(occ.size()) + " " + std::to_string(occRev.size()));
+        }
+        // compute last row
+        for (size_t i{1}; i < ct.size(); ++i) {
+            ct[i] = ct[i-1] + ct[i];
+        }
+        // check last row is correct
+        for (size_t sym{0}; sym < Sigma; ++sym) {
+            if (occ.rank(occ.size(), sym) != ct[sym]) {
+                auto e = std::string{"Wrong rank for the last entry."}
+                    + " Got different values for forward index."
+                    + " sym: " + std::to_string(sym)
+                    + " got: " + std::to_string(occ.rank(occ.size(), sym))
+                    + " expected: " + std::to_string(ct[sym]);
+                throw std::runtime_error(e);
+            }
+            if (occRev.rank(occRev.size(), sym) != ct[sym]) {
+                auto e = std::string{"Wrong rank for the last entry."}
+                    + " Got different values for reverse index."
+                    + " sym: " + std::to_string(sym)
+                    + " got: " + std::to_string(occRev.rank(occRev.size(), sym))
+                    + " expected: " + std::to_string(ct[sym]);
+                throw std::runtime_error(e);
+            }
+        }
+        markSamples();
+    }
+
+    /**!\brief marks the sampled rows of the csa inside of the occ table, if supported
+     */
+    void markSamples() {
+        if constexpr (OccTableSampleMarker<Table> && SuffixArraySampleValue<TCSA>) {
+            occ.markSamples([&](size_t i) { return csa.value(i).has_value(); });
+        }
+    }
 };
 
 }
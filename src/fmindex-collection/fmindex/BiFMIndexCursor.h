@@ -7,27 +7,32 @@
 
 namespace fmindex_collection {
 
-template <typename Index>
+template <typename Index, typename TSize = index_size_t<Index>>
 struct LeftBiFMIndexCursor;
 
-template <typename Index>
+/**!\brief Bidirectional cursor of a BiFMIndex
+ *
+ * \tparam TSize integer type of lb, lbRev and len, by default the size type of the occ table.
+ *               With uint32_t the cursor shrinks from 32 to 24 bytes.
+ */
+template <typename Index, typename TSize = index_size_t<Index>>
 struct BiFMIndexCursor {
     static constexpr size_t Sigma    = Index::Sigma;
     static constexpr bool   Reversed = false;
 
     Index const* index{};
-    size_t lb;
-    size_t lbRev;
-    size_t len{};
+    TSize lb;
+    TSize lbRev;
+    TSize len{};
     BiFMIndexCursor() noexcept = default;
     BiFMIndexCursor(Index const& index) noexcept
         : BiFMIndexCursor{index, 0, 0, index.size()}
     {}
     BiFMIndexCursor(Index const& index, size_t lb, size_t lbRev, size_t len) noexcept
         : index{&index}
-        , lb{lb}
-        , lbRev{lbRev}
-        , len{len}
+        , lb{static_cast<TSize>(lb)}
+        , lbRev{static_cast<TSize>(lbRev)}
+        , len{static_cast<TSize>(len)}
     {}
 
     bool operator==(BiFMIndexCursor const& _other) const noexcept {
@@ -42,11 +47,10 @@ struct BiFMIndexCursor {
     }
     auto extendLeft() const -> std::array<BiFMIndexCursor, Sigma> {
         auto const& occ = index->occ;
-        if constexpr (OccTablePrefetch<Index>) {
+        if constexpr (OccTablePrefetch<decltype(Index::occ)>) {
             occ.prefetch(lb+len);
         }
-        auto [rs1, prs1] = occ.all_ranks(lb);
-        auto [rs2, prs2] = occ.all_ranks(lb+len);
+        auto [rs1, prs1, rs2, prs2] = allRanksInterval(occ, lb, lb+len);
 
         auto cursors = std::array<BiFMIndexCursor, Sigma>{};
         cursors[0] = BiFMIndexCursor{*index, rs1[0], lbRev, rs2[0] - rs1[0]};
@@ -59,11 +63,10 @@ struct BiFMIndexCursor {
 
     auto extendRight() const -> std::array<BiFMIndexCursor, Sigma> {
         auto const& occ = index->occRev;
-        if constexpr (OccTablePrefetch<Index>) {
+        if constexpr (OccTablePrefetch<decltype(Index::occ)>) {
             occ.prefetch(lbRev+len);
         }
-        auto [rs1, prs1] = occ.all_ranks(lbRev);
-        auto [rs2, prs2] = occ.all_ranks(lbRev+len);
+        auto [rs1, prs1, rs2, prs2] = allRanksInterval(occ, lbRev, lbRev+len);
 
         auto cursors = std::array<BiFMIndexCursor, Sigma>{};
         cursors[0] = BiFMIndexCursor{*index, lb, rs1[0], rs2[0] - rs1[0]};
@@ -74,14 +77,14 @@ struct BiFMIndexCursor {
         return cursors;
     }
     void prefetchLeft() const {
-        if constexpr (OccTablePrefetch<Index>) {
+        if constexpr (OccTablePrefetch<decltype(Index::occ)>) {
             auto& occ = index->occ;
             occ.prefetch(lb);
             occ.prefetch(lb+len);
         }
     }
     void prefetchRight() const {
-        if constexpr (OccTablePrefetch<Index>) {
+        if constexpr (OccTablePrefetch<decltype(Index::occ)>) {
             auto& occ = index->occRev;
             occ.prefetch(lbRev);
             occ.prefetch(lbRev+len);
@@ -115,24 +118,24 @@ struct BiFMIndexCursor {
 
 };
 
-template <typename Index>
-auto begin(BiFMIndexCursor<Index> const& _cursor) {
+template <typename Index, typename TSize>
+auto begin(BiFMIndexCursor<Index, TSize> const& _cursor) {
     return IntIterator{_cursor.lb};
 }
-template <typename Index>
-auto end(BiFMIndexCursor<Index> const& _cursor) {
-    return IntIterator{_cursor.lb + _cursor.len};
+template <typename Index, typename TSize>
+auto end(BiFMIndexCursor<Index, TSize> const& _cursor) {
+    return IntIterator{size_t{_cursor.lb} + _cursor.len};
 }
 
-template <typename Index>
+template <typename Index, typename TSize>
 struct LeftBiFMIndexCursor {
     static constexpr size_t Sigma    = Index::Sigma;
     static constexpr bool   Reversed = false;
 
     Index const* index;
-    size_t lb;
-    size_t len;
-    LeftBiFMIndexCursor(BiFMIndexCursor<Index> const& _other)
+    TSize lb;
+    TSize len;
+    LeftBiFMIndexCursor(BiFMIndexCursor<Index, TSize> const& _other)
         : index{_other.index}
         , lb{_other.lb}
         , len{_other.len}
@@ -145,8 +148,8 @@ struct LeftBiFMIndexCursor {
     {}
     LeftBiFMIndexCursor(Index const& index, size_t lb, size_t len)
         : index{&index}
-        , lb{lb}
-        , len{len}
+        , lb{static_cast<TSize>(lb)}
+        , len{static_cast<TSize>(len)}
     {}
     bool empty() const {
         return len == 0;
@@ -156,8 +159,7 @@ struct LeftBiFMIndexCursor {
     }
     auto extendLeft() const -> std::array<LeftBiFMIndexCursor, Sigma> {
         auto const& occ = index->occ;
-        auto [rs1, prs1] = occ.all_ranks(lb);
-        auto [rs2, prs2] = occ.all_ranks(lb+len);
+        auto [rs1, prs1, rs2, prs2] = allRanksInterval(occ, lb, lb+len);
 
         auto cursors = std::array<LeftBiFMIndexCursor, Sigma>{};
         cursors[0] = LeftBiFMIndexCursor{*index, rs1[0], rs2[0] - rs1[0]};
@@ -173,7 +175,7 @@ struct LeftBiFMIndexCursor {
 
         size_t newLb    = occ.rank(lb, symb);
         size_t newLen   = occ.rank(lb+len, symb) - newLb;
-        if constexpr (OccTablePrefetch<Index>) {
+        if constexpr (OccTablePrefetch<decltype(Index::occ)>) {
             occ.prefetch(newLb);
             occ.prefetch(newLb + newLen);
         }
@@ -183,22 +185,22 @@ struct LeftBiFMIndexCursor {
     }
 };
 
-template <typename Index>
-auto begin(LeftBiFMIndexCursor<Index> const& _cursor) {
+template <typename Index, typename TSize>
+auto begin(LeftBiFMIndexCursor<Index, TSize> const& _cursor) {
     return IntIterator{_cursor.lb};
 }
-template <typename Index>
-auto end(LeftBiFMIndexCursor<Index> const& _cursor) {
-    return IntIterator{_cursor.lb + _cursor.len};
+template <typename Index, typename TSize>
+auto end(LeftBiFMIndexCursor<Index, TSize> const& _cursor) {
+    return IntIterator{size_t{_cursor.lb} + _cursor.len};
 }
 
 }
 
 namespace std {
 
-template <typename index_t>
-struct hash<fmindex_collection::BiFMIndexCursor<index_t>> {
-    auto operator()(fmindex_collection::BiFMIndexCursor<index_t> const& cursor) const -> size_t {
+template <typename index_t, typename size_type>
+struct hash<fmindex_collection::BiFMIndexCursor<index_t, size_type>> {
+    auto operator()(fmindex_collection::BiFMIndexCursor<index_t, size_type> const& cursor) const -> size_t {
         return hash<size_t>()(cursor.lb)
             ^ hash<size_t>()(cursor.len);
     }
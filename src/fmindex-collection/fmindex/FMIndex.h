@@ -3,6 +3,7 @@
 // SPDX-License-Identifier: BSD-3-Clause
 #pragma once
 
+#include "../locate.h"
 #include "../occtable/concepts.h"
 #include "../suffixarray/CSA.h"
 #include "../utils.h"
@@ -19,10 +20,12 @@ struct FMIndex {
     FMIndex() = default;
     FMIndex(FMIndex const&) = delete;
     FMIndex(FMIndex&&) noexcept = default;
-    FMIndex(std::span<uint8_t const> bwt, TCSA _csa)
-        : occ{bwt}
+    FMIndex(std::span<uint8_t const> bwt, TCSA _csa, size_t threadNbr = 1)
+        : occ{createOccTable<Table>(bwt, threadNbr)}
         , csa{std::move(_csa)}
-    {}
+    {
+        markSamples();
+    }
 
     FMIndex(std::vector<uint8_t> _input, size_t samplingRate, size_t threadNbr) {
         auto input = std::vector<std::vector<uint8_t>>{std::move(_input)};
@@ -41,7 +44,7 @@ struct FMIndex {
                 return std::make_tuple(std::move(bwt), std::move(csa));
             }();
 
-            *this = FMIndex{bwt, std::move(csa)};
+            *this = FMIndex{bwt, std::move(csa), threadNbr};
 
         } else { // required 64bit SA required
             auto [bwt, csa] = [&, &inputText=inputText, &inputSizes=inputSizes] () {
@@ -52,7 +55,7 @@ struct FMIndex {
                 return std::make_tuple(std::move(bwt), std::move(csa));
             }();
 
-            *this = FMIndex{bwt, std::move(csa)};
+            *this = FMIndex{bwt, std::move(csa), threadNbr};
         }
     }
     auto operator=(FMIndex const&) -> FMIndex& = delete;
@@ -68,25 +71,53 @@ struct FMIndex {
     }
 
     auto locate(size_t idx) const -> std::tuple<size_t, size_t> {
-        auto opt = csa.value(idx);
-        size_t steps{};
-        while(!opt) {
-            idx = occ.rank(idx, occ.symbol(idx));
-            steps += 1;
-            opt = csa.value(idx);
+        if constexpr (OccTableSampleMarker<Table> && SuffixArraySampleValue<TCSA>) {
+            // sample marker is stored inside the occ table, csa is only accessed for the final value
+            size_t steps{};
+            while(!occ.hasValue(idx)) {
+                idx = occ.rank_symbol(idx);
+                steps += 1;
+            }
+            auto [chr, pos] = csa.sampleValue(occ.sampleRank(idx));
+            return std::make_tuple(chr, pos + steps);
+        } else {
+            auto opt = csa.value(idx);
+            size_t steps{};
+            while(!opt) {
+                idx = occ.rank_symbol(idx);
+                steps += 1;
+                opt = csa.value(idx);
+            }
+            auto [chr, pos] = *opt;
+            return std::make_tuple(chr, pos + steps);
         }
-        auto [chr, pos] = *opt;
-        return std::make_tuple(chr, pos + steps);
     }
 
     auto single_locate_step(size_t idx) const -> std::optional<std::tuple<size_t, size_t>> {
         return csa.value(idx);
     }
 
+    /**!\brief Locates multiple rows at once, see `fmindex_collection::locateBatch`
+     *
+     * \param rows rows that should be located
+     * \param out  out[i] receives the same value as `locate(rows[i])`
+     */
+    void locateBatch(std::span<size_t const> rows, std::span<std::tuple<size_t, size_t>> out, size_t batchSize = 32) const {
+        fmindex_collection::locateBatch(*this, rows, out, batchSize);
+    }
+
     template <typename Archive>
     void serialize(Archive& ar) {
         ar(occ, csa);
     }
+private:
+    /**!\brief marks the sampled rows of the csa inside of the occ table, if supported
+     */
+    void markSamples() {
+        if constexpr (OccTableSampleMarker<Table> && SuffixArraySampleValue<TCSA>) {
+            occ.markSamples([&](size_t i) { return csa.value(i).has_value(); });
+        }
+    }
 };
 
 }
@@ -9,14 +9,18 @@
 
 namespace fmindex_collection {
 
-template <typename Index>
+/**!\brief Cursor of an FMIndex
+ *
+ * \tparam TSize integer type of lb and len, by default the size type of the occ table
+ */
+template <typename Index, typename TSize = index_size_t<Index>>
 struct FMIndexCursor {
     static constexpr size_t Sigma    = Index::Sigma;
     static constexpr bool   Reversed = false;
 
     Index const* index{};
-    size_t lb;
-    size_t len{};
+    TSize lb;
+    TSize len{};
 
     FMIndexCursor() noexcept = default;
 
@@ -26,8 +30,8 @@ struct FMIndexCursor {
 
     FMIndexCursor(Index const& index, size_t lb, size_t len) noexcept
         : index{&index}
-        , lb{lb}
-        , len{len}
+        , lb{static_cast<TSize>(lb)}
+        , len{static_cast<TSize>(len)}
     {}
 
     auto extendLeft(uint8_t symb) const -> FMIndexCursor {
@@ -36,8 +40,7 @@ struct FMIndexCursor {
         return {*index, newLb, newLen};
     }
     auto extendLeft() const -> std::array<FMIndexCursor, Sigma> {
-        auto [rs1, prs1] = index->occ.all_ranks(lb);
-        auto [rs2, prs2] = index->occ.all_ranks(lb+len);
+        auto [rs1, prs1, rs2, prs2] = allRanksInterval(index->occ, lb, lb+len);
 
         auto cursors = std::array<FMIndexCursor, Sigma>{};
         cursors[0] = FMIndexCursor{*index, rs1[0], rs2[0] - rs1[0]};
@@ -57,13 +60,13 @@ struct FMIndexCursor {
 
 };
 
-template <typename Index>
-auto begin(FMIndexCursor<Index> const& _cursor) {
+template <typename Index, typename TSize>
+auto begin(FMIndexCursor<Index, TSize> const& _cursor) {
     return IntIterator{_cursor.lb};
 }
-template <typename Index>
-auto end(FMIndexCursor<Index> const& _cursor) {
-    return IntIterator{_cursor.lb + _cursor.len};
+template <typename Index, typename TSize>
+auto end(FMIndexCursor<Index, TSize> const& _cursor) {
+    return IntIterator{size_t{_cursor.lb} + _cursor.len};
 }
 
 }
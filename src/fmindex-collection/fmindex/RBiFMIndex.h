@@ -42,13 +42,7 @@ struct RBiFMIndex {
                 throw std::runtime_error(e);
             }
         }
-        if constexpr (requires(Table t) {{ t.hasValue(size_t{}) }; }) {
-            for (size_t i{0}; i < occ.size(); ++i) {
-                if (csa.value(i).has_value()) {
-                    occ.setValue(i);
-                }
-            }
-        }
+        markSamples();
     }
 
     /**!\brief Creates a RBiFMIndex with a specified sampling rate
@@ -68,7 +62,13 @@ struct RBiFMIndex {
         }());
 
         // create BurrowsWheelerTransform and CompressedSuffixArray
-        auto [bwt, csa] = [&, &inputText=inputText, &inputSizes=inputSizes] () {
+        auto [bwt, csa] = [&, totalSize=totalSize, &inputText=inputText, &inputSizes=inputSizes] () {
+            if (totalSize < std::numeric_limits<int32_t>::max()) { // only 32bit SA required
+                auto sa  = createSA32(inputText, threadNbr);
+                auto bwt = createBWT32(inputText, sa);
+                auto csa = TCSA(std::move(sa), samplingRate, inputSizes);
+                return std::make_tuple(std::move(bwt), std::move(csa));
+            }
             auto sa  = createSA64(inputText, threadNbr);
             auto bwt = createBWT64(inputText, sa);
             auto csa = TCSA(std::move(sa), samplingRate, inputSizes);
@@ -89,26 +89,21 @@ struct RBiFMIndex {
     }
 
     auto locate(size_t idx) const -> std::tuple<size_t, size_t> {
-        if constexpr (requires(Table t) {{ t.hasValue(size_t{}) }; }) {
-            bool v = occ.hasValue(idx);
+        if constexpr (OccTableSampleMarker<Table> && SuffixArraySampleValue<TCSA>) {
+            // sample marker is stored inside the occ table, csa is only accessed for the final value
             uint64_t steps{};
-            while(!v) {
+            while(!occ.hasValue(idx)) {
                 idx = occ.rank_symbol(idx);
                 steps += 1;
-                v = occ.hasValue(idx);
             }
-            auto [chr, pos] = csa.value(idx);
+            auto [chr, pos] = csa.sampleValue(occ.sampleRank(idx));
             return {chr, pos+steps};
 
         } else {
             auto opt = csa.value(idx);
             uint64_t steps{};
             while(!opt) {
-                if constexpr (requires(Table t) { { t.rank_symbol(size_t{}) }; }) {
-                    idx = occ.rank_symbol(idx);
-                } else {
-                    idx = occ.rank(idx, occ.symbol(idx));
-                }
+                idx = occ.rank_symbol(idx);
                 steps += 1;
                 opt = csa.value(idx);
             }
@@ -126,6 +121,14 @@ struct RBiFMIndex {
     void serialize(Archive& ar) {
         ar(occ, csa);
     }
+private:
+    /**!\brief marks the sampled rows of the csa inside of the occ table, if supported
+     */
+    void markSamples() {
+        if constexpr (OccTableSampleMarker<Table> && SuffixArraySampleValue<TCSA>) {
+            occ.markSamples([&](size_t i) { return csa.value(i).has_value(); });
+        }
+    }
 };
 
 }
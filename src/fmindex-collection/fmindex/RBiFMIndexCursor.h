@@ -42,11 +42,10 @@ struct RBiFMIndexCursor {
     }
     auto extendLeft() const -> std::array<RBiFMIndexCursor, Sigma> {
         auto const& occ = index->occ;
-        if constexpr (OccTablePrefetch<Index>) {
+        if constexpr (OccTablePrefetch<decltype(Index::occ)>) {
             occ.prefetch(lb+len);
         }
-        auto [rs1, prs1] = occ.all_ranks(lb);
-        auto [rs2, prs2] = occ.all_ranks(lb+len);
+        auto [rs1, prs1, rs2, prs2] = allRanksInterval(occ, lb, lb+len);
 
         auto cursors = std::array<RBiFMIndexCursor, Sigma>{};
         cursors[0] = RBiFMIndexCursor{*index, rs1[0], lbRev, rs2[0] - rs1[0]};
@@ -59,11 +58,10 @@ struct RBiFMIndexCursor {
 
     auto extendRight() const -> std::array<RBiFMIndexCursor, Sigma> {
         auto const& occ = index->occ;
-        if constexpr (OccTablePrefetch<Index>) {
+        if constexpr (OccTablePrefetch<decltype(Index::occ)>) {
             occ.prefetch(lbRev+len);
         }
-        auto [rs1, prs1] = occ.all_ranks(lbRev);
-        auto [rs2, prs2] = occ.all_ranks(lbRev+len);
+        auto [rs1, prs1, rs2, prs2] = allRanksInterval(occ, lbRev, lbRev+len);
 
         auto cursors = std::array<RBiFMIndexCursor, Sigma>{};
         cursors[0] = RBiFMIndexCursor{*index, lb, rs1[0], rs2[0] - rs1[0]};
@@ -74,14 +72,14 @@ struct RBiFMIndexCursor {
         return cursors;
     }
     void prefetchLeft() const {
-        if constexpr (OccTablePrefetch<Index>) {
+        if constexpr (OccTablePrefetch<decltype(Index::occ)>) {
             auto& occ = index->occ;
             occ.prefetch(lb);
             occ.prefetch(lb+len);
         }
     }
     void prefetchRight() const {
-        if constexpr (OccTablePrefetch<Index>) {
+        if constexpr (OccTablePrefetch<decltype(Index::occ)>) {
             auto& occ = index->occ;
             occ.prefetch(lbRev);
             occ.prefetch(lbRev+len);
@@ -155,8 +153,7 @@ struct LeftRBiFMIndexCursor {
     }
     auto extendLeft() const -> std::array<LeftRBiFMIndexCursor, Sigma> {
         auto const& occ = index->occ;
-        auto [rs1, prs1] = occ.all_ranks(lb);
-        auto [rs2, prs2] = occ.all_ranks(lb+len);
+        auto [rs1, prs1, rs2, prs2] = allRanksInterval(occ, lb, lb+len);
 
         auto cursors = std::array<LeftRBiFMIndexCursor, Sigma>{};
         cursors[0] = LeftRBiFMIndexCursor{*index, rs1[0], rs2[0] - rs1[0]};
@@ -171,7 +168,7 @@ struct LeftRBiFMIndexCursor {
 
         size_t newLb    = occ.rank(lb, symb);
         size_t newLen   = occ.rank(lb+len, symb) - newLb;
-        if constexpr (OccTablePrefetch<Index>) {
+        if constexpr (OccTablePrefetch<decltype(Index::occ)>) {
             occ.prefetch(newLb);
             occ.prefetch(newLb + newLen);
         }
@@ -0,0 +1,156 @@
+// SPDX-FileCopyrightText: 2006-2023, Knut Reinert & Freie Universität Berlin
+// SPDX-FileCopyrightText: 2016-2023, Knut Reinert & MPI für molekulare Genetik
+// SPDX-License-Identifier: BSD-3-Clause
+#pragma once
+
+#include "../occtable/concepts.h"
+#include "../suffixarray/CSA.h"
+#include "../utils.h"
+
+#include <algorithm>
+
+namespace fmindex_collection {
+
+/**!\brief A bidirectional fm index for DNA, that only requires a single occ table
+ *
+ * The text consists of the sequences and their reverse complements. Since the text is
+ * closed under reverse complement, the interval of the reverse complement of a pattern
+ * serves as the second interval of a bidirectional search: extending the pattern to
+ * the right by `c` is the same as extending its reverse complement to the left by the
+ * complement of `c` (see RCBiFMIndexCursor).
+ *
+ * Each occurrence is reported on the strand it occurs on, searching a reverse complemented
+ * query separately is not required. Sequence id `i` refers to the i-th input sequence,
+ * sequence id `2*n-1-i` to its reverse complement (with n the number of input sequences).
+ *
+ * Alphabet: 0 delimiter, 1-4 ACGT and optionally 5 as N, which is its own complement.
+ */
+template <OccTable Table, SuffixArray_c TCSA = CSA>
+struct RCBiFMIndex {
+    static size_t constexpr Sigma = Table::Sigma;
+    static_assert(Sigma == 5 or Sigma == 6, "RCBiFMIndex only supports a DNA alphabet");
+
+    Table  occ;
+    TCSA   csa;
+
+    /**!\brief complement of a symbol, A<->T and C<->G
+     */
+    static constexpr auto complement(size_t symb) -> uint8_t {
+        if (symb == 0 or symb > 4) return symb;
+        return 5 - symb;
+    }
+
+    RCBiFMIndex() = default;
+    RCBiFMIndex(std::span<uint8_t const> bwt, TCSA _csa)
+        : occ{bwt}
+        , csa{std::move(_csa)}
+    {
+        // compute last row
+        auto ct = std::array<uint64_t, Sigma>{};
+        for (auto v : bwt) {
+            ct[v] += 1;
+        }
+        for (size_t i{1}; i < ct.size(); ++i) {
+            ct[i] = ct[i-1] + ct[i];
+        }
+        // check last row is correct
+        for (size_t sym{0}; sym < Sigma; ++sym) {
+            if (occ.rank(occ.size(), sym) != ct[sym]) {
+                auto e = std::string{"Wrong rank for the last entry."}
+                    + " Got different values for forward index."
+                    + " sym: " + std::to_string(sym)
+                    + " got: " + std::to_string(occ.rank(occ.size(), sym))
+                    + " expected: " + std::to_string(ct[sym]);
+                throw std::runtime_error(e);
+            }
+        }
+        markSamples();
+    }
+
+    /**!\brief Creates a RCBiFMIndex with a specified sampling rate
+     *
+     * \param _input a list of sequences, the reverse complements are added automatically
+     * \param samplingRate rate of the sampling
+     */
+    RCBiFMIndex(Sequences auto const& _input, size_t samplingRate, size_t threadNbr) {
+        auto [totalSize, inputText, inputSizes] = createSequencesAndReverseComplement(_input, &complement);
+
+        // Check only valid characters are used
+        assert([&]() {
+            for (auto c : inputText) {
+                if (c >= Sigma) return false;
+            }
+            return true;
+        }());
+
+        // create BurrowsWheelerTransform and CompressedSuffixArray
+        auto [bwt, csa] = [&, totalSize=totalSize, &inputText=inputText, &inputSizes=inputSizes] () {
+            if (totalSize < std::numeric_limits<int32_t>::max()) { // only 32bit SA required
+                auto sa  = createSA32(inputText, threadNbr);
+                auto bwt = createBWT32(inputText, sa);
+                auto csa = TCSA(std::move(sa), samplingRate, inputSizes);
+                return std::make_tuple(std::move(bwt), std::move(csa));
+            }
+            auto sa  = createSA64(inputText, threadNbr);
+            auto bwt = createBWT64(inputText, sa);
+            auto csa = TCSA(std::move(sa), samplingRate, inputSizes);
+            return std::make_tuple(std::move(bwt), std::move(csa));
+        }();
+
+        decltype(inputText){}.swap(inputText); // inputText memory can be deleted
+
+        *this = RCBiFMIndex{bwt, std::move(csa)};
+    }
+
+    size_t memoryUsage() const requires OccTableMemoryUsage<Table> {
+        return occ.memoryUsage() + csa.memoryUsage();
+    }
+
+    size_t size() const {
+        return occ.size();
+    }
+
+    auto locate(size_t idx) const -> std::tuple<size_t, size_t> {
+        if constexpr (OccTableSampleMarker<Table> && SuffixArraySampleValue<TCSA>) {
+            // sample marker is stored inside the occ table, csa is only accessed for the final value
+            uint64_t steps{};
+            while(!occ.hasValue(idx)) {
+                idx = occ.rank_symbol(idx);
+                steps += 1;
+            }
+            auto [chr, pos] = csa.sampleValue(occ.sampleRank(idx));
+            return {chr, pos+steps};
+
+        } else {
+            auto opt = csa.value(idx);
+            uint64_t steps{};
+            while(!opt) {
+                idx = occ.rank_symbol(idx);
+                steps += 1;
+                opt = csa.value(idx);
+            }
+            auto [chr, pos] = *opt;
+            return {chr, pos+steps};
+        }
+    }
+
+    auto single_locate_step(size_t idx) const -> std::optional<std::tuple<size_t, size_t>> {
+        return csa.value(idx);
+    }
+
+
+    template <typename Archive>
+    void serialize(Archive& ar) {
+        ar(occ, csa);
+    }
+private:
+    /**!\brief marks the sampled rows of the csa inside of the occ table, if supported
+     */
+    void markSamples() {
+        if constexpr (OccTableSampleMarker<Table> && SuffixArraySampleValue<TCSA>) {
+            occ.markSamples([&](size_t i) { return csa.value(i).has_value(); });
+        }
+    }
+};
+
+}
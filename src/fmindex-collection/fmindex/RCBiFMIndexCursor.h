@@ -0,0 +1,172 @@
+// SPDX-FileCopyrightText: 2006-2023, Knut Reinert & Freie Universität Berlin
+// SPDX-FileCopyrightText: 2016-2023, Knut Reinert & MPI für molekulare Genetik
+// SPDX-License-Identifier: BSD-3-Clause
+#pragma once
+
+#include "RCBiFMIndex.h"
+
+namespace fmindex_collection {
+
+/**!\brief Bidirectional cursor of an RCBiFMIndex
+ *
+ * lb/len is the interval of the pattern P, lbRc/len the interval of its reverse complement.
+ * Both intervals are inside of the same occ table.
+ */
+template <typename Index>
+struct RCBiFMIndexCursor {
+    static constexpr size_t Sigma    = Index::Sigma;
+    static constexpr bool   Reversed = false;
+
+    Index const* index{};
+    size_t lb;
+    size_t lbRc;
+    size_t len{};
+    RCBiFMIndexCursor() noexcept = default;
+    RCBiFMIndexCursor(Index const& index) noexcept
+        : RCBiFMIndexCursor{index, 0, 0, index.size()}
+    {}
+    RCBiFMIndexCursor(Index const& index, size_t lb, size_t lbRc, size_t len) noexcept
+        : index{&index}
+        , lb{lb}
+        , lbRc{lbRc}
+        , len{len}
+    {}
+
+    bool operator==(RCBiFMIndexCursor const& _other) const noexcept {
+        return lb == _other.lb
+               && len == _other.len;
+    }
+    bool empty() const {
+        return len == 0;
+    }
+    size_t count() const {
+        return len;
+    }
+
+    /**!\brief cursor of the reverse complemented pattern
+     */
+    auto reverseComplement() const -> RCBiFMIndexCursor {
+        return {*index, lbRc, lb, len};
+    }
+
+    auto extendLeft() const -> std::array<RCBiFMIndexCursor, Sigma> {
+        auto const& occ = index->occ;
+        if constexpr (OccTablePrefetch<decltype(Index::occ)>) {
+            occ.prefetch(lb+len);
+        }
+        auto [rs1, prs1, rs2, prs2] = allRanksInterval(occ, lb, lb+len);
+        auto offsets = partnerOffsets(rs1, rs2);
+
+        auto cursors = std::array<RCBiFMIndexCursor, Sigma>{};
+        for (size_t i{0}; i < Sigma; ++i) {
+            cursors[i] = RCBiFMIndexCursor{*index, rs1[i], lbRc + offsets[Index::complement(i)], rs2[i] - rs1[i]};
+        }
+        cursors[0].prefetchLeft();
+        return cursors;
+    }
+
+    auto extendRight() const -> std::array<RCBiFMIndexCursor, Sigma> {
+        auto const& occ = index->occ;
+        if constexpr (OccTablePrefetch<decltype(Index::occ)>) {
+            occ.prefetch(lbRc+len);
+        }
+        auto [rs1, prs1, rs2, prs2] = allRanksInterval(occ, lbRc, lbRc+len);
+        auto offsets = partnerOffsets(rs1, rs2);
+
+        auto cursors = std::array<RCBiFMIndexCursor, Sigma>{};
+        for (size_t i{0}; i < Sigma; ++i) {
+            auto c = Index::complement(i);
+            cursors[i] = RCBiFMIndexCursor{*index, lb + offsets[i], rs1[c], rs2[c] - rs1[c]};
+        }
+        cursors[0].prefetchRight();
+        return cursors;
+    }
+    void prefetchLeft() const {
+        if constexpr (OccTablePrefetch<decltype(Index::occ)>) {
+            auto& occ = index->occ;
+            occ.prefetch(lb);
+            occ.prefetch(lb+len);
+        }
+    }
+    void prefetchRight() const {
+        if constexpr (OccTablePrefetch<decltype(Index::occ)>) {
+            auto& occ = index->occ;
+            occ.prefetch(lbRc);
+            occ.prefetch(lbRc+len);
+        }
+    }
+
+    auto extendLeft(size_t symb) const -> RCBiFMIndexCursor {
+        auto& occ = index->occ;
+        size_t newLb   = occ.rank(lb, symb);
+        size_t newLbRc = lbRc + partnerOffset(lb, Index::complement(symb));
+        size_t newLen  = occ.rank(lb+len, symb) - newLb;
+        auto newCursor = RCBiFMIndexCursor{*index, newLb, newLbRc, newLen};
+        newCursor.prefetchLeft();
+        return newCursor;
+    }
+    auto extendRight(size_t symb) const -> RCBiFMIndexCursor {
+        auto& occ = index->occ;
+        auto c = Index::complement(symb);
+        size_t newLb   = lb + partnerOffset(lbRc, symb);
+        size_t newLbRc = occ.rank(lbRc, c);
+        size_t newLen  = occ.rank(lbRc+len, c) - newLbRc;
+        auto newCursor = RCBiFMIndexCursor{*index, newLb, newLbRc, newLen};
+        newCursor.prefetchRight();
+        return newCursor;
+    }
+
+private:
+    /**!\brief number of rows of the partner interval that are in front of the partner interval extended to the right by symb
+     *
+     * Rows of the interval [_lb, _lb+len) of a pattern Q, the partner interval is the one of rc(Q).
+     * In front of rc(Q)symb are all rows rc(Q)$ and rc(Q)x with 0 < x < symb.
+     * The number of rows rc(Q)x is the number of rows complement(x)Q, which are counted
+     * with the occ table.
+     */
+    size_t partnerOffset(size_t _lb, size_t symb) const {
+        if (symb == 0) return 0;
+        auto& occ = index->occ;
+        size_t k = std::min<size_t>(symb-1, 4); // complements of the bases 1..k are 5-k..4
+        auto count = [&](size_t idx) -> size_t {
+            return occ.rank(idx, 0) + occ.prefix_rank(idx, 4) - occ.prefix_rank(idx, 4-k);
+        };
+        return count(_lb+len) - count(_lb);
+    }
+
+    /**!\brief same as partnerOffset, but for all symbols at once
+     */
+    static auto partnerOffsets(auto const& rs1, auto const& rs2) -> std::array<size_t, Sigma> {
+        auto offsets = std::array<size_t, Sigma>{};
+        size_t acc = rs2[0] - rs1[0];
+        for (size_t i{1}; i < Sigma; ++i) {
+            offsets[i] = acc;
+            auto c = Index::complement(i);
+            acc += rs2[c] - rs1[c];
+        }
+        return offsets;
+    }
+};
+
+template <typename Index>
+auto begin(RCBiFMIndexCursor<Index> const& _cursor) {
+    return IntIterator{_cursor.lb};
+}
+template <typename Index>
+auto end(RCBiFMIndexCursor<Index> const& _cursor) {
+    return IntIterator{_cursor.lb + _cursor.len};
+}
+
+}
+
+namespace std {
+
+template <typename index_t>
+struct hash<fmindex_collection::RCBiFMIndexCursor<index_t>> {
+    auto operator()(fmindex_collection::RCBiFMIndexCursor<index_t> const& cursor) const -> size_t {
+        return hash<size_t>()(cursor.lb)
+            ^ hash<size_t>()(cursor.len);
+    }
+};
+
+}
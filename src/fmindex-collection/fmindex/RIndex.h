@@ -0,0 +1,191 @@
+// SPDX-FileCopyrightText: 2006-2023, Knut Reinert & Freie Universität Berlin
+// SPDX-FileCopyrightText: 2016-2023, Knut Reinert & MPI für molekulare Genetik
+// SPDX-License-Identifier: BSD-3-Clause
+#pragma once
+
+#include "../MMapAllocator.h"
+#include "../occtable/concepts.h"
+#include "../utils.h"
+
+#include <algorithm>
+#include <cassert>
+#include <limits>
+#include <tuple>
+#include <vector>
+
+namespace fmindex_collection {
+
+/**!\brief An FM-Index with an r-index style locate
+ *
+ * Instead of sampling the suffix array every `samplingRate` text positions, only the
+ * suffix array values at the boundaries of the runs of the bwt are stored.
+ * The memory of the samples is O(r) with r the number of runs (plus one entry per sequence).
+ *
+ * - toehold: the cursor (see `RIndexCursor`) keeps track of the suffix array value of its
+ *   last row. On a left extension this value is either decreased by one, or taken from the
+ *   samples at the end of a run (stored at their LF mapped rows).
+ * - phi: given SA[i] the value SA[i-1] is computed with a predecessor search over the suffix
+ *   array values of all run starts, all occurrences are listed without any LF steps.
+ *
+ * The delimiter breaks the LF relation SA[LF(i)] = SA[i]-1, since the delimiters of the
+ * different sequences are not ordered by their position. All rows with a delimiter in the
+ * bwt are therefore treated as run boundaries.
+ *
+ * \tparam Table an occ table, e.g. a run length encoded one
+ */
+template <OccTable Table>
+struct RIndex {
+    static size_t constexpr Sigma = Table::Sigma;
+
+    Table occ;
+    MMapVector<uint64_t> toeholdRows;   // rows LF(j) for each run end j (sorted)
+    MMapVector<uint64_t> toeholdValues; // SA[toeholdRows[i]]
+    MMapVector<uint64_t> phiKeys;       // SA[p] for each run start p > 0 (sorted)
+    MMapVector<uint64_t> phiValues;     // SA[p-1], for the entry with key SA[p]
+    MMapVector<uint64_t> seqStarts;     // text position of the first character of each sequence
+    uint64_t lastRowValue{};            // SA[size()-1], the toehold of the full interval
+
+    RIndex() = default;
+    RIndex(RIndex&&) noexcept = default;
+
+    /**!\brief Creates an RIndex
+     *
+     * \param _input a list of sequences
+     * \param threadNbr number of threads used to construct the suffix array and the occ table
+     */
+    RIndex(Sequences auto const& _input, size_t threadNbr) {
+        auto [totalSize, inputText, inputSizes] = createSequences(_input);
+
+        if (totalSize < std::numeric_limits<int32_t>::max()) { // only 32bit SA required
+            construct(inputText, createSA32(inputText, threadNbr), inputSizes, threadNbr);
+        } else { // required 64bit SA required
+            construct(inputText, createSA64(inputText, threadNbr), inputSizes, threadNbr);
+        }
+    }
+
+    auto operator=(RIndex const&) -> RIndex& = delete;
+    auto operator=(RIndex&&) noexcept -> RIndex& = default;
+
+    size_t memoryUsage() const requires OccTableMemoryUsage<Table> {
+        return occ.memoryUsage()
+            + (toeholdRows.size() + toeholdValues.size() + phiKeys.size() + phiValues.size() + seqStarts.size()) * sizeof(uint64_t);
+    }
+
+    size_t size() const {
+        return occ.size();
+    }
+
+    /**!\brief suffix array value of the last row of a left extended interval
+     *
+     * \param lastRow   the last row of the interval before the extension
+     * \param toehold   the suffix array value of `lastRow`
+     * \param symb      symbol the interval was extended with
+     * \param newLastRow the last row of the extended (non empty) interval
+     */
+    uint64_t extendToehold(size_t lastRow, uint64_t toehold, uint8_t symb, size_t newLastRow) const {
+        if (symb != 0 and occ.symbol(lastRow) == symb) {
+            return toehold-1;
+        }
+        return toeholdValue(newLastRow);
+    }
+
+    /**!\brief suffix array value of the row LF(j), for j the end of a run
+     */
+    uint64_t toeholdValue(size_t row) const {
+        auto iter = std::ranges::lower_bound(toeholdRows, row);
+        assert(iter != toeholdRows.end() and *iter == row);
+        return toeholdValues[std::distance(toeholdRows.begin(), iter)];
+    }
+
+    /**!\brief computes SA[i-1] from SA[i], only valid for i > 0
+     */
+    uint64_t phi(uint64_t value) const {
+        auto iter = std::ranges::upper_bound(phiKeys, value);
+        assert(iter != phiKeys.begin());
+        auto idx = std::distance(phiKeys.begin(), iter) - 1;
+        return phiValues[idx] + (value - phiKeys[idx]);
+    }
+
+    /**!\brief converts a text position into a sequence id and a position inside this sequence
+     */
+    auto textPosition(uint64_t value) const -> std::tuple<size_t, size_t> {
+        auto iter   = std::ranges::upper_bound(seqStarts, value);
+        size_t seqId = std::distance(seqStarts.begin(), iter) - 1;
+        return {seqId, value - seqStarts[seqId]};
+    }
+
+    template <typename Archive>
+    void serialize(Archive& ar) {
+        ar(occ, toeholdRows, toeholdValues, phiKeys, phiValues, seqStarts, lastRowValue);
+    }
+
+private:
+    template <typename T>
+    void construct(std::span<uint8_t const> inputText, std::vector<T> const& sa, std::span<size_t const> inputSizes, size_t threadNbr) {
+        auto const n = sa.size();
+        auto bwt = [&]() {
+            if constexpr (sizeof(T) == 4) {
+                return createBWT32(inputText, sa);
+            } else {
+                return createBWT64(inputText, sa);
+            }
+        }();
+
+        seqStarts.clear();
+        seqStarts.reserve(inputSizes.size());
+        uint64_t acc{};
+        for (auto len : inputSizes) {
+            seqStarts.push_back(acc);
+            acc += len;
+        }
+        lastRowValue = sa.back();
+
+        // first row of each symbol
+        auto C = std::array<uint64_t, Sigma+1>{};
+        for (auto c : bwt) {
+            C[c+1] += 1;
+        }
+        for (size_t i{1}; i < C.size(); ++i) {
+            C[i] += C[i-1];
+        }
+
+        // samples at the end of the runs, stored at the LF mapped row
+        auto toeholds = std::vector<std::tuple<uint64_t, uint64_t>>{};
+        auto counts   = std::array<uint64_t, Sigma>{};
+        for (size_t j{0}; j < n; ++j) {
+            auto c   = bwt[j];
+            auto row = C[c] + counts[c];
+            counts[c] += 1;
+            if (j+1 == n or bwt[j+1] != c or c == 0) {
+                toeholds.emplace_back(row, sa[row]);
+            }
+        }
+        std::ranges::sort(toeholds);
+
+        // samples at the start of the runs
+        auto phis = std::vector<std::tuple<uint64_t, uint64_t>>{};
+        for (size_t p{1}; p < n; ++p) {
+            if (bwt[p] != bwt[p-1] or bwt[p] == 0) {
+                phis.emplace_back(sa[p], sa[p-1]);
+            }
+        }
+        std::ranges::sort(phis);
+
+        toeholdRows.clear();
+        toeholdValues.clear();
+        for (auto [row, value] : toeholds) {
+            toeholdRows.push_back(row);
+            toeholdValues.push_back(value);
+        }
+        phiKeys.clear();
+        phiValues.clear();
+        for (auto [key, value] : phis) {
+            phiKeys.push_back(key);
+            phiValues.push_back(value);
+        }
+
+        occ = createOccTable<Table>(bwt, threadNbr);
+    }
+};
+
+}
@@ -0,0 +1,111 @@
+// SPDX-FileCopyrightText: 2006-2023, Knut Reinert & Freie Universität Berlin
+// SPDX-FileCopyrightText: 2016-2023, Knut Reinert & MPI für molekulare Genetik
+// SPDX-License-Identifier: BSD-3-Clause
+#pragma once
+
+#include "RIndex.h"
+
+#include <compare>
+
+namespace fmindex_collection {
+
+/**!\brief Same as FMIndexCursor, but tracks the suffix array value of the last row (toehold)
+ */
+template <typename Index>
+struct RIndexCursor {
+    static constexpr size_t Sigma    = Index::Sigma;
+    static constexpr bool   Reversed = false;
+
+    Index const* index{};
+    size_t lb;
+    size_t len{};
+    uint64_t toehold{}; // suffix array value of row lb+len-1, only valid if len > 0
+
+    RIndexCursor() noexcept = default;
+
+    RIndexCursor(Index const& index) noexcept
+        : RIndexCursor{index, 0, index.size(), index.lastRowValue}
+    {}
+
+    RIndexCursor(Index const& index, size_t lb, size_t len, uint64_t toehold) noexcept
+        : index{&index}
+        , lb{lb}
+        , len{len}
+        , toehold{toehold}
+    {}
+
+    auto extendLeft(uint8_t symb) const -> RIndexCursor {
+        size_t newLb  = index->occ.rank(lb, symb);
+        size_t newLen = index->occ.rank(lb+len, symb) - newLb;
+        if (newLen == 0) {
+            return {*index, newLb, newLen, 0};
+        }
+        return {*index, newLb, newLen, index->extendToehold(lb+len-1, toehold, symb, newLb+newLen-1)};
+    }
+
+    auto extendLeft() const -> std::array<RIndexCursor, Sigma> {
+        auto [rs1, prs1, rs2, prs2] = allRanksInterval(index->occ, lb, lb+len);
+
+        auto cursors = std::array<RIndexCursor, Sigma>{};
+        for (size_t i{0}; i < Sigma; ++i) {
+            cursors[i] = RIndexCursor{*index, rs1[i], rs2[i] - rs1[i], 0};
+            if (cursors[i].len > 0) {
+                cursors[i].toehold = index->extendToehold(lb+len-1, toehold, i, rs2[i]-1);
+            }
+        }
+        return cursors;
+    }
+
+    bool empty() const {
+        return len == 0;
+    }
+
+    size_t count() const {
+        return len;
+    }
+};
+
+/**!\brief Locates all rows of an RIndexCursor
+ *
+ * Starting at the toehold, the positions are computed from the last row to the first
+ * row with `phi`, no LF steps are required.
+ */
+template <typename index_t, typename cursor_t>
+struct LocateRIndex {
+    std::vector<std::tuple<size_t, size_t>> positions;
+
+    LocateRIndex(index_t const& index, cursor_t const& cursor) {
+        positions.resize(cursor.len);
+        uint64_t value = cursor.toehold;
+        for (size_t i{cursor.len}; i > 0; --i) {
+            positions[i-1] = index.textPosition(value);
+            if (i > 1) {
+                value = index.phi(value);
+            }
+        }
+    }
+
+    friend auto begin(LocateRIndex const& locate) {
+        return begin(locate.positions);
+    }
+    friend auto end(LocateRIndex const& locate) {
+        return end(locate.positions);
+    }
+};
+
+//!TODO remove as soon as clang supports auto deduction guides (not the case in clang 15
+#if __clang__
+    template <typename index_t, typename cursor_t>
+    LocateRIndex(index_t const&, cursor_t) -> LocateRIndex<index_t, cursor_t>;
+#endif
+
+template <typename Index>
+auto begin(RIndexCursor<Index> const& _cursor) {
+    return IntIterator{_cursor.lb};
+}
+template <typename Index>
+auto end(RIndexCursor<Index> const& _cursor) {
+    return IntIterator{_cursor.lb + _cursor.len};
+}
+
+}
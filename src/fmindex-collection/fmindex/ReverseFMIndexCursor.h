@@ -7,15 +7,19 @@
 
 namespace fmindex_collection {
 
-template <typename Index>
+/**!\brief Cursor of a ReverseFMIndex
+ *
+ * \tparam TSize integer type of lb, len and depth, by default the size type of the occ table
+ */
+template <typename Index, typename TSize = index_size_t<Index>>
 struct ReverseFMIndexCursor {
     static constexpr size_t Sigma    = Index::Sigma;
     static constexpr bool   Reversed = true;
 
     Index const* index{};
-    size_t lb;
-    size_t len{};
-    size_t depth{};
+    TSize lb;
+    TSize len{};
+    TSize depth{};
 
     ReverseFMIndexCursor() noexcept = default;
 
@@ -25,9 +29,9 @@ struct ReverseFMIndexCursor {
 
     ReverseFMIndexCursor(Index const& index, size_t lb, size_t len, size_t depth) noexcept
         : index{&index}
-        , lb{lb}
-        , len{len}
-        , depth{depth}
+        , lb{static_cast<TSize>(lb)}
+        , len{static_cast<TSize>(len)}
+        , depth{static_cast<TSize>(depth)}
     {}
 
     auto extendRight(uint8_t symb) const -> ReverseFMIndexCursor {
@@ -36,8 +40,7 @@ struct ReverseFMIndexCursor {
         return {*index, newLb, newLen, depth+1};
     }
     auto extendRight() const -> std::array<ReverseFMIndexCursor, Sigma> {
-        auto [rs1, prs1] = index->occ.all_ranks(lb);
-        auto [rs2, prs2] = index->occ.all_ranks(lb+len);
+        auto [rs1, prs1, rs2, prs2] = allRanksInterval(index->occ, lb, lb+len);
 
         auto cursors = std::array<ReverseFMIndexCursor, Sigma>{};
         cursors[0] = ReverseFMIndexCursor{*index, rs1[0], rs2[0] - rs1[0], depth+1};
@@ -61,13 +64,13 @@ struct ReverseFMIndexCursor {
 
 };
 
-template <typename Index>
-auto begin(ReverseFMIndexCursor<Index> const& _cursor) {
+template <typename Index, typename TSize>
+auto begin(ReverseFMIndexCursor<Index, TSize> const& _cursor) {
     return IntIterator{_cursor.lb};
 }
-template <typename Index>
-auto end(ReverseFMIndexCursor<Index> const& _cursor) {
-    return IntIterator{_cursor.lb + _cursor.len};
+template <typename Index, typename TSize>
+auto end(ReverseFMIndexCursor<Index, TSize> const& _cursor) {
+    return IntIterator{size_t{_cursor.lb} + _cursor.len};
 }
 
 
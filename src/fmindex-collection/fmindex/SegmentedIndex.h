@@ -0,0 +1,310 @@
+// SPDX-FileCopyrightText: 2006-2023, Knut Reinert & Freie Universität Berlin
+// SPDX-FileCopyrightText: 2016-2023, Knut Reinert & MPI für molekulare Genetik
+// SPDX-License-Identifier: BSD-3-Clause
+#pragma once
+
+#include "merge.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace fmindex_collection {
+
+/**!\brief An index consisting of multiple segments, that can be extended by new sequences
+ *
+ * New sequences are indexed as a new segment, the existing segments are not touched.
+ * Segments are ordered from oldest to newest, trailing segments are merged (k-way merge),
+ * as soon as a segment is not larger than `mergeRatio` times the total size of the newer segments.
+ * Each segment is therefore more than `mergeRatio` times larger than all newer segments together,
+ * resulting in a logarithmic number of segments.
+ *
+ * Merging happens on a background thread, `append` only indexes the new sequences, O(m log m) for m
+ * appended characters. Each character is merged a logarithmic number of times, the background merges
+ * cost amortized O(m log n) per append to an index of size n, a single merge costs up to O(n).
+ *
+ * Segments are immutable. Queries work on a snapshot of the segments (see `forEachSegment` and `snapshot`),
+ * a finished merge publishes a new list of segments and never blocks running queries.
+ * Rows of a segment are located with `locate(segment, row)`, which reports the sequence ids in the order
+ * the sequences were appended.
+ *
+ * `append`, `compact` and `wait` must not be called concurrently, all other functions are thread safe.
+ *
+ * \tparam Index e.g. `FMIndex` or `BiFMIndex`
+ */
+template <typename Index>
+struct SegmentedIndex {
+    static size_t constexpr Sigma = Index::Sigma;
+
+    struct Segment {
+        Index  index;
+        size_t seqOffset{}; // sequence id of the first sequence of this segment
+
+        template <typename Archive>
+        void serialize(Archive& ar) {
+            ar(index, seqOffset);
+        }
+    };
+    using Segments = std::vector<std::shared_ptr<Segment const>>;
+
+    size_t samplingRate{1};
+    size_t threadNbr{1};
+    size_t mergeRatio{2};
+
+    SegmentedIndex() = default;
+    SegmentedIndex(SegmentedIndex&& other)
+        : samplingRate{other.samplingRate}
+        , threadNbr{other.threadNbr}
+        , mergeRatio{other.mergeRatio}
+    {
+        other.wait();
+        segments = std::move(other.segments);
+        other.segments = std::make_shared<Segments const>();
+    }
+
+    /**!\brief Creates an empty index
+     *
+     * \param samplingRate rate of the sampling of each segment
+     * \param threadNbr number of threads used to create and merge segments
+     */
+    SegmentedIndex(size_t _samplingRate, size_t _threadNbr)
+        : samplingRate{_samplingRate}
+        , threadNbr{_threadNbr}
+    {}
+
+    SegmentedIndex(Sequences auto const& _input, size_t _samplingRate, size_t _threadNbr)
+        : SegmentedIndex{_samplingRate, _threadNbr}
+    {
+        append(_input);
+    }
+
+    ~SegmentedIndex() {
+        if (merger.joinable()) {
+            merger.join();
+        }
+    }
+
+    auto operator=(SegmentedIndex&& other) -> SegmentedIndex& {
+        wait();
+        other.wait();
+        samplingRate   = other.samplingRate;
+        threadNbr      = other.threadNbr;
+        mergeRatio     = other.mergeRatio;
+        segments       = std::move(other.segments);
+        other.segments = std::make_shared<Segments const>();
+        return *this;
+    }
+
+    /**!\brief Appends sequences as a new segment
+     *
+     * The new sequences receive the next sequence ids.
+     * If the size ratio demands it, a merge is started on a background thread.
+     */
+    void append(Sequences auto const& _input) {
+        if (_input.size() == 0) {
+            return;
+        }
+        auto segment = std::make_shared<Segment const>(Segment{Index{_input, samplingRate, threadNbr}, sequenceCount()});
+
+        bool startMerge{};
+        {
+            auto g = std::lock_guard{mutex};
+            auto next = std::make_shared<Segments>(*segments);
+            next->push_back(std::move(segment));
+            segments = std::move(next);
+            startMerge = !merging && firstMergedSegment(*segments) + 1 < segments->size();
+            merging = merging || startMerge;
+        }
+        if (startMerge) {
+            if (merger.joinable()) {
+                merger.join();
+            }
+            merger = std::thread{[this]() {
+                try {
+                    mergeTrailingSegments();
+                } catch(...) {
+                    auto g = std::lock_guard{mutex};
+                    mergeError = std::current_exception();
+                    merging = false;
+                }
+            }};
+        }
+    }
+
+    /**!\brief Waits until the background merges are finished
+     *
+     * Rethrows exceptions that occurred while merging.
+     */
+    void wait() {
+        if (merger.joinable()) {
+            merger.join();
+        }
+        auto g = std::lock_guard{mutex};
+        if (mergeError) {
+            std::rethrow_exception(std::exchange(mergeError, nullptr));
+        }
+    }
+
+    /**!\brief Merges all segments into a single segment
+     *
+     * Runs on the calling thread, queries are not blocked meanwhile.
+     */
+    void compact() {
+        wait();
+        while (true) {
+            auto current = snapshot();
+            if (current->size() < 2) {
+                return;
+            }
+            // k-way merge is limited to 256 indices, merge from the back
+            mergeRange(*current, current->size() - std::min(current->size(), size_t{256}), current->size());
+        }
+    }
+
+    /**!\brief The current list of segments, it stays valid while merges are being published
+     */
+    auto snapshot() const -> std::shared_ptr<Segments const> {
+        auto g = std::lock_guard{mutex};
+        return segments;
+    }
+
+    /**!\brief Number of rows over all segments
+     */
+    size_t size() const {
+        size_t s{};
+        for (auto const& segment : *snapshot()) {
+            s += segment->index.size();
+        }
+        return s;
+    }
+
+    /**!\brief Number of sequences over all segments
+     */
+    size_t sequenceCount() const {
+        auto current = snapshot();
+        if (current->empty()) {
+            return 0;
+        }
+        auto const& last = *current->back();
+        return last.seqOffset + last.index.occ.rank(last.index.size(), 0);
+    }
+
+    /**!\brief Calls `f(segment, index)` for each segment of the current snapshot
+     *
+     * \param f callback, e.g. running a search on `index` and locating with `locate(segment, row)`
+     */
+    template <typename F>
+    void forEachSegment(F&& f) const {
+        auto current = snapshot();
+        for (auto const& segment : *current) {
+            f(*segment, segment->index);
+        }
+    }
+
+    /**!\brief Locates a row of a segment
+     *
+     * \return sequence id and position inside of the sequence
+     */
+    auto locate(Segment const& segment, size_t row) const -> std::tuple<size_t, size_t> {
+        auto [seq, pos] = segment.index.locate(row);
+        return {seq + segment.seqOffset, pos};
+    }
+
+    template <typename Archive>
+    void save(Archive& ar) const {
+        auto current = snapshot();
+        ar(uint64_t{current->size()});
+        for (auto const& segment : *current) {
+            ar(*segment);
+        }
+        ar(samplingRate, threadNbr, mergeRatio);
+    }
+
+    template <typename Archive>
+    void load(Archive& ar) {
+        wait();
+        auto count = uint64_t{};
+        ar(count);
+        auto next = std::make_shared<Segments>();
+        for (size_t i{0}; i < count; ++i) {
+            auto segment = Segment{};
+            ar(segment);
+            next->push_back(std::make_shared<Segment const>(std::move(segment)));
+        }
+        ar(samplingRate, threadNbr, mergeRatio);
+        auto g = std::lock_guard{mutex};
+        segments = std::move(next);
+    }
+
+private:
+    mutable std::mutex              mutex;                                       // guards segments, merging and mergeError
+    std::shared_ptr<Segments const> segments{std::make_shared<Segments const>()};
+    std::thread                     merger;                                      // at most one background merge at a time
+    bool                            merging{};
+    std::exception_ptr              mergeError;
+
+    /**!\brief first segment of the trailing segments that should be merged, `size()` if none
+     */
+    auto firstMergedSegment(Segments const& current) const -> size_t {
+        if (current.size() < 2) {
+            return current.size();
+        }
+        // find oldest segment, that is not larger than mergeRatio times all newer segments
+        size_t first = current.size();
+        size_t newer = current.back()->index.size();
+        for (size_t i{current.size()-1}; i > 0; --i) {
+            if (current[i-1]->index.size() <= mergeRatio * newer) {
+                first = i-1;
+            }
+            newer += current[i-1]->index.size();
+        }
+        return first;
+    }
+
+    /**!\brief merges the segments [begin, end) of `current` and publishes the result
+     *
+     * Only the thread merging changes existing segments, segments appended meanwhile are kept.
+     */
+    void mergeRange(Segments const& current, size_t begin, size_t end) {
+        auto indices = std::vector<Index const*>{};
+        for (size_t i{begin}; i < end; ++i) {
+            indices.push_back(&current[i]->index);
+        }
+        auto merged = std::make_shared<Segment const>(Segment{merge(std::span<Index const* const>{indices}, threadNbr), current[begin]->seqOffset});
+
+        auto g = std::lock_guard{mutex};
+        auto next = std::make_shared<Segments>(segments->begin(), segments->begin() + begin);
+        next->push_back(std::move(merged));
+        next->insert(next->end(), segments->begin() + end, segments->end());
+        segments = std::move(next);
+    }
+
+    void mergeTrailingSegments() {
+        while (true) {
+            auto current = snapshot();
+            auto first   = firstMergedSegment(*current);
+            if (first + 1 >= current->size()) {
+                // segments could have been appended since the snapshot was taken
+                auto g = std::lock_guard{mutex};
+                if (segments == current) {
+                    merging = false;
+                    return;
+                }
+                continue;
+            }
+            // k-way merge is limited to 256 indices, merge from the back
+            auto begin = std::max(first, current->size() - std::min(current->size() - first, size_t{256}));
+            mergeRange(*current, begin, current->size());
+        }
+    }
+};
+
+}
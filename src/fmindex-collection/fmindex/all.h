@@ -9,6 +9,10 @@
 #include "fmindex/FMIndexCursor.h"
 #include "fmindex/RBiFMIndex.h"
 #include "fmindex/RBiFMIndexCursor.h"
+#include "fmindex/RCBiFMIndex.h"
+#include "fmindex/RCBiFMIndexCursor.h"
+#include "fmindex/RIndex.h"
+#include "fmindex/RIndexCursor.h"
 #include "fmindex/ReverseFMIndex.h"
 #include "fmindex/ReverseFMIndexCursor.h"
 #include "fmindex/VariableFMIndex.h"
@@ -0,0 +1,232 @@
+// SPDX-FileCopyrightText: 2006-2023, Knut Reinert & Freie Universität Berlin
+// SPDX-FileCopyrightText: 2016-2023, Knut Reinert & MPI für molekulare Genetik
+// SPDX-License-Identifier: BSD-3-Clause
+#pragma once
+
+#include "../MMapArchive.h"
+#include "merge.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <ranges>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace fmindex_collection {
+
+namespace external_detail {
+
+/**!\brief A file in a temporary directory, that is deleted when going out of scope
+ */
+struct TmpFile {
+    std::filesystem::path path;
+
+    explicit TmpFile(std::filesystem::path const& tmpDir) {
+        // random per process, the counter makes it unique inside of the process
+        static auto const processId = std::random_device{}();
+        static std::atomic<size_t> counter{};
+        path = tmpDir / ("fmc-" + std::to_string(processId) + "-" + std::to_string(counter++) + ".tmp");
+    }
+    TmpFile(TmpFile const&) = delete;
+    TmpFile(TmpFile&& _other) noexcept
+        : path{std::move(_other.path)}
+    {
+        _other.path.clear();
+    }
+    auto operator=(TmpFile const&) -> TmpFile& = delete;
+    auto operator=(TmpFile&&) -> TmpFile& = delete;
+
+    ~TmpFile() {
+        if (!path.empty()) {
+            auto ec = std::error_code{};
+            std::filesystem::remove(path, ec);
+        }
+    }
+};
+
+/**!\brief Writes bytes buffered into a file
+ */
+class BufferedWriter {
+    std::ofstream        ofs;
+    std::vector<uint8_t> buffer;
+    std::string          name;
+
+public:
+    explicit BufferedWriter(std::filesystem::path const& path, size_t bufferSize = 1<<20)
+        : ofs{path, std::ios::binary}
+        , name{path.string()}
+    {
+        if (!ofs) {
+            throw std::runtime_error{"fmindex-collection - could not open file " + name};
+        }
+        buffer.reserve(bufferSize);
+    }
+
+    void push_back(uint8_t v) {
+        buffer.push_back(v);
+        if (buffer.size() == buffer.capacity()) {
+            flush();
+        }
+    }
+
+    void flush() {
+        ofs.write(reinterpret_cast<char const*>(buffer.data()), buffer.size());
+        buffer.clear();
+        if (!ofs) {
+            throw std::runtime_error{"fmindex-collection - failed writing file " + name};
+        }
+    }
+
+    void close() {
+        flush();
+        ofs.close();
+    }
+};
+
+/**!\brief Interleaves two occurrence tables, the bwt is written to `path`
+ */
+template <typename OccLhs, typename OccRhs, typename CB>
+void writeInterleavedBWT(OccLhs const& lhsOcc, OccRhs const& rhsOcc, std::filesystem::path const& path, CB const& cb) {
+    auto R      = computeInterleavingR(lhsOcc, rhsOcc);
+    auto writer = BufferedWriter{path};
+    forEachInterleavedRow(R, lhsOcc, rhsOcc, [&](uint8_t symb, bool rhs, size_t idx) {
+        writer.push_back(symb);
+        cb(rhs, idx);
+    });
+    writer.close();
+}
+
+inline auto asSpan(MMapFile const& file) -> std::span<uint8_t const> {
+    return {static_cast<uint8_t const*>(file.data), file.size};
+}
+
+/**!\brief Loads a partial index
+ *
+ * Not every csa stores the number of sequences (e.g. DenseCSA), it is
+ * restored from the number of delimiters, `createJoinedCSA` depends on it.
+ */
+template <typename Index>
+auto loadPart(std::filesystem::path const& path) -> Index {
+    auto index = loadMMap<Index>(path);
+    index.csa.seqCount = index.occ.rank(index.size(), 0);
+    return index;
+}
+
+}
+
+/**!\brief Merges two indices and stores the result with `saveMMap`
+ *
+ * Same as `merge`, but the merged bwts are streamed into temporary files,
+ * which are memory mapped to construct the occurrence tables.
+ * Besides the inputs (which can be loaded with `loadMMap`) only the R array (1 bit per character),
+ * the joined csa and the occurrence tables of the result are held in memory.
+ * The number of sequences of both csa (`csa.seqCount`) must be set.
+ *
+ * \param index1 first index, its sequences keep their ids
+ * \param index2 second index, its sequence ids are shifted by the number of sequences in index1
+ * \param path file the merged index is written to
+ * \param tmpDir directory for temporary files
+ * \param threadNbr number of threads used to construct the occurrence tables
+ */
+template <typename Index>
+void mergeExternal(Index const& index1, Index const& index2, std::filesystem::path const& path, std::filesystem::path const& tmpDir, size_t threadNbr = 1) {
+    using TCSA = std::decay_t<decltype(index1.csa)>;
+    auto csa = TCSA::createJoinedCSA(index1.csa, index2.csa);
+    auto seqOffset2 = index1.occ.rank(index1.size(), 0);
+
+    auto bwtFile = external_detail::TmpFile{tmpDir};
+    external_detail::writeInterleavedBWT(index1.occ, index2.occ, bwtFile.path, [&](bool rhs, size_t idx) {
+        if (!rhs) {
+            addJoinedSSAEntry(csa, index1.csa, idx, 0);
+        } else {
+            addJoinedSSAEntry(csa, index2.csa, idx, seqOffset2);
+        }
+    });
+
+    if constexpr (requires() { index1.occRev; }) {
+        auto bwtRevFile = external_detail::TmpFile{tmpDir};
+        external_detail::writeInterleavedBWT(index1.occRev, index2.occRev, bwtRevFile.path, [](bool, size_t) {});
+
+        auto bwt    = MMapFile{bwtFile.path};
+        auto bwtRev = MMapFile{bwtRevFile.path};
+        saveMMap(Index{external_detail::asSpan(bwt), external_detail::asSpan(bwtRev), std::move(csa), threadNbr}, path);
+    } else {
+        auto bwt = MMapFile{bwtFile.path};
+        saveMMap(Index{external_detail::asSpan(bwt), std::move(csa), threadNbr}, path);
+    }
+}
+
+/**!\brief Creates an index of a collection, that does not fit into memory
+ *
+ * The sequences are split into partitions of about `partitionSize` characters
+ * (at least one sequence each). Each partition is indexed in memory and stored
+ * in a temporary file. Neighbouring partitions are merged pairwise with `mergeExternal`,
+ * until a single index remains, which is written to `path` and can be loaded with `loadMMap`.
+ * The sequence ids are the same as if the index was created directly.
+ *
+ * Peak memory is the construction of a single partition (see the constructor of the index)
+ * or the last merge step (occurrence tables and csa of the result plus 1 bit per character),
+ * whichever is larger. `_input` is only accessed one partition at a time,
+ * it can be a view into memory mapped files.
+ *
+ * \param _input a list of sequences
+ * \param samplingRate rate of the sampling
+ * \param threadNbr number of threads used for the suffix arrays and the occurrence tables
+ * \param path file the index is written to
+ * \param partitionSize number of characters per partition
+ * \param tmpDir directory for temporary files, requires about twice the size of the final index
+ */
+template <typename Index>
+void createExternal(Sequences auto const& _input, size_t samplingRate, size_t threadNbr, std::filesystem::path const& path, size_t partitionSize, std::filesystem::path const& tmpDir = std::filesystem::temp_directory_path()) {
+    if (_input.size() == 0) {
+        throw std::runtime_error{"fmindex-collection - can not create an index without sequences"};
+    }
+
+    // index each partition and store it on disk
+    auto parts = std::vector<external_detail::TmpFile>{};
+    size_t begin{0};
+    while (begin < _input.size()) {
+        size_t end  = begin;
+        size_t size = 0;
+        do {
+            size += std::ranges::size(_input[end]) + 1;
+            end  += 1;
+        } while (end < _input.size() && size + std::ranges::size(_input[end]) + 1 <= partitionSize);
+
+        auto part = Index{std::ranges::subrange{_input.begin() + begin, _input.begin() + end}, samplingRate, threadNbr};
+        if (begin == 0 && end == _input.size()) {
+            saveMMap(part, path);
+            return;
+        }
+        parts.emplace_back(tmpDir);
+        saveMMap(part, parts.back().path);
+        begin = end;
+    }
+
+    // merge neighbouring partitions, the order of the sequences is kept
+    while (parts.size() > 1) {
+        auto merged = std::vector<external_detail::TmpFile>{};
+        for (size_t i{0}; i+1 < parts.size(); i += 2) {
+            auto index1 = external_detail::loadPart<Index>(parts[i].path);
+            auto index2 = external_detail::loadPart<Index>(parts[i+1].path);
+            if (parts.size() == 2) {
+                mergeExternal(index1, index2, path, tmpDir, threadNbr);
+                return;
+            }
+            merged.emplace_back(tmpDir);
+            mergeExternal(index1, index2, merged.back().path, tmpDir, threadNbr);
+        }
+        if (parts.size() % 2 == 1) {
+            merged.emplace_back(std::move(parts.back()));
+        }
+        parts = std::move(merged);
+    }
+}
+
+}
@@ -3,10 +3,18 @@
 // SPDX-License-Identifier: BSD-3-Clause
 #pragma once
 
+#include "../rankvector/ParallelConstruction.h"
 #include "FMIndex.h"
 #include "BiFMIndex.h"
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <exception>
+#include <numeric>
+#include <span>
+#include <thread>
+#include <tuple>
 #include <type_traits>
 #include <vector>
 
@@ -28,14 +36,13 @@ auto computeInterleavingR(OccLhs const& lhsOcc, OccRhs const& rhsOcc) -> std::ve
     for (size_t n{}; n < nbrOfSeqRhs; ++n) {
         size_t idx1{};
         size_t idx2{n};
-        uint8_t c{};
+        uint64_t c{};
         do {
             assert(idx1 + idx2 < R.size());
             assert(R[idx1 + idx2] == false);
             R[idx1 + idx2] = true;
-            c = rhsOcc.symbol(idx2);
+            std::tie(idx2, c) = rankAndSymbol(rhsOcc, idx2);
             idx1 = lhsOcc.rank(idx1, c);
-            idx2 = rhsOcc.rank(idx2, c);
         } while(c != 0);
     }
     assert([&]() {
@@ -48,7 +55,136 @@ auto computeInterleavingR(OccLhs const& lhsOcc, OccRhs const& rhsOcc) -> std::ve
     return R;
 }
 
+/**
+ * walks through the interleaved bwt, calls `cb(symb, rhs, idx)` for each row,
+ * `idx` being the row inside of the lhs (rhs == false) or the rhs (rhs == true) index
+ */
+template <typename OccLhs, typename OccRhs, typename CB>
+void forEachInterleavedRow(std::vector<bool> const& R, OccLhs const& lhsOcc, OccRhs const& rhsOcc, CB const& cb) {
+    size_t idx1{}, idx2{};
+    for (bool v : R) {
+        if (!v) {
+            assert(idx1 < lhsOcc.size());
+            cb(static_cast<uint8_t>(lhsOcc.symbol(idx1)), false, idx1);
+            idx1 += 1;
+        } else {
+            assert(idx2 < rhsOcc.size());
+            cb(static_cast<uint8_t>(rhsOcc.symbol(idx2)), true, idx2);
+            idx2 += 1;
+        }
+    }
+}
 
+/**
+ * appends the sample of row `idx` of `srcCsa` to a joined csa
+ */
+template <typename TCSA>
+void addJoinedSSAEntry(TCSA& csa, TCSA const& srcCsa, size_t idx, size_t seqOffset) {
+    auto loc = srcCsa.value(idx);
+    if (loc) {
+        auto [seq, pos] = *loc;
+        csa.push_back(std::tuple{seq + seqOffset, pos});
+    } else {
+        csa.push_back(std::nullopt);
+    }
+}
+
+/**
+ * creates the interleaving of multiple FM-Indices
+ *
+ * For each row of the merged index, the position (inside of `occs`) of the index
+ * the row originates from. Each sequence is walked through LF steps on all occ tables,
+ * the sum of the ranks is the row in the merged index. The walks are independent and
+ * distributed over `threadNbr` threads. The delimiters of later indices are sorted in front
+ * of earlier ones, the result is the same as merging the indices pairwise from left to right.
+ */
+template <typename Occ>
+auto computeInterleavingK(std::span<Occ const* const> occs, size_t threadNbr) -> std::vector<uint8_t> {
+    if (occs.size() > 256) {
+        throw std::runtime_error{"Can not interleave more than 256 indices at once"};
+    }
+    auto const k = occs.size();
+
+    // one job per sequence, firstJob[j] is the first job of index j
+    auto seqCounts = std::vector<size_t>(k);
+    auto firstJob  = std::vector<size_t>(k+1);
+    size_t totalSize{};
+    for (size_t j{0}; j < k; ++j) {
+        seqCounts[j]  = occs[j]->rank(occs[j]->size(), 0);
+        firstJob[j+1] = firstJob[j] + seqCounts[j];
+        totalSize    += occs[j]->size();
+    }
+
+    auto source  = std::vector<uint8_t>(totalSize);
+    auto nextJob = std::atomic<size_t>{0};
+    auto worker = [&]() {
+        auto idx = std::vector<size_t>(k);
+        for (size_t job = nextJob++; job < firstJob[k]; job = nextJob++) {
+            size_t j = std::distance(firstJob.begin(), std::upper_bound(firstJob.begin(), firstJob.end(), job)) - 1;
+            for (size_t i{0}; i < k; ++i) {
+                idx[i] = (i < j) ? 0 : seqCounts[i];
+            }
+            idx[j] = job - firstJob[j];
+            uint64_t c{};
+            do {
+                auto pos = std::accumulate(idx.begin(), idx.end(), size_t{});
+                assert(pos < source.size());
+                source[pos] = j;
+                std::tie(idx[j], c) = rankAndSymbol(*occs[j], idx[j]);
+                for (size_t i{0}; i < k; ++i) {
+                    if (i == j) continue;
+                    idx[i] = occs[i]->rank(idx[i], c);
+                }
+            } while (c != 0);
+        }
+    };
+
+    auto threads = std::vector<std::jthread>{};
+    for (size_t i{1}; i < std::min(threadNbr, firstJob[k]); ++i) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    return source;
+}
+
+/**
+ * the bwt of the merged index, given the interleaving computed by `computeInterleavingK`
+ */
+template <typename Occ>
+auto interleaveBWT(std::span<Occ const* const> occs, std::vector<uint8_t> const& source, size_t threadNbr) -> std::vector<uint8_t> {
+    auto bwt = std::vector<uint8_t>(source.size());
+    // each chunk needs to know how many rows of each index are in front of it
+    rankvector::parallelConstruction<256>(source, 1, threadNbr, [&](size_t begin, size_t end, std::array<uint64_t, 256> acc) {
+        for (size_t i{begin}; i < end; ++i) {
+            auto j = source[i];
+            bwt[i] = occs[j]->symbol(acc[j]);
+            acc[j] += 1;
+        }
+    });
+    return bwt;
+}
+
+/**
+ * joined csa of multiple indices, given the interleaving computed by `computeInterleavingK`
+ */
+template <typename Index>
+auto interleaveCSA(std::span<Index const* const> indices, std::vector<uint8_t> const& source) {
+    auto csa = std::decay_t<decltype(indices[0]->csa)>::createJoinedCSA(indices[0]->csa, indices[1]->csa);
+    for (size_t j{2}; j < indices.size(); ++j) {
+        csa = std::decay_t<decltype(csa)>::createJoinedCSA(csa, indices[j]->csa);
+    }
+
+    auto seqOffsets = std::vector<size_t>(indices.size());
+    for (size_t j{1}; j < indices.size(); ++j) {
+        seqOffsets[j] = seqOffsets[j-1] + indices[j-1]->occ.rank(indices[j-1]->size(), 0);
+    }
+    auto cursors = std::vector<size_t>(indices.size());
+    for (auto j : source) {
+        addJoinedSSAEntry(csa, indices[j]->csa, cursors[j], seqOffsets[j]);
+        cursors[j] += 1;
+    }
+    return csa;
+}
 
 template <typename Res = void, typename OccLhs, typename OccRhs, typename TCSA>
 auto mergeImpl(FMIndex<OccLhs, TCSA> const& index1, FMIndex<OccRhs, TCSA> const& index2, size_t seqOffset1, size_t seqOffset2) -> FMIndex<std::conditional_t<std::is_void_v<Res>, OccLhs, Res>, TCSA> {
@@ -61,32 +197,14 @@ auto mergeImpl(FMIndex<OccLhs, TCSA> const& index1, FMIndex<OccRhs, TCSA> const&
     using CSA = decltype(index1.csa);
     auto csa = CSA::createJoinedCSA(index1.csa, index2.csa);
 
-    auto addSSAEntry = [&csa](auto const& index, size_t idx, size_t seqOffset) {
-        auto loc = index.csa.value(idx);
-        if (loc) {
-            auto [seq, pos] = *loc;
-            csa.push_back(std::tuple{seq + seqOffset, pos});
+    forEachInterleavedRow(R, index1.occ, index2.occ, [&](uint8_t symb, bool rhs, size_t idx) {
+        mergedBWT.push_back(symb);
+        if (!rhs) {
+            addJoinedSSAEntry(csa, index1.csa, idx, seqOffset1);
         } else {
-            csa.push_back(std::nullopt);
+            addJoinedSSAEntry(csa, index2.csa, idx, seqOffset2);
         }
-
-
-    };
-
-    size_t idx1{}, idx2{};
-    for (bool v : R) {
-        if (!v) {
-            assert(idx1 < index1.occ.size());
-            mergedBWT.push_back(index1.occ.symbol(idx1));
-            addSSAEntry(index1, idx1, seqOffset1);
-            idx1 += 1;
-        } else {
-            assert(idx2 < index2.occ.size());
-            mergedBWT.push_back(index2.occ.symbol(idx2));
-            addSSAEntry(index2, idx2, seqOffset2);
-            idx2 += 1;
-        }
-    }
+    });
     R.clear();
 
     return {mergedBWT, std::move(csa)};
@@ -112,29 +230,14 @@ auto mergeImpl(BiFMIndex<OccLhs, TCSA> const& index1, BiFMIndex<OccRhs, TCSA> co
     // compute normal forward bwt
     {
         auto R = computeInterleavingR(index1.occ, index2.occ);
-        auto addSSAEntry = [&csa](auto const& index, size_t idx, size_t seqOffset) {
-            auto loc = index.csa.value(idx);
-            if (loc) {
-                auto [seq, pos] = *loc;
-                csa.push_back(std::tuple{seq + seqOffset, pos});
+        forEachInterleavedRow(R, index1.occ, index2.occ, [&](uint8_t symb, bool rhs, size_t idx) {
+            mergedBWT.push_back(symb);
+            if (!rhs) {
+                addJoinedSSAEntry(csa, index1.csa, idx, seqOffset1);
             } else {
-                csa.push_back(std::nullopt);
+                addJoinedSSAEntry(csa, index2.csa, idx, seqOffset2);
             }
-        };
-        size_t idx1{}, idx2{};
-        for (bool v : R) {
-            if (!v) {
-                assert(idx1 < index1.occ.size());
-                mergedBWT.push_back(index1.occ.symbol(idx1));
-                addSSAEntry(index1, idx1, seqOffset1);
-                idx1 += 1;
-            } else {
-                assert(idx2 < index2.occ.size());
-                mergedBWT.push_back(index2.occ.symbol(idx2));
-                addSSAEntry(index2, idx2, seqOffset2);
-                idx2 += 1;
-            }
-        }
+        });
     }
 
     // Interleave BWT->R and SA->ssa
@@ -144,18 +247,9 @@ auto mergeImpl(BiFMIndex<OccLhs, TCSA> const& index1, BiFMIndex<OccRhs, TCSA> co
     // compute reversed bwt
     {
         auto R = computeInterleavingR(index1.occRev, index2.occRev);
-        size_t idx1{}, idx2{};
-        for (bool v : R) {
-            if (!v) {
-                assert(idx1 < index1.occRev.size());
-                mergedBWTRev.push_back(index1.occRev.symbol(idx1));
-                idx1 += 1;
-            } else {
-                assert(idx2 < index2.occRev.size());
-                mergedBWTRev.push_back(index2.occRev.symbol(idx2));
-                idx2 += 1;
-            }
-        }
+        forEachInterleavedRow(R, index1.occRev, index2.occRev, [&](uint8_t symb, bool, size_t) {
+            mergedBWTRev.push_back(symb);
+        });
     }
 
     return {mergedBWT, mergedBWTRev, std::move(csa)};
@@ -169,4 +263,84 @@ auto merge(BiFMIndex<OccLhs, TCSA> const& index1, BiFMIndex<OccRhs, TCSA> const&
 //    return mergeImpl(index2, index1, index2.occ.rank(index2.size(), 0), 0);
 }
 
+/**
+ * merges multiple FM-Indices at once
+ *
+ * Same result as merging the indices pairwise from left to right, but the interleaving
+ * is computed in a single pass, using `threadNbr` threads.
+ */
+template <typename Res = void, typename Occ, typename TCSA>
+auto merge(std::span<FMIndex<Occ, TCSA> const* const> indices, size_t threadNbr) -> FMIndex<std::conditional_t<std::is_void_v<Res>, Occ, Res>, TCSA> {
+    if (indices.size() < 2) {
+        throw std::runtime_error{"merging requires at least two indices"};
+    }
+    auto occs = std::vector<Occ const*>{};
+    for (auto index : indices) {
+        occs.push_back(&index->occ);
+    }
+    auto source = computeInterleavingK<Occ>(occs, threadNbr);
+    auto bwt    = interleaveBWT<Occ>(occs, source, threadNbr);
+    auto csa    = interleaveCSA(indices, source);
+    return {bwt, std::move(csa), threadNbr};
+}
+
+/**
+ * merges multiple bidirectional FM-Indices at once
+ *
+ * Same result as merging the indices pairwise from left to right, but the interleaving
+ * is computed in a single pass. The reversed bwt is computed concurrently to the forward bwt,
+ * the `threadNbr` threads are split between both.
+ */
+template <typename Res = void, typename Occ, typename TCSA>
+auto merge(std::span<BiFMIndex<Occ, TCSA> const* const> indices, size_t threadNbr) -> BiFMIndex<std::conditional_t<std::is_void_v<Res>, Occ, Res>, TCSA> {
+    if (indices.size() < 2) {
+        throw std::runtime_error{"merging requires at least two indices"};
+    }
+    auto occs    = std::vector<Occ const*>{};
+    using OccRev = typename BiFMIndex<Occ, TCSA>::TableRev;
+    auto occsRev = std::vector<OccRev const*>{};
+    for (auto index : indices) {
+        occs.push_back(&index->occ);
+        occsRev.push_back(&index->occRev);
+    }
+    auto revThreadNbr = std::max(threadNbr / 2, size_t{1});
+    auto fwdThreadNbr = std::max(threadNbr - revThreadNbr, size_t{1});
+
+    // compute reversed bwt on a separate thread
+    auto bwtRev   = std::vector<uint8_t>{};
+    auto revError = std::exception_ptr{};
+    auto revThread = std::jthread{[&]() {
+        try {
+            auto source = computeInterleavingK<OccRev>(occsRev, revThreadNbr);
+            bwtRev = interleaveBWT<OccRev>(occsRev, source, revThreadNbr);
+        } catch(...) {
+            revError = std::current_exception();
+        }
+    }};
+
+    auto source = computeInterleavingK<Occ>(occs, fwdThreadNbr);
+    auto bwt    = interleaveBWT<Occ>(occs, source, fwdThreadNbr);
+    auto csa    = interleaveCSA(indices, source);
+    source.clear();
+    source.shrink_to_fit();
+
+    revThread.join();
+    if (revError) {
+        std::rethrow_exception(revError);
+    }
+    return {bwt, bwtRev, std::move(csa), threadNbr};
+}
+
+/**
+ * same as above, for indices that are stored in a vector
+ */
+template <typename Res = void, typename Index>
+auto merge(std::vector<Index> const& indices, size_t threadNbr) {
+    auto ptrs = std::vector<Index const*>{};
+    for (auto const& index : indices) {
+        ptrs.push_back(&index);
+    }
+    return merge<Res>(std::span<Index const* const>{ptrs}, threadNbr);
+}
+
 }
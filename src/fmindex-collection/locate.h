@@ -3,9 +3,15 @@
 // SPDX-License-Identifier: BSD-3-Clause
 #pragma once
 
+#include "occtable/concepts.h"
+#include "suffixarray/concepts.h"
+
+#include <cassert>
 #include <cstdint>
 #include <optional>
+#include <span>
 #include <tuple>
+#include <type_traits>
 #include <vector>
 
 namespace fmindex_collection {
@@ -61,6 +67,152 @@ struct LocateLinear {
     LocateLinear(index_t const&, cursor_t) -> LocateLinear<index_t, cursor_t>;
 #endif
 
+/**!\brief Locates many rows at once
+ *
+ * Keeps `batchSize` LF walks in flight. In each round the occurrence table
+ * and sampling entries of all walks are prefetched, before any walk continues.
+ * Instead of waiting for each cache miss one after another, the misses of
+ * different walks overlap.
+ *
+ * \param rows rows of the suffix array that should be located
+ * \param out  results (seqId, seqPos), out[i] is the location of rows[i]
+ */
+template <typename index_t>
+void locateBatch(index_t const& index, std::span<size_t const> rows, std::span<std::tuple<size_t, size_t>> out, size_t batchSize = 32) {
+    assert(rows.size() == out.size());
+
+    auto const& occ = index.occ;
+    auto const& csa = index.csa;
+    using occ_t = std::decay_t<decltype(occ)>;
+    using csa_t = std::decay_t<decltype(csa)>;
+
+    // sample markers inside of the occ table, w.row is replaced by the sample index once sampled
+    constexpr bool OccHasValue = OccTableSampleMarker<occ_t> && SuffixArraySampleValue<csa_t>;
+    constexpr bool CsaHasValue = requires() {
+        {csa.prefetch(size_t{})};
+        {csa.hasValue(size_t{})};
+        {csa.prefetchValue(size_t{})};
+    };
+
+    struct Walk {
+        size_t outIdx;
+        size_t row;
+        size_t steps;
+        bool   sampled; // row is sampled, the sample is being prefetched
+    };
+
+    auto walks = std::vector<Walk>{};
+    size_t nextRow{0};
+
+    auto start = [&](Walk& walk) -> bool {
+        if (nextRow == rows.size()) return false;
+        walk = Walk{nextRow, rows[nextRow], 0, false};
+        nextRow += 1;
+        return true;
+    };
+
+    auto isSampled = [&](size_t row) -> bool {
+        if constexpr (OccHasValue) {
+            return occ.hasValue(row);
+        } else if constexpr (CsaHasValue) {
+            return csa.hasValue(row);
+        } else {
+            return csa.value(row).has_value();
+        }
+    };
+
+    for (size_t i{0}; i < batchSize; ++i) {
+        auto walk = Walk{};
+        if (!start(walk)) break;
+        walks.push_back(walk);
+    }
+
+    while (!walks.empty()) {
+        for (auto const& w : walks) {
+            if (w.sampled) continue;
+            if constexpr (OccTablePrefetch<occ_t>) {
+                occ.prefetch(w.row);
+            }
+            if constexpr (!OccHasValue and CsaHasValue) {
+                csa.prefetch(w.row);
+            }
+        }
+
+        for (size_t i{0}; i < walks.size();) {
+            auto& w = walks[i];
+            if (!w.sampled and isSampled(w.row)) {
+                w.sampled = true;
+                if constexpr (OccHasValue) {
+                    w.row = occ.sampleRank(w.row);
+                } else if constexpr (CsaHasValue) {
+                    csa.prefetchValue(w.row);
+                    ++i;
+                    continue;
+                }
+            }
+            if (!w.sampled) {
+                w.row = occ.rank_symbol(w.row);
+                w.steps += 1;
+                ++i;
+                continue;
+            }
+
+            auto [chr, pos] = [&]() -> std::tuple<size_t, size_t> {
+                if constexpr (OccHasValue) {
+                    return csa.sampleValue(w.row);
+                } else {
+                    return *csa.value(w.row);
+                }
+            }();
+            out[w.outIdx] = {chr, pos + w.steps};
+
+            // reuse the walk for the next row or remove it
+            if (start(w)) {
+                ++i;
+            } else {
+                std::swap(w, walks.back());
+                walks.pop_back();
+            }
+        }
+    }
+}
+
+/**!\brief Same as LocateLinear, but locates all positions at once using locateBatch
+ */
+template <typename index_t, typename cursor_t>
+struct LocateBatch {
+    std::vector<std::tuple<size_t, size_t>> positions;
+
+    LocateBatch(index_t const& index, cursor_t cursor, size_t batchSize = 32) {
+        auto rows = std::vector<size_t>(cursor.len);
+        for (size_t i{0}; i < rows.size(); ++i) {
+            rows[i] = cursor.lb + i;
+        }
+        positions.resize(rows.size());
+        locateBatch(index, rows, positions, batchSize);
+
+        // Check if it is the reversed cursor
+        if constexpr (requires(cursor_t c) {{c.query_length()} -> std::same_as<size_t>; }) {
+            for (auto& [subjNo, subjOffset] : positions) {
+                subjOffset -= cursor.depth;
+            }
+        }
+    }
+
+    friend auto begin(LocateBatch const& locate) {
+        return begin(locate.positions);
+    }
+    friend auto end(LocateBatch const& locate) {
+        return end(locate.positions);
+    }
+};
+
+//!TODO remove as soon as clang supports auto deduction guides (not the case in clang 15
+#if __clang__
+    template <typename index_t, typename cursor_t>
+    LocateBatch(index_t const&, cursor_t) -> LocateBatch<index_t, cursor_t>;
+#endif
+
 template <typename index_t, typename cursor_t>
 struct LocateFMTree {
     std::vector<std::tuple<size_t, size_t>> positions;
@@ -81,7 +233,7 @@ struct LocateFMTree {
                     auto opt = index.single_locate_step(idx);
                     uint64_t steps{};
                     for (;!opt && maxSteps > 0; --maxSteps) {
-                        idx = index.occ.rank(idx, index.occ.symbol(idx));
+                        idx = index.occ.rank_symbol(idx);
                         steps += 1;
                         opt = index.single_locate_step(idx);
                     }
@@ -143,7 +295,7 @@ void locateFMTree(index_t const& index, cursor_t cursor, CB const& cb, size_t sa
             auto opt = index.single_locate_step(idx);
             uint64_t steps{};
             for (;!opt && maxSteps > 0; --maxSteps) {
-                idx = index.occ.rank(idx, index.occ.symbol(idx));
+                idx = index.occ.rank_symbol(idx);
                 steps += 1;
                 opt = index.single_locate_step(idx);
             }
@@ -0,0 +1,333 @@
+// SPDX-FileCopyrightText: 2006-2023, Knut Reinert & Freie Universität Berlin
+// SPDX-FileCopyrightText: 2016-2023, Knut Reinert & MPI für molekulare Genetik
+// SPDX-License-Identifier: BSD-3-Clause
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <concepts>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if __has_include(<cereal/archives/binary.hpp>)
+#include <cereal/archives/binary.hpp>
+#include <cereal/types/array.hpp>
+#include <cereal/types/vector.hpp>
+#endif
+
+#if defined(__linux__)
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#define FMC_NUMA 1
+#endif
+
+/**!\brief NUMA aware placement of indices
+ *
+ * On machines with multiple NUMA nodes (sockets), memory is allocated on the node of
+ * the thread that touches it first. An index that is loaded by a single thread is
+ * therefore local to only one node, threads on all other nodes pay the remote
+ * memory latency on every rank query.
+ *
+ * `Replicas` keeps one copy of an index per node and each search thread binds itself
+ * to a node and uses the copy of this node. On machines with a single node (or
+ * without NUMA support) no copies are created and binding does nothing.
+ *
+ * The topology is read from /sys/devices/system/node, placement uses the
+ * `set_mempolicy` system call, libnuma is not required.
+ */
+namespace fmindex_collection::numa {
+
+struct Node {
+    size_t              id;
+    std::vector<size_t> cpus;
+};
+
+namespace detail {
+
+/* parses a cpu list like "0-3,8,10-11"
+ */
+inline auto parseCpuList(std::string const& list) -> std::vector<size_t> {
+    auto cpus   = std::vector<size_t>{};
+    auto stream = std::stringstream{list};
+    auto range  = std::string{};
+    while (std::getline(stream, range, ',')) {
+        if (range.empty() || range == "\n") continue;
+        auto dash  = range.find('-');
+        auto first = std::stoull(range.substr(0, dash));
+        auto last  = (dash == std::string::npos) ? first : std::stoull(range.substr(dash+1));
+        for (auto cpu{first}; cpu <= last; ++cpu) {
+            cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
+
+inline auto readNodes() -> std::vector<Node> {
+    auto result = std::vector<Node>{};
+#if FMC_NUMA
+    auto path = std::filesystem::path{"/sys/devices/system/node"};
+    auto ec   = std::error_code{};
+    for (auto const& entry : std::filesystem::directory_iterator{path, ec}) {
+        auto name = entry.path().filename().string();
+        if (name.size() <= 4 || name.substr(0, 4) != "node" || name.find_first_not_of("0123456789", 4) != std::string::npos) {
+            continue;
+        }
+        auto file = std::ifstream{entry.path() / "cpulist"};
+        auto list = std::string{};
+        std::getline(file, list);
+        auto cpus = parseCpuList(list);
+        if (cpus.empty()) continue; // memory only node
+        result.emplace_back(std::stoull(name.substr(4)), std::move(cpus));
+    }
+    std::ranges::sort(result, {}, &Node::id);
+#endif
+    return result;
+}
+
+}
+
+/**!\brief All NUMA nodes with at least one cpu, sorted by id
+ *
+ * Empty if the topology is not available.
+ */
+inline auto nodes() -> std::vector<Node> const& {
+    static auto const result = detail::readNodes();
+    return result;
+}
+
+/**!\brief number of NUMA nodes, at least one
+ */
+inline size_t nodeCount() {
+    return std::max(size_t{1}, nodes().size());
+}
+
+/**!\brief index (into `nodes()`) of the node the calling thread is running on
+ */
+inline size_t currentNode() {
+#if FMC_NUMA
+    if (nodeCount() == 1) return 0;
+    auto cpu = ::sched_getcpu();
+    if (cpu < 0) return 0;
+    auto const& ns = nodes();
+    for (size_t i{0}; i < ns.size(); ++i) {
+        if (std::ranges::find(ns[i].cpus, size_t(cpu)) != ns[i].cpus.end()) {
+            return i;
+        }
+    }
+#endif
+    return 0;
+}
+
+/**!\brief Binds the calling thread to the cpus of a node
+ *
+ * All further allocations of this thread are preferably placed on this node.
+ * Does nothing on single node machines.
+ *
+ * \param node index into `nodes()`
+ */
+inline void bindThread(size_t node) {
+#if FMC_NUMA
+    if (nodeCount() == 1) return;
+    auto const& n = nodes().at(node);
+
+    auto set = cpu_set_t{};
+    CPU_ZERO(&set);
+    for (auto cpu : n.cpus) {
+        if (cpu < CPU_SETSIZE) {
+            CPU_SET(cpu, &set);
+        }
+    }
+    ::sched_setaffinity(0, sizeof(set), &set);
+
+    // MPOL_PREFERRED, allocations fall back to other nodes if this node is out of memory
+    constexpr int MpolPreferred = 1;
+    auto mask = std::vector<unsigned long>(n.id / (sizeof(unsigned long)*8) + 1);
+    mask[n.id / (sizeof(unsigned long)*8)] |= 1ul << (n.id % (sizeof(unsigned long)*8));
+    ::syscall(SYS_set_mempolicy, MpolPreferred, mask.data(), mask.size() * sizeof(unsigned long) * 8 + 1);
+#else
+    (void)node;
+#endif
+}
+
+/**!\brief Saves the cpu affinity and memory policy of the calling thread and restores them on destruction
+ *
+ * `bindThread` changes the calling thread permanently, this guard undoes it for threads
+ * that are not owned by the library (e.g. the thread calling a parallel search).
+ * Does nothing on single node machines.
+ */
+class ThreadBindingGuard {
+#if FMC_NUMA
+    bool                       active{false};
+    cpu_set_t                  affinity{};
+    int                        mode{};
+    std::vector<unsigned long> mask;
+    bool                       hasMode{false};
+#endif
+
+public:
+    ThreadBindingGuard() {
+#if FMC_NUMA
+        if (nodeCount() == 1) return;
+        CPU_ZERO(&affinity);
+        active = (::sched_getaffinity(0, sizeof(affinity), &affinity) == 0);
+
+        // large enough for 1024 nodes, if the kernel supports more the policy is not restored
+        mask.resize(1024 / (sizeof(unsigned long)*8));
+        hasMode = (::syscall(SYS_get_mempolicy, &mode, mask.data(), mask.size() * sizeof(unsigned long) * 8, nullptr, 0) == 0);
+#endif
+    }
+
+    ThreadBindingGuard(ThreadBindingGuard const&) = delete;
+    auto operator=(ThreadBindingGuard const&) -> ThreadBindingGuard& = delete;
+
+    ~ThreadBindingGuard() {
+#if FMC_NUMA
+        if (active) {
+            ::sched_setaffinity(0, sizeof(affinity), &affinity);
+        }
+        if (hasMode) {
+            constexpr int MpolDefault = 0;
+            if (mode == MpolDefault) {
+                ::syscall(SYS_set_mempolicy, mode, nullptr, 0);
+            } else {
+                ::syscall(SYS_set_mempolicy, mode, mask.data(), mask.size() * sizeof(unsigned long) * 8 + 1);
+            }
+        }
+#endif
+    }
+};
+
+template <typename Index>
+struct Replicas;
+
+#if __has_include(<cereal/archives/binary.hpp>)
+/**!\brief One copy of an index per NUMA node
+ *
+ * The copies are created by serializing the index once and deserializing it on a
+ * thread bound to each node, all memory of a copy is therefore allocated on its node.
+ * On single node machines the original index is used directly.
+ * Requires cereal.
+ */
+template <typename Index>
+struct Replicas {
+    using index_t = Index;
+
+    Index const* primary{};
+    std::vector<std::unique_ptr<Index>> copies; // copy i is placed on node i % nodeCount()
+    mutable std::atomic<size_t> nextCopy{0};
+
+    /**!\brief creates the replicas, index must outlive this object
+     *
+     * \param replicaCount number of copies, copy i is placed on node i % nodeCount().
+     *                     No copies are created if this is 1.
+     */
+    Replicas(Index const& index, size_t replicaCount = nodeCount())
+        : primary{&index}
+    {
+        if (replicaCount <= 1) return;
+
+        auto buffer = std::string{};
+        {
+            auto stream  = std::ostringstream{};
+            auto archive = cereal::BinaryOutputArchive{stream};
+            archive(index);
+            buffer = std::move(stream).str();
+        }
+
+        copies.resize(replicaCount);
+        auto errors = std::vector<std::exception_ptr>(replicaCount);
+        {
+            auto threads = std::vector<std::jthread>{};
+            for (size_t i{0}; i < replicaCount; ++i) {
+                threads.emplace_back([&, i]() {
+                    try {
+                        bindThread(i % nodeCount());
+                        auto stream  = std::istringstream{buffer};
+                        auto archive = cereal::BinaryInputArchive{stream};
+                        auto copy    = std::make_unique<Index>();
+                        archive(*copy);
+                        copies[i] = std::move(copy);
+                    } catch(...) {
+                        errors[i] = std::current_exception();
+                    }
+                });
+            }
+        }
+        for (auto const& e : errors) {
+            if (e) std::rethrow_exception(e);
+        }
+    }
+
+    Replicas(Replicas const&) = delete;
+    auto operator=(Replicas const&) -> Replicas& = delete;
+
+    size_t size() const {
+        return std::max(size_t{1}, copies.size());
+    }
+
+    /**!\brief the i-th copy
+     */
+    auto operator[](size_t i) const -> Index const& {
+        if (copies.empty()) return *primary;
+        return *copies.at(i);
+    }
+
+    /**!\brief a copy placed on the node the calling thread is running on
+     */
+    auto local() const -> Index const& {
+        return (*this)[currentNode() % size()];
+    }
+
+    /**!\brief binds the calling thread to the node of the next copy (round robin) and returns this copy
+     *
+     * Intended to be called once at the start of each search thread. The binding is
+     * not undone, threads that outlive the search must be protected by a `ThreadBindingGuard`.
+     */
+    auto bind() const -> Index const& {
+        if (copies.empty()) return *primary;
+        auto i = nextCopy++ % copies.size();
+        bindThread(i % nodeCount());
+        return *copies[i];
+    }
+};
+#endif
+
+template <typename T>
+struct replicated {
+    using type = T;
+};
+
+template <typename Index>
+struct replicated<Replicas<Index>> {
+    using type = Index;
+};
+
+/**!\brief type of the index, for an index or its replicas
+ */
+template <typename T>
+using replicated_t = typename replicated<T>::type;
+
+/**!\brief index to be used by the calling thread
+ *
+ * For `Replicas` the calling thread is bound to a node, any other index is
+ * returned as is. `parallelQueries` restores the binding of its calling thread.
+ */
+template <typename T>
+auto bindLocal(T const& index) -> replicated_t<T> const& {
+    if constexpr (std::same_as<T, Replicas<replicated_t<T>>>) {
+        return index.bind();
+    } else {
+        return index;
+    }
+}
+
+}
@@ -215,6 +215,10 @@ struct OccTable {
         return Sigma-1;
     }
 
+    uint64_t rank_symbol(uint64_t idx) const {
+        return rank(idx, symbol(idx));
+    }
+
     auto all_ranks(uint64_t idx) const -> std::tuple<std::array<uint64_t, Sigma>, std::array<uint64_t, Sigma>> {
         std::array<uint64_t, Sigma> rs{0};
         std::array<uint64_t, Sigma> prs{0};
@@ -184,6 +184,15 @@ template <size_t TSigma>
 using RecursiveRunBlockEncodedD2 = GenericOccTable<rankvector::rRBBwt<TSigma, 2>, "recursive run block encoded, depth 2", "rec_rbbwt2">;
 static_assert(checkOccTable<RecursiveRunBlockEncodedD2>);
 
+/**
+ * A run length encoded bwt, memory depends on the number of runs
+ *
+ */
+template <size_t TSigma>
+using RunLengthEncoded = GenericOccTable<rankvector::RLEBwt<TSigma>, "run length encoded", "rle">;
+static_assert(checkOccTable<RunLengthEncoded>);
+static_assert(OccTablePrefetch<RunLengthEncoded<4>>);
+
 #ifdef FMC_USE_SDSL
 
 template <size_t TSigma>
@@ -3,6 +3,7 @@
 // SPDX-License-Identifier: BSD-3-Clause
 #pragma once
 
+#include "../MMapAllocator.h"
 #include "../builtins.h"
 #include "concepts.h"
 
@@ -52,7 +53,7 @@ struct Bitvector {
             for (size_t _symb{0}; _symb <= symb; ++_symb) {
                 size_t imask = -1;
                 for (size_t i{0}; i < bitct; ++i) {
-                    imask &= bits[i] ^ -((~symb>>i)&1);
+                    imask &= bits[i] ^ -((~_symb>>i)&1);
                 }
                 mask |= imask;
             };
@@ -110,15 +111,15 @@ struct Bitvector {
     using BlockL0 = blockL0_t;
     using BlockL1 = blockL1_t;
 
-    std::vector<uint64_t> bits;
+    MMapVector<uint64_t> bits;
 //    std::vector<InBitsView> bitsView;
 //    std::vector<InBits> bits;
     std::vector<BlockL0> level0;
     std::vector<BlockL1> level1;
-    std::vector<uint64_t> superBlocks;
+    MMapVector<uint64_t> superBlocks;
 
 
-    std::vector<uint64_t> C;
+    MMapVector<uint64_t> C;
 //    std::array<uint64_t, TSigma+1> C;
 
     Bitvector() = default;
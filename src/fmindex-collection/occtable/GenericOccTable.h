@@ -8,8 +8,12 @@
 
 #include <algorithm>
 #include <array>
+#include <concepts>
 #include <cstdint>
+#include <limits>
 #include <span>
+#include <stdexcept>
+#include <string>
 
 #if __has_include(<cereal/archives/binary.hpp>)
 #include <cereal/types/array.hpp>
@@ -38,16 +42,51 @@ struct StringLiteral {
     }
 };
 
-template <RankVector Vector, StringLiteral Name, StringLiteral Extension>
+// rank vector without sample markers, see `unmarked_type`
+template <typename Vector>
+struct UnmarkedVector {
+    using type = Vector;
+};
+
+template <typename Vector>
+    requires requires() { typename Vector::WithoutSampleMarkers; }
+struct UnmarkedVector<Vector> {
+    using type = typename Vector::WithoutSampleMarkers;
+};
+
+/**!\brief Occ table on top of a rank vector
+ *
+ * \tparam TSize integer type used for row numbers, with uint32_t the table is limited
+ *               to less than 2^32 rows and cursors of an index over this table store
+ *               their intervals with 32 bits (see `index_size_t`)
+ */
+template <RankVector Vector, StringLiteral Name, StringLiteral Extension, std::unsigned_integral TSize = size_t>
 struct GenericOccTable {
     static constexpr size_t Sigma = Vector::Sigma;
+    using size_type = TSize;
+    using unmarked_type = GenericOccTable<typename UnmarkedVector<Vector>::type, Name, Extension, TSize>;
 
-    Vector                      vector;
-    std::array<size_t, Sigma+1> C{};
+    Vector                     vector;
+    std::array<TSize, Sigma+1> C{};
 
     GenericOccTable() = default;
     GenericOccTable(std::span<uint8_t const> _symbols)
-        : vector{_symbols}
+        : GenericOccTable{_symbols, 1}
+    {}
+
+    /**!\brief constructs the rank vector with multiple threads, if supported by the rank vector
+     */
+    GenericOccTable(std::span<uint8_t const> _symbols, size_t threadNbr)
+        : vector{[&]() {
+            if (_symbols.size() >= std::numeric_limits<TSize>::max()) {
+                throw std::runtime_error{"text with " + std::to_string(_symbols.size()) + " rows is too large for the size type of this occ table"};
+            }
+            if constexpr (RankVectorParallelConstruction<Vector>) {
+                return Vector{_symbols, threadNbr};
+            } else {
+                return Vector{_symbols};
+            }
+        }()}
     {
         for (auto c : _symbols) {
             C[c+1] += 1;
@@ -57,9 +96,10 @@ struct GenericOccTable {
         }
     }
 
-    auto prefetch(uint64_t idx) const {
-        (void)idx;
-        vector.prefetch();
+    void prefetch(uint64_t idx) const {
+        if constexpr (requires() { vector.prefetch(idx); }) {
+            vector.prefetch(idx);
+        }
     }
 
     size_t size() const {
@@ -78,6 +118,16 @@ struct GenericOccTable {
         return vector.prefix_rank(idx, symb);
     }
 
+    uint64_t rank_symbol(size_t idx) const {
+        auto [rank, symb] = rankAndSymbol(vector, idx);
+        return rank + C[symb];
+    }
+
+    auto rank_and_symbol(size_t idx) const -> std::tuple<uint64_t, uint64_t> {
+        auto [rank, symb] = rankAndSymbol(vector, idx);
+        return {rank + C[symb], symb};
+    }
+
     auto all_ranks(size_t idx) const -> std::tuple<std::array<uint64_t, Sigma>, std::array<uint64_t, Sigma>> {
         auto [rs, prs] = vector.all_ranks_and_prefix_ranks(idx);
         for (size_t i{0}; i < rs.size(); ++i) {
@@ -86,19 +136,121 @@ struct GenericOccTable {
         return {rs, prs};
     }
 
+    /**!\brief all_ranks of lb and rb
+     *
+     * For intervals of length 0 and 1 only the ranks of lb are computed,
+     * the ranks of rb are derived from the symbol at lb.
+     * Otherwise the rank vector may decode a shared block only once.
+     */
+    auto all_ranks_interval(size_t lb, size_t rb) const -> std::tuple<std::array<uint64_t, Sigma>, std::array<uint64_t, Sigma>, std::array<uint64_t, Sigma>, std::array<uint64_t, Sigma>> {
+        if (rb <= lb + 1) {
+            auto [rs1, prs1] = all_ranks(lb);
+            auto rs2  = rs1;
+            auto prs2 = prs1;
+            if (rb == lb + 1) {
+                auto symb = vector.symbol(lb);
+                rs2[symb] += 1;
+                for (size_t i{symb}; i < Sigma; ++i) {
+                    prs2[i] += 1;
+                }
+            }
+            return {rs1, prs1, rs2, prs2};
+        }
+        if constexpr (RankVectorIntervalRanks<Vector>) {
+            auto [rs1, prs1, rs2, prs2] = vector.all_ranks_and_prefix_ranks_interval(lb, rb);
+            for (size_t i{0}; i < Sigma; ++i) {
+                rs1[i] += C[i];
+                rs2[i] += C[i];
+            }
+            return {rs1, prs1, rs2, prs2};
+        } else {
+            auto [rs1, prs1] = all_ranks(lb);
+            auto [rs2, prs2] = all_ranks(rb);
+            return {rs1, prs1, rs2, prs2};
+        }
+    }
+
+    /**!\brief number of runs, only for run length encoded rank vectors
+     */
+    size_t runCount() const requires RankVectorRunCount<Vector> {
+        return vector.runCount();
+    }
+
+    template <typename CB>
+    void markSamples(CB const& isSampled) requires RankVectorSampleMarker<Vector> {
+        vector.markSamples(isSampled);
+    }
+
+    bool hasValue(size_t idx) const requires RankVectorSampleMarker<Vector> {
+        return vector.isSampled(idx);
+    }
+
+    uint64_t sampleRank(size_t idx) const requires RankVectorSampleMarker<Vector> {
+        return vector.sampleRank(idx);
+    }
+
     template <typename Archive>
     void serialize(Archive& ar) {
         ar(vector, C);
     }
 
     static auto name() -> std::string {
-        return Name;
+        auto name = std::string{Name};
+        if constexpr (RankVectorSampleMarker<Vector>) {
+            name += " (sample markers)";
+        }
+        if constexpr (sizeof(TSize) < sizeof(size_t)) {
+            name += " (" + std::to_string(sizeof(TSize)*8) + "bit rows)";
+        }
+        return name;
     }
 
     static auto extension() -> std::string {
-        return Extension;
+        auto extension = std::string{Extension};
+        if constexpr (RankVectorSampleMarker<Vector>) {
+            extension += "_sm";
+        }
+        if constexpr (sizeof(TSize) < sizeof(size_t)) {
+            extension += "_r" + std::to_string(sizeof(TSize)*8);
+        }
+        return extension;
     }
 
 };
 
+template <typename Table>
+struct WithSize32;
+
+template <RankVector Vector, StringLiteral Name, StringLiteral Extension, std::unsigned_integral TSize>
+struct WithSize32<GenericOccTable<Vector, Name, Extension, TSize>> {
+    using type = GenericOccTable<Vector, Name, Extension, uint32_t>;
+};
+
+/**!\brief Same occ table, but limited to less than 2^32 rows
+ *
+ * Example: `BiFMIndex<occtable::Size32<occtable::Interleaved_16<5>>>`
+ */
+template <typename Table>
+using Size32 = typename WithSize32<Table>::type;
+
+template <typename Table>
+struct WithSampleMarkers;
+
+template <RankVector Vector, StringLiteral Name, StringLiteral Extension, std::unsigned_integral TSize>
+    requires requires() { typename Vector::WithSampleMarkers; }
+struct WithSampleMarkers<GenericOccTable<Vector, Name, Extension, TSize>> {
+    using type = GenericOccTable<typename Vector::WithSampleMarkers, Name, Extension, TSize>;
+};
+
+/**!\brief Same occ table, but with sample markers (see OccTableSampleMarker)
+ *
+ * Marks the sampled rows of the suffix array inside of the occ table blocks, locate
+ * only touches the suffix array once the sample is found. Costs one additional
+ * bit per row, only the occ table of the forward text is marked.
+ *
+ * Example: `BiFMIndex<occtable::SampleMarked<occtable::Interleaved_16<5>>>`
+ */
+template <typename Table>
+using SampleMarked = typename WithSampleMarkers<Table>::type;
+
 }
@@ -3,6 +3,7 @@
 // SPDX-License-Identifier: BSD-3-Clause
 #pragma once
 
+#include "../rankvector/ParallelConstruction.h"
 #include "concepts.h"
 
 #include <algorithm>
@@ -83,6 +84,22 @@ struct Bitvector {
         return blocks[blockId].symbol(bitId);
     }
 
+    /* The symbol at idx is stored at bit idx+1, all values are taken from the same block
+     */
+    uint64_t rank_symbol(uint64_t idx) const {
+        idx += 1;
+        auto blockId      = idx >>  6;
+        auto superBlockId = idx >> 32;
+        auto bitId        = idx &  63;
+        auto const& block = blocks[blockId];
+        auto symb = block.symbol(bitId);
+        auto r = block.rank(bitId, symb) + superBlocks[superBlockId][symb];
+        if (symb > 0) {
+            r -= block.rank(bitId, symb-1) + superBlocks[superBlockId][symb-1];
+        }
+        return r - 1 + C[symb];
+    }
+
     template <typename Archive>
     void serialize(Archive& ar) {
         ar(blocks, superBlocks, C);
@@ -90,44 +107,56 @@ struct Bitvector {
 };
 
 template <uint64_t TSigma>
-Bitvector<TSigma> construct_bitvector(std::span<uint8_t const> _bwt) {
+Bitvector<TSigma> construct_bitvector(std::span<uint8_t const> _bwt, size_t threadNbr = 1) {
     auto const length = _bwt.size();
     Bitvector<TSigma> bitvector;
-    bitvector.blocks.reserve(length/64+2);
-
-    bitvector.blocks.emplace_back();
-    bitvector.superBlocks.emplace_back();
+    bitvector.blocks.resize(length/64+1);
+    bitvector.superBlocks.resize(length/(1ull<<32)+1);
 
     auto& bv = bitvector;
 
-    std::array<uint64_t, TSigma> sblock_acc{0};
-    std::array<uint32_t, TSigma> block_acc{0};
-
-    for (uint64_t size{1}; size <= length; ++size) {
-        if (size % (1ull<<32) == 0) { // new super block + new block
-            bv.superBlocks.emplace_back(sblock_acc);
-            bv.blocks.emplace_back();
-            block_acc = {};
-        } else if (size % 64 == 0) { // new block
-            bv.blocks.emplace_back();
-            bv.blocks.back().blocks = block_acc;
+    // symbol at position i is stored at bit i+1
+    rankvector::parallelConstruction<TSigma>(_bwt, 1ull<<32, threadNbr, [&](size_t begin, size_t end, std::array<uint64_t, TSigma> acc) {
+        if (begin == 0) {
+            begin = 1;
+        } else {
+            acc[_bwt[begin-1]] -= 1;
         }
-        auto blockId      = size >>  6;
-        auto bitId        = size &  63;
-
-        auto start = _bwt[size-1];
-        for (uint64_t symb{start}; symb < TSigma; ++symb) {
-            auto& bits = bv.blocks[blockId].bits[symb];
-            bits = bits | (1ull << bitId);
-            block_acc[symb] += 1;
-            sblock_acc[symb] += 1;
+        // blocks count all symbols smaller or equal
+        std::array<uint64_t, TSigma> sblock_acc{0};
+        std::array<uint32_t, TSigma> block_acc{0};
+        for (uint64_t symb{0}; symb < TSigma; ++symb) {
+            sblock_acc[symb] = acc[symb] + (symb > 0 ? sblock_acc[symb-1] : 0);
         }
-    }
 
-    bv.C[0] = 0;
-    for (uint64_t i{0}; i < TSigma; ++i) {
-        bv.C[i+1] = sblock_acc[i];
-    }
+        bool lastChunk = (end == length);
+        if (lastChunk) end += 1;
+        for (uint64_t size{begin}; size < end; ++size) {
+            if (size % (1ull<<32) == 0) { // new super block + new block
+                bv.superBlocks[size >> 32] = sblock_acc;
+                block_acc = {};
+            } else if (size % 64 == 0) { // new block
+                bv.blocks[size >> 6].blocks = block_acc;
+            }
+            auto blockId      = size >>  6;
+            auto bitId        = size &  63;
+
+            auto start = _bwt[size-1];
+            for (uint64_t symb{start}; symb < TSigma; ++symb) {
+                auto& bits = bv.blocks[blockId].bits[symb];
+                bits = bits | (1ull << bitId);
+                block_acc[symb] += 1;
+                sblock_acc[symb] += 1;
+            }
+        }
+
+        if (lastChunk) {
+            bv.C[0] = 0;
+            for (uint64_t i{0}; i < TSigma; ++i) {
+                bv.C[i+1] = sblock_acc[i];
+            }
+        }
+    });
     return bv;
 }
 
@@ -148,8 +177,8 @@ struct OccTable {
     }
 
     OccTable() = default;
-    OccTable(std::span<uint8_t const> _bwt) {
-        bitvector = construct_bitvector<Sigma>(_bwt);
+    OccTable(std::span<uint8_t const> _bwt, size_t threadNbr = 1) {
+        bitvector = construct_bitvector<Sigma>(_bwt, threadNbr);
     }
 
     static auto name() -> std::string {
@@ -179,6 +208,10 @@ struct OccTable {
         return bitvector.symbol(idx);
     }
 
+    uint64_t rank_symbol(uint64_t idx) const {
+        return bitvector.rank_symbol(idx);
+    }
+
     auto all_ranks(uint64_t idx) const -> std::tuple<std::array<uint64_t, Sigma>, std::array<uint64_t, Sigma>> {
         std::array<uint64_t, Sigma> rs{0};
         std::array<uint64_t, Sigma> prs{0};
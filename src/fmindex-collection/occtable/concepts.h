@@ -3,6 +3,8 @@
 // SPDX-License-Identifier: BSD-3-Clause
 #pragma once
 
+#include "../concepts.h"
+
 #include <array>
 #include <cstddef>
 #include <cstdint>
@@ -51,6 +53,13 @@ concept OccTable = requires(T t, std::span<SymbolType const> bwt, uint64_t idx,
      */
     { t.prefix_rank(idx, symb) } -> std::same_as<uint64_t>;
 
+    /* Return the rank of the symbol at a certain row (LF-mapping)
+     *
+     * \param first - row index
+     * \return same as t.rank(idx, t.symbol(idx))
+     */
+    { t.rank_symbol(idx) } -> std::same_as<uint64_t>;
+
     /* Combined rank and prefix_rank over all symbols
      *
      * \param first - row index
@@ -127,4 +136,126 @@ concept OccTableMemoryUsage = OccTable<T> and requires(T t) {
     { t.memoryUsage() } -> std::same_as<uint64_t>;
 };
 
+/** Additional constructor, that uses multiple threads
+ */
+template <typename T>
+concept OccTableParallelConstruction = OccTable<T> and requires(std::span<uint8_t const> bwt, size_t threadNbr) {
+    { T{bwt, threadNbr} } -> std::same_as<T>;
+};
+
+/** Additional sample marker, stored inside of the occ table blocks
+ *
+ * Allows to check if a row is sampled without touching the suffix array,
+ * the marker is inside the block that is loaded by `t.rank_symbol(idx)` anyway.
+ */
+template <typename T>
+concept OccTableSampleMarker = OccTable<T> and requires(T t, T const ct, uint64_t idx) {
+    /* Marks all rows `i` for which `cb(i)` is true
+     */
+    { t.markSamples([](size_t) { return false; }) };
+
+    /* Checks if row idx is marked
+     */
+    { ct.hasValue(idx) } -> std::same_as<bool>;
+
+    /* Number of marked rows in front of idx,
+     * e.g. the position of the sample of row idx in the sampled suffix array
+     */
+    { ct.sampleRank(idx) } -> std::same_as<uint64_t>;
+};
+
+/** Additional method computing `all_ranks` of both ends of an interval [lb, rb)
+ */
+template <typename T>
+concept OccTableIntervalRanks = OccTable<T> and requires(T t, uint64_t lb, uint64_t rb) {
+    /* Same result as calling `t.all_ranks(lb)` and `t.all_ranks(rb)`, but
+     * may share work, e.g. if both ends are inside the same block
+     *
+     * \return tuple {ranks of lb, prefix ranks of lb, ranks of rb, prefix ranks of rb}
+     */
+    { t.all_ranks_interval(lb, rb) } -> std::same_as<std::tuple<std::array<uint64_t, T::Sigma>, std::array<uint64_t, T::Sigma>, std::array<uint64_t, T::Sigma>, std::array<uint64_t, T::Sigma>>>;
+};
+
+/**!\brief Computes `all_ranks` of lb and rb, in one call if the table supports it
+ *
+ * \return tuple {ranks of lb, prefix ranks of lb, ranks of rb, prefix ranks of rb}
+ */
+template <OccTable Table>
+auto allRanksInterval(Table const& occ, uint64_t lb, uint64_t rb) {
+    if constexpr (OccTableIntervalRanks<Table>) {
+        return occ.all_ranks_interval(lb, rb);
+    } else {
+        auto [rs1, prs1] = occ.all_ranks(lb);
+        auto [rs2, prs2] = occ.all_ranks(rb);
+        return std::tuple{rs1, prs1, rs2, prs2};
+    }
+}
+
+/** Additional method returning the LF step together with the symbol of the row, see `rankAndSymbol`
+ */
+template <typename T>
+concept OccTableRankAndSymbol = OccTable<T> and requires(T t, uint64_t idx) {
+    /* Same result as `t.rank_symbol(idx)` and `t.symbol(idx)`, but decodes the block only once
+     *
+     * \return tuple {rank_symbol(idx), symbol(idx)}
+     */
+    { t.rank_and_symbol(idx) } -> std::same_as<std::tuple<uint64_t, uint64_t>>;
+};
+
+/**!\brief Creates an occurrence table, with multiple threads if the table supports it
+ */
+template <OccTable Table>
+auto createOccTable(std::span<uint8_t const> bwt, size_t threadNbr) -> Table {
+    if constexpr (OccTableParallelConstruction<Table>) {
+        return Table{bwt, threadNbr};
+    } else {
+        return Table{bwt};
+    }
+}
+
+/**!\brief Integer type that is able to address every row of an occ table
+ *
+ * Tables may declare a smaller `size_type` (e.g. uint32_t for tables with
+ * less than 2^32 rows), otherwise size_t is used.
+ * Cursors use this type to store their intervals.
+ */
+template <typename T>
+struct OccTableSizeType {
+    using type = size_t;
+};
+
+template <typename T>
+    requires requires() { typename T::size_type; }
+struct OccTableSizeType<T> {
+    using type = typename T::size_type;
+};
+
+template <typename T>
+using occ_size_t = typename OccTableSizeType<T>::type;
+
+/**!\brief Integer type that is able to address every row of an index, see `occ_size_t`
+ */
+template <typename Index>
+using index_size_t = occ_size_t<decltype(Index::occ)>;
+
+/**!\brief Same occ table, but without sample markers (see OccTableSampleMarker)
+ *
+ * Tables may declare an `unmarked_type`, otherwise the table itself is used.
+ * Only the occ table of the forward text is marked, the occ table of the
+ * reversed text uses this type and does not pay for the markers.
+ */
+template <typename T>
+struct OccTableUnmarkedType {
+    using type = T;
+};
+
+template <typename T>
+    requires requires() { typename T::unmarked_type; }
+struct OccTableUnmarkedType<T> {
+    using type = typename T::unmarked_type;
+};
+
+template <typename T>
+using occ_unmarked_t = typename OccTableUnmarkedType<T>::type;
+
 }
@@ -4,6 +4,7 @@
 #pragma once
 
 #include "../DenseVector.h"
+#include "../MMapAllocator.h"
 #include "concepts.h"
 
 #include <bit>
@@ -114,9 +115,9 @@ struct DenseEPRV6 {
     using BlockL0 = std::array<blockL0_t, TSigma>;
     using BlockL1 = std::array<blockL1_t, TSigma>;
 
-    std::vector<InBits> bits;
-    std::vector<BlockL0> level0;
-    std::vector<BlockL1> level1;
+    MMapVector<InBits> bits;
+    MMapVector<BlockL0> level0;
+    MMapVector<BlockL1> level1;
     DenseVector superBlocks;
 
     size_t totalSize;
@@ -266,7 +267,7 @@ struct DenseEPRV6 {
         return {rs, prs};
     }
 
-    uint64_t rank_symbol(uint64_t idx) const {
+    auto rank_and_symbol(uint64_t idx) const -> std::tuple<uint64_t, uint64_t> {
         prefetch(idx);
 
         auto level0Id     = idx >>  6;
@@ -275,10 +276,14 @@ struct DenseEPRV6 {
         auto bitId = idx & 63;
 
         auto [rank, symb] = bits[level0Id].rank_symbol(bitId);
-        return    rank
-                + level0[level0Id][symb]
-                + level1[level1Id][symb]
-                + superBlocks[superBlockId*TSigma+symb];
+        return {  rank
+                 + level0[level0Id][symb]
+                 + level1[level1Id][symb]
+                 + superBlocks[superBlockId*TSigma+symb], symb};
+    }
+
+    uint64_t rank_symbol(uint64_t idx) const {
+        return std::get<0>(rank_and_symbol(idx));
     }
 
     template <typename Archive>
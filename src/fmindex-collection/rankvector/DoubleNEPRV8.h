@@ -2,7 +2,10 @@
 // SPDX-License-Identifier: BSD-3-Clause
 #pragma once
 
+#include "../MMapAllocator.h"
 #include "../bitset_popcount.h"
+#include "ParallelConstruction.h"
+#include "SampleCounts.h"
 #include "concepts.h"
 #include "utils.h"
 #include "EPRV3.h"
@@ -20,11 +23,18 @@
 
 namespace fmindex_collection::rankvector {
 
-template <size_t TSigma, size_t popcount_width, typename blockL0_t = uint16_t, typename blockL1_t = uint32_t>
+/**!\brief DoubleNEPRV8 rank vector
+ *
+ * \tparam SampleMarkers additionally stores a sample marker bit for each row (see RankVectorSampleMarker)
+ */
+template <size_t TSigma, size_t popcount_width, typename blockL0_t = uint16_t, typename blockL1_t = uint32_t, bool SampleMarkers = false>
 struct DoubleNEPRV8 {
 
     static constexpr size_t Sigma = TSigma;
 
+    using WithSampleMarkers    = DoubleNEPRV8<TSigma, popcount_width, blockL0_t, blockL1_t, true>;
+    using WithoutSampleMarkers = DoubleNEPRV8<TSigma, popcount_width, blockL0_t, blockL1_t, false>;
+
     // number of full length bit vectors needed `2^bitct > TSigma`
     static constexpr auto bitct = std::bit_width(TSigma-1);
     // next full power of 2
@@ -32,7 +42,7 @@ struct DoubleNEPRV8 {
 
     static constexpr auto popcount_width_bits = std::bit_width(popcount_width-1);
 
-    struct InBits {
+    struct InBits : SampleMarkerBits<SampleMarkers, std::bitset<popcount_width>> {
         std::array<std::bitset<popcount_width>, bitct> bits;
 
         uint8_t symbol(uint64_t idx) const {
@@ -45,7 +55,7 @@ struct DoubleNEPRV8 {
         }
 
         template <bool reverse=false>
-        uint64_t rank(uint64_t idx, uint8_t symb) const {
+        uint64_t rank(uint64_t idx, uint8_t symb, cpu_dispatch::Kernels const* kernels = nullptr) const {
             assert(idx < popcount_width);
             auto f = [&]<uint64_t I>(std::integer_sequence<uint64_t, I>) {
                 if (symb & (1<<I)) {
@@ -59,9 +69,9 @@ struct DoubleNEPRV8 {
             }(std::make_integer_sequence<uint64_t, bitct>{});
 
             if constexpr (reverse) {
-                return rshift_and_count(mask, idx);
+                return rshift_and_count(mask, idx, kernels);
             }
-            return lshift_and_count(mask, popcount_width-idx);
+            return lshift_and_count(mask, popcount_width-idx, kernels);
         }
 
         static inline std::array<std::bitset<popcount_width>, 2> flip_masks = []() {
@@ -71,11 +81,11 @@ struct DoubleNEPRV8 {
         }();
 
 
-        uint64_t signed_rank(uint64_t idx, uint8_t symb) const {
+        uint64_t signed_rank(uint64_t idx, uint8_t symb, cpu_dispatch::Kernels const* kernels = nullptr) const {
             assert(idx < popcount_width*2);
             if constexpr (bitct == 3 && false) {
                 auto mask = ternarylogic<popcount_width>(symb, bits[2], bits[1], bits[0]);
-                return signed_rshift_and_count(mask, idx);
+                return signed_rshift_and_count(mask, idx, kernels);
             } else {
                 auto f = [&]<uint64_t I>(std::integer_sequence<uint64_t, I>) {
                     return flip_masks[(symb>>I) & 1] ^ bits[I];
@@ -85,13 +95,13 @@ struct DoubleNEPRV8 {
                     return (f(std::integer_sequence<uint64_t, Is>{})&...);
                 }(std::make_integer_sequence<uint64_t, bitct>{});
 
-                return signed_rshift_and_count(mask, idx);
+                return signed_rshift_and_count(mask, idx, kernels);
             }
         }
 
 
         template <bool reverse=false>
-        uint64_t prefix_rank(uint64_t idx, uint64_t symb) const {
+        uint64_t prefix_rank(uint64_t idx, uint64_t symb, cpu_dispatch::Kernels const* kernels = nullptr) const {
             assert(idx < popcount_width);
             auto fallback_mask = [&]() -> std::bitset<popcount_width> {
                 auto mask = std::bitset<popcount_width>{};
@@ -114,24 +124,25 @@ struct DoubleNEPRV8 {
             auto mask = [&]() -> std::bitset<popcount_width> {
                 #if __AVX512F__
                 if constexpr (bitct == 3) {
-                    return ternarylogic<popcount_width>(symb, bits[2], bits[1], bits[0]);
-//                    _mm512_ternarylogic_epi32(
+                    // truth table selecting all symbols smaller or equal to symb
+                    return ternarylogic<popcount_width>((2ull << symb) - 1, bits[2], bits[1], bits[0]);
                 }
                 #endif
                 return fallback_mask();
             }();
 
             if constexpr (reverse) {
-                return rshift_and_count(mask, idx);
+                return rshift_and_count(mask, idx, kernels);
             }
-            return lshift_and_count(mask, popcount_width-idx);
+            return lshift_and_count(mask, popcount_width-idx, kernels);
         }
 
-        uint64_t signed_prefix_rank(uint64_t idx, uint64_t symb) const {
+        uint64_t signed_prefix_rank(uint64_t idx, uint64_t symb, cpu_dispatch::Kernels const* kernels = nullptr) const {
             assert(idx < popcount_width*2);
             if constexpr (bitct == 3) {
-                auto mask = ternarylogic<popcount_width>(symb, bits[2], bits[1], bits[0]);
-                return signed_rshift_and_count(mask, idx);
+                // truth table selecting all symbols smaller or equal to symb
+                auto mask = ternarylogic<popcount_width>((2ull << symb) - 1, bits[2], bits[1], bits[0]);
+                return signed_rshift_and_count(mask, idx, kernels);
             } else {
                 auto mask = [&]() -> std::bitset<popcount_width> {
                     auto mask = std::bitset<popcount_width>{};
@@ -146,13 +157,13 @@ struct DoubleNEPRV8 {
                     }
                     return mask;
                 }();
-                return signed_rshift_and_count(mask, idx);
+                return signed_rshift_and_count(mask, idx, kernels);
             }
         }
 
 
         template <bool reverse=false>
-        auto all_ranks(uint64_t idx) const -> std::array<uint64_t, TSigma> {
+        auto all_ranks(uint64_t idx, cpu_dispatch::Kernels const* kernels = nullptr) const -> std::array<uint64_t, TSigma> {
             assert(idx < popcount_width);
 
             auto rs = std::array<uint64_t, TSigma>{0};
@@ -170,9 +181,9 @@ struct DoubleNEPRV8 {
                     return (f(i, std::integer_sequence<uint64_t, Is>{})&...);
                 }(std::make_integer_sequence<uint64_t, bitct>{});
                 if constexpr (reverse) {
-                    rs[i] = rshift_and_count(mask, idx);
+                    rs[i] = rshift_and_count(mask, idx, kernels);
                 } else {
-                    rs[i] = lshift_and_count(mask, popcount_width-idx);
+                    rs[i] = lshift_and_count(mask, popcount_width-idx, kernels);
                 }
             }
             return rs;
@@ -180,25 +191,31 @@ struct DoubleNEPRV8 {
 
 
         template <bool reverse=false>
-        auto signed_all_ranks(uint64_t idx) const -> std::array<uint64_t, TSigma> {
+        auto signed_all_ranks(uint64_t idx, cpu_dispatch::Kernels const* kernels = nullptr) const -> std::array<uint64_t, TSigma> {
             assert(idx < popcount_width*2);
 
             auto rs = std::array<uint64_t, TSigma>{0};
 
-            auto bits2 = bits;
-            for (auto& b : bits2) {
-                b = b & signed_rightshift_masks<popcount_width>[idx];
-            }
+            // the shift mask is applied after combining, flipped bits would reintroduce masked bits
+            auto const& shift_mask = signed_rightshift_masks<popcount_width>[idx];
 
-            auto f = [&]<uint64_t I>(uint64_t _symb, std::integer_sequence<uint64_t, I>) {
-                return flip_masks[(_symb>>I) & 1] ^ bits2[I];
-            };
+            if constexpr (TSigma <= 8 && bitset_detail::hasWordLayout<popcount_width>) {
+                // all symbols at once, vectorized if the cpu supports it
+                auto counts = symbol_counts3(bits, shift_mask, kernels);
+                for (uint64_t i{0}; i < TSigma; ++i) {
+                    rs[i] = counts[i];
+                }
+            } else {
+                auto f = [&]<uint64_t I>(uint64_t _symb, std::integer_sequence<uint64_t, I>) {
+                    return flip_masks[(_symb>>I) & 1] ^ bits[I];
+                };
 
-            for (uint64_t i{0}; i < TSigma; ++i) {
-                auto mask = [&]<uint64_t ...Is>(std::integer_sequence<uint64_t, Is...>) {
-                    return (f(i, std::integer_sequence<uint64_t, Is>{})&...);
-                }(std::make_integer_sequence<uint64_t, bitct>{});
-                rs[i] = mask.count();
+                for (uint64_t i{0}; i < TSigma; ++i) {
+                    auto mask = [&]<uint64_t ...Is>(std::integer_sequence<uint64_t, Is...>) {
+                        return (f(i, std::integer_sequence<uint64_t, Is>{})&...);
+                    }(std::make_integer_sequence<uint64_t, bitct>{});
+                    rs[i] = popcount_and(mask, shift_mask, kernels);
+                }
             }
             return rs;
         }
@@ -207,35 +224,15 @@ struct DoubleNEPRV8 {
 
 
 
-        template <bool reverse=false>
-        auto rank_symbol(uint64_t idx) const -> std::tuple<uint64_t, uint64_t> {
-            assert(idx < popcount_width);
-
-            uint64_t symb{};
-            auto mask = std::bitset<popcount_width>{};
-            auto f = [&]<uint64_t I>(std::integer_sequence<uint64_t, I>) {
-                auto b = (bits[I] >> idx).test(0);
-                mask |= bits[I] ^ -b;
-                symb |= b << I;
-            };
-            [&]<uint64_t ...Is>(std::integer_sequence<uint64_t, Is...>) {
-                (f(std::integer_sequence<uint64_t, Is>{}) ,...);
-            }(std::make_integer_sequence<uint64_t, bitct>{});
-
-            if constexpr (reverse) {
-                auto count = rshift_and_count(~mask, idx);
-                return {count, symb};
-            }
-            auto count = lshift_and_count(~mask, popcount_width-idx);
-            return {count, symb};
-        }
-
         template <typename Archive>
         void load(Archive& ar) {
             for (auto& v : bits) {
                 (void)v;
                 loadBV(v, ar);
             }
+            if constexpr (SampleMarkers) {
+                loadBV(this->samples, ar);
+            }
         }
         template <typename Archive>
         void save(Archive& ar) const {
@@ -244,6 +241,9 @@ struct DoubleNEPRV8 {
                 (void)v;
                 saveBV(v, ar);
             }
+            if constexpr (SampleMarkers) {
+                saveBV(this->samples, ar);
+            }
         }
 
     };
@@ -254,97 +254,78 @@ struct DoubleNEPRV8 {
     using BlockL0 = std::array<blockL0_t, TSigma>;
     using BlockL1 = std::array<blockL1_t, TSigma>;
 
-    std::vector<InBits> bits;
-    std::vector<BlockL0> level0;
-    std::vector<BlockL1> level1;
-    std::vector<std::array<uint64_t, TSigma>> superBlocks;
+    MMapVector<InBits> bits;
+    MMapVector<BlockL0> level0;
+    MMapVector<BlockL1> level1;
+    MMapVector<std::array<uint64_t, TSigma>> superBlocks;
+
+    [[no_unique_address]] OptionalSampleCounts<SampleMarkers, popcount_width> sampleCounts;
 
     size_t totalLength;
 
+    cpu_dispatch::Kernels const* kernels{&cpu_dispatch::current()}; // selected once per rank vector, not serialized
+
     DoubleNEPRV8() = default;
-    DoubleNEPRV8(std::span<uint8_t const> _symbols) {
+    DoubleNEPRV8(std::span<uint8_t const> _symbols)
+        : DoubleNEPRV8{_symbols, 1}
+    {}
+
+    DoubleNEPRV8(std::span<uint8_t const> _symbols, size_t threadNbr) {
         totalLength = _symbols.size();
         auto const length = _symbols.size();
-        level1.reserve(length/(1ull<<level1_size)+2);
-        level0.reserve(length/popcount_width+2);
-        bits.reserve(length/popcount_width+2);
-
-//        auto blockL0_acc = std::array<blockL0_t, TSigma>{0};
-        auto blockL1_acc = std::array<blockL1_t, TSigma>{0};
-        auto sblock_acc  = std::array<uint64_t, TSigma>{0};
-
-        for (uint64_t size{0}; size < length+1; ++size) {
-            if (size % (1ull<<level1_size) == 0) { // new l3 block
-                superBlocks.emplace_back(sblock_acc);
-                level1.emplace_back();
-//                level0.emplace_back();
-                if (level0.empty()) {
-                    level0.emplace_back();
-                }
-                level0.back() = {};
-                level0.back()[0] = popcount_width;
-                bits.emplace_back();
-//                blockL0_acc = {};
-                blockL1_acc = {};
-            } else if (size % (1ull<<level0_size) == 0) { // new l1 block
-                level1.emplace_back(blockL1_acc);
-//                level0.emplace_back();
-                level0.back() = {};
-                level0.back()[0] = popcount_width;
-                bits.emplace_back();
-
-//                blockL0_acc = {};
-            } else if (size % popcount_width == 0) { // new l0 block
-                if ((size / popcount_width) % 2 == 1) {
-                    level0.emplace_back(level0.back());
-                    level0.back()[0] += popcount_width*2;
+        level1.resize(length/(1ull<<level0_size)+1);
+        level0.resize((length/popcount_width+1)/2+1);
+        bits.resize(length/popcount_width+1);
+        superBlocks.resize(length/(1ull<<level1_size)+1);
+
+        // two neighboring blocks share one level0 entry, the entry is kept in `level0_acc`
+        // and written when the next entry starts
+        parallelConstruction<TSigma>(_symbols, 1ull<<level1_size, threadNbr, [&](size_t begin, size_t end, std::array<uint64_t, TSigma> sblock_acc) {
+            auto blockL1_acc = std::array<blockL1_t, TSigma>{0};
+            auto level0_acc  = BlockL0{};
+            auto level0Id    = (begin / popcount_width + 1) / 2;
+            bool lastChunk   = (end == length);
+
+            if (lastChunk) end += 1; // last chunk adds a block to the end
+            for (uint64_t size{begin}; size < end; ++size) {
+                if (size % (1ull<<level1_size) == 0) { // new l3 block
+                    superBlocks[size >> level1_size] = sblock_acc;
+                    level0_acc = {};
+                    level0_acc[0] = popcount_width;
+                    blockL1_acc = {};
+                } else if (size % (1ull<<level0_size) == 0) { // new l1 block
+                    level1[size >> level0_size] = blockL1_acc;
+                    level0_acc = {};
+                    level0_acc[0] = popcount_width;
+                } else if (size % popcount_width == 0) { // new l0 block
+                    if ((size / popcount_width) % 2 == 1) {
+                        level0[level0Id] = level0_acc;
+                        level0Id += 1;
+                        level0_acc[0] += popcount_width*2;
+                    }
                 }
-                bits.emplace_back();
-            }
-            // Abort, we only wanted to add a new block to the end, if required
-            if (size == length) continue;
+                // Abort, we only wanted to add a new block to the end, if required
+                if (size == length) continue;
 
-            auto level0Id     = size >>  (popcount_width_bits);
-            auto bitId        = size &  (popcount_width-1);
+                auto bitsId = size >>  (popcount_width_bits);
+                auto bitId  = size &  (popcount_width-1);
 
-            uint64_t symb = _symbols[size];
+                uint64_t symb = _symbols[size];
 
-            for (uint64_t i{}; i < bitct; ++i) {
-                auto b = ((symb>>i)&1);
-                bits[level0Id].bits[i].set(bitId, b);
-            }
-//            blockL0_acc[symb] += 1;
-            level0.back()[symb] += 1;
-            blockL1_acc[symb] += 1;
-            sblock_acc[symb] += 1;
-            level0.back()[0] -= 1;
-
-/*            {
-                size_t a{};
-                for (auto v : level0.back()) {
-                    a += v;
+                for (uint64_t i{}; i < bitct; ++i) {
+                    auto b = ((symb>>i)&1);
+                    bits[bitsId].bits[i].set(bitId, b);
                 }
-                assert(a == 64+(((level0.size()-1)%2)*128));
-            }*/
-        }
-
-/*        for (size_t i{0}; i < level0.size(); ++i) {
-            size_t a{};
-            for (auto v : level0[i]) {
-                a += v;
+                level0_acc[symb] += 1;
+                blockL1_acc[symb] += 1;
+                sblock_acc[symb] += 1;
+                level0_acc[0] -= 1;
             }
-            assert(a == 64+((i%2)*128));
-        }*/
-
-        // check last level0, this should be more efficient
-/*        {
-            uint64_t a{};
-            for (size_t symb{}; symb < Sigma; ++symb) {
-                a += level0.back()[symb];
+            // the last entry of all other chunks is overwritten by the following chunk
+            if (lastChunk) {
+                level0[level0Id] = level0_acc;
             }
-            assert(a <= popcount_width);
-            level0.back()[0] += (popcount_width - a);
-        }*/
+        });
     }
 
     void prefetch(uint64_t idx) const {
@@ -370,58 +351,75 @@ struct DoubleNEPRV8 {
     }
 
     uint64_t rank(uint64_t idx, uint8_t symb) const {
-        prefetch(idx);
-
-        auto level0Id     = idx >> popcount_width_bits;
-        auto level1Id     = idx >> level0_size;
-        auto superBlockId = idx >> level1_size;
-        #if 0
-        auto bitId        = idx &  (popcount_width - 1);
-
-        if ((idx / popcount_width) % 2 == 1) {
+        return with_popcnt(kernels, [&]() -> uint64_t {
+            prefetch(idx);
+
+            auto level0Id     = idx >> popcount_width_bits;
+            auto level1Id     = idx >> level0_size;
+            auto superBlockId = idx >> level1_size;
+            #if 0
+            auto bitId        = idx &  (popcount_width - 1);
+
+            if ((idx / popcount_width) % 2 == 1) {
+                return  size_t{}
+                        + bits[level0Id].rank(bitId, symb)
+                        + level0[level0Id/2][symb]
+                        + level1[level1Id][symb]
+                        + superBlocks[superBlockId][symb];
+            } else {
+                return  size_t{}
+                        + level0[level0Id/2][symb]
+                        + level1[level1Id][symb]
+                        + superBlocks[superBlockId][symb]
+                        - bits[level0Id].template rank</*reverse = */true>(bitId, symb);
+            }
+            #else
+            auto bitId        = idx &  (popcount_width*2 - 1);
+            auto sign         = (level0Id % 2)*2-1;
             return  size_t{}
-                    + bits[level0Id].rank(bitId, symb)
+                    + bits[level0Id].signed_rank(bitId, symb, kernels)*sign
                     + level0[level0Id/2][symb]
                     + level1[level1Id][symb]
                     + superBlocks[superBlockId][symb];
-        } else {
-            return  size_t{}
-                    + level0[level0Id/2][symb]
-                    + level1[level1Id][symb]
-                    + superBlocks[superBlockId][symb]
-                    - bits[level0Id].template rank</*reverse = */true>(bitId, symb);
-        }
-        #else
-        auto bitId        = idx &  (popcount_width*2 - 1);
-        auto sign         = (level0Id % 2)*2-1;
-        return  size_t{}
-                + bits[level0Id].signed_rank(bitId, symb)*sign
-                + level0[level0Id/2][symb]
-                + level1[level1Id][symb]
-                + superBlocks[superBlockId][symb];
-        #endif
+            #endif
 
+        });
     }
 
     uint64_t prefix_rank(uint64_t idx, uint8_t symb) const {
-        prefetch(idx);
+        return with_popcnt(kernels, [&]() -> uint64_t {
+            prefetch(idx);
+
+            auto level0Id     = idx >>  popcount_width_bits;
+            auto level1Id     = idx >> level0_size;
+            auto superBlockId = idx >> level1_size;
+            #if 0
+            auto bitId        = idx &  (popcount_width - 1);
+            if ((idx / popcount_width) % 2 == 1) {
+                uint64_t a={};
+                for (uint64_t i{0}; i <= symb; ++i) {
+                    a += size_t{}
+                         + level0[level0Id/2][i]
+                         + level1[level1Id][i]
+                         + superBlocks[superBlockId][i];
 
-        auto level0Id     = idx >>  popcount_width_bits;
-        auto level1Id     = idx >> level0_size;
-        auto superBlockId = idx >> level1_size;
-        #if 0
-        auto bitId        = idx &  (popcount_width - 1);
-        if ((idx / popcount_width) % 2 == 1) {
-            uint64_t a={};
-            for (uint64_t i{0}; i <= symb; ++i) {
-                a += size_t{}
-                     + level0[level0Id/2][i]
-                     + level1[level1Id][i]
-                     + superBlocks[superBlockId][i];
+                }
+                return a + bits[level0Id].prefix_rank(bitId, symb);
+            } else {
+                uint64_t a={};
+                for (uint64_t i{0}; i <= symb; ++i) {
+                    a += size_t{}
+                         + level0[level0Id/2][i]
+                         + level1[level1Id][i]
+                         + superBlocks[superBlockId][i];
 
+                }
+                auto c = bits[level0Id].template prefix_rank</*reverse = */true>(bitId, symb);
+                return a - c;
             }
-            return a + bits[level0Id].prefix_rank(bitId, symb);
-        } else {
+            #else
+            auto bitId        = idx &  (popcount_width*2 - 1);
+            auto sign         = (level0Id % 2)*2-1;
             uint64_t a={};
             for (uint64_t i{0}; i <= symb; ++i) {
                 a += size_t{}
@@ -430,164 +428,226 @@ struct DoubleNEPRV8 {
                      + superBlocks[superBlockId][i];
 
             }
-            auto c = bits[level0Id].template prefix_rank</*reverse = */true>(bitId, symb);
-            return a - c;
-        }
-        #else
-        auto bitId        = idx &  (popcount_width*2 - 1);
-        auto sign         = (level0Id % 2)*2-1;
-        uint64_t a={};
-        for (uint64_t i{0}; i <= symb; ++i) {
-            a += size_t{}
-                 + level0[level0Id/2][i]
-                 + level1[level1Id][i]
-                 + superBlocks[superBlockId][i];
-
-        }
-        return a + bits[level0Id].signed_prefix_rank(bitId, symb)*sign;
-        #endif
+            return a + bits[level0Id].signed_prefix_rank(bitId, symb, kernels)*sign;
+            #endif
+        });
     }
 
 
     auto all_ranks(uint64_t idx) const -> std::array<uint64_t, TSigma> {
-        prefetch(idx);
+        return with_popcnt(kernels, [&]() -> std::array<uint64_t, TSigma> {
+            prefetch(idx);
+
+            auto level0Id     = idx >>  popcount_width_bits;
+            auto level1Id     = idx >> level0_size;
+            auto superBlockId = idx >> level1_size;
+            #if 0
+            auto bitId        = idx &  (popcount_width - 1);
+            auto res = std::array<uint64_t, TSigma>{};
+            if ((idx / popcount_width) % 2 == 1) {
+                for (uint64_t symb{0}; symb < TSigma; ++symb) {
+                    res[symb] =   bits[level0Id].rank(bitId, symb)
+                                + level0[level0Id/2][symb]
+                                + level1[level1Id][symb]
+                                + superBlocks[superBlockId][symb];
+                }
+            } else {
+                for (uint64_t symb{0}; symb < TSigma; ++symb) {
+                    res[symb] =   level0[level0Id/2][symb]
+                                + level1[level1Id][symb]
+                                + superBlocks[superBlockId][symb]
+                                - bits[level0Id].template rank</*reverse =*/ true>(bitId, symb);
+                }
 
-        auto level0Id     = idx >>  popcount_width_bits;
-        auto level1Id     = idx >> level0_size;
-        auto superBlockId = idx >> level1_size;
-        #if 0
-        auto bitId        = idx &  (popcount_width - 1);
-        auto res = std::array<uint64_t, TSigma>{};
-        if ((idx / popcount_width) % 2 == 1) {
-            for (uint64_t symb{0}; symb < TSigma; ++symb) {
-                res[symb] =   bits[level0Id].rank(bitId, symb)
-                            + level0[level0Id/2][symb]
-                            + level1[level1Id][symb]
-                            + superBlocks[superBlockId][symb];
             }
-        } else {
+            #else
+            auto bitId        = idx &  (popcount_width*2 - 1);
+            auto sign         = (level0Id % 2)*2-1;
+            //auto res = std::array<uint64_t, TSigma>{};
+            auto res = bits[level0Id].signed_all_ranks(bitId, kernels);
             for (uint64_t symb{0}; symb < TSigma; ++symb) {
                 res[symb] =   level0[level0Id/2][symb]
                             + level1[level1Id][symb]
                             + superBlocks[superBlockId][symb]
-                            - bits[level0Id].template rank</*reverse =*/ true>(bitId, symb);
+                            + res[symb]*sign;
             }
 
-        }
-        #else
-        auto bitId        = idx &  (popcount_width*2 - 1);
-        auto sign         = (level0Id % 2)*2-1;
-        //auto res = std::array<uint64_t, TSigma>{};
-        auto res = bits[level0Id].signed_all_ranks(bitId);
-        for (uint64_t symb{0}; symb < TSigma; ++symb) {
-            res[symb] =   level0[level0Id/2][symb]
-                        + level1[level1Id][symb]
-                        + superBlocks[superBlockId][symb]
-                        + res[symb]*sign;
-        }
-
-        #endif
-        return res;
+            #endif
+            return res;
+        });
     }
 
     auto all_ranks_and_prefix_ranks(uint64_t idx) const -> std::tuple<std::array<uint64_t, TSigma>, std::array<uint64_t, TSigma>> {
-        prefetch(idx);
+        return with_popcnt(kernels, [&]() -> std::tuple<std::array<uint64_t, TSigma>, std::array<uint64_t, TSigma>> {
+            prefetch(idx);
 
-        auto level0Id     = idx >>  popcount_width_bits;
-        auto level1Id     = idx >> level0_size;
-        auto superBlockId = idx >> level1_size;
+            auto level0Id     = idx >>  popcount_width_bits;
+            auto level1Id     = idx >> level0_size;
+            auto superBlockId = idx >> level1_size;
 
-        auto prs = std::array<uint64_t, TSigma>{};
+            auto prs = std::array<uint64_t, TSigma>{};
 
-    #if 0
-        auto bitId        = idx &  (popcount_width - 1);
-        if ((idx / popcount_width) % 2 >= 1) {
-            auto rs = bits[level0Id].all_ranks(bitId);
+        #if 0
+            auto bitId        = idx &  (popcount_width - 1);
+            if ((idx / popcount_width) % 2 >= 1) {
+                auto rs = bits[level0Id].all_ranks(bitId);
+
+                rs[0] +=   level0[level0Id/2][0]
+                         + level1[level1Id][0]
+                         + superBlocks[superBlockId][0];
+
+                prs[0] = rs[0];
+                for (uint64_t symb{1}; symb < TSigma; ++symb) {
+                    auto a =   level0[level0Id/2][symb]
+                             + level1[level1Id][symb]
+                             + superBlocks[superBlockId][symb]
+                             + rs[symb];
+
+                    rs[symb]  = a;
+                    prs[symb] = prs[symb-1] + a;
+                }
+                return {rs, prs};
+            } else {
+                auto rs = bits[level0Id].template all_ranks</*reverse =*/true>(bitId);
+
+                rs[0]  =   level0[level0Id/2][0]
+                         + level1[level1Id][0]
+                         + superBlocks[superBlockId][0]
+                         - rs[0];
+
+                prs[0] = rs[0];
+                for (uint64_t symb{1}; symb < TSigma; ++symb) {
+                    auto a =   level0[level0Id/2][symb]
+                             + level1[level1Id][symb]
+                             + superBlocks[superBlockId][symb]
+                             - rs[symb];
+
+                    rs[symb] = a;
+                    prs[symb] = prs[symb-1] + a;
+                }
+                return {rs, prs};
+            }
+        #else
+            auto bitId        = idx &  (popcount_width*2 - 1);
+            auto sign         = (level0Id % 2)*2-1;
+            //auto res = std::array<uint64_t, TSigma>{};
+            auto res = bits[level0Id].signed_all_ranks(bitId, kernels);
+            for (uint64_t symb{0}; symb < TSigma; ++symb) {
+                res[symb] =   level0[level0Id/2][symb]
+                            + level1[level1Id][symb]
+                            + superBlocks[superBlockId][symb]
+                            + res[symb]*sign;
+                if (symb > 0) {
+                    prs[symb] = prs[symb-1] + res[symb];
+                } else {
+                    prs[symb] = res[symb];
+                }
+            }
+            return {res, prs};
 
-            rs[0] +=   level0[level0Id/2][0]
-                     + level1[level1Id][0]
-                     + superBlocks[superBlockId][0];
 
-            prs[0] = rs[0];
-            for (uint64_t symb{1}; symb < TSigma; ++symb) {
-                auto a =   level0[level0Id/2][symb]
-                         + level1[level1Id][symb]
-                         + superBlocks[superBlockId][symb]
-                         + rs[symb];
+        #endif
+        });
+    }
 
-                rs[symb]  = a;
-                prs[symb] = prs[symb-1] + a;
+    /**!\brief all_ranks_and_prefix_ranks of lb and rb
+     *
+     * If both are inside the same block, the block and the level0/level1/superblock counts are loaded only once.
+     */
+    auto all_ranks_and_prefix_ranks_interval(uint64_t lb, uint64_t rb) const -> std::tuple<std::array<uint64_t, TSigma>, std::array<uint64_t, TSigma>, std::array<uint64_t, TSigma>, std::array<uint64_t, TSigma>> {
+        return with_popcnt(kernels, [&]() -> std::tuple<std::array<uint64_t, TSigma>, std::array<uint64_t, TSigma>, std::array<uint64_t, TSigma>, std::array<uint64_t, TSigma>> {
+            static_assert(popcount_width <= (1ull<<level0_size), "a block must not cross level1 boundaries");
+
+            auto level0Id = lb >> popcount_width_bits;
+            if (level0Id != (rb >> popcount_width_bits)) {
+                auto [rs1, prs1] = all_ranks_and_prefix_ranks(lb);
+                auto [rs2, prs2] = all_ranks_and_prefix_ranks(rb);
+                return {rs1, prs1, rs2, prs2};
             }
-            return {rs, prs};
-        } else {
-            auto rs = bits[level0Id].template all_ranks</*reverse =*/true>(bitId);
+            prefetch(lb);
+
+            auto level1Id     = lb >> level0_size;
+            auto superBlockId = lb >> level1_size;
+            auto sign         = (level0Id % 2)*2-1;
 
-            rs[0]  =   level0[level0Id/2][0]
-                     + level1[level1Id][0]
-                     + superBlocks[superBlockId][0]
-                     - rs[0];
+            auto const& block = bits[level0Id];
+            auto rs1 = block.signed_all_ranks(lb & (popcount_width*2 - 1), kernels);
+            auto rs2 = block.signed_all_ranks(rb & (popcount_width*2 - 1), kernels);
 
-            prs[0] = rs[0];
-            for (uint64_t symb{1}; symb < TSigma; ++symb) {
+            auto prs1 = std::array<uint64_t, TSigma>{};
+            auto prs2 = std::array<uint64_t, TSigma>{};
+            for (uint64_t symb{0}; symb < TSigma; ++symb) {
                 auto a =   level0[level0Id/2][symb]
                          + level1[level1Id][symb]
-                         + superBlocks[superBlockId][symb]
-                         - rs[symb];
-
-                rs[symb] = a;
-                prs[symb] = prs[symb-1] + a;
+                         + superBlocks[superBlockId][symb];
+                rs1[symb] = a + rs1[symb]*sign;
+                rs2[symb] = a + rs2[symb]*sign;
+                prs1[symb] = rs1[symb] + (symb > 0 ? prs1[symb-1] : 0);
+                prs2[symb] = rs2[symb] + (symb > 0 ? prs2[symb-1] : 0);
             }
-            return {rs, prs};
-        }
-    #else
-        auto bitId        = idx &  (popcount_width*2 - 1);
-        auto sign         = (level0Id % 2)*2-1;
-        //auto res = std::array<uint64_t, TSigma>{};
-        auto res = bits[level0Id].signed_all_ranks(bitId);
-        for (uint64_t symb{0}; symb < TSigma; ++symb) {
-            res[symb] =   level0[level0Id/2][symb]
-                        + level1[level1Id][symb]
-                        + superBlocks[superBlockId][symb]
-                        + res[symb]*sign;
-            if (symb > 0) {
-                prs[symb] = prs[symb-1] + res[symb];
-            } else {
-                prs[symb] = 0;
-            }
-        }
-        return {res, prs};
-
+            return {rs1, prs1, rs2, prs2};
+        });
+    }
 
-    #endif
+    auto rank_and_symbol(uint64_t idx) const -> std::tuple<uint64_t, uint64_t> {
+        return with_popcnt(kernels, [&]() -> std::tuple<uint64_t, uint64_t> {
+            prefetch(idx);
+
+            auto level0Id     = idx >>  popcount_width_bits;
+            auto level1Id     = idx >> level0_size;
+            auto superBlockId = idx >> level1_size;
+            auto sign         = (level0Id % 2)*2-1;
+
+            auto const& block = bits[level0Id];
+            uint64_t symb = block.symbol(idx & (popcount_width-1));
+            return {  level0[level0Id/2][symb]
+                     + level1[level1Id][symb]
+                     + superBlocks[superBlockId][symb]
+                     + block.signed_rank(idx & (popcount_width*2 - 1), symb, kernels)*sign, symb};
+        });
     }
 
     uint64_t rank_symbol(uint64_t idx) const {
-        prefetch(idx);
+        return std::get<0>(rank_and_symbol(idx));
+    }
 
-        auto level0Id     = idx >>  popcount_width_bits;
-        auto level1Id     = idx >> level0_size;
-        auto superBlockId = idx >> level1_size;
-        auto bitId        = idx & (popcount_width-1);
+    /**!\brief marks all rows `i` for which `isSampled(i)` is true
+     */
+    template <typename CB>
+    void markSamples(CB const& isSampled) requires SampleMarkers {
+        for (auto& block : bits) {
+            block.samples.reset();
+        }
+        for (size_t idx{0}; idx < totalLength; ++idx) {
+            if (isSampled(idx)) {
+                bits[idx >> popcount_width_bits].samples.set(idx & (popcount_width-1));
+            }
+        }
+        sampleCounts.build(bits.size(), [&](size_t blockId) -> uint64_t {
+            return bits[blockId].samples.count();
+        });
+    }
 
-        if ((idx / popcount_width) % 2 == 1) {
-            auto [rank, symb] = bits[level0Id].rank_symbol(bitId);
-            return    rank
-                    + level0[level0Id/2][symb]
-                    + level1[level1Id][symb]
-                    + superBlocks[superBlockId][symb];
-        } else {
-            auto [rank, symb] = bits[level0Id].template rank_symbol</*reverse = */true>(bitId);
-            return    level0[level0Id/2][symb]
-                    + level1[level1Id][symb]
-                    + superBlocks[superBlockId][symb];
-                    - rank;
+    bool isSampled(uint64_t idx) const requires SampleMarkers {
+        return bits[idx >> popcount_width_bits].samples.test(idx & (popcount_width-1));
+    }
 
-        }
+    /**!\brief number of sampled rows in front of idx
+     */
+    uint64_t sampleRank(uint64_t idx) const requires SampleMarkers {
+        auto level0Id = idx >> popcount_width_bits;
+        auto bitId    = idx & (popcount_width-1);
+        return sampleCounts.rank(level0Id) + (bits[level0Id].samples << (popcount_width - bitId)).count();
     }
 
     template <typename Archive>
     void serialize(Archive& ar) {
-        ar(bits, level0, level1, superBlocks, totalLength);
+        if constexpr (SampleMarkers) {
+            serializeSampleMarkerFormat(ar);
+            ar(bits, level0, level1, superBlocks, sampleCounts, totalLength);
+        } else {
+            ar(bits, level0, level1, superBlocks, totalLength);
+        }
 //        std::cout << "bits: " << bits.size() << " " << sizeof(bits[0]) << " -> " << bits.size() * sizeof(bits[0]) << "\n";
 //        std::cout << "level0: " << level0.size() << " " << sizeof(level0[0]) << " -> " << level0.size() * sizeof(level0[0]) << "\n";
 //        std::cout << "level1: " << level1.size() << " " << sizeof(level1[0]) << " -> " << level1.size() * sizeof(level1[0]) << "\n";
@@ -598,6 +658,9 @@ struct DoubleNEPRV8 {
 template <size_t Sigma>
 using Double64ShortEPRV8 = DoubleNEPRV8<Sigma, 64, uint8_t, uint16_t>;
 static_assert(checkRankVector<Double64ShortEPRV8>);
+static_assert(RankVectorIntervalRanks<Double64ShortEPRV8<4>>);
+static_assert(!RankVectorSampleMarker<Double64ShortEPRV8<4>>);
+static_assert(RankVectorSampleMarker<Double64ShortEPRV8<4>::WithSampleMarkers>);
 
 template <size_t Sigma>
 using Double128ShortEPRV8 = DoubleNEPRV8<Sigma, 128, uint8_t, uint16_t>;
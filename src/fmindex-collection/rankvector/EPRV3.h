@@ -3,6 +3,10 @@
 // SPDX-License-Identifier: BSD-3-Clause
 #pragma once
 
+#include "../MMapAllocator.h"
+#include "../bitset_popcount.h"
+#include "ParallelConstruction.h"
+#include "SampleCounts.h"
 #include "concepts.h"
 
 #include <bit>
@@ -12,11 +16,18 @@
 
 namespace fmindex_collection::rankvector {
 
-template <size_t TSigma, typename block_t = uint16_t>
+/**!\brief EPRV3 rank vector
+ *
+ * \tparam SampleMarkers additionally stores a sample marker bit for each row (see RankVectorSampleMarker)
+ */
+template <size_t TSigma, typename block_t = uint16_t, bool SampleMarkers = false>
 struct EPRV3 {
 
     static constexpr size_t Sigma = TSigma;
 
+    using WithSampleMarkers    = EPRV3<TSigma, block_t, true>;
+    using WithoutSampleMarkers = EPRV3<TSigma, block_t, false>;
+
     // number of full length bitvectors needed `2^bitct ≥ TSigma`
     static constexpr auto bitct = std::bit_width(TSigma-1);
     // next full power of 2
@@ -38,7 +49,7 @@ struct EPRV3 {
         }
     };
 
-    struct InBits {
+    struct InBits : SampleMarkerBits<SampleMarkers> {
         std::array<uint64_t, bitct> bits{};
 
         uint8_t symbol(uint64_t idx) const {
@@ -60,7 +71,7 @@ struct EPRV3 {
             }(std::make_integer_sequence<uint64_t, bitct>{});
 
             auto bitset = std::bitset<64>(mask) << (64-idx);
-            return bitset.count();
+            return popcount(bitset);
         }
 
         uint64_t prefix_rank(uint64_t idx, uint64_t symb) const {
@@ -76,7 +87,7 @@ struct EPRV3 {
             }
 
             auto bitset = std::bitset<64>(mask) << (64-idx);
-            return bitset.count();
+            return popcount(bitset);
         }
 
         auto all_ranks(uint64_t idx) const -> std::array<uint64_t, TSigma> {
@@ -92,7 +103,7 @@ struct EPRV3 {
                 auto mask = [&]<uint64_t ...Is>(std::integer_sequence<uint64_t, Is...>) {
                     return (f(i, std::integer_sequence<uint64_t, Is>{})&...);
                 }(std::make_integer_sequence<uint64_t, bitct>{});
-                rs[i] = (std::bitset<64>(mask) << (64 - idx)).count();
+                rs[i] = popcount(std::bitset<64>(mask) << (64 - idx));
             }
             return rs;
         }
@@ -113,59 +124,68 @@ struct EPRV3 {
 
             auto bitset = std::bitset<64>{~mask} << (64-idx);
 
-            return {bitset.count(), symb};
+            return {popcount(bitset), symb};
         }
 
         template <typename Archive>
         void serialize(Archive& ar) {
             ar(bits);
+            if constexpr (SampleMarkers) {
+                ar(this->samples);
+            }
         }
     };
 
     static constexpr uint64_t block_size = sizeof(block_t) * 8;
 
-    std::vector<InBits> bits;
-    std::vector<Block> blocks_;
-    std::vector<std::array<uint64_t, TSigma>> superBlocks;
+    MMapVector<InBits> bits;
+    MMapVector<Block> blocks_;
+    MMapVector<std::array<uint64_t, TSigma>> superBlocks;
+    [[no_unique_address]] OptionalSampleCounts<SampleMarkers, 64> sampleCounts;
     size_t totalLength;
 
-    EPRV3() = default;
-    EPRV3(std::span<uint8_t const> _symbols) {
-        totalLength = _symbols.size();
-        blocks_.reserve(_symbols.size()/block_size+1);
-        bits.reserve(_symbols.size()/block_size+1);
-
-        auto sblock_acc = std::array<uint64_t, TSigma>{}; // accumulator for super blocks
-        auto block_acc  = std::array<block_t, TSigma>{};  // accumulator for blocks
-
-        for (uint64_t size{0}; size < _symbols.size();) {
-            superBlocks.emplace_back(sblock_acc);
-            block_acc = {};
+    cpu_dispatch::Kernels const* kernels{&cpu_dispatch::current()}; // selected once per rank vector, not serialized
 
-             for (uint64_t blockId{0}; blockId < (uint64_t{1}<<block_size)/64 and size < _symbols.size(); ++blockId) {
-                blocks_.emplace_back();
-                blocks_.back().blocks = block_acc;
-                bits.emplace_back();
+    EPRV3() = default;
+    EPRV3(std::span<uint8_t const> _symbols)
+        : EPRV3{_symbols, 1}
+    {}
 
-                for (uint64_t bitId{0}; bitId < 64 and size < _symbols.size(); ++bitId, ++size) {
+    EPRV3(std::span<uint8_t const> _symbols, size_t threadNbr) {
+        totalLength = _symbols.size();
+        auto const length = _symbols.size();
+        blocks_.resize(length/64+1);
+        bits.resize(length/64+1);
+        superBlocks.resize(length/(uint64_t{1}<<block_size)+1);
+
+        parallelConstruction<TSigma>(_symbols, uint64_t{1}<<block_size, threadNbr, [&](size_t begin, size_t end, std::array<uint64_t, TSigma> sblock_acc) {
+            auto block_acc = std::array<block_t, TSigma>{}; // accumulator for blocks
+
+            if (end == length) end += 1; // last chunk adds a block to the end
+            for (uint64_t size{begin}; size < end; ++size) {
+                if (size % (uint64_t{1}<<block_size) == 0) { // new super block + new block
+                    superBlocks[size >> block_size] = sblock_acc;
+                    block_acc = {};
+                } else if (size % 64 == 0) { // new block
+                    blocks_[size >> 6].blocks = block_acc;
+                }
+                // Abort, we only wanted to add a new block to the end, if required
+                if (size == length) continue;
 
-                    uint64_t symb = _symbols[size];
+                auto blockId = size >>  6;
+                auto bitId   = size &  63;
 
-                    for (uint64_t i{}; i < bitct; ++i) {
-                        auto b = ((symb>>i)&1);
-                        bits.back().bits[i] |= (b << bitId);
-                    }
+                uint64_t symb = _symbols[size];
 
-                    block_acc[symb] += 1;
-                    sblock_acc[symb] += 1;
+                for (uint64_t i{}; i < bitct; ++i) {
+                    auto b = ((symb>>i)&1);
+                    bits[blockId].bits[i] |= (b << bitId);
                 }
+
+                block_acc[symb] += 1;
+                sblock_acc[symb] += 1;
             }
-        }
-        // For safety we add a new super block and block
-        superBlocks.emplace_back(sblock_acc);
-        blocks_.emplace_back();
-        blocks_.back().blocks = block_acc;
-        bits.emplace_back();
+        });
     }
 
     void prefetch(uint64_t idx) const {
@@ -189,73 +209,122 @@ struct EPRV3 {
     }
 
     uint64_t rank(uint64_t idx, uint8_t symb) const {
-        prefetch(idx);
-
-        auto blockId      = idx >>  6;
-        auto superBlockId = idx >> block_size;
-        auto bitId        = idx &  63;
-        return blocks_[blockId][symb] + bits[blockId].rank(bitId, symb) + superBlocks[superBlockId][symb];
+        return with_popcnt(kernels, [&]() -> uint64_t {
+            prefetch(idx);
+
+            auto blockId      = idx >>  6;
+            auto superBlockId = idx >> block_size;
+            auto bitId        = idx &  63;
+            return blocks_[blockId][symb] + bits[blockId].rank(bitId, symb) + superBlocks[superBlockId][symb];
+        });
     }
 
     uint64_t prefix_rank(uint64_t idx, uint8_t symb) const {
-        prefetch(idx);
-
-        auto blockId      = idx >>  6;
-        auto superBlockId = idx >> block_size;
-        auto bitId        = idx &  63;
-        uint64_t a={};
-        for (uint64_t i{0}; i<= symb; ++i) {
-            a += superBlocks[superBlockId][i] + blocks_[blockId][i];
-        }
-        return bits[blockId].prefix_rank(bitId, symb) + a;
+        return with_popcnt(kernels, [&]() -> uint64_t {
+            prefetch(idx);
+
+            auto blockId      = idx >>  6;
+            auto superBlockId = idx >> block_size;
+            auto bitId        = idx &  63;
+            uint64_t a={};
+            for (uint64_t i{0}; i<= symb; ++i) {
+                a += superBlocks[superBlockId][i] + blocks_[blockId][i];
+            }
+            return bits[blockId].prefix_rank(bitId, symb) + a;
+        });
     }
 
 
     auto all_ranks(uint64_t idx) const -> std::array<uint64_t, TSigma> {
-        prefetch(idx);
-
-        auto blockId      = idx >>  6;
-        auto superBlockId = idx >> block_size;
-        auto bitId        = idx &  63;
-        auto res = std::array<uint64_t, TSigma>{};
-        for (uint64_t symb{0}; symb < TSigma; ++symb) {
-            res[symb] = blocks_[blockId][symb] + bits[blockId].rank(bitId, symb) + superBlocks[superBlockId][symb];
-        }
-        return res;
+        return with_popcnt(kernels, [&]() -> std::array<uint64_t, TSigma> {
+            prefetch(idx);
+
+            auto blockId      = idx >>  6;
+            auto superBlockId = idx >> block_size;
+            auto bitId        = idx &  63;
+            auto res = std::array<uint64_t, TSigma>{};
+            for (uint64_t symb{0}; symb < TSigma; ++symb) {
+                res[symb] = blocks_[blockId][symb] + bits[blockId].rank(bitId, symb) + superBlocks[superBlockId][symb];
+            }
+            return res;
+        });
     }
 
     auto all_ranks_and_prefix_ranks(uint64_t idx) const -> std::tuple<std::array<uint64_t, TSigma>, std::array<uint64_t, TSigma>> {
-        prefetch(idx);
+        return with_popcnt(kernels, [&]() -> std::tuple<std::array<uint64_t, TSigma>, std::array<uint64_t, TSigma>> {
+            prefetch(idx);
 
-        auto blockId      = idx >>  6;
-        auto superBlockId = idx >> block_size;
-        auto bitId        = idx &  63;
+            auto blockId      = idx >>  6;
+            auto superBlockId = idx >> block_size;
+            auto bitId        = idx &  63;
 
-        std::array<uint64_t, TSigma> prs;
-        auto rs = bits[blockId].all_ranks(bitId);
+            std::array<uint64_t, TSigma> prs;
+            auto rs = bits[blockId].all_ranks(bitId);
 
-        rs[0] += superBlocks[superBlockId][0] + blocks_[blockId][0];
-        prs[0] = rs[0];
-        for (uint64_t symb{1}; symb < TSigma; ++symb) {
-            prs[symb] = prs[symb-1] + superBlocks[superBlockId][symb] + rs[symb] + blocks_[blockId][symb];
-            rs[symb] += superBlocks[superBlockId][symb] + blocks_[blockId][symb];
-        }
-        return {rs, prs};
+            rs[0] += superBlocks[superBlockId][0] + blocks_[blockId][0];
+            prs[0] = rs[0];
+            for (uint64_t symb{1}; symb < TSigma; ++symb) {
+                prs[symb] = prs[symb-1] + superBlocks[superBlockId][symb] + rs[symb] + blocks_[blockId][symb];
+                rs[symb] += superBlocks[superBlockId][symb] + blocks_[blockId][symb];
+            }
+            return {rs, prs};
+        });
+    }
+
+    auto rank_and_symbol(uint64_t idx) const -> std::tuple<uint64_t, uint64_t> {
+        return with_popcnt(kernels, [&]() -> std::tuple<uint64_t, uint64_t> {
+            prefetch(idx);
+
+            auto blockId = idx >> 6;
+            auto bitId = idx & 63;
+            auto superBlockId = idx >> block_size;
+            auto [rank, symb] = bits[blockId].rank_symbol(bitId);
+            return {rank + superBlocks[superBlockId][symb] + blocks_[blockId][symb], symb};
+        });
     }
 
     uint64_t rank_symbol(uint64_t idx) const {
-        prefetch(idx);
+        return std::get<0>(rank_and_symbol(idx));
+    }
 
-        auto blockId = idx >> 6;
-        auto bitId = idx & 63;
-        auto superBlockId = idx >> block_size;
-        auto [rank, symb] = bits[blockId].rank_symbol(bitId);
-        return rank + superBlocks[superBlockId][symb] + blocks_[blockId][symb];
+    /**!\brief marks all rows `i` for which `isSampled(i)` is true
+     */
+    template <typename CB>
+    void markSamples(CB const& isSampled) requires SampleMarkers {
+        for (auto& block : bits) {
+            block.samples = 0;
+        }
+        for (size_t idx{0}; idx < totalLength; ++idx) {
+            if (isSampled(idx)) {
+                bits[idx >> 6].samples |= 1ull << (idx & 63);
+            }
+        }
+        sampleCounts.build(bits.size(), [&](size_t blockId) -> uint64_t {
+            return std::popcount(uint64_t{bits[blockId].samples});
+        });
+    }
+
+    bool isSampled(uint64_t idx) const requires SampleMarkers {
+        return (bits[idx >> 6].samples >> (idx & 63)) & 1;
+    }
+
+    /**!\brief number of sampled rows in front of idx
+     */
+    uint64_t sampleRank(uint64_t idx) const requires SampleMarkers {
+        auto level0Id = idx >> 6;
+        auto bitId    = idx & 63;
+        auto mask     = (1ull << bitId) - 1;
+        return sampleCounts.rank(level0Id) + std::popcount(bits[level0Id].samples & mask);
     }
 
     template <typename Archive>
     void serialize(Archive& ar) {
-        ar(blocks_, bits, superBlocks, totalLength);
+        if constexpr (SampleMarkers) {
+            serializeSampleMarkerFormat(ar);
+            ar(blocks_, bits, superBlocks, sampleCounts, totalLength);
+        } else {
+            ar(blocks_, bits, superBlocks, totalLength);
+        }
     }
 
 };
@@ -265,6 +334,8 @@ static_assert(checkRankVector<EPRV3_8>);
 
 template <size_t TSigma> using EPRV3_16 = EPRV3<TSigma, uint16_t>;
 static_assert(checkRankVector<EPRV3_16>);
+static_assert(!RankVectorSampleMarker<EPRV3_16<4>>);
+static_assert(RankVectorSampleMarker<EPRV3_16<4>::WithSampleMarkers>);
 
 #if SIZE_MAX == UINT64_MAX
 template <size_t TSigma> using EPRV3_32 = EPRV3<TSigma, uint32_t>;
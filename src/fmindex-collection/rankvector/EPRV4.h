@@ -3,25 +3,35 @@
 // SPDX-License-Identifier: BSD-3-Clause
 #pragma once
 
+#include "../MMapAllocator.h"
 #include "concepts.h"
 #include "EPRV3.h"
+#include "ParallelConstruction.h"
+#include "SampleCounts.h"
 
 #include <bit>
 #include <vector>
 
 namespace fmindex_collection::rankvector {
 
-template <size_t TSigma>
+/**!\brief EPRV4 rank vector
+ *
+ * \tparam SampleMarkers additionally stores a sample marker bit for each row (see RankVectorSampleMarker)
+ */
+template <size_t TSigma, bool SampleMarkers = false>
 struct EPRV4 {
 
     static constexpr size_t Sigma = TSigma;
 
+    using WithSampleMarkers    = EPRV4<TSigma, true>;
+    using WithoutSampleMarkers = EPRV4<TSigma, false>;
+
     // number of full length bitvectors needed `2^bitct ≥ TSigma`
     static constexpr auto bitct = std::bit_width(TSigma-1);
     // next full power of 2
     static constexpr auto bvct  = std::bit_ceil(TSigma);
 
-    using InBits = typename EPRV3<TSigma>::InBits;
+    using InBits = typename EPRV3<TSigma, uint16_t, SampleMarkers>::InBits;
 
     using blockL0_t = uint8_t;
     using blockL1_t = uint16_t;
@@ -34,75 +44,72 @@ struct EPRV4 {
     using BlockL1 = std::array<blockL1_t, TSigma>;
     using BlockL2 = std::array<blockL2_t, TSigma>;
 
-    std::vector<InBits> bits;
-    std::vector<BlockL0> level0;
-    std::vector<BlockL1> level1;
-    std::vector<BlockL2> level2;
-    std::vector<std::array<uint64_t, TSigma>> superBlocks;
+    MMapVector<InBits> bits;
+    MMapVector<BlockL0> level0;
+    MMapVector<BlockL1> level1;
+    MMapVector<BlockL2> level2;
+    MMapVector<std::array<uint64_t, TSigma>> superBlocks;
 
+    [[no_unique_address]] OptionalSampleCounts<SampleMarkers, 64> sampleCounts;
     size_t totalLength;
 
+    cpu_dispatch::Kernels const* kernels{&cpu_dispatch::current()}; // selected once per rank vector, not serialized
+
     EPRV4() = default;
-    EPRV4(std::span<uint8_t const> _symbols) {
+    EPRV4(std::span<uint8_t const> _symbols)
+        : EPRV4{_symbols, 1}
+    {}
+
+    EPRV4(std::span<uint8_t const> _symbols, size_t threadNbr) {
         totalLength = _symbols.size();
 
         auto const length = _symbols.size();
-        level2.reserve(length/(1ull<<level2_size)+2);
-        level1.reserve(length/(1ull<<level1_size)+2);
-        level0.reserve(length/64+2);
-        bits.reserve(length/64+2);
-
-        std::array<blockL0_t, TSigma> blockL0_acc{0};
-        std::array<blockL1_t, TSigma> blockL1_acc{0};
-        std::array<blockL2_t, TSigma> blockL2_acc{0};
-        std::array<uint64_t, TSigma> sblock_acc{0};
-
-
-        for (uint64_t size{0}; size < length+1; ++size) {
-            if (size % (1ull<<level2_size) == 0) { // new l3 block
-                superBlocks.emplace_back(sblock_acc);
-                level2.emplace_back();
-                level1.emplace_back();
-                level0.emplace_back();
-                bits.emplace_back();
-                blockL0_acc = {};
-                blockL1_acc = {};
-                blockL2_acc = {};
-            } else if (size % (1ull<<level1_size) == 0) { // new l2 block
-                level2.emplace_back(blockL2_acc);
-                level1.emplace_back();
-                level0.emplace_back();
-                bits.emplace_back();
-                blockL0_acc = {};
-                blockL1_acc = {};
-            } else if (size % (1ull<<level0_size) == 0) { // new l1 block
-                level1.emplace_back(blockL1_acc);
-                level0.emplace_back();
-                bits.emplace_back();
-
-                blockL0_acc = {};
-            } else if (size % 64 == 0) { // new l0 block
-                level0.emplace_back();
-                bits.emplace_back();
-                level0.back() = blockL0_acc;
-            }
-            // Abort, we only wanted to add a new block to the end, if required
-            if (size == length) continue;
-
-            auto level0Id     = size >>  6;
-            auto bitId        = size &  63;
-
-            uint64_t symb = _symbols[size];
-
-            for (uint64_t i{}; i < bitct; ++i) {
-                auto b = ((symb>>i)&1);
-                bits[level0Id].bits[i] |= (b << bitId);
+        level2.resize(length/(1ull<<level1_size)+1);
+        level1.resize(length/(1ull<<level0_size)+1);
+        level0.resize(length/64+1);
+        bits.resize(length/64+1);
+        superBlocks.resize(length/(1ull<<level2_size)+1);
+
+        parallelConstruction<TSigma>(_symbols, 1ull<<level2_size, threadNbr, [&](size_t begin, size_t end, std::array<uint64_t, TSigma> sblock_acc) {
+            std::array<blockL0_t, TSigma> blockL0_acc{0};
+            std::array<blockL1_t, TSigma> blockL1_acc{0};
+            std::array<blockL2_t, TSigma> blockL2_acc{0};
+
+            if (end == length) end += 1; // last chunk adds a block to the end
+            for (uint64_t size{begin}; size < end; ++size) {
+                if (size % (1ull<<level2_size) == 0) { // new l3 block
+                    superBlocks[size >> level2_size] = sblock_acc;
+                    blockL0_acc = {};
+                    blockL1_acc = {};
+                    blockL2_acc = {};
+                } else if (size % (1ull<<level1_size) == 0) { // new l2 block
+                    level2[size >> level1_size] = blockL2_acc;
+                    blockL0_acc = {};
+                    blockL1_acc = {};
+                } else if (size % (1ull<<level0_size) == 0) { // new l1 block
+                    level1[size >> level0_size] = blockL1_acc;
+                    blockL0_acc = {};
+                } else if (size % 64 == 0) { // new l0 block
+                    level0[size >> 6] = blockL0_acc;
+                }
+                // Abort, we only wanted to add a new block to the end, if required
+                if (size == length) continue;
+
+                auto level0Id     = size >>  6;
+                auto bitId        = size &  63;
+
+                uint64_t symb = _symbols[size];
+
+                for (uint64_t i{}; i < bitct; ++i) {
+                    auto b = ((symb>>i)&1);
+                    bits[level0Id].bits[i] |= (b << bitId);
+                }
+                blockL0_acc[symb] += 1;
+                blockL1_acc[symb] += 1;
+                blockL2_acc[symb] += 1;
+                sblock_acc[symb] += 1;
             }
-            blockL0_acc[symb] += 1;
-            blockL1_acc[symb] += 1;
-            blockL2_acc[symb] += 1;
-            sblock_acc[symb] += 1;
-        }
+        });
     }
 
     void prefetch(uint64_t idx) const {
@@ -129,112 +136,163 @@ struct EPRV4 {
     }
 
     uint64_t rank(uint64_t idx, uint8_t symb) const {
-        prefetch(idx);
-
-        auto level0Id     = idx >>  6;
-        auto level1Id     = idx >> level0_size;
-        auto level2Id     = idx >> level1_size;
-        auto superBlockId = idx >> level2_size;
-        auto bitId        = idx &  63;
-        return    bits[level0Id].rank(bitId, symb)
-                + level0[level0Id][symb]
-                + level1[level1Id][symb]
-                + level2[level2Id][symb]
-                + superBlocks[superBlockId][symb];
+        return with_popcnt(kernels, [&]() -> uint64_t {
+            prefetch(idx);
+
+            auto level0Id     = idx >>  6;
+            auto level1Id     = idx >> level0_size;
+            auto level2Id     = idx >> level1_size;
+            auto superBlockId = idx >> level2_size;
+            auto bitId        = idx &  63;
+            return    bits[level0Id].rank(bitId, symb)
+                    + level0[level0Id][symb]
+                    + level1[level1Id][symb]
+                    + level2[level2Id][symb]
+                    + superBlocks[superBlockId][symb];
+        });
     }
 
     uint64_t prefix_rank(uint64_t idx, uint8_t symb) const {
-        prefetch(idx);
-
-        auto level0Id     = idx >>  6;
-        auto level1Id     = idx >> level0_size;
-        auto level2Id     = idx >> level1_size;
-        auto superBlockId = idx >> level2_size;
-        auto bitId        = idx &  63;
-        uint64_t a{};
-        for (uint64_t i{0}; i<= symb; ++i) {
-            a +=   level0[level0Id][i]
-                 + level1[level1Id][i]
-                 + level2[level2Id][i]
-                 + superBlocks[superBlockId][i];
+        return with_popcnt(kernels, [&]() -> uint64_t {
+            prefetch(idx);
+
+            auto level0Id     = idx >>  6;
+            auto level1Id     = idx >> level0_size;
+            auto level2Id     = idx >> level1_size;
+            auto superBlockId = idx >> level2_size;
+            auto bitId        = idx &  63;
+            uint64_t a{};
+            for (uint64_t i{0}; i<= symb; ++i) {
+                a +=   level0[level0Id][i]
+                     + level1[level1Id][i]
+                     + level2[level2Id][i]
+                     + superBlocks[superBlockId][i];
 
-        }
-        return bits[level0Id].prefix_rank(bitId, symb) + a;
+            }
+            return bits[level0Id].prefix_rank(bitId, symb) + a;
+        });
     }
 
 
     auto all_ranks(uint64_t idx) const -> std::array<uint64_t, TSigma> {
-        prefetch(idx);
-
-        auto level0Id     = idx >>  6;
-        auto level1Id     = idx >> level0_size;
-        auto level2Id     = idx >> level1_size;
-        auto superBlockId = idx >> level2_size;
-        auto bitId        = idx &  63;
-        auto res = std::array<uint64_t, TSigma>{};
-        for (uint64_t symb{0}; symb < TSigma; ++symb) {
-            res[symb] =   bits[level0Id].rank(bitId, symb)
-                        + level0[level0Id][symb]
-                        + level1[level1Id][symb]
-                        + level2[level2Id][symb]
-                        + superBlocks[superBlockId][symb];
-        }
-        return res;
+        return with_popcnt(kernels, [&]() -> std::array<uint64_t, TSigma> {
+            prefetch(idx);
+
+            auto level0Id     = idx >>  6;
+            auto level1Id     = idx >> level0_size;
+            auto level2Id     = idx >> level1_size;
+            auto superBlockId = idx >> level2_size;
+            auto bitId        = idx &  63;
+            auto res = std::array<uint64_t, TSigma>{};
+            for (uint64_t symb{0}; symb < TSigma; ++symb) {
+                res[symb] =   bits[level0Id].rank(bitId, symb)
+                            + level0[level0Id][symb]
+                            + level1[level1Id][symb]
+                            + level2[level2Id][symb]
+                            + superBlocks[superBlockId][symb];
+            }
+            return res;
+        });
     }
 
     auto all_ranks_and_prefix_ranks(uint64_t idx) const -> std::tuple<std::array<uint64_t, TSigma>, std::array<uint64_t, TSigma>> {
-        prefetch(idx);
-
-        auto level0Id     = idx >>  6;
-        auto level1Id     = idx >> level0_size;
-        auto level2Id     = idx >> level1_size;
-        auto superBlockId = idx >> level2_size;
-        auto bitId        = idx &  63;
+        return with_popcnt(kernels, [&]() -> std::tuple<std::array<uint64_t, TSigma>, std::array<uint64_t, TSigma>> {
+            prefetch(idx);
+
+            auto level0Id     = idx >>  6;
+            auto level1Id     = idx >> level0_size;
+            auto level2Id     = idx >> level1_size;
+            auto superBlockId = idx >> level2_size;
+            auto bitId        = idx &  63;
+
+            std::array<uint64_t, TSigma> prs;
+            auto rs = bits[level0Id].all_ranks(bitId);
+
+            rs[0] +=   level0[level0Id][0]
+                     + level1[level1Id][0]
+                     + level2[level2Id][0]
+                     + superBlocks[superBlockId][0];
+
+            prs[0] = rs[0];
+            for (uint64_t symb{1}; symb < TSigma; ++symb) {
+                auto a =   level0[level0Id][symb]
+                         + level1[level1Id][symb]
+                         + level2[level2Id][symb]
+                         + superBlocks[superBlockId][symb];
+
+                prs[symb] = prs[symb-1] + rs[symb] + a;
+                rs[symb] += a;
+            }
+            return {rs, prs};
+        });
+    }
 
-        std::array<uint64_t, TSigma> prs;
-        auto rs = bits[level0Id].all_ranks(bitId);
+    auto rank_and_symbol(uint64_t idx) const -> std::tuple<uint64_t, uint64_t> {
+        return with_popcnt(kernels, [&]() -> std::tuple<uint64_t, uint64_t> {
+            prefetch(idx);
 
-        rs[0] +=   level0[level0Id][0]
-                 + level1[level1Id][0]
-                 + level2[level2Id][0]
-                 + superBlocks[superBlockId][0];
+            auto level0Id     = idx >>  6;
+            auto level1Id     = idx >> level0_size;
+            auto level2Id     = idx >> level1_size;
+            auto superBlockId = idx >> level2_size;
+            auto bitId = idx & 63;
 
-        prs[0] = rs[0];
-        for (uint64_t symb{1}; symb < TSigma; ++symb) {
-            auto a =   level0[level0Id][symb]
+            auto [rank, symb] = bits[level0Id].rank_symbol(bitId);
+            return {  rank
+                     + level0[level0Id][symb]
                      + level1[level1Id][symb]
                      + level2[level2Id][symb]
-                     + superBlocks[superBlockId][symb];
+                     + superBlocks[superBlockId][symb], symb};
+        });
+    }
 
-            prs[symb] = prs[symb-1] + rs[symb] + a;
-            rs[symb] += a;
+    uint64_t rank_symbol(uint64_t idx) const {
+        return std::get<0>(rank_and_symbol(idx));
+    }
+
+    /**!\brief marks all rows `i` for which `isSampled(i)` is true
+     */
+    template <typename CB>
+    void markSamples(CB const& isSampled) requires SampleMarkers {
+        for (auto& block : bits) {
+            block.samples = 0;
         }
-        return {rs, prs};
+        for (size_t idx{0}; idx < totalLength; ++idx) {
+            if (isSampled(idx)) {
+                bits[idx >> 6].samples |= 1ull << (idx & 63);
+            }
+        }
+        sampleCounts.build(bits.size(), [&](size_t blockId) -> uint64_t {
+            return std::popcount(uint64_t{bits[blockId].samples});
+        });
     }
 
-    uint64_t rank_symbol(uint64_t idx) const {
-        prefetch(idx);
+    bool isSampled(uint64_t idx) const requires SampleMarkers {
+        return (bits[idx >> 6].samples >> (idx & 63)) & 1;
+    }
 
-        auto level0Id     = idx >>  6;
-        auto level1Id     = idx >> level0_size;
-        auto level2Id     = idx >> level1_size;
-        auto superBlockId = idx >> level2_size;
-        auto bitId = idx & 63;
-
-        auto [rank, symb] = bits[level0Id].rank_symbol(bitId);
-        return    rank
-                + level0[level0Id][symb]
-                + level1[level1Id][symb]
-                + level2[level2Id][symb]
-                + superBlocks[superBlockId][symb];
+    /**!\brief number of sampled rows in front of idx
+     */
+    uint64_t sampleRank(uint64_t idx) const requires SampleMarkers {
+        auto level0Id = idx >> 6;
+        auto bitId    = idx & 63;
+        auto mask     = (1ull << bitId) - 1;
+        return sampleCounts.rank(level0Id) + std::popcount(bits[level0Id].samples & mask);
     }
 
     template <typename Archive>
     void serialize(Archive& ar) {
-        ar(bits, level0, level1, level2, superBlocks, totalLength);
+        if constexpr (SampleMarkers) {
+            serializeSampleMarkerFormat(ar);
+            ar(bits, level0, level1, level2, superBlocks, sampleCounts, totalLength);
+        } else {
+            ar(bits, level0, level1, level2, superBlocks, totalLength);
+        }
     }
 };
 
 static_assert(checkRankVector<EPRV4>);
+static_assert(!RankVectorSampleMarker<EPRV4<4>>);
+static_assert(RankVectorSampleMarker<EPRV4<4>::WithSampleMarkers>);
 
 }
@@ -3,16 +3,27 @@
 // SPDX-License-Identifier: BSD-3-Clause
 #pragma once
 
+#include "../MMapAllocator.h"
+#include "ParallelConstruction.h"
+#include "SampleCounts.h"
 #include "concepts.h"
 
+#include <bit>
 #include <bitset>
 #include <vector>
 
 namespace fmindex_collection::rankvector {
 
-template <size_t TSigma, uint64_t TAlignment, typename block_t>
+/**!\brief Interleaved rank vector
+ *
+ * \tparam SampleMarkers additionally stores a sample marker bit for each row (see RankVectorSampleMarker)
+ */
+template <size_t TSigma, uint64_t TAlignment, typename block_t, bool SampleMarkers = false>
 struct InterleavedBitvector {
-    struct alignas(TAlignment) Block {
+    using WithSampleMarkers    = InterleavedBitvector<TSigma, TAlignment, block_t, true>;
+    using WithoutSampleMarkers = InterleavedBitvector<TSigma, TAlignment, block_t, false>;
+
+    struct alignas(TAlignment) Block : SampleMarkerBits<SampleMarkers> {
         std::array<block_t, TSigma> blocks{};
         std::array<uint64_t, TSigma> bits{};
 
@@ -49,6 +60,9 @@ struct InterleavedBitvector {
         template <typename Archive>
         void serialize(Archive& ar) {
             ar(blocks, bits);
+            if constexpr (SampleMarkers) {
+                ar(this->samples);
+            }
         }
     };
 
@@ -56,41 +70,50 @@ struct InterleavedBitvector {
 
     static constexpr uint64_t block_size = sizeof(block_t) * 8;
 
-    std::vector<Block> blocks;
-    std::vector<std::array<uint64_t, TSigma>> superBlocks;
+    MMapVector<Block> blocks;
+    MMapVector<std::array<uint64_t, TSigma>> superBlocks;
+    [[no_unique_address]] OptionalSampleCounts<SampleMarkers, 64> sampleCounts;
     size_t totalLength;
 
     InterleavedBitvector() = default;
-    InterleavedBitvector(std::span<uint8_t const> _symbols) {
+    InterleavedBitvector(std::span<uint8_t const> _symbols)
+        : InterleavedBitvector{_symbols, 1}
+    {}
+
+    InterleavedBitvector(std::span<uint8_t const> _symbols, size_t threadNbr) {
         totalLength = _symbols.size();
         auto length = _symbols.size();
-        blocks.reserve(length/64+2);
-
-        blocks.emplace_back();
-        superBlocks.emplace_back();
-
-        auto sblock_acc = std::array<uint64_t, TSigma>{0};
-        auto block_acc = std::array<block_t, TSigma>{0};
-
-        for (uint64_t size{1}; size <= length; ++size) {
-            if (size % (1ull<<block_size) == 0) { // new super block + new block
-                superBlocks.emplace_back(sblock_acc);
-                blocks.emplace_back();
-                block_acc = {};
-            } else if (size % 64 == 0) { // new block
-                blocks.emplace_back();
-                blocks.back().blocks = block_acc;
+        blocks.resize(length/64+1);
+        superBlocks.resize(length/(1ull<<block_size)+1);
+
+        // symbol at position i is stored at bit i+1
+        parallelConstruction<TSigma>(_symbols, 1ull<<block_size, threadNbr, [&](size_t begin, size_t end, std::array<uint64_t, TSigma> sblock_acc) {
+            auto block_acc = std::array<block_t, TSigma>{0};
+            if (begin == 0) {
+                begin = 1;
+            } else {
+                sblock_acc[_symbols[begin-1]] -= 1;
             }
-            auto blockId      = size >>  6;
-            auto bitId        = size &  63;
 
-            auto symb = _symbols[size-1];
+            if (end == length) end += 1;
+            for (uint64_t size{begin}; size < end; ++size) {
+                if (size % (1ull<<block_size) == 0) { // new super block + new block
+                    superBlocks[size >> block_size] = sblock_acc;
+                    block_acc = {};
+                } else if (size % 64 == 0) { // new block
+                    blocks[size >> 6].blocks = block_acc;
+                }
+                auto blockId      = size >>  6;
+                auto bitId        = size &  63;
 
-            auto& bits = blocks[blockId].bits[symb];
-            bits = bits | (1ull << bitId);
-            block_acc[symb] += 1;
-            sblock_acc[symb] += 1;
-        }
+                auto symb = _symbols[size-1];
+
+                auto& bits = blocks[blockId].bits[symb];
+                bits = bits | (1ull << bitId);
+                block_acc[symb] += 1;
+                sblock_acc[symb] += 1;
+            }
+        });
     }
 
     size_t size() const noexcept {
@@ -116,6 +139,25 @@ struct InterleavedBitvector {
         return blocks[blockId].rank(bitId, symb) + superBlocks[superBlockId][symb];
     }
 
+    /**!\brief rank of the symbol at idx
+     *
+     * The symbol at idx is stored at bit idx+1, rank(idx+1) counts this symbol as well.
+     * This way only a single block has to be loaded.
+     */
+    auto rank_and_symbol(uint64_t idx) const -> std::tuple<uint64_t, uint64_t> {
+        idx += 1;
+        auto blockId      = idx >>  6;
+        auto superBlockId = idx >> block_size;
+        auto bitId        = idx &  63;
+        auto const& block = blocks[blockId];
+        auto symb = block.symbol(bitId);
+        return {block.rank(bitId, symb) + superBlocks[superBlockId][symb] - 1, symb};
+    }
+
+    uint64_t rank_symbol(uint64_t idx) const {
+        return std::get<0>(rank_and_symbol(idx));
+    }
+
     uint64_t prefix_rank(uint64_t idx, uint64_t symb) const {
         auto blockId      = idx >>  6;
         auto superBlockId = idx >> block_size;
@@ -160,9 +202,46 @@ struct InterleavedBitvector {
         return {rs, prs};
     }
 
+    /**!\brief marks all rows `i` for which `isSampled(i)` is true
+     */
+    template <typename CB>
+    void markSamples(CB const& isSampled) requires SampleMarkers {
+        for (auto& block : blocks) {
+            block.samples = 0;
+        }
+        for (size_t idx{0}; idx < totalLength; ++idx) {
+            if (isSampled(idx)) {
+                blocks[(idx+1) >> 6].samples |= 1ull << ((idx+1) & 63);
+            }
+        }
+        sampleCounts.build(blocks.size(), [&](size_t blockId) -> uint64_t {
+            return std::popcount(blocks[blockId].samples);
+        });
+    }
+
+    bool isSampled(uint64_t idx) const requires SampleMarkers {
+        idx += 1;
+        return (blocks[idx >> 6].samples >> (idx & 63)) & 1;
+    }
+
+    /**!\brief number of sampled rows in front of idx
+     */
+    uint64_t sampleRank(uint64_t idx) const requires SampleMarkers {
+        idx += 1;
+        auto blockId = idx >> 6;
+        auto bitId   = idx & 63;
+        auto mask    = (1ull << bitId) - 1;
+        return sampleCounts.rank(blockId) + std::popcount(blocks[blockId].samples & mask);
+    }
+
     template <typename Archive>
     void serialize(Archive& ar) {
-        ar(blocks, superBlocks, totalLength);
+        if constexpr (SampleMarkers) {
+            serializeSampleMarkerFormat(ar);
+            ar(blocks, superBlocks, sampleCounts, totalLength);
+        } else {
+            ar(blocks, superBlocks, totalLength);
+        }
     }
 };
 
@@ -180,5 +259,7 @@ static_assert(checkRankVector<InterleavedBitvector32>);
 static_assert(checkRankVector<InterleavedBitvector8Aligned>);
 static_assert(checkRankVector<InterleavedBitvector16Aligned>);
 static_assert(checkRankVector<InterleavedBitvector32Aligned>);
+static_assert(!RankVectorSampleMarker<InterleavedBitvector16<4>>);
+static_assert(RankVectorSampleMarker<InterleavedBitvector16<4>::WithSampleMarkers>);
 
 }
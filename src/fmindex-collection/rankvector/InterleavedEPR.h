@@ -3,6 +3,8 @@
 // SPDX-License-Identifier: BSD-3-Clause
 #pragma once
 
+#include "../MMapAllocator.h"
+#include "ParallelConstruction.h"
 #include "concepts.h"
 
 #include <bit>
@@ -102,41 +104,43 @@ struct InterleavedEPR {
     constexpr static uint64_t letterFit = 64 / bitct;
     static constexpr uint64_t block_size = ((uint64_t{1}<<(sizeof(block_t)*8)) / letterFit)*letterFit;
 
-    std::vector<Block> blocks;
-    std::vector<std::array<uint64_t, TSigma>> superBlocks;
+    MMapVector<Block> blocks;
+    MMapVector<std::array<uint64_t, TSigma>> superBlocks;
     size_t totalLength{};
 
 
     InterleavedEPR() = default;
-    InterleavedEPR(std::span<uint8_t const> _symbols) {
-        totalLength = _symbols.size();
-        blocks.reserve(_symbols.size()/block_size+1);
-
-        auto sblock_acc = std::array<uint64_t, TSigma>{}; // accumulator for super blocks
-        auto block_acc  = std::array<block_t, TSigma>{};  // accumulator for blocks
-
-        for (uint64_t size{0}; size < _symbols.size();) {
-            superBlocks.emplace_back(sblock_acc);
-            block_acc = {};
-
-            for (uint64_t blockId{0}; blockId < block_size/letterFit and size < _symbols.size(); ++blockId) {
-                blocks.emplace_back();
-                blocks.back().blocks = block_acc;
+    InterleavedEPR(std::span<uint8_t const> _symbols)
+        : InterleavedEPR{_symbols, 1}
+    {}
 
-                for (uint64_t bitId{0}; bitId < letterFit and size < _symbols.size(); ++bitId, ++size) {
+    InterleavedEPR(std::span<uint8_t const> _symbols, size_t threadNbr) {
+        totalLength = _symbols.size();
+        auto const length = _symbols.size();
+        blocks.resize(length/letterFit+1);
+        superBlocks.resize(length/block_size+1);
+
+        parallelConstruction<TSigma>(_symbols, block_size, threadNbr, [&](size_t begin, size_t end, std::array<uint64_t, TSigma> sblock_acc) {
+            auto block_acc = std::array<block_t, TSigma>{};  // accumulator for blocks
+
+            // Last chunk adds a new block, so we can access one row more than our symbols length
+            if (end == length) end += 1;
+            for (uint64_t size{begin}; size < end; ++size) {
+                if (size % block_size == 0) { // new super block + new block
+                    superBlocks[size / block_size] = sblock_acc;
+                    block_acc = {};
+                } else if (size % letterFit == 0) { // new block
+                    blocks[size / letterFit].blocks = block_acc;
+                }
+                if (size == length) continue;
 
-                    uint64_t symb = _symbols[size];
-                    blocks.back().inBlock |= symb << (bitct * bitId);
+                uint64_t symb = _symbols[size];
+                blocks[size / letterFit].inBlock |= symb << (bitct * (size % letterFit));
 
-                    block_acc[symb] += 1;
-                    sblock_acc[symb] += 1;
-                }
+                block_acc[symb] += 1;
+                sblock_acc[symb] += 1;
             }
-        }
-        // Add a new block, so we can access one row more than our symbols length (!TODO this might be more than required)
-        superBlocks.emplace_back(sblock_acc);
-        blocks.emplace_back();
-        blocks.back().blocks = block_acc;
+        });
     }
 
     void prefetch(uint64_t idx) const {
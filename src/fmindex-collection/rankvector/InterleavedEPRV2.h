@@ -3,7 +3,10 @@
 // SPDX-License-Identifier: BSD-3-Clause
 #pragma once
 
+#include "../MMapAllocator.h"
+#include "../bitset_popcount.h"
 #include "../builtins.h"
+#include "ParallelConstruction.h"
 #include "concepts.h"
 
 #include <bit>
@@ -70,14 +73,14 @@ struct InterleavedEPRV2 {
             assert(idx < 64);
             auto bits_set = bits_have_symbols(symb, bits);
             auto bits_masked = std::bitset<64>(bits_set) << (64-idx);
-            return blocks[symb] + bits_masked.count();
+            return blocks[symb] + popcount(bits_masked);
         }
 
         uint64_t prefix_rank(size_t idx, uint64_t symb) const {
             auto bits_set = bits_have_symbols_or_less(symb, bits);
 
             auto bits_masked = std::bitset<64>(bits_set) << (64-idx);
-            auto ct = bits_masked.count();
+            auto ct = popcount(bits_masked);
 
             for (size_t i{0}; i <= symb; ++i) {
                 ct += blocks[i];
@@ -92,7 +95,7 @@ struct InterleavedEPRV2 {
 
             for (size_t i{0}; i < TSigma; ++i) {
                 auto bits_set = bits_have_symbols(i, bits);
-                rs[i] = (std::bitset<64>(bits_set) << (64 - idx)).count() + blocks[i];
+                rs[i] = popcount(std::bitset<64>(bits_set) << (64 - idx)) + blocks[i];
             }
             return rs;
         }
@@ -122,7 +125,7 @@ struct InterleavedEPRV2 {
 
             auto bitset = std::bitset<64>{~mask} << (64-idx);
 
-            return {blocks[symb] + bitset.count(), symb};
+            return {blocks[symb] + popcount(bitset), symb};
         }
 
         template <typename Archive>
@@ -133,50 +136,53 @@ struct InterleavedEPRV2 {
 
     static constexpr size_t block_size = sizeof(block_t) * 8;
 
-    std::vector<Block> blocks;
-    std::vector<std::array<uint64_t, TSigma>> superBlocks;
+    MMapVector<Block> blocks;
+    MMapVector<std::array<uint64_t, TSigma>> superBlocks;
     size_t totalLength{};
 
+    cpu_dispatch::Kernels const* kernels{&cpu_dispatch::current()}; // selected once per rank vector, not serialized
+
     InterleavedEPRV2() = default;
-    InterleavedEPRV2(std::span<uint8_t const> _symbols) {
+    InterleavedEPRV2(std::span<uint8_t const> _symbols)
+        : InterleavedEPRV2{_symbols, 1}
+    {}
+
+    InterleavedEPRV2(std::span<uint8_t const> _symbols, size_t threadNbr) {
         totalLength = _symbols.size();
-        // Next three lines are a reserve call, with zero initialization
-        // This is required, so padding bytes will also be zero
-        blocks.resize(_symbols.size()/64+1);
+        auto const length = _symbols.size();
+        // Zero initialization of all blocks, this is required, so padding bytes will also be zero
+        blocks.resize(length/64+1);
         memset((void*)blocks.data(), 0, blocks.size() * sizeof(Block));
-        blocks.resize(0);
-
-        auto sblock_acc = std::array<uint64_t, TSigma>{}; // accumulator for super blocks
-        auto block_acc  = std::array<block_t, TSigma>{};  // accumulator for blocks
-
-        for (size_t size{0}; size < _symbols.size();) {
-            superBlocks.emplace_back(sblock_acc);
-            block_acc = {};
-
-            for (size_t blockId{0}; blockId < (uint64_t{1}<<block_size)/64 and size < _symbols.size(); ++blockId) {
-                blocks.emplace_back();
-                blocks.back().blocks = block_acc;
-
-                for (size_t bitId{0}; bitId < 64 and size < _symbols.size(); ++bitId, ++size) {
+        superBlocks.resize(length/(uint64_t{1}<<block_size)+1);
+
+        parallelConstruction<TSigma>(_symbols, uint64_t{1}<<block_size, threadNbr, [&](size_t begin, size_t end, std::array<uint64_t, TSigma> sblock_acc) {
+            auto block_acc = std::array<block_t, TSigma>{};  // accumulator for blocks
+
+            // Last chunk adds a new block, so we can access one row more than our symbols length
+            if (end == length) end += 1;
+            for (size_t size{begin}; size < end; ++size) {
+                if (size % (uint64_t{1}<<block_size) == 0) { // new super block + new block
+                    superBlocks[size >> block_size] = sblock_acc;
+                    block_acc = {};
+                } else if (size % 64 == 0) { // new block
+                    blocks[size >> 6].blocks = block_acc;
+                }
+                if (size == length) continue;
 
-                    uint64_t symb = _symbols[size];
+                auto blockId = size >>  6;
+                auto bitId   = size &  63;
 
-                    for (size_t i{}; i < sigma_bits; ++i) {
-                        auto b = ((symb>>i)&1);
-                        blocks.back().bits[i] |= (b << bitId);
-                    }
+                uint64_t symb = _symbols[size];
 
-                    block_acc[symb] += 1;
-                    sblock_acc[symb] += 1;
+                for (size_t i{}; i < sigma_bits; ++i) {
+                    auto b = ((symb>>i)&1);
+                    blocks[blockId].bits[i] |= (b << bitId);
                 }
+
+                block_acc[symb] += 1;
+                sblock_acc[symb] += 1;
             }
-        }
-        // Add a new block, so we can access one row more than our symbols length
-        if (_symbols.size() % 64 == 0) {
-            superBlocks.emplace_back(sblock_acc);
-            blocks.emplace_back();
-            blocks.back().blocks = block_acc;
-        }
+        });
     }
 
     size_t size() const {
@@ -195,58 +201,72 @@ struct InterleavedEPRV2 {
     }
 
     uint64_t rank(size_t idx, uint8_t symb) const {
-        auto blockId      = idx >>  6;
-        auto superBlockId = idx >> block_size;
-        auto bitId        = idx &  63;
-        return blocks[blockId].rank(bitId, symb) + superBlocks[superBlockId][symb];
+        return with_popcnt(kernels, [&]() -> uint64_t {
+            auto blockId      = idx >>  6;
+            auto superBlockId = idx >> block_size;
+            auto bitId        = idx &  63;
+            return blocks[blockId].rank(bitId, symb) + superBlocks[superBlockId][symb];
+        });
     }
 
     uint64_t prefix_rank(size_t idx, uint8_t symb) const {
-        auto blockId      = idx >>  6;
-        auto superBlockId = idx >> block_size;
-        auto bitId        = idx &  63;
-        uint64_t a{};
-        for (size_t i{0}; i<= symb; ++i) {
-            a += superBlocks[superBlockId][i];
-        }
-        return blocks[blockId].prefix_rank(bitId, symb) + a;
+        return with_popcnt(kernels, [&]() -> uint64_t {
+            auto blockId      = idx >>  6;
+            auto superBlockId = idx >> block_size;
+            auto bitId        = idx &  63;
+            uint64_t a{};
+            for (size_t i{0}; i<= symb; ++i) {
+                a += superBlocks[superBlockId][i];
+            }
+            return blocks[blockId].prefix_rank(bitId, symb) + a;
+        });
     }
 
 
     auto all_ranks(size_t idx) const -> std::array<uint64_t, TSigma> {
-        auto blockId      = idx >>  6;
-        auto superBlockId = idx >> block_size;
-        auto bitId        = idx &  63;
-        auto res = std::array<uint64_t, TSigma>{};
-        for (size_t symb{0}; symb < TSigma; ++symb) {
-            res[symb] = blocks[blockId].rank(bitId, symb) + superBlocks[superBlockId][symb];
-        }
-        return res;
+        return with_popcnt(kernels, [&]() -> std::array<uint64_t, TSigma> {
+            auto blockId      = idx >>  6;
+            auto superBlockId = idx >> block_size;
+            auto bitId        = idx &  63;
+            auto res = std::array<uint64_t, TSigma>{};
+            for (size_t symb{0}; symb < TSigma; ++symb) {
+                res[symb] = blocks[blockId].rank(bitId, symb) + superBlocks[superBlockId][symb];
+            }
+            return res;
+        });
     }
 
     auto all_ranks_and_prefix_ranks(size_t idx) const -> std::tuple<std::array<uint64_t, TSigma>, std::array<uint64_t, TSigma>> {
-        auto blockId      = idx >>  6;
-        auto superBlockId = idx >> block_size;
-        auto bitId        = idx &  63;
-
-        auto prs = std::array<uint64_t, TSigma>{};
-        auto rs = blocks[blockId].all_ranks(bitId);
+        return with_popcnt(kernels, [&]() -> std::tuple<std::array<uint64_t, TSigma>, std::array<uint64_t, TSigma>> {
+            auto blockId      = idx >>  6;
+            auto superBlockId = idx >> block_size;
+            auto bitId        = idx &  63;
+
+            auto prs = std::array<uint64_t, TSigma>{};
+            auto rs = blocks[blockId].all_ranks(bitId);
+
+            rs[0] += superBlocks[superBlockId][0];
+            prs[0] = rs[0];
+            for (size_t symb{1}; symb < TSigma; ++symb) {
+                prs[symb] = prs[symb-1] + superBlocks[superBlockId][symb] + rs[symb];
+                rs[symb] += superBlocks[superBlockId][symb];
+            }
+            return {rs, prs};
+        });
+    }
 
-        rs[0] += superBlocks[superBlockId][0];
-        prs[0] = rs[0];
-        for (size_t symb{1}; symb < TSigma; ++symb) {
-            prs[symb] = prs[symb-1] + superBlocks[superBlockId][symb] + rs[symb];
-            rs[symb] += superBlocks[superBlockId][symb];
-        }
-        return {rs, prs};
+    auto rank_and_symbol(size_t idx) const -> std::tuple<uint64_t, uint64_t> {
+        return with_popcnt(kernels, [&]() -> std::tuple<uint64_t, uint64_t> {
+            auto blockId      = idx >> 6;
+            auto bitId        = idx & 63;
+            auto superBlockId = idx >> block_size;
+            auto [rank, symb] = blocks[blockId].rank_symbol(bitId);
+            return {rank + superBlocks[superBlockId][symb], symb};
+        });
     }
 
     uint64_t rank_symbol(size_t idx) const {
-        auto blockId      = idx >> 6;
-        auto bitId        = idx & 63;
-        auto superBlockId = idx >> block_size;
-        auto [rank, symb] = blocks[blockId].rank_symbol(bitId);
-        return rank + superBlocks[superBlockId][symb];
+        return std::get<0>(rank_and_symbol(idx));
     }
 
     template <typename Archive>
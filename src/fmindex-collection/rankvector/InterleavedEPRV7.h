@@ -3,6 +3,10 @@
 // SPDX-License-Identifier: BSD-3-Clause
 #pragma once
 
+#include "../MMapAllocator.h"
+#include "../bitset_popcount.h"
+#include "ParallelConstruction.h"
+#include "SampleCounts.h"
 #include "concepts.h"
 
 #include <bit>
@@ -12,16 +16,23 @@
 
 namespace fmindex_collection::rankvector {
 
-template <size_t TSigma>
+/**!\brief Interleaved EPRV7 rank vector
+ *
+ * \tparam SampleMarkers additionally stores a sample marker bit for each row (see RankVectorSampleMarker)
+ */
+template <size_t TSigma, bool SampleMarkers = false>
 struct InterleavedEPRV7 {
 
     static constexpr size_t Sigma = TSigma;
 
+    using WithSampleMarkers    = InterleavedEPRV7<TSigma, true>;
+    using WithoutSampleMarkers = InterleavedEPRV7<TSigma, false>;
+
     // number of full length bitvectors needed `2^bitct ≥ TSigma`
     static constexpr auto bitct = std::bit_width(TSigma-1);
 
     #pragma pack(push, 1)
-    struct InBits {
+    struct InBits : SampleMarkerBits<SampleMarkers> {
         std::array<uint64_t, bitct> bits{};
         std::array<uint8_t, TSigma> level0{};
 
@@ -44,7 +55,7 @@ struct InterleavedEPRV7 {
             }(std::make_integer_sequence<uint64_t, bitct>{});
 
             auto bitset = std::bitset<64>(mask) << (64-idx);
-            return bitset.count() + level0[symb];
+            return popcount(bitset) + level0[symb];
         }
 
         uint64_t prefix_rank(uint64_t idx, uint64_t symb) const {
@@ -60,7 +71,7 @@ struct InterleavedEPRV7 {
             }
 
             auto bitset = std::bitset<64>(mask) << (64-idx);
-            auto ct = bitset.count();
+            auto ct = popcount(bitset);
             for (uint64_t i{0}; i <= symb; ++i) {
                 ct += level0[i];
             }
@@ -72,15 +83,24 @@ struct InterleavedEPRV7 {
 
             std::array<uint64_t, TSigma> rs{0};
 
-            auto f = [&]<uint64_t I>(uint64_t symb, std::integer_sequence<uint64_t, I>) {
-                return bits[I] ^ -((~symb>>I)&1);
-            };
-
-            for (uint64_t i{0}; i < TSigma; ++i) {
-                auto mask = [&]<uint64_t ...Is>(std::integer_sequence<uint64_t, Is...>) {
-                    return (f(i, std::integer_sequence<uint64_t, Is>{})&...);
-                }(std::make_integer_sequence<uint64_t, bitct>{});
-                rs[i] = (std::bitset<64>(mask) << (64 - idx)).count() + level0[i];
+            if constexpr (TSigma <= 8) {
+                // all symbols at once, a single word is counted inline (see `with_popcnt`)
+                auto planes = bits;
+                auto counts = symbol_counts3(planes, idx == 0 ? uint64_t{} : ~uint64_t{} >> (64 - idx));
+                for (uint64_t i{0}; i < TSigma; ++i) {
+                    rs[i] = counts[i] + level0[i];
+                }
+            } else {
+                auto f = [&]<uint64_t I>(uint64_t symb, std::integer_sequence<uint64_t, I>) {
+                    return bits[I] ^ -((~symb>>I)&1);
+                };
+
+                for (uint64_t i{0}; i < TSigma; ++i) {
+                    auto mask = [&]<uint64_t ...Is>(std::integer_sequence<uint64_t, Is...>) {
+                        return (f(i, std::integer_sequence<uint64_t, Is>{})&...);
+                    }(std::make_integer_sequence<uint64_t, bitct>{});
+                    rs[i] = popcount(std::bitset<64>(mask) << (64 - idx)) + level0[i];
+                }
             }
             return rs;
         }
@@ -101,19 +121,25 @@ struct InterleavedEPRV7 {
 
             auto bitset = std::bitset<64>{~mask} << (64-idx);
 
-            return {bitset.count() + level0[symb], symb};
+            return {popcount(bitset) + level0[symb], symb};
         }
 
         template <typename Archive>
         void serialize(Archive& ar) {
             //!TODO this can be done for sure in a smarter way
-            auto bits_unpacked   = bits;
-            auto level0_unpacked = level0;
+            auto bits_unpacked    = bits;
+            auto level0_unpacked  = level0;
 
             ar(bits_unpacked, level0_unpacked);
 
-            bits   = bits_unpacked;
-            level0 = level0_unpacked;
+            bits    = bits_unpacked;
+            level0  = level0_unpacked;
+
+            if constexpr (SampleMarkers) {
+                uint64_t samples_unpacked = this->samples;
+                ar(samples_unpacked);
+                this->samples = samples_unpacked;
+            }
 
         }
     };
@@ -127,55 +153,59 @@ struct InterleavedEPRV7 {
     using BlockL0 = std::array<blockL0_t, TSigma>;
     using BlockL1 = std::array<blockL1_t, TSigma>;
 
-    std::vector<InBits> bits;
-    std::vector<BlockL1> level1;
-    std::vector<std::array<uint64_t, TSigma>> superBlocks;
+    MMapVector<InBits> bits;
+    MMapVector<BlockL1> level1;
+    MMapVector<std::array<uint64_t, TSigma>> superBlocks;
+    [[no_unique_address]] OptionalSampleCounts<SampleMarkers, 64> sampleCounts;
     size_t totalLength;
 
+    cpu_dispatch::Kernels const* kernels{&cpu_dispatch::current()}; // selected once per rank vector, not serialized
+
     InterleavedEPRV7() = default;
-    InterleavedEPRV7(std::span<uint8_t const> _symbols) {
+    InterleavedEPRV7(std::span<uint8_t const> _symbols)
+        : InterleavedEPRV7{_symbols, 1}
+    {}
+
+    InterleavedEPRV7(std::span<uint8_t const> _symbols, size_t threadNbr) {
         totalLength = _symbols.size();
         auto const length = _symbols.size();
-        level1.reserve(length/(1ull<<level1_size)+2);
-        bits.reserve(length/64+2);
-
-        std::array<blockL0_t, TSigma> blockL0_acc{0};
-        std::array<blockL1_t, TSigma> blockL1_acc{0};
-        std::array<uint64_t, TSigma> sblock_acc{0};
-
-
-        for (uint64_t size{0}; size < length+1; ++size) {
-            if (size % (1ull<<level1_size) == 0) { // new l3 block
-                superBlocks.emplace_back(sblock_acc);
-                level1.emplace_back();
-                bits.emplace_back();
-                blockL0_acc = {};
-                blockL1_acc = {};
-            } else if (size % (1ull<<level0_size) == 0) { // new l1 block
-                level1.emplace_back(blockL1_acc);
-                bits.emplace_back();
-
-                blockL0_acc = {};
-            } else if (size % 64 == 0) { // new l0 block
-                bits.emplace_back();
-                bits.back().level0 = blockL0_acc;
+        level1.resize(length/(1ull<<level0_size)+1);
+        bits.resize(length/64+1);
+        superBlocks.resize(length/(1ull<<level1_size)+1);
+
+        parallelConstruction<TSigma>(_symbols, 1ull<<level1_size, threadNbr, [&](size_t begin, size_t end, std::array<uint64_t, TSigma> sblock_acc) {
+            std::array<blockL0_t, TSigma> blockL0_acc{0};
+            std::array<blockL1_t, TSigma> blockL1_acc{0};
+
+            if (end == length) end += 1; // last chunk adds a block to the end
+            for (uint64_t size{begin}; size < end; ++size) {
+                if (size % (1ull<<level1_size) == 0) { // new l3 block
+                    superBlocks[size >> level1_size] = sblock_acc;
+                    blockL0_acc = {};
+                    blockL1_acc = {};
+                } else if (size % (1ull<<level0_size) == 0) { // new l1 block
+                    level1[size >> level0_size] = blockL1_acc;
+                    blockL0_acc = {};
+                } else if (size % 64 == 0) { // new l0 block
+                    bits[size >> 6].level0 = blockL0_acc;
+                }
+                // Abort, we only wanted to add a new block to the end, if required
+                if (size == length) continue;
+
+                auto level0Id     = size >>  6;
+                auto bitId        = size &  63;
+
+                uint64_t symb = _symbols[size];
+
+                for (uint64_t i{}; i < bitct; ++i) {
+                    auto b = ((symb>>i)&1);
+                    bits[level0Id].bits[i] |= (b << bitId);
+                }
+                blockL0_acc[symb] += 1;
+                blockL1_acc[symb] += 1;
+                sblock_acc[symb] += 1;
             }
-            // Abort, we only wanted to add a new block to the end, if required
-            if (size == length) continue;
-
-            auto level0Id     = size >>  6;
-            auto bitId        = size &  63;
-
-            uint64_t symb = _symbols[size];
-
-            for (uint64_t i{}; i < bitct; ++i) {
-                auto b = ((symb>>i)&1);
-                bits[level0Id].bits[i] |= (b << bitId);
-            }
-            blockL0_acc[symb] += 1;
-            blockL1_acc[symb] += 1;
-            sblock_acc[symb] += 1;
-        }
+        });
     }
 
     size_t size() const {
@@ -189,86 +219,169 @@ struct InterleavedEPRV7 {
     }
 
     uint64_t rank(uint64_t idx, uint64_t symb) const {
-        auto level0Id     = idx >>  6;
-        auto level1Id     = idx >> level0_size;
-        auto superBlockId = idx >> level1_size;
-        auto bitId        = idx &  63;
-        return    bits[level0Id].rank(bitId, symb)
+        return with_popcnt(kernels, [&]() -> uint64_t {
+            auto level0Id     = idx >>  6;
+            auto level1Id     = idx >> level0_size;
+            auto superBlockId = idx >> level1_size;
+            auto bitId        = idx &  63;
+            return    bits[level0Id].rank(bitId, symb)
 //                + level0[level0Id][symb]
-                + level1[level1Id][symb]
-                + superBlocks[superBlockId][symb];
+                    + level1[level1Id][symb]
+                    + superBlocks[superBlockId][symb];
+        });
     }
 
     uint64_t prefix_rank(uint64_t idx, uint64_t symb) const {
-        auto level0Id     = idx >>  6;
-        auto level1Id     = idx >> level0_size;
-        auto superBlockId = idx >> level1_size;
-        auto bitId        = idx &  63;
-        uint64_t a={};
-        for (uint64_t i{0}; i<= symb; ++i) {
-            a += level1[level1Id][i] + superBlocks[superBlockId][i];
+        return with_popcnt(kernels, [&]() -> uint64_t {
+            auto level0Id     = idx >>  6;
+            auto level1Id     = idx >> level0_size;
+            auto superBlockId = idx >> level1_size;
+            auto bitId        = idx &  63;
+            uint64_t a={};
+            for (uint64_t i{0}; i<= symb; ++i) {
+                a += level1[level1Id][i] + superBlocks[superBlockId][i];
 
-        }
-        return bits[level0Id].prefix_rank(bitId, symb) + a;
+            }
+            return bits[level0Id].prefix_rank(bitId, symb) + a;
+        });
     }
 
 
     auto all_ranks(uint64_t idx) const -> std::array<uint64_t, TSigma> {
-        auto level0Id     = idx >>  6;
-        auto level1Id     = idx >> level0_size;
-        auto superBlockId = idx >> level1_size;
-        auto bitId        = idx &  63;
-        auto res = std::array<uint64_t, TSigma>{};
-        for (uint64_t symb{0}; symb < TSigma; ++symb) {
-            res[symb] =   bits[level0Id].rank(bitId, symb)
-                        + level1[level1Id][symb]
-                        + superBlocks[superBlockId][symb];
-        }
-        return res;
+        return with_popcnt(kernels, [&]() -> std::array<uint64_t, TSigma> {
+            auto level0Id     = idx >>  6;
+            auto level1Id     = idx >> level0_size;
+            auto superBlockId = idx >> level1_size;
+            auto bitId        = idx &  63;
+            auto res = bits[level0Id].all_ranks(bitId);
+            for (uint64_t symb{0}; symb < TSigma; ++symb) {
+                res[symb] +=   level1[level1Id][symb]
+                             + superBlocks[superBlockId][symb];
+            }
+            return res;
+        });
     }
 
     auto all_ranks_and_prefix_ranks(uint64_t idx) const -> std::tuple<std::array<uint64_t, TSigma>, std::array<uint64_t, TSigma>> {
-        auto level0Id     = idx >>  6;
-        auto level1Id     = idx >> level0_size;
-        auto superBlockId = idx >> level1_size;
-        auto bitId        = idx &  63;
+        return with_popcnt(kernels, [&]() -> std::tuple<std::array<uint64_t, TSigma>, std::array<uint64_t, TSigma>> {
+            auto level0Id     = idx >>  6;
+            auto level1Id     = idx >> level0_size;
+            auto superBlockId = idx >> level1_size;
+            auto bitId        = idx &  63;
 
-        std::array<uint64_t, TSigma> prs;
-        auto rs = bits[level0Id].all_ranks(bitId);
+            std::array<uint64_t, TSigma> prs;
+            auto rs = bits[level0Id].all_ranks(bitId);
 
-        rs[0] +=   level1[level1Id][0]
-                 + superBlocks[superBlockId][0];
+            rs[0] +=   level1[level1Id][0]
+                     + superBlocks[superBlockId][0];
 
-        prs[0] = rs[0];
-        for (uint64_t symb{1}; symb < TSigma; ++symb) {
-            auto a =   level1[level1Id][symb]
-                     + superBlocks[superBlockId][symb];
+            prs[0] = rs[0];
+            for (uint64_t symb{1}; symb < TSigma; ++symb) {
+                auto a =   level1[level1Id][symb]
+                         + superBlocks[superBlockId][symb];
 
-            prs[symb] = prs[symb-1] + rs[symb] + a;
-            rs[symb] += a;
-        }
-        return {rs, prs};
+                prs[symb] = prs[symb-1] + rs[symb] + a;
+                rs[symb] += a;
+            }
+            return {rs, prs};
+        });
+    }
+
+    /**!\brief all_ranks_and_prefix_ranks of lb and rb
+     *
+     * If both are inside the same 64bit block, the block and the level1/superblock counts are loaded only once.
+     */
+    auto all_ranks_and_prefix_ranks_interval(uint64_t lb, uint64_t rb) const -> std::tuple<std::array<uint64_t, TSigma>, std::array<uint64_t, TSigma>, std::array<uint64_t, TSigma>, std::array<uint64_t, TSigma>> {
+        return with_popcnt(kernels, [&]() -> std::tuple<std::array<uint64_t, TSigma>, std::array<uint64_t, TSigma>, std::array<uint64_t, TSigma>, std::array<uint64_t, TSigma>> {
+            auto level0Id = lb >> 6;
+            if (level0Id != (rb >> 6)) {
+                auto [rs1, prs1] = all_ranks_and_prefix_ranks(lb);
+                auto [rs2, prs2] = all_ranks_and_prefix_ranks(rb);
+                return {rs1, prs1, rs2, prs2};
+            }
+            auto level1Id     = lb >> level0_size;
+            auto superBlockId = lb >> level1_size;
+
+            auto const& block = bits[level0Id];
+            auto rs1 = block.all_ranks(lb & 63);
+            auto rs2 = block.all_ranks(rb & 63);
+
+            std::array<uint64_t, TSigma> prs1, prs2;
+            for (uint64_t symb{0}; symb < TSigma; ++symb) {
+                auto a =   level1[level1Id][symb]
+                         + superBlocks[superBlockId][symb];
+                rs1[symb] += a;
+                rs2[symb] += a;
+                prs1[symb] = rs1[symb] + (symb > 0 ? prs1[symb-1] : 0);
+                prs2[symb] = rs2[symb] + (symb > 0 ? prs2[symb-1] : 0);
+            }
+            return {rs1, prs1, rs2, prs2};
+        });
+    }
+
+    auto rank_and_symbol(uint64_t idx) const -> std::tuple<uint64_t, uint64_t> {
+        return with_popcnt(kernels, [&]() -> std::tuple<uint64_t, uint64_t> {
+            auto level0Id     = idx >>  6;
+            auto level1Id     = idx >> level0_size;
+            auto superBlockId = idx >> level1_size;
+            auto bitId = idx & 63;
+
+            auto [rank, symb] = bits[level0Id].rank_symbol(bitId);
+            return {  rank
+                     + level1[level1Id][symb]
+                     + superBlocks[superBlockId][symb], symb};
+        });
     }
 
     uint64_t rank_symbol(uint64_t idx) const {
-        auto level0Id     = idx >>  6;
-        auto level1Id     = idx >> level0_size;
-        auto superBlockId = idx >> level1_size;
-        auto bitId = idx & 63;
-
-        auto [rank, symb] = bits[level0Id].rank_symbol(bitId);
-        return    rank
-                + level1[level1Id][symb]
-                + superBlocks[superBlockId][symb];
+        return std::get<0>(rank_and_symbol(idx));
+    }
+
+    /**!\brief marks all rows `i` for which `isSampled(i)` is true
+     */
+    template <typename CB>
+    void markSamples(CB const& isSampled) requires SampleMarkers {
+        for (auto& block : bits) {
+            block.samples = 0;
+        }
+        for (size_t idx{0}; idx < totalLength; ++idx) {
+            if (isSampled(idx)) {
+                bits[idx >> 6].samples |= 1ull << (idx & 63);
+            }
+        }
+        sampleCounts.build(bits.size(), [&](size_t blockId) -> uint64_t {
+            return std::popcount(uint64_t{bits[blockId].samples});
+        });
+    }
+
+    bool isSampled(uint64_t idx) const requires SampleMarkers {
+        return (bits[idx >> 6].samples >> (idx & 63)) & 1;
+    }
+
+    /**!\brief number of sampled rows in front of idx
+     */
+    uint64_t sampleRank(uint64_t idx) const requires SampleMarkers {
+        auto level0Id = idx >> 6;
+        auto bitId    = idx & 63;
+        auto mask     = (1ull << bitId) - 1;
+        return sampleCounts.rank(level0Id) + std::popcount(bits[level0Id].samples & mask);
     }
 
     template <typename Archive>
     void serialize(Archive& ar) {
-        ar(bits, level1, superBlocks, totalLength);
+        if constexpr (SampleMarkers) {
+            serializeSampleMarkerFormat(ar);
+            ar(bits, level1, superBlocks, sampleCounts, totalLength);
+        } else {
+            ar(bits, level1, superBlocks, totalLength);
+        }
     }
 
 };
 
 static_assert(checkRankVector<InterleavedEPRV7>);
+static_assert(RankVectorIntervalRanks<InterleavedEPRV7<4>>);
+static_assert(!RankVectorSampleMarker<InterleavedEPRV7<4>>);
+static_assert(RankVectorSampleMarker<InterleavedEPRV7<4>::WithSampleMarkers>);
 
 }
@@ -7,8 +7,10 @@
 #include "concepts.h"
 #include "utils.h"
 
+#include <algorithm>
 #include <bitset>
 #include <ranges>
+#include <thread>
 #include <vector>
 
 namespace fmindex_collection::rankvector {
@@ -21,13 +23,28 @@ struct MultiBitvector {
 
     MultiBitvector() = default;
 
-    MultiBitvector(std::span<uint8_t const> _symbols) {
-        for (size_t sym{0}; sym < Sigma; ++sym) {
-            bitvectors[sym] = Bitvector(std::views::iota(size_t{}, _symbols.size())
-                                        | std::views::transform([&](size_t idx) {
-                                            return _symbols[idx] == sym;
-                                        }));
+    MultiBitvector(std::span<uint8_t const> _symbols)
+        : MultiBitvector{_symbols, 1}
+    {}
+
+    /**!\brief each thread constructs the bitvectors of different symbols
+     */
+    MultiBitvector(std::span<uint8_t const> _symbols, size_t threadNbr) {
+        threadNbr = std::clamp<size_t>(threadNbr, 1, Sigma);
+        auto construct = [&](size_t firstSym) {
+            for (size_t sym{firstSym}; sym < Sigma; sym += threadNbr) {
+                bitvectors[sym] = Bitvector(std::views::iota(size_t{}, _symbols.size())
+                                            | std::views::transform([&](size_t idx) {
+                                                return _symbols[idx] == sym;
+                                            }));
+            }
+        };
+        auto threads = std::vector<std::jthread>{};
+        threads.reserve(threadNbr-1);
+        for (size_t i{1}; i < threadNbr; ++i) {
+            threads.emplace_back(construct, i);
         }
+        construct(0);
     }
 
     void prefetch(uint64_t idx) const {
@@ -55,6 +72,19 @@ struct MultiBitvector {
         return bitvectors[symb].rank(idx);
     }
 
+    auto rank_and_symbol(uint64_t idx) const -> std::tuple<uint64_t, uint64_t> {
+        for (size_t sym{0}; sym < Sigma; ++sym) {
+            if (bitvectors[sym].symbol(idx)) {
+                return {bitvectors[sym].rank(idx), sym};
+            }
+        }
+        return {bitvectors[0].rank(idx), 0};
+    }
+
+    uint64_t rank_symbol(uint64_t idx) const {
+        return std::get<0>(rank_and_symbol(idx));
+    }
+
     uint64_t prefix_rank(uint64_t idx, uint8_t symb) const {
         size_t a{};
         for (size_t i{0}; i <= symb; ++i) {
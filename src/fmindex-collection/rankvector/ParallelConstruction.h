@@ -0,0 +1,77 @@
+// SPDX-FileCopyrightText: 2006-2023, Knut Reinert & Freie Universität Berlin
+// SPDX-FileCopyrightText: 2016-2023, Knut Reinert & MPI für molekulare Genetik
+// SPDX-License-Identifier: BSD-3-Clause
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <thread>
+#include <vector>
+
+namespace fmindex_collection::rankvector {
+
+/**!\brief Two phase parallel construction of rank vectors
+ *
+ * The symbols are split into one chunk per thread, each chunk starts at a
+ * multiple of `alignment` (usually the number of symbols covered by a super block).
+ *  1. each thread counts the symbols of its chunk
+ *  2. a prefix sum over these counts gives the occurrences in front of each chunk
+ *  3. each thread calls `fill(begin, end, acc)`, acc being the occurrences in [0, begin)
+ *
+ * The last chunk ends at `symbols.size()`. The containers must be sized in advance,
+ * so each chunk can be written without synchronization. With a single thread or
+ * less than `alignment` symbols `fill(0, symbols.size(), {})` is called directly.
+ *
+ * \param threadNbr number of threads, the calling thread is one of them
+ */
+template <size_t Sigma, typename fill_t>
+void parallelConstruction(std::span<uint8_t const> symbols, uint64_t alignment, size_t threadNbr, fill_t const& fill) {
+    auto const length = symbols.size();
+    threadNbr = std::max(threadNbr, size_t{1});
+    auto chunkSize = (length + threadNbr - 1) / threadNbr;
+    chunkSize = (chunkSize + alignment - 1) / alignment * alignment;
+    if (chunkSize == 0 || chunkSize >= length) {
+        fill(size_t{0}, length, std::array<uint64_t, Sigma>{});
+        return;
+    }
+    auto const chunkCount = (length + chunkSize - 1) / chunkSize;
+    auto chunkBegin = [&](size_t chunk) { return std::min(chunk * chunkSize, length); };
+
+    auto forEachChunk = [&](auto const& f) {
+        auto threads = std::vector<std::jthread>{};
+        threads.reserve(chunkCount-1);
+        for (size_t chunk{1}; chunk < chunkCount; ++chunk) {
+            threads.emplace_back([&, chunk]() { f(chunk); });
+        }
+        f(0);
+    };
+
+    // phase 1: occurrences of each symbol in each chunk
+    auto acc = std::vector<std::array<uint64_t, Sigma>>(chunkCount);
+    forEachChunk([&](size_t chunk) {
+        auto& ct = acc[chunk];
+        for (size_t i{chunkBegin(chunk)}; i < chunkBegin(chunk+1); ++i) {
+            ct[symbols[i]] += 1;
+        }
+    });
+
+    // phase 2: exclusive prefix sum
+    auto sum = std::array<uint64_t, Sigma>{};
+    for (auto& ct : acc) {
+        for (size_t symb{0}; symb < Sigma; ++symb) {
+            auto v = ct[symb];
+            ct[symb] = sum[symb];
+            sum[symb] += v;
+        }
+    }
+
+    // phase 3: fill chunks independently
+    forEachChunk([&](size_t chunk) {
+        fill(chunkBegin(chunk), chunkBegin(chunk+1), acc[chunk]);
+    });
+}
+
+}
@@ -106,6 +106,25 @@ struct RBBwt {
         }
     }
 
+    auto rank_and_symbol(uint64_t idx) const -> std::tuple<uint64_t, uint64_t> {
+        auto nbr = partition.rank(idx / encodingBlockSize);
+        auto s = partition.symbol(idx/encodingBlockSize);
+        if (s == 0) {
+            auto [v, symb] = rankAndSymbol(bitvector1, idx - nbr*encodingBlockSize);
+            auto v2 = bitvector2.rank(nbr, symb) * encodingBlockSize;
+            return {v + v2, symb};
+        } else {
+            auto tail = idx % encodingBlockSize;
+            auto [v2, symb] = rankAndSymbol(bitvector2, nbr);
+            auto v = bitvector1.rank(idx - nbr*encodingBlockSize - tail, symb);
+            return {v + tail + v2 * encodingBlockSize, symb};
+        }
+    }
+
+    uint64_t rank_symbol(uint64_t idx) const {
+        return std::get<0>(rank_and_symbol(idx));
+    }
+
     uint64_t prefix_rank(uint64_t idx, uint64_t symb) const {
         auto nbr = partition.rank(idx / encodingBlockSize);
         auto v2  = bitvector2.prefix_rank(nbr, symb) * encodingBlockSize;
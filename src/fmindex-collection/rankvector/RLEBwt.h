@@ -0,0 +1,165 @@
+// SPDX-FileCopyrightText: 2006-2023, Knut Reinert & Freie Universität Berlin
+// SPDX-FileCopyrightText: 2016-2023, Knut Reinert & MPI für molekulare Genetik
+// SPDX-License-Identifier: BSD-3-Clause
+#pragma once
+
+#include "../bitvector/SparseBitvector.h"
+#include "InterleavedBitvector.h"
+#include "concepts.h"
+
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace fmindex_collection::rankvector {
+
+/**
+ * A run length encoded bwt
+ *
+ * The symbols are stored as r runs:
+ *  - heads: the symbol of each run, as rank vector of length r
+ *  - runStarts: sparse bitvector marking the first position of each run
+ *  - sortedRunStarts: sparse bitvector marking the first position of each run, as if the
+ *    runs were stably sorted by their symbol
+ *
+ * rank(idx, c) = (number of c in the first heads.rank(run, c) runs of c) + (idx - start of run, if the run consists of c),
+ * with run being the run containing idx-1. The first value is a select on sortedRunStarts.
+ * Memory and query cost depend on r, not on the length of the bwt, which makes it suitable
+ * for highly repetitive texts.
+ */
+template <size_t TSigma, typename HeadVector = InterleavedBitvector16<TSigma>>
+struct RLEBwt {
+    static constexpr size_t Sigma = TSigma;
+
+    HeadVector                     heads{};
+    bitvector::SparseBitvector     runStarts{};
+    bitvector::SparseBitvector     sortedRunStarts{};
+    std::array<uint64_t, TSigma+1> C{};          // number of occurrences of all smaller symbols
+    std::array<uint64_t, TSigma+1> runOffsets{}; // number of runs of all smaller symbols
+
+    RLEBwt() = default;
+    RLEBwt(std::span<uint8_t const> _symbols) {
+        auto runSymbols = std::vector<uint8_t>{};
+        auto runLengths = std::vector<uint64_t>{};
+        for (size_t i{0}; i < _symbols.size(); ++i) {
+            bool newRun = (i == 0 or _symbols[i] != _symbols[i-1]);
+            if (newRun) {
+                runSymbols.push_back(_symbols[i]);
+                runLengths.push_back(0);
+            }
+            runLengths.back() += 1;
+            runStarts.push_back(newRun);
+        }
+
+        for (size_t i{0}; i < runSymbols.size(); ++i) {
+            C[runSymbols[i]+1]          += runLengths[i];
+            runOffsets[runSymbols[i]+1] += 1;
+        }
+        for (size_t c{1}; c < C.size(); ++c) {
+            C[c]          += C[c-1];
+            runOffsets[c] += runOffsets[c-1];
+        }
+
+        auto marks = std::vector<bool>(_symbols.size());
+        auto acc   = C;
+        for (size_t i{0}; i < runSymbols.size(); ++i) {
+            marks[acc[runSymbols[i]]] = true;
+            acc[runSymbols[i]] += runLengths[i];
+        }
+        sortedRunStarts = bitvector::SparseBitvector{marks.size(), [&](size_t i) {
+            return marks[i];
+        }};
+
+        heads = HeadVector{std::span{runSymbols}};
+    }
+
+    size_t size() const {
+        return runStarts.size();
+    }
+
+    /**!\brief number of runs
+     */
+    size_t runCount() const {
+        return heads.size();
+    }
+
+    /**!\brief number of occurrences of symb in the first k runs of symb
+     */
+    uint64_t runAccumulated(uint64_t symb, uint64_t k) const {
+        if (runOffsets[symb] + k == runOffsets[symb+1]) {
+            return C[symb+1] - C[symb];
+        }
+        return sortedRunStarts.select(runOffsets[symb] + k) - C[symb];
+    }
+
+    void prefetch(uint64_t idx) const {
+        runStarts.prefetch(idx);
+    }
+
+    uint8_t symbol(uint64_t idx) const {
+        auto run = runStarts.rank(idx+1) - 1;
+        return heads.symbol(run);
+    }
+
+    uint64_t rank(uint64_t idx, uint64_t symb) const {
+        if (idx == 0) return 0;
+        auto run = runStarts.rank(idx) - 1;
+        auto r = runAccumulated(symb, heads.rank(run, symb));
+        if (heads.symbol(run) == symb) {
+            r += idx - runStarts.select(run);
+        }
+        return r;
+    }
+
+    auto rank_and_symbol(uint64_t idx) const -> std::tuple<uint64_t, uint64_t> {
+        auto run = runStarts.rank(idx+1) - 1;
+        auto [k, symb] = rankAndSymbol(heads, run);
+        return {runAccumulated(symb, k) + idx - runStarts.select(run), symb};
+    }
+
+    uint64_t rank_symbol(uint64_t idx) const {
+        return std::get<0>(rank_and_symbol(idx));
+    }
+
+    uint64_t prefix_rank(uint64_t idx, uint64_t symb) const {
+        auto rs = all_ranks(idx);
+        uint64_t a{};
+        for (size_t i{0}; i <= symb; ++i) {
+            a += rs[i];
+        }
+        return a;
+    }
+
+    auto all_ranks(uint64_t idx) const -> std::array<uint64_t, TSigma> {
+        auto rs = std::array<uint64_t, TSigma>{};
+        if (idx == 0) return rs;
+        auto run = runStarts.rank(idx) - 1;
+        auto ks  = heads.all_ranks(run);
+        for (size_t i{0}; i < TSigma; ++i) {
+            rs[i] = runAccumulated(i, ks[i]);
+        }
+        rs[heads.symbol(run)] += idx - runStarts.select(run);
+        return rs;
+    }
+
+    auto all_ranks_and_prefix_ranks(uint64_t idx) const -> std::tuple<std::array<uint64_t, TSigma>, std::array<uint64_t, TSigma>> {
+        auto rs  = all_ranks(idx);
+        auto prs = rs;
+        for (size_t i{1}; i < TSigma; ++i) {
+            prs[i] = prs[i-1] + prs[i];
+        }
+        return {rs, prs};
+    }
+
+    template <typename Archive>
+    void serialize(Archive& ar) {
+        ar(heads, runStarts, sortedRunStarts, C, runOffsets);
+    }
+};
+
+template <size_t TSigma> using RLEBwtInstance = RLEBwt<TSigma>;
+static_assert(checkRankVector<RLEBwtInstance>);
+
+}
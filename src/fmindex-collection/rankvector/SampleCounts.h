@@ -0,0 +1,102 @@
+// SPDX-FileCopyrightText: 2006-2023, Knut Reinert & Freie Universität Berlin
+// SPDX-FileCopyrightText: 2016-2023, Knut Reinert & MPI für molekulare Genetik
+// SPDX-License-Identifier: BSD-3-Clause
+#pragma once
+
+#include "../MMapAllocator.h"
+
+#include <cstdint>
+#include <stdexcept>
+#include <type_traits>
+
+namespace fmindex_collection::rankvector {
+
+/* Number of sampled rows in front of each block
+ *
+ * Used by rank vectors, that store a sample marker bit for each row inside
+ * of their blocks. Each block has a 32bit count relative to its superblock,
+ * each superblock covers 2^32 rows.
+ *
+ * \param RowsPerBlock number of rows (and marker bits) of a single block
+ */
+template <uint64_t RowsPerBlock>
+struct SampleCounts {
+    static constexpr uint64_t blocksPerSuperBlock = (uint64_t{1}<<32) / RowsPerBlock;
+
+    MMapVector<uint32_t> blocks;
+    MMapVector<uint64_t> superBlocks;
+
+    /**!\brief computes the counts of all blocks
+     *
+     * \param blockCount number of blocks
+     * \param popcount   callback, returning the number of marker bits of block `i`
+     */
+    template <typename CB>
+    void build(size_t blockCount, CB const& popcount) {
+        blocks.clear();
+        superBlocks.clear();
+        blocks.reserve(blockCount);
+        superBlocks.reserve(blockCount / blocksPerSuperBlock + 1);
+
+        uint64_t acc{};
+        for (size_t blockId{0}; blockId < blockCount; ++blockId) {
+            if (blockId % blocksPerSuperBlock == 0) {
+                superBlocks.push_back(acc);
+            }
+            blocks.push_back(acc - superBlocks.back());
+            acc += popcount(blockId);
+        }
+    }
+
+    /**!\brief number of sampled rows in front of block `blockId`
+     */
+    uint64_t rank(size_t blockId) const {
+        return blocks[blockId] + superBlocks[blockId / blocksPerSuperBlock];
+    }
+
+    template <typename Archive>
+    void serialize(Archive& ar) {
+        ar(blocks, superBlocks);
+    }
+};
+
+/* SampleCounts, only present if `Enabled`
+ *
+ * Rank vectors declare it `[[no_unique_address]]`, so rank vectors without
+ * sample markers don't carry an (empty) member.
+ */
+struct NoSampleCounts {};
+
+template <bool Enabled, uint64_t RowsPerBlock>
+using OptionalSampleCounts = std::conditional_t<Enabled, SampleCounts<RowsPerBlock>, NoSampleCounts>;
+
+/* Sample marker bits of a block, only present if `Enabled`
+ *
+ * Blocks inherit from it, so rank vectors without sample markers keep their
+ * size and their serialized layout (empty base).
+ */
+template <bool Enabled, typename Word = uint64_t>
+struct SampleMarkerBits {
+    Word samples{}; // sample marker, same bit position as the symbol
+};
+
+template <typename Word>
+struct SampleMarkerBits<false, Word> {};
+
+/* Format tag, stored in front of rank vectors with sample markers
+ *
+ * Loading a rank vector with sample markers from a file that was stored
+ * without them (or with an older layout) throws instead of misreading it.
+ */
+inline constexpr uint64_t SampleMarkerFormat = 0x314b52414d434d46ull; // "FMCMARK1"
+
+template <typename Archive>
+void serializeSampleMarkerFormat(Archive& ar) {
+    auto format = SampleMarkerFormat;
+    ar(format);
+    if (format != SampleMarkerFormat) {
+        throw std::runtime_error{"fmindex-collection - rank vector was not stored with sample markers"};
+    }
+}
+
+}
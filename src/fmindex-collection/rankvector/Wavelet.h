@@ -75,7 +75,15 @@ struct Wavelet {
     }
 
     uint8_t symbol(uint64_t idx) const {
-        uint8_t symb{};
+        return std::get<1>(rank_and_symbol(idx));
+    }
+
+    /**!\brief rank of the symbol at idx
+     *
+     * Descending the tree to find the symbol computes its rank on the way.
+     */
+    auto rank_and_symbol(uint64_t idx) const -> std::tuple<uint64_t, uint64_t> {
+        uint64_t symb{};
         for (uint8_t b{0}; b < bits; ++b) {
             uint8_t id_offset = (1ull<<b)-1;
             uint8_t id        = id_offset + symb;
@@ -97,7 +105,11 @@ struct Wavelet {
             }
 
         }
-        return symb;
+        return {idx, symb};
+    }
+
+    uint64_t rank_symbol(uint64_t idx) const {
+        return std::get<0>(rank_and_symbol(idx));
     }
 
     uint64_t rank(uint64_t idx, uint8_t symb) const {
@@ -4,6 +4,7 @@
 #pragma once
 
 #include "../bitvector/concepts.h"
+#include "../concepts.h"
 
 #include <array>
 #include <cstddef>
@@ -86,7 +87,59 @@ concept RankVector =
 };
 
 
-template<template <auto> typename T>
+/* RankVector with an additional constructor, that uses multiple threads
+ */
+template <typename T, typename SymbolType = uint8_t>
+concept RankVectorParallelConstruction = RankVector<T, SymbolType>
+    && requires(std::span<SymbolType const> symbols, size_t threadNbr) {
+    { T{symbols, threadNbr} } -> std::same_as<T>;
+};
+
+/* RankVector, that computes the rank of the symbol at a certain position together with the symbol itself,
+ * e.g. decoding the block only once (fused LF-step), see `rankAndSymbol`
+ *
+ * \return tuple {rank(idx, symbol(idx)), symbol(idx)}
+ */
+template <typename T, typename SymbolType = uint8_t>
+concept RankVectorRankAndSymbol = RankVector<T, SymbolType>
+    && requires(T t, size_t idx) {
+    { t.rank_and_symbol(idx) } -> std::same_as<std::tuple<uint64_t, uint64_t>>;
+};
+
+/* RankVector, that computes all_ranks_and_prefix_ranks of both ends of an interval [lb, rb) at once,
+ * e.g. decoding a block only once, if both ends are inside of it
+ *
+ * \return tuple {ranks of lb, prefix ranks of lb, ranks of rb, prefix ranks of rb}
+ */
+template <typename T, typename SymbolType = uint8_t>
+concept RankVectorIntervalRanks = RankVector<T, SymbolType>
+    && requires(T t, size_t lb, size_t rb) {
+    { t.all_ranks_and_prefix_ranks_interval(lb, rb) } -> std::same_as<std::tuple<std::array<uint64_t, T::Sigma>, std::array<uint64_t, T::Sigma>, std::array<uint64_t, T::Sigma>, std::array<uint64_t, T::Sigma>>>;
+};
+
+/* RankVector, that stores a sample marker bit for each row inside of its blocks
+ *
+ * markSamples(cb) - marks all rows `i` for which `cb(i)` returns true
+ * isSampled(idx)  - checks if row idx is marked, the marker is inside the block of `symbol(idx)`
+ * sampleRank(idx) - number of marked rows in front of idx
+ */
+template <typename T, typename SymbolType = uint8_t>
+concept RankVectorSampleMarker = RankVector<T, SymbolType>
+    && requires(T t, T const ct, size_t idx) {
+    { t.markSamples([](size_t) { return false; }) };
+    { ct.isSampled(idx) } -> std::same_as<bool>;
+    { ct.sampleRank(idx) } -> std::same_as<uint64_t>;
+};
+
+/* Run length encoded rank vectors report the number of runs
+ */
+template <typename T, typename SymbolType = uint8_t>
+concept RankVectorRunCount = RankVector<T, SymbolType>
+    && requires(T const t) {
+    { t.runCount() } -> std::same_as<size_t>;
+};
+
+template<template <auto...> typename T>
 concept checkRankVector =    RankVector<T<2>>
                           && RankVector<T<4>>
                           && RankVector<T<5>>
@@ -19,5 +19,6 @@
 #include "Wavelet.h"
 #include "RBBwt.h"
 #include "RBBwtV2.h"
+#include "RLEBwt.h"
 #include "Sdsl_wt_bldc.h"
 #include "Sdsl_wt_epr.h"
@@ -0,0 +1,127 @@
+// SPDX-FileCopyrightText: 2006-2023, Knut Reinert & Freie Universität Berlin
+// SPDX-FileCopyrightText: 2016-2023, Knut Reinert & MPI für molekulare Genetik
+// SPDX-License-Identifier: BSD-3-Clause
+#pragma once
+
+#include "../MMapAllocator.h"
+#include "SelectCursor.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+
+namespace fmindex_collection {
+
+/**!\brief Precomputed cursors of all strings of length k
+ *
+ * Every search starts with a cursor covering the whole index, the first
+ * steps are the most expensive ones (each rank operation is a cache miss).
+ * This table stores the interval of every k-mer, a search can start
+ * directly at depth k.
+ *
+ * Only k-mers over the symbols 1 to Sigma-1 are stored, (Sigma-1)^k entries.
+ * Cursors of k-mers that don't occur in the index are empty, but
+ * can have a different `lb` than a cursor computed step by step.
+ *
+ * The table is independent of the index, but must only be used with
+ * the index it was created from. It can be serialized next to the index.
+ */
+template <typename Index>
+struct KmerTable {
+    static constexpr size_t Sigma = Index::Sigma;
+
+    struct Entry {
+        uint64_t lb{};
+        uint64_t lbRev{}; // or lbRc of a RCBiFMIndexCursor
+        uint64_t len{};
+
+        template <typename Archive>
+        void serialize(Archive& ar) {
+            ar(lb, lbRev, len);
+        }
+    };
+
+    size_t            k{};
+    MMapVector<Entry> entries;
+
+    KmerTable() = default;
+
+    /**!\brief creates the table
+     *
+     * \param index index that the table is created for
+     * \param _k length of the stored k-mers, the table has (Sigma-1)^k entries
+     */
+    KmerTable(Index const& index, size_t _k)
+        : k{_k}
+    {
+        if (k == 0) {
+            throw std::runtime_error{"fmindex-collection - KmerTable requires k > 0"};
+        }
+        size_t size{1};
+        for (size_t i{0}; i < k; ++i) {
+            size *= Sigma-1;
+        }
+        entries.resize(size);
+
+        // k-mers are extended to the left, the last symbol is the least significant digit
+        auto fill = [&](auto const& self, auto const& cur, size_t depth, size_t code, size_t factor) -> void {
+            if (depth == k) {
+                auto& e = entries[code];
+                e.lb  = cur.lb;
+                e.len = cur.len;
+                if constexpr (requires() { cur.lbRev; }) {
+                    e.lbRev = cur.lbRev;
+                } else if constexpr (requires() { cur.lbRc; }) {
+                    e.lbRev = cur.lbRc;
+                }
+                return;
+            }
+            auto cursors = cur.extendLeft();
+            for (size_t symb{1}; symb < Sigma; ++symb) {
+                if (cursors[symb].empty()) continue;
+                self(self, cursors[symb], depth+1, code + (symb-1) * factor, factor * (Sigma-1));
+            }
+        };
+        fill(fill, select_cursor_t<Index>{index}, 0, 0, 1);
+    }
+
+    /**!\brief cursor of the k-mer `query[pos] ... query[pos+k-1]`
+     *
+     * If the k-mer contains a symbol that is not stored in the table
+     * (symbol 0), the cursor is computed step by step.
+     *
+     * \tparam cursor_t type of the returned cursor, e.g. `select_left_cursor_t<Index>`
+     */
+    template <typename cursor_t = select_cursor_t<Index>, typename query_t>
+    auto lookup(Index const& index, query_t const& query, size_t pos) const -> cursor_t {
+        size_t code{0};
+        for (size_t i{0}; i < k; ++i) {
+            size_t symb = query[pos+i];
+            if (symb == 0 || symb >= Sigma) {
+                auto cur = cursor_t{index};
+                for (size_t j{k}; j > 0 and !cur.empty(); --j) {
+                    cur = cur.extendLeft(query[pos+j-1]);
+                }
+                return cur;
+            }
+            code = code * (Sigma-1) + (symb-1);
+        }
+        auto const& e = entries[code];
+        if constexpr (requires(cursor_t cur) { cur.lbRev; } or requires(cursor_t cur) { cur.lbRc; }) {
+            return cursor_t{index, e.lb, e.lbRev, e.len};
+        } else {
+            return cursor_t{index, e.lb, e.len};
+        }
+    }
+
+    size_t memoryUsage() const {
+        return sizeof(KmerTable) + entries.size() * sizeof(Entry);
+    }
+
+    template <typename Archive>
+    void serialize(Archive& ar) {
+        ar(k, entries);
+    }
+};
+
+}
@@ -0,0 +1,125 @@
+// SPDX-FileCopyrightText: 2006-2023, Knut Reinert & Freie Universität Berlin
+// SPDX-FileCopyrightText: 2016-2023, Knut Reinert & MPI für molekulare Genetik
+// SPDX-License-Identifier: BSD-3-Clause
+#pragma once
+
+#include "../numa.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+namespace fmindex_collection {
+
+/**!\brief Processes a batch of queries on multiple threads
+ *
+ * The queries [0, queryCount) are cut into chunks. Every thread grabs the next
+ * unprocessed chunk, until none are left. This way fast threads take over
+ * work from slow threads.
+ *
+ * \param queryCount number of queries
+ * \param threadNbr  number of threads, the calling thread is one of them
+ * \param makeWorker called once per thread with a thread local result buffer
+ *                   `std::vector<result_t>&`. Must return a callable that
+ *                   processes the queries [begin, end) and appends its results
+ *                   into this buffer.
+ * \param delegate   called for every result (with the unpacked result_t).
+ *                   Calls are serialized and happen in the same order as a
+ *                   single threaded execution would report them.
+ * \param chunkSize  number of queries per chunk, 0 chooses automatically
+ *
+ * The calling thread runs one of the workers. If a worker binds itself to a
+ * NUMA node (see `numa::bindLocal`), the cpu affinity and memory policy of the
+ * calling thread are restored before returning.
+ */
+template <typename result_t, typename make_worker_t, typename delegate_t>
+void parallelQueries(size_t queryCount, size_t threadNbr, make_worker_t const& makeWorker, delegate_t&& delegate, size_t chunkSize = 0) {
+    threadNbr = std::max(size_t{1}, std::min(threadNbr, queryCount));
+
+    auto bindingGuard = numa::ThreadBindingGuard{};
+
+    auto report = [&](result_t const& r) {
+        std::apply(delegate, r);
+    };
+
+    if (chunkSize == 0) {
+        chunkSize = std::clamp<size_t>(queryCount / (threadNbr * 16), 1, 1024);
+    }
+
+    // single threaded, results can be reported directly after each chunk
+    if (threadNbr == 1) {
+        auto buffer = std::vector<result_t>{};
+        auto worker = makeWorker(buffer);
+        for (size_t begin{0}; begin < queryCount; begin += chunkSize) {
+            worker(begin, std::min(queryCount, begin + chunkSize));
+            for (auto const& r : buffer) {
+                report(r);
+            }
+            buffer.clear();
+        }
+        return;
+    }
+    size_t const chunkCount = (queryCount + chunkSize - 1) / chunkSize;
+
+    auto nextChunk = std::atomic<size_t>{0};
+    auto results   = std::vector<std::vector<result_t>>(chunkCount);
+    auto finished  = std::vector<bool>(chunkCount, false);
+    size_t nextReport{0};
+    auto mutex     = std::mutex{};
+    auto error     = std::exception_ptr{};
+
+    // reports all results of finished chunks, that are next in line
+    auto flush = [&]() {
+        while (nextReport < chunkCount && finished[nextReport]) {
+            for (auto const& r : results[nextReport]) {
+                report(r);
+            }
+            std::vector<result_t>{}.swap(results[nextReport]);
+            nextReport += 1;
+        }
+    };
+
+    auto run = [&]() {
+        try {
+            auto buffer = std::vector<result_t>{};
+            auto worker = makeWorker(buffer);
+            for (size_t chunk = nextChunk++; chunk < chunkCount; chunk = nextChunk++) {
+                auto begin = chunk * chunkSize;
+                auto end   = std::min(queryCount, begin + chunkSize);
+                worker(begin, end);
+
+                auto g = std::lock_guard{mutex};
+                if (error) break;
+                results[chunk] = std::move(buffer);
+                buffer.clear();
+                finished[chunk] = true;
+                flush();
+            }
+        } catch(...) {
+            auto g = std::lock_guard{mutex};
+            if (!error) {
+                error = std::current_exception();
+            }
+            nextChunk = chunkCount;
+        }
+    };
+
+    {
+        auto threads = std::vector<std::jthread>{};
+        threads.reserve(threadNbr-1);
+        for (size_t i{1}; i < threadNbr; ++i) {
+            threads.emplace_back(run);
+        }
+        run();
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+}
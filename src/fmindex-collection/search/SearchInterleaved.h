@@ -0,0 +1,220 @@
+// SPDX-FileCopyrightText: 2006-2023, Knut Reinert & Freie Universität Berlin
+// SPDX-FileCopyrightText: 2016-2023, Knut Reinert & MPI für molekulare Genetik
+// SPDX-License-Identifier: BSD-3-Clause
+#pragma once
+
+#include "../concepts.h"
+#include "../occtable/concepts.h"
+#include "SelectCursor.h"
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+/**
+ * Searches multiple queries at once.
+ *
+ * Each query is a small state machine. In every round all active queries
+ * first prefetch the rows of their next rank operation, and only then all
+ * ranks are computed. This way the cache misses of different queries overlap,
+ * instead of being paid one after another.
+ */
+namespace fmindex_collection::search_interleaved {
+
+namespace detail {
+
+template <typename occ_t>
+void prefetch(occ_t const& occ, size_t lb, size_t len) {
+    if constexpr (OccTablePrefetch<occ_t>) {
+        occ.prefetch(lb);
+        occ.prefetch(lb+len);
+    }
+}
+
+}
+
+/**!\brief Searches all queries without errors, `batchSize` queries are processed interleaved
+ *
+ * Same results as `search_no_errors::search`, but the delegate is called
+ * in the order in which the queries finish.
+ *
+ * \param delegate called as `delegate(qidx, cursor)`, also for queries without a match
+ */
+template <typename index_t, Sequences queries_t, typename delegate_t>
+void search_no_errors(index_t const& index, queries_t&& queries, delegate_t&& delegate, size_t batchSize = 16) {
+    using cursor_t = select_left_cursor_t<index_t>;
+    static_assert(not cursor_t::Reversed, "reversed fmindex is not supported");
+
+    struct Slot {
+        size_t   qidx;
+        size_t   pos; // number of already matched characters
+        cursor_t cur;
+    };
+
+    auto slots = std::vector<Slot>{};
+    size_t nextQuery{0};
+
+    // starts the next query, queries of length 0 are reported directly
+    auto startQuery = [&](Slot& slot) -> bool {
+        while (nextQuery < queries.size()) {
+            slot = Slot{nextQuery++, 0, cursor_t{index}};
+            if (queries[slot.qidx].size() == 0) {
+                delegate(slot.qidx, slot.cur);
+                continue;
+            }
+            return true;
+        }
+        return false;
+    };
+
+    for (size_t i{0}; i < batchSize; ++i) {
+        auto slot = Slot{};
+        if (!startQuery(slot)) break;
+        slots.push_back(slot);
+    }
+
+    while (!slots.empty()) {
+        for (auto const& s : slots) {
+            detail::prefetch(index.occ, s.cur.lb, s.cur.len);
+        }
+        for (size_t i{0}; i < slots.size();) {
+            auto& s = slots[i];
+            auto const& query = queries[s.qidx];
+            s.cur = s.cur.extendLeft(query[query.size() - s.pos - 1]);
+            s.pos += 1;
+            if (!s.cur.empty() and s.pos < query.size()) {
+                ++i;
+                continue;
+            }
+            delegate(s.qidx, s.cur);
+
+            // reuse the slot for the next query or remove it
+            if (startQuery(s)) {
+                ++i;
+            } else {
+                std::swap(slots[i], slots.back());
+                slots.pop_back();
+            }
+        }
+    }
+}
+
+/**!\brief Searches all queries with a search scheme (hamming distance), `batchSize` queries are processed interleaved
+ *
+ * Reports the same (qidx, cursor, errors) triples as `search_pseudo::search<false>`,
+ * but the delegate is called in the order in which they are found.
+ */
+template <typename index_t, Sequences queries_t, typename search_schemes_t, typename delegate_t>
+void search(index_t const& index, queries_t&& queries, search_schemes_t const& search_scheme, delegate_t&& delegate, size_t batchSize = 16) {
+    using cursor_t = select_cursor_t<index_t>;
+    static_assert(not cursor_t::Reversed, "reversed fmindex is not supported");
+
+    if (search_scheme.empty()) return;
+
+    constexpr static size_t Sigma = index_t::Sigma;
+
+    // a node of the search tree, that still needs to be expanded
+    struct Frame {
+        cursor_t cur;
+        size_t   e;
+        size_t   pos;
+        size_t   schemeIdx;
+    };
+
+    struct Slot {
+        size_t             qidx;
+        std::vector<Frame> stack;
+    };
+
+    auto isRight = [&](Frame const& f) {
+        auto const& pi = search_scheme[f.schemeIdx].pi;
+        return f.pos == 0 or pi[f.pos-1] < pi[f.pos];
+    };
+
+    auto slots = std::vector<Slot>{};
+    size_t nextQuery{0};
+
+    auto startQuery = [&](Slot& slot) -> bool {
+        while (nextQuery < queries.size()) {
+            slot.qidx = nextQuery++;
+            if (queries[slot.qidx].size() == 0) continue;
+            slot.stack.clear();
+            for (size_t j{search_scheme.size()}; j > 0; --j) {
+                slot.stack.push_back(Frame{cursor_t{index}, 0, 0, j-1});
+            }
+            if (slot.stack.empty()) continue;
+            return true;
+        }
+        return false;
+    };
+
+    for (size_t i{0}; i < batchSize; ++i) {
+        auto slot = Slot{};
+        if (!startQuery(slot)) break;
+        slots.emplace_back(std::move(slot));
+    }
+
+    while (!slots.empty()) {
+        for (auto const& s : slots) {
+            auto const& f = s.stack.back();
+            if (isRight(f)) {
+                detail::prefetch(index.occRev, f.cur.lbRev, f.cur.len);
+            } else {
+                detail::prefetch(index.occ, f.cur.lb, f.cur.len);
+            }
+        }
+
+        for (size_t i{0}; i < slots.size();) {
+            auto& s           = slots[i];
+            auto const& query = queries[s.qidx];
+            auto f            = s.stack.back();
+            s.stack.pop_back();
+
+            auto const& pi = search_scheme[f.schemeIdx].pi;
+            auto const& l  = search_scheme[f.schemeIdx].l;
+            auto const& u  = search_scheme[f.schemeIdx].u;
+
+            // only nodes with a non empty cursor are on the stack
+            if (f.pos == query.size()) {
+                if (l[f.pos-1] <= f.e and f.e <= u[f.pos-1]) {
+                    delegate(s.qidx, f.cur, f.e);
+                }
+            } else if (f.e <= u[f.pos]) {
+                auto rank  = query[pi[f.pos]];
+                bool right = isRight(f);
+
+                auto push = [&](cursor_t const& cur, size_t e) {
+                    if (cur.count() == 0) return;
+                    s.stack.push_back(Frame{cur, e, f.pos+1, f.schemeIdx});
+                };
+
+                // pushed in reverse, so they are popped in the same order as search_pseudo visits them
+                if (f.e+1 <= u[f.pos]) {
+                    auto cursors = right ? f.cur.extendRight() : f.cur.extendLeft();
+                    if (l[f.pos] <= f.e+1) {
+                        for (size_t symb{Sigma-1}; symb > 0; --symb) {
+                            if (symb == rank) continue;
+                            push(cursors[symb], f.e+1);
+                        }
+                    }
+                    if (l[f.pos] <= f.e) {
+                        push(cursors[rank], f.e);
+                    }
+                } else if (l[f.pos] <= f.e) {
+                    push(right ? f.cur.extendRight(rank) : f.cur.extendLeft(rank), f.e);
+                }
+            }
+
+            if (!s.stack.empty()) {
+                ++i;
+            } else if (startQuery(s)) {
+                ++i;
+            } else {
+                std::swap(slots[i], slots.back());
+                slots.pop_back();
+            }
+        }
+    }
+}
+
+}
@@ -3,10 +3,17 @@
 // SPDX-License-Identifier: BSD-3-Clause
 #pragma once
 
+#include "../numa.h"
+#include "KmerTable.h"
+#include "ParallelQueries.h"
 #include "SelectCursor.h"
 
+#include <algorithm>
 #include <array>
 #include <cstddef>
+#include <numeric>
+#include <tuple>
+#include <vector>
 
 /**
  * like search_ng14
@@ -47,6 +54,14 @@ struct Search {
         return search_next<'M', 'M'>(cur, 0, blockIter, 0);
     }
 
+    /**!\brief continues a search, after the first `depth` blocks were matched without errors
+     */
+    bool run(cursor_t const& cur, size_t depth) {
+        auto blockIter = search.begin() + depth;
+
+        return search_next<'M', 'M'>(cur, 0, blockIter, (blockIter-1)->rank);
+    }
+
 
     template <bool Right>
     static auto extend(cursor_t const& cur, uint64_t symb) noexcept {
@@ -157,8 +172,12 @@ struct Search {
 
 
 
+/**!\brief searches a single query
+ *
+ * \param kmerTable optional, searches starting with k error free positions start at depth k
+ */
 template <typename index_t, typename query_t, typename search_scheme_t, typename search_scheme_reordered_t, typename delegate_t>
-void search_reordered(index_t const& index, query_t&& query, search_scheme_t const& search_scheme, search_scheme_reordered_t& reordered, delegate_t&& delegate) {
+void search_reordered(index_t const& index, query_t&& query, search_scheme_t const& search_scheme, search_scheme_reordered_t& reordered, delegate_t&& delegate, KmerTable<index_t> const* kmerTable = nullptr) {
     using cursor_t = select_cursor_t<index_t>;
     using R = std::decay_t<decltype(delegate(std::declval<cursor_t>(), 0))>;
 
@@ -178,7 +197,22 @@ void search_reordered(index_t const& index, query_t&& query, search_scheme_t con
         for (size_t k {0}; k < search.size(); ++k) {
             search[k].rank = query[search_scheme[j].pi[k]];
         }
-        bool f = Search{index, search, internal_delegate}.run();
+        bool f = [&]() {
+            if (kmerTable) {
+                auto k = kmerTable->k;
+                auto const& pi = search_scheme[j].pi;
+                bool errorFree = k <= search.size() and std::all_of(search.begin(), search.begin() + k, [](auto const& b) {
+                    return b.u == 0;
+                });
+                if (errorFree) {
+                    // the first k positions of a search form a continuous part of the query
+                    auto pos = *std::min_element(pi.begin(), pi.begin() + k);
+                    auto cur = kmerTable->lookup(index, query, pos);
+                    return Search{index, search, internal_delegate}.run(cur, k);
+                }
+            }
+            return Search{index, search, internal_delegate}.run();
+        }();
         if (f) {
             return;
         }
@@ -219,6 +253,20 @@ void search(index_t const & index, queries_t && queries, search_scheme_t const &
     }
 }
 
+/**!\brief Same as `search`, but the error free beginning of a search is looked up in `kmerTable`
+ */
+template <typename index_t, typename queries_t, typename search_scheme_t, typename delegate_t>
+void search(index_t const & index, KmerTable<index_t> const & kmerTable, queries_t && queries, search_scheme_t const & search_scheme, delegate_t && delegate) {
+    if (search_scheme.empty()) return;
+
+    auto reordered = prepare_reorder(search_scheme);
+
+    for (size_t qidx{}; qidx < queries.size(); ++qidx) {
+        search_reordered(index, queries[qidx], search_scheme, reordered, [&](auto const& cur, size_t e) {
+            delegate(qidx, cur, e);
+        }, &kmerTable);
+    }
+}
 
 template <typename index_t, typename queries_t, typename search_scheme_t, typename delegate_t>
 void search_n(index_t const & index, queries_t && queries, search_scheme_t const & search_scheme, size_t n, delegate_t && delegate) {
@@ -292,4 +340,615 @@ void search_best_n(index_t const & index, queries_t && queries, std::vector<sear
     }
 }
 
+/**!\brief Searches all error counts of a search scheme in a single pass, ordered by the number of errors
+ *
+ * Instead of running a separate search scheme for each number of errors (see `search_best`),
+ * the tree of a single search scheme for 0..k errors is explored once. Only matches are
+ * followed right away, nodes at which an error can occur are stored in the stratum of
+ * e+1 errors and expanded after all nodes with e errors are processed.
+ * Hits are therefore reported grouped by their number of errors, the exact prefixes that
+ * every error count shares are walked only once.
+ */
+template <typename index_t, typename search_scheme_t, typename delegate_t>
+struct StratifiedSearch {
+    constexpr static size_t Sigma = index_t::Sigma;
+
+    using cursor_t = select_cursor_t<index_t>;
+    using search_t = std::vector<Block<size_t>>;
+
+    /* a node whose error transitions still have to be expanded */
+    struct Node {
+        cursor_t cursor;
+        size_t   search;
+        size_t   pos;
+        size_t   lastRank;
+
+        using F = void (StratifiedSearch::*)(cursor_t const&, size_t e, size_t j, size_t pos, size_t lastRank);
+        F func;
+    };
+
+    index_t const& index;
+    search_scheme_t const& search_scheme;
+    delegate_t const& delegate;
+
+    std::vector<search_t>          searches;
+    std::vector<std::vector<Node>> strata; // strata[e] nodes that are expanded with e errors
+
+    size_t errorFreeSearch; // index of a search without lower bounds, or searches.size()
+
+    size_t qidx{};
+    bool   hits{};
+    bool   abort{};
+
+    StratifiedSearch(index_t const& _index, search_scheme_t const& _search_scheme, delegate_t const& _delegate)
+        : index        {_index}
+        , search_scheme{_search_scheme}
+        , delegate     {_delegate}
+        , searches     {prepare_reorder(_search_scheme)}
+    {
+        size_t maxErrors{};
+        for (auto const& search : searches) {
+            for (auto const& block : search) {
+                maxErrors = std::max(maxErrors, block.u);
+            }
+        }
+        strata.resize(maxErrors+1);
+
+        errorFreeSearch = std::ranges::find_if(searches, [](auto const& search) {
+            return std::ranges::all_of(search, [](auto const& block) { return block.l == 0; });
+        }) - searches.begin();
+    }
+
+    /**!\brief searches a single query
+     *
+     * \param bestHit stops after the first number of errors that has any hits
+     */
+    template <typename query_t>
+    void search(size_t _qidx, query_t const& query, bool bestHit) {
+        qidx  = _qidx;
+        hits  = false;
+        abort = false;
+        for (auto& stratum : strata) {
+            stratum.clear();
+        }
+
+        for (size_t j{0}; j < searches.size(); ++j) {
+            auto& search = searches[j];
+            for (size_t k {0}; k < search.size(); ++k) {
+                search[k].rank = query[search_scheme[j].pi[k]];
+            }
+        }
+
+        // error free stratum, a search without lower bounds already finds all error free hits
+        if (bestHit and errorFreeSearch < searches.size()) {
+            search_next<'M', 'M'>(cursor_t{index}, 0, errorFreeSearch, 0, 0);
+            if (abort or hits) return;
+        }
+        for (size_t j{0}; j < searches.size() and not abort; ++j) {
+            if (bestHit and j == errorFreeSearch) continue;
+            search_next<'M', 'M'>(cursor_t{index}, 0, j, 0, 0);
+        }
+
+        for (size_t e{1}; e < strata.size(); ++e) {
+            if (abort or (bestHit and hits)) return;
+            // expanding nodes of stratum e only adds nodes to later strata
+            for (auto const& node : strata[e]) {
+                (this->*node.func)(node.cursor, e-1, node.search, node.pos, node.lastRank);
+                if (abort) return;
+            }
+        }
+    }
+
+    template <bool Right>
+    static auto extend(cursor_t const& cur, uint64_t symb) noexcept {
+        if constexpr (Right) {
+            return cur.extendRight(symb);
+        } else {
+            return cur.extendLeft(symb);
+        }
+    }
+    template <bool Right>
+    static auto extend(cursor_t const& cur) noexcept {
+        if constexpr (Right) {
+            return cur.extendRight();
+        } else {
+            return cur.extendLeft();
+        }
+    }
+
+    template <char LInfo, char RInfo>
+    void search_next(cursor_t const& cur, size_t e, size_t j, size_t pos, size_t lastRank) {
+        if (cur.count() == 0) {
+            return;
+        }
+
+        auto const& search = searches[j];
+        if (pos == search.size()) {
+            if constexpr ((LInfo == 'M' or LInfo == 'I') and (RInfo == 'M' or RInfo == 'I')) {
+                hits = true;
+                using R = std::decay_t<decltype(delegate(qidx, cur, e))>;
+                if constexpr (std::same_as<R, bool>) {
+                    abort = delegate(qidx, cur, e);
+                } else {
+                    delegate(qidx, cur, e);
+                }
+            }
+            return;
+        }
+        if (search[pos].dir == Dir::Right) {
+            cur.prefetchRight();
+            search_next_dir<LInfo, RInfo, true>(cur, e, j, pos, lastRank);
+        } else {
+            cur.prefetchLeft();
+            search_next_dir<LInfo, RInfo, false>(cur, e, j, pos, lastRank);
+        }
+    }
+
+    /**!\brief follows the match and defers all error transitions into the next stratum
+     */
+    template <char LInfo, char RInfo, bool Right>
+    void search_next_dir(cursor_t const& cur, size_t e, size_t j, size_t pos, size_t lastRank) {
+        static constexpr char TInfo = Right ? RInfo : LInfo;
+
+        constexpr char OnMatchL = Right ? LInfo : 'M';
+        constexpr char OnMatchR = Right ? 'M'   : RInfo;
+
+        auto blockIter = searches[j].begin() + pos;
+        auto symb = blockIter->rank;
+
+        bool matchAllowed    = blockIter->l <= e and e <= blockIter->u
+                               and (TInfo != 'I' or symb != (blockIter-1)->rank)
+                               and (TInfo != 'D' or symb != lastRank);
+        bool mismatchAllowed = blockIter->l <= e+1 and e+1 <= blockIter->u;
+
+        if (mismatchAllowed) {
+            strata[e+1].push_back(Node{cur, j, pos, lastRank, &StratifiedSearch::expand_errors<LInfo, RInfo, Right>});
+        }
+        if (matchAllowed) {
+            auto newCur = extend<Right>(cur, symb);
+            search_next<OnMatchL, OnMatchR>(newCur, e, j, pos+1, symb);
+        }
+    }
+
+    /**!\brief expands all transitions of a node that introduce an error, see `search_ng21::Search::search_next_dir`
+     */
+    template <char LInfo, char RInfo, bool Right>
+    void expand_errors(cursor_t const& cur, size_t e, size_t j, size_t pos, size_t lastRank) {
+        static constexpr char TInfo = Right ? RInfo : LInfo;
+
+        constexpr bool Deletion     = TInfo == 'M' or TInfo == 'D';
+        constexpr bool Insertion    = TInfo == 'M' or TInfo == 'I';
+
+        constexpr char OnSubstituteL = Right ? LInfo : 'S';
+        constexpr char OnSubstituteR = Right ? 'S'   : RInfo;
+        constexpr char OnDeletionL   = Right ? LInfo : 'D';
+        constexpr char OnDeletionR   = Right ? 'D'   : RInfo;
+        constexpr char OnInsertionL  = Right ? LInfo : 'I';
+        constexpr char OnInsertionR  = Right ? 'I'   : RInfo;
+
+        auto symb = searches[j][pos].rank;
+
+        auto cursors = extend<Right>(cur);
+        for (uint64_t i{1}; i < Sigma; ++i) {
+            if (i == symb) continue;
+            if constexpr (Deletion) {
+                search_next<OnDeletionL, OnDeletionR>(cursors[i], e+1, j, pos, i); // deletion occurred in query
+                if (abort) return;
+            }
+            search_next<OnSubstituteL, OnSubstituteR>(cursors[i], e+1, j, pos+1, i); // as substitution
+            if (abort) return;
+        }
+
+        if constexpr (Insertion) {
+            search_next<OnInsertionL, OnInsertionR>(cur, e+1, j, pos+1, lastRank); // insertion occurred in query
+        }
+    }
+};
+
+/**!\brief Same as `search`, but hits of a query are reported ordered by their number of errors
+ *
+ * \param search_scheme a single search scheme covering all error counts, e.g. 0 to k errors
+ */
+template <typename index_t, typename queries_t, typename search_scheme_t, typename delegate_t>
+void search_stratified(index_t const & index, queries_t && queries, search_scheme_t const & search_scheme, delegate_t && delegate) {
+    if (search_scheme.empty()) return;
+
+    auto search = StratifiedSearch{index, search_scheme, delegate};
+    for (size_t qidx{}; qidx < queries.size(); ++qidx) {
+        search.search(qidx, queries[qidx], /*bestHit*/ false);
+    }
+}
+
+/**!\brief Same as `search_best`, but explores a single search scheme only once
+ *
+ * Reports all hits with the lowest number of errors, without restarting the search for each error count.
+ * \param search_scheme a single search scheme covering all error counts, e.g. 0 to k errors
+ */
+template <typename index_t, typename queries_t, typename search_scheme_t, typename delegate_t>
+void search_best_stratified(index_t const & index, queries_t && queries, search_scheme_t const & search_scheme, delegate_t && delegate) {
+    if (search_scheme.empty()) return;
+
+    auto search = StratifiedSearch{index, search_scheme, delegate};
+    for (size_t qidx{}; qidx < queries.size(); ++qidx) {
+        search.search(qidx, queries[qidx], /*bestHit*/ true);
+    }
+}
+
+/**!\brief Same as `search_best_n`, but explores a single search scheme only once
+ */
+template <typename index_t, typename queries_t, typename search_scheme_t, typename delegate_t>
+void search_best_n_stratified(index_t const & index, queries_t && queries, search_scheme_t const & search_scheme, size_t n, delegate_t && delegate) {
+    if (search_scheme.empty()) return;
+
+    size_t ct{};
+    auto cb = [&](size_t qidx, auto cur, size_t e) {
+        if (cur.count() + ct > n) {
+            cur.len = n-ct;
+        }
+        ct += cur.count();
+        delegate(qidx, cur, e);
+        return ct == n;
+    };
+    auto search = StratifiedSearch{index, search_scheme, cb};
+    for (size_t qidx{}; qidx < queries.size(); ++qidx) {
+        ct = 0;
+        search.search(qidx, queries[qidx], /*bestHit*/ true);
+    }
+}
+
+/**!\brief Same search as `Search`, but for a batch of queries at once
+ *
+ * The queries are sorted by the characters in the order the search visits them (`pi`).
+ * Queries that share the first characters form a continuous range and are searched
+ * together, until their characters differ. Each node of the search is therefore expanded
+ * once per range instead of once per query. Hits are reported to every query of the range.
+ *
+ * All queries must have the length of the search scheme.
+ */
+template <typename index_t, typename queries_t, typename delegate_t>
+struct BatchSearch {
+    constexpr static size_t Sigma = index_t::Sigma;
+
+    using cursor_t = select_cursor_t<index_t>;
+
+    index_t const& index;
+    queries_t const& queries;
+    delegate_t const& delegate;
+
+    std::vector<Block<size_t>> const& search;
+    std::vector<size_t> order; // queries, sorted by their characters in pi order
+    std::vector<size_t> pi;
+
+    /* queries order[begin..end), sharing the characters of the first pos (or more) visited positions */
+    struct Range {
+        size_t begin;
+        size_t end;
+    };
+
+    template <typename search_t>
+    BatchSearch(index_t const& _index, queries_t const& _queries, search_t const& _search, std::vector<Block<size_t>> const& _reordered, delegate_t const& _delegate)
+        : index   {_index}
+        , queries {_queries}
+        , delegate{_delegate}
+        , search  {_reordered}
+        , order   (_queries.size())
+        , pi      (_search.pi.begin(), _search.pi.end())
+    {
+        std::iota(order.begin(), order.end(), 0);
+        std::ranges::stable_sort(order, [&](size_t lhs, size_t rhs) {
+            for (auto p : pi) {
+                if (queries[lhs][p] != queries[rhs][p]) {
+                    return queries[lhs][p] < queries[rhs][p];
+                }
+            }
+            return false;
+        });
+    }
+
+    void run() {
+        if (order.empty()) return;
+        search_next<'M', 'M'>(cursor_t{index}, 0, Range{0, order.size()}, 0, 0);
+    }
+
+    /**!\brief character of the i-th query (in sorted order) at the pos-th visited position
+     */
+    size_t symbol(size_t i, size_t pos) const {
+        return queries[order[i]][pi[pos]];
+    }
+
+    /**!\brief end of the queries in [begin, end) that have the character symb at pos
+     *
+     * All queries in [begin, end) share the characters before pos and are therefore sorted by the character at pos.
+     */
+    size_t findGroupEnd(size_t begin, size_t end, size_t pos, size_t symb) const {
+        while (begin < end) {
+            auto mid = begin + (end - begin) / 2;
+            if (symbol(mid, pos) <= symb) {
+                begin = mid + 1;
+            } else {
+                end = mid;
+            }
+        }
+        return begin;
+    }
+
+    template <bool Right>
+    static auto extend(cursor_t const& cur, uint64_t symb) noexcept {
+        if constexpr (Right) {
+            return cur.extendRight(symb);
+        } else {
+            return cur.extendLeft(symb);
+        }
+    }
+    template <bool Right>
+    static auto extend(cursor_t const& cur) noexcept {
+        if constexpr (Right) {
+            return cur.extendRight();
+        } else {
+            return cur.extendLeft();
+        }
+    }
+
+    template <char LInfo, char RInfo>
+    void search_next(cursor_t const& cur, size_t e, Range range, size_t pos, size_t lastRank) const {
+        if (cur.count() == 0) {
+            return;
+        }
+
+        if (pos == search.size()) {
+            if constexpr ((LInfo == 'M' or LInfo == 'I') and (RInfo == 'M' or RInfo == 'I')) {
+                for (size_t i{range.begin}; i < range.end; ++i) {
+                    delegate(order[i], cur, e);
+                }
+            }
+            return;
+        }
+        if (search[pos].dir == Dir::Right) {
+            cur.prefetchRight();
+            search_next_dir<LInfo, RInfo, true>(cur, e, range, pos, lastRank);
+        } else {
+            cur.prefetchLeft();
+            search_next_dir<LInfo, RInfo, false>(cur, e, range, pos, lastRank);
+        }
+    }
+
+    template <char LInfo, char RInfo, bool Right>
+    void search_next_dir(cursor_t const& cur, size_t e, Range range, size_t pos, size_t lastRank) const {
+        static constexpr char TInfo = Right ? RInfo : LInfo;
+
+        constexpr bool Deletion     = TInfo == 'M' or TInfo == 'D';
+        constexpr bool Insertion    = TInfo == 'M' or TInfo == 'I';
+
+        constexpr char OnMatchL      = Right ? LInfo : 'M';
+        constexpr char OnMatchR      = Right ? 'M'   : RInfo;
+        constexpr char OnSubstituteL = Right ? LInfo : 'S';
+        constexpr char OnSubstituteR = Right ? 'S'   : RInfo;
+        constexpr char OnDeletionL   = Right ? LInfo : 'D';
+        constexpr char OnDeletionR   = Right ? 'D'   : RInfo;
+        constexpr char OnInsertionL  = Right ? LInfo : 'I';
+        constexpr char OnInsertionR  = Right ? 'I'   : RInfo;
+
+        auto const& block = search[pos];
+        bool mismatchAllowed = block.l <= e+1 and e+1 <= block.u;
+
+        // all symbols are computed once for all queries of this range
+        auto cursors = std::array<cursor_t, Sigma>{};
+        if (mismatchAllowed) {
+            cursors = extend<Right>(cur);
+        }
+
+        // queries of this range, grouped by their character at pos
+        for (size_t groupBegin{range.begin}; groupBegin < range.end;) {
+            auto symb     = symbol(groupBegin, pos);
+            auto groupEnd = findGroupEnd(groupBegin, range.end, pos, symb);
+            auto group    = Range{groupBegin, groupEnd};
+            groupBegin = groupEnd;
+
+            bool matchAllowed = block.l <= e and e <= block.u
+                                and (TInfo != 'I' or symb != symbol(group.begin, pos-1))
+                                and (TInfo != 'D' or symb != lastRank);
+
+            if (mismatchAllowed) {
+                if (matchAllowed) {
+                    search_next<OnMatchL, OnMatchR>(cursors[symb], e, group, pos+1, symb);
+                }
+
+                for (uint64_t i{1}; i < Sigma; ++i) {
+                    if (i == symb) continue;
+                    if constexpr (Deletion) {
+                        search_next<OnDeletionL, OnDeletionR>(cursors[i], e+1, group, pos, i); // deletion occurred in query
+                    }
+                    search_next<OnSubstituteL, OnSubstituteR>(cursors[i], e+1, group, pos+1, i); // as substitution
+                }
+
+                if constexpr (Insertion) {
+                    search_next<OnInsertionL, OnInsertionR>(cur, e+1, group, pos+1, lastRank); // insertion occurred in query
+                }
+            } else if (matchAllowed) {
+                auto newCur = extend<Right>(cur, symb);
+                search_next<OnMatchL, OnMatchR>(newCur, e, group, pos+1, symb);
+            }
+        }
+    }
+};
+
+/**!\brief Same as `search`, but queries that share characters are searched together
+ *
+ * Intended for batches with many identical or similar queries (e.g. PCR duplicates or
+ * amplicon data). The cost of each search of the search scheme depends on the
+ * number of distinct queries, instead of the number of queries.
+ * Hits of a query are reported in the same order as `search` does, but hits of different
+ * queries are interleaved.
+ */
+template <typename index_t, typename queries_t, typename search_scheme_t, typename delegate_t>
+void search_batch(index_t const & index, queries_t && queries, search_scheme_t const & search_scheme, delegate_t && delegate) {
+    if (search_scheme.empty()) return;
+
+    auto reordered = prepare_reorder(search_scheme);
+
+    for (size_t j{0}; j < search_scheme.size(); ++j) {
+        BatchSearch{index, queries, search_scheme[j], reordered[j], delegate}.run();
+    }
+}
+
+/**!\brief Same as `search`, but distributes the queries over `threadNbr` threads
+ *
+ * Each thread uses its own reordered search scheme.
+ * The delegate is never called concurrently and receives the results in
+ * the same order as `search` would report them.
+ * `index` can also be `numa::Replicas`, each thread then searches the copy of its NUMA node.
+ */
+template <typename index_t, typename queries_t, typename search_scheme_t, typename delegate_t>
+void search_parallel(index_t const & index, queries_t && queries, search_scheme_t const & search_scheme, size_t threadNbr, delegate_t && delegate) {
+    using cursor_t = select_cursor_t<numa::replicated_t<index_t>>;
+    if (search_scheme.empty()) return;
+
+    parallelQueries<std::tuple<size_t, cursor_t, size_t>>(queries.size(), threadNbr, [&](auto& results) {
+        auto const& localIndex = numa::bindLocal(index);
+        return [&, reordered = prepare_reorder(search_scheme)](size_t begin, size_t end) mutable {
+            for (size_t qidx{begin}; qidx < end; ++qidx) {
+                search_reordered(localIndex, queries[qidx], search_scheme, reordered, [&](auto const& cur, size_t e) {
+                    results.emplace_back(qidx, cur, e);
+                });
+            }
+        };
+    }, delegate);
+}
+
+/**!\brief Same as `search_n`, but distributes the queries over `threadNbr` threads
+ */
+template <typename index_t, typename queries_t, typename search_scheme_t, typename delegate_t>
+void search_n_parallel(index_t const & index, queries_t && queries, search_scheme_t const & search_scheme, size_t n, size_t threadNbr, delegate_t && delegate) {
+    using cursor_t = select_cursor_t<numa::replicated_t<index_t>>;
+    if (search_scheme.empty()) return;
+
+    parallelQueries<std::tuple<size_t, cursor_t, size_t>>(queries.size(), threadNbr, [&](auto& results) {
+        auto const& localIndex = numa::bindLocal(index);
+        return [&, reordered = prepare_reorder(search_scheme)](size_t begin, size_t end) mutable {
+            for (size_t qidx{begin}; qidx < end; ++qidx) {
+                size_t ct{};
+                search_reordered(localIndex, queries[qidx], search_scheme, reordered, [&] (auto cur, size_t e) {
+                    if (cur.count() + ct > n) {
+                        cur.len = n-ct;
+                    }
+                    ct += cur.count();
+                    results.emplace_back(qidx, cur, e);
+                    return ct == n;
+                });
+            }
+        };
+    }, delegate);
+}
+
+/**!\brief Same as `search_best`, but distributes the queries over `threadNbr` threads
+ */
+template <typename index_t, typename queries_t, typename search_scheme_t, typename delegate_t>
+void search_best_parallel(index_t const & index, queries_t && queries, std::vector<search_scheme_t> const & search_schemes, size_t threadNbr, delegate_t && delegate) {
+    using cursor_t = select_cursor_t<numa::replicated_t<index_t>>;
+    if (search_schemes.empty()) return;
+
+    parallelQueries<std::tuple<size_t, cursor_t, size_t>>(queries.size(), threadNbr, [&](auto& results) {
+        auto const& localIndex = numa::bindLocal(index);
+        auto reordered_list = std::vector<decltype(prepare_reorder(search_schemes[0]))>{};
+        for (auto const& search_scheme : search_schemes) {
+            reordered_list.emplace_back(prepare_reorder(search_scheme));
+        }
+        return [&, reordered_list = std::move(reordered_list)](size_t begin, size_t end) mutable {
+            for (size_t qidx{begin}; qidx < end; ++qidx) {
+                for (size_t i{0}; i < reordered_list.size(); ++i) {
+                    size_t ct{};
+                    search_reordered(localIndex, queries[qidx], search_schemes[i], reordered_list[i], [&] (auto const& cur, size_t e) {
+                        ct += cur.count();
+                        results.emplace_back(qidx, cur, e);
+                    });
+                    if (ct > 0) break;
+                }
+            }
+        };
+    }, delegate);
+}
+
+/**!\brief Same as `search_best_n`, but distributes the queries over `threadNbr` threads
+ */
+template <typename index_t, typename queries_t, typename search_scheme_t, typename delegate_t>
+void search_best_n_parallel(index_t const & index, queries_t && queries, std::vector<search_scheme_t> const & search_schemes, size_t n, size_t threadNbr, delegate_t && delegate) {
+    using cursor_t = select_cursor_t<numa::replicated_t<index_t>>;
+    static_assert(not cursor_t::Reversed, "reversed fmindex is not supported");
+
+    if (search_schemes.empty()) return;
+
+    parallelQueries<std::tuple<size_t, cursor_t, size_t>>(queries.size(), threadNbr, [&](auto& results) {
+        auto const& localIndex = numa::bindLocal(index);
+        auto reordered_list = std::vector<decltype(prepare_reorder(search_schemes[0]))>{};
+        for (auto const& search_scheme : search_schemes) {
+            reordered_list.emplace_back(prepare_reorder(search_scheme));
+        }
+        return [&, reordered_list = std::move(reordered_list)](size_t begin, size_t end) mutable {
+            for (size_t qidx{begin}; qidx < end; ++qidx) {
+                for (size_t i{0}; i < reordered_list.size(); ++i) {
+                    size_t ct{};
+                    search_reordered(localIndex, queries[qidx], search_schemes[i], reordered_list[i], [&] (auto cur, size_t e) {
+                        if (cur.count() + ct > n) {
+                            cur.len = n-ct;
+                        }
+                        ct += cur.count();
+                        results.emplace_back(qidx, cur, e);
+                        return ct == n;
+                    });
+                    if (ct > 0) break;
+                }
+            }
+        };
+    }, delegate);
+}
+
+/**!\brief Same as `search_best_stratified`, but distributes the queries over `threadNbr` threads
+ */
+template <typename index_t, typename queries_t, typename search_scheme_t, typename delegate_t>
+void search_best_stratified_parallel(index_t const & index, queries_t && queries, search_scheme_t const & search_scheme, size_t threadNbr, delegate_t && delegate) {
+    using cursor_t = select_cursor_t<numa::replicated_t<index_t>>;
+    if (search_scheme.empty()) return;
+
+    parallelQueries<std::tuple<size_t, cursor_t, size_t>>(queries.size(), threadNbr, [&](auto& results) {
+        auto const& localIndex = numa::bindLocal(index);
+        return [&](size_t begin, size_t end) {
+            auto cb = [&](size_t qidx, auto const& cur, size_t e) {
+                results.emplace_back(qidx, cur, e);
+            };
+            auto search = StratifiedSearch{localIndex, search_scheme, cb};
+            for (size_t qidx{begin}; qidx < end; ++qidx) {
+                search.search(qidx, queries[qidx], /*bestHit*/ true);
+            }
+        };
+    }, delegate);
+}
+
+/**!\brief Same as `search_best_n_stratified`, but distributes the queries over `threadNbr` threads
+ */
+template <typename index_t, typename queries_t, typename search_scheme_t, typename delegate_t>
+void search_best_n_stratified_parallel(index_t const & index, queries_t && queries, search_scheme_t const & search_scheme, size_t n, size_t threadNbr, delegate_t && delegate) {
+    using cursor_t = select_cursor_t<numa::replicated_t<index_t>>;
+    if (search_scheme.empty()) return;
+
+    parallelQueries<std::tuple<size_t, cursor_t, size_t>>(queries.size(), threadNbr, [&](auto& results) {
+        auto const& localIndex = numa::bindLocal(index);
+        return [&](size_t begin, size_t end) {
+            size_t ct{};
+            auto cb = [&](size_t qidx, auto cur, size_t e) {
+                if (cur.count() + ct > n) {
+                    cur.len = n-ct;
+                }
+                ct += cur.count();
+                results.emplace_back(qidx, cur, e);
+                return ct == n;
+            };
+            auto search = StratifiedSearch{localIndex, search_scheme, cb};
+            for (size_t qidx{begin}; qidx < end; ++qidx) {
+                ct = 0;
+                search.search(qidx, queries[qidx], /*bestHit*/ true);
+            }
+        };
+    }, delegate);
+}
+
 }
@@ -3,10 +3,14 @@
 // SPDX-License-Identifier: BSD-3-Clause
 #pragma once
 
+#include "../numa.h"
+#include "ParallelQueries.h"
 #include "SelectCursor.h"
 
 #include <array>
 #include <cstddef>
+#include <tuple>
+#include <vector>
 
 /**
  * like search_ng21
@@ -292,4 +296,115 @@ void search_best_n(index_t const & index, queries_t && queries, std::vector<sear
     }
 }
 
+/**!\brief Same as `search`, but distributes the queries over `threadNbr` threads
+ *
+ * Each thread uses its own reordered search scheme.
+ * The delegate is never called concurrently and receives the results in
+ * the same order as `search` would report them.
+ * `index` can also be `numa::Replicas`, each thread then searches the copy of its NUMA node.
+ */
+template <typename index_t, typename queries_t, typename search_scheme_t, typename delegate_t>
+void search_parallel(index_t const & index, queries_t && queries, search_scheme_t const & search_scheme, size_t threadNbr, delegate_t && delegate) {
+    using cursor_t = select_cursor_t<numa::replicated_t<index_t>>;
+    if (search_scheme.empty()) return;
+
+    parallelQueries<std::tuple<size_t, cursor_t, size_t>>(queries.size(), threadNbr, [&](auto& results) {
+        auto const& localIndex = numa::bindLocal(index);
+        return [&, reordered = prepare_reorder(search_scheme)](size_t begin, size_t end) mutable {
+            for (size_t qidx{begin}; qidx < end; ++qidx) {
+                search_reordered(localIndex, queries[qidx], search_scheme, reordered, [&](auto const& cur, size_t e) {
+                    results.emplace_back(qidx, cur, e);
+                });
+            }
+        };
+    }, delegate);
+}
+
+/**!\brief Same as `search_n`, but distributes the queries over `threadNbr` threads
+ */
+template <typename index_t, typename queries_t, typename search_scheme_t, typename delegate_t>
+void search_n_parallel(index_t const & index, queries_t && queries, search_scheme_t const & search_scheme, size_t n, size_t threadNbr, delegate_t && delegate) {
+    using cursor_t = select_cursor_t<numa::replicated_t<index_t>>;
+    if (search_scheme.empty()) return;
+
+    parallelQueries<std::tuple<size_t, cursor_t, size_t>>(queries.size(), threadNbr, [&](auto& results) {
+        auto const& localIndex = numa::bindLocal(index);
+        return [&, reordered = prepare_reorder(search_scheme)](size_t begin, size_t end) mutable {
+            for (size_t qidx{begin}; qidx < end; ++qidx) {
+                size_t ct{};
+                search_reordered(localIndex, queries[qidx], search_scheme, reordered, [&] (auto cur, size_t e) {
+                    if (cur.count() + ct > n) {
+                        cur.len = n-ct;
+                    }
+                    ct += cur.count();
+                    results.emplace_back(qidx, cur, e);
+                    return ct == n;
+                });
+            }
+        };
+    }, delegate);
+}
+
+/**!\brief Same as `search_best`, but distributes the queries over `threadNbr` threads
+ */
+template <typename index_t, typename queries_t, typename search_scheme_t, typename delegate_t>
+void search_best_parallel(index_t const & index, queries_t && queries, std::vector<search_scheme_t> const & search_schemes, size_t threadNbr, delegate_t && delegate) {
+    using cursor_t = select_cursor_t<numa::replicated_t<index_t>>;
+    if (search_schemes.empty()) return;
+
+    parallelQueries<std::tuple<size_t, cursor_t, size_t>>(queries.size(), threadNbr, [&](auto& results) {
+        auto const& localIndex = numa::bindLocal(index);
+        auto reordered_list = std::vector<decltype(prepare_reorder(search_schemes[0]))>{};
+        for (auto const& search_scheme : search_schemes) {
+            reordered_list.emplace_back(prepare_reorder(search_scheme));
+        }
+        return [&, reordered_list = std::move(reordered_list)](size_t begin, size_t end) mutable {
+            for (size_t qidx{begin}; qidx < end; ++qidx) {
+                for (size_t i{0}; i < reordered_list.size(); ++i) {
+                    size_t ct{};
+                    search_reordered(localIndex, queries[qidx], search_schemes[i], reordered_list[i], [&] (auto const& cur, size_t e) {
+                        ct += cur.count();
+                        results.emplace_back(qidx, cur, e);
+                    });
+                    if (ct > 0) break;
+                }
+            }
+        };
+    }, delegate);
+}
+
+/**!\brief Same as `search_best_n`, but distributes the queries over `threadNbr` threads
+ */
+template <typename index_t, typename queries_t, typename search_scheme_t, typename delegate_t>
+void search_best_n_parallel(index_t const & index, queries_t && queries, std::vector<search_scheme_t> const & search_schemes, size_t n, size_t threadNbr, delegate_t && delegate) {
+    using cursor_t = select_cursor_t<numa::replicated_t<index_t>>;
+    static_assert(not cursor_t::Reversed, "reversed fmindex is not supported");
+
+    if (search_schemes.empty()) return;
+
+    parallelQueries<std::tuple<size_t, cursor_t, size_t>>(queries.size(), threadNbr, [&](auto& results) {
+        auto const& localIndex = numa::bindLocal(index);
+        auto reordered_list = std::vector<decltype(prepare_reorder(search_schemes[0]))>{};
+        for (auto const& search_scheme : search_schemes) {
+            reordered_list.emplace_back(prepare_reorder(search_scheme));
+        }
+        return [&, reordered_list = std::move(reordered_list)](size_t begin, size_t end) mutable {
+            for (size_t qidx{begin}; qidx < end; ++qidx) {
+                for (size_t i{0}; i < reordered_list.size(); ++i) {
+                    size_t ct{};
+                    search_reordered(localIndex, queries[qidx], search_schemes[i], reordered_list[i], [&] (auto cur, size_t e) {
+                        if (cur.count() + ct > n) {
+                            cur.len = n-ct;
+                        }
+                        ct += cur.count();
+                        results.emplace_back(qidx, cur, e);
+                        return ct == n;
+                    });
+                    if (ct > 0) break;
+                }
+            }
+        };
+    }, delegate);
+}
+
 }
@@ -3,10 +3,14 @@
 // SPDX-License-Identifier: BSD-3-Clause
 #pragma once
 
+#include "../numa.h"
+#include "ParallelQueries.h"
 #include "SelectCursor.h"
 
 #include <array>
 #include <cstddef>
+#include <tuple>
+#include <vector>
 
 /**
  * like search_ng21V6 (with abort flag)
@@ -303,4 +307,69 @@ void search_best_n(index_t const & index, queries_t && queries, search_scheme_t
     return search_n(index, std::forward<queries_t>(queries), search_scheme, n, std::forward<delegate_t>(delegate), std::true_type{});
 }
 
+/**!\brief Same as `search`, but distributes the queries over `threadNbr` threads
+ *
+ * The delegate is never called concurrently and receives the results in
+ * the same order as `search` would report them.
+ * `index` can also be `numa::Replicas`, each thread then searches the copy of its NUMA node.
+ */
+template <typename index_t, typename queries_t, typename search_scheme_t, typename delegate_t, typename bestHit_t = std::false_type>
+void search_parallel(index_t const & index, queries_t && queries, search_scheme_t const & search_scheme, size_t threadNbr, delegate_t && delegate, bestHit_t bestHit = {}) {
+    using cursor_t = select_cursor_t<numa::replicated_t<index_t>>;
+    static_assert(not cursor_t::Reversed, "reversed fmindex is not supported");
+
+    parallelQueries<std::tuple<size_t, cursor_t, size_t>>(queries.size(), threadNbr, [&](auto& results) {
+        auto const& localIndex = numa::bindLocal(index);
+        return [&](size_t begin, size_t end) {
+            auto cb = [&](size_t qidx, auto cur, size_t e) {
+                results.emplace_back(qidx, cur, e);
+            };
+            auto internal_delegate = refine_callback<numa::replicated_t<index_t>>(cb);
+            auto search = Search{localIndex, search_scheme, internal_delegate};
+            for (size_t qidx{begin}; qidx < end; ++qidx) {
+                search.search(qidx, queries[qidx], bestHit);
+            }
+        };
+    }, delegate);
+}
+
+/**!\brief Same as `search_n`, but distributes the queries over `threadNbr` threads
+ */
+template <typename index_t, typename queries_t, typename search_scheme_t, typename delegate_t, typename bestHit_t = std::false_type>
+void search_n_parallel(index_t const & index, queries_t && queries, search_scheme_t const & search_scheme, size_t n, size_t threadNbr, delegate_t && delegate, bestHit_t bestHit = {}) {
+    using cursor_t = select_cursor_t<numa::replicated_t<index_t>>;
+    static_assert(not cursor_t::Reversed, "reversed fmindex is not supported");
+
+    parallelQueries<std::tuple<size_t, cursor_t, size_t>>(queries.size(), threadNbr, [&](auto& results) {
+        auto const& localIndex = numa::bindLocal(index);
+        return [&](size_t begin, size_t end) {
+            size_t ct;
+            auto cb = [&](size_t qidx, auto cur, size_t e) {
+                if (cur.count() + ct > n) {
+                    cur.len = n-ct;
+                }
+                ct += cur.count();
+                results.emplace_back(qidx, cur, e);
+                return ct == n;
+            };
+            auto internal_delegate = refine_callback<numa::replicated_t<index_t>>(cb);
+            auto search = Search{localIndex, search_scheme, internal_delegate};
+            for (size_t qidx{begin}; qidx < end; ++qidx) {
+                ct = 0;
+                search.search(qidx, queries[qidx], bestHit);
+            }
+        };
+    }, delegate);
+}
+
+template <typename index_t, typename queries_t, typename search_scheme_t, typename delegate_t>
+void search_best_parallel(index_t const & index, queries_t && queries, search_scheme_t const & search_scheme, size_t threadNbr, delegate_t && delegate) {
+    return search_parallel(index, queries, search_scheme, threadNbr, delegate, std::true_type{});
+}
+
+template <typename index_t, typename queries_t, typename search_scheme_t, typename delegate_t>
+void search_best_n_parallel(index_t const & index, queries_t && queries, search_scheme_t const & search_scheme, size_t n, size_t threadNbr, delegate_t && delegate) {
+    return search_n_parallel(index, std::forward<queries_t>(queries), search_scheme, n, threadNbr, std::forward<delegate_t>(delegate), std::true_type{});
+}
+
 }
@@ -0,0 +1,334 @@
+// SPDX-FileCopyrightText: 2006-2023, Knut Reinert & Freie Universität Berlin
+// SPDX-FileCopyrightText: 2016-2023, Knut Reinert & MPI für molekulare Genetik
+// SPDX-License-Identifier: BSD-3-Clause
+#pragma once
+
+#include "../numa.h"
+#include "ParallelQueries.h"
+#include "SelectCursor.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+/**
+ * like search_ng21
+ * but breadth first over a batch of queries. All pending cursors (the frontier) of all
+ * queries are advanced one step at a time, sorted by their position in the BWT. Rank queries
+ * of consecutive cursors are then close to each other and share cache lines and pages.
+ * If the frontier grows beyond `maxFrontier` entries, the remaining cursors of the current
+ * step are searched depth first.
+ */
+namespace fmindex_collection::search_ng21V8 {
+
+enum class Dir : uint8_t { Left, Right };
+struct Block {
+    size_t l;
+    size_t u;
+    Dir dir;
+};
+
+template <typename index_t, typename queries_t, typename search_scheme_t, typename delegate_t>
+struct Search {
+    constexpr static size_t Sigma = index_t::Sigma;
+
+    using cursor_t = select_cursor_t<index_t>;
+
+    struct Entry;
+    using F = void (Search::*)(Entry const&);
+
+    struct Entry {
+        cursor_t cursor;
+        F        func;
+        uint32_t qidx;   // relative to the first query of the batch
+        uint16_t search; // index of the search inside the search scheme
+        uint16_t pos;
+        uint8_t  e;
+        uint8_t  lastRank;
+        Dir      dir;
+    };
+
+    index_t const& index;
+    queries_t const& queries;
+    search_scheme_t const& search_scheme;
+    delegate_t const& delegate;
+    size_t maxFrontier;
+
+    std::vector<std::vector<Block>> searches;
+
+    std::vector<Entry> current;
+    std::vector<Entry> next;
+    std::vector<size_t> buckets;
+    size_t firstQuery{};
+    bool depthFirst{};
+
+    Search(index_t const& _index, queries_t const& _queries, search_scheme_t const& _search_scheme, delegate_t const& _delegate, size_t _maxFrontier)
+        : index        {_index}
+        , queries      {_queries}
+        , search_scheme{_search_scheme}
+        , delegate     {_delegate}
+        , maxFrontier  {_maxFrontier}
+    {
+        static_assert(Sigma <= 256, "lastRank is stored as uint8_t");
+        if (search_scheme.size() > std::numeric_limits<uint16_t>::max()) {
+            throw std::runtime_error{"fmindex-collection - search_ng21V8 supports at most 65535 searches per search scheme"};
+        }
+
+        // generate reordered searches
+        for (auto const& s : search_scheme) {
+            if (s.pi.size() > std::numeric_limits<uint16_t>::max()) {
+                throw std::runtime_error{"fmindex-collection - search_ng21V8 supports queries of at most 65535 characters"};
+            }
+            auto& search = searches.emplace_back();
+            for (size_t i{0}; i < s.pi.size(); ++i) {
+                auto dir = [&]() {
+                    if (i == 0) {
+                        return s.pi[i] < s.pi[i+1]?Dir::Right:Dir::Left;
+                    } else {
+                        return s.pi[i-1] < s.pi[i]?Dir::Right:Dir::Left;
+                    }
+                }();
+                search.emplace_back(Block{size_t{s.l[i]}, size_t{s.u[i]}, dir});
+            }
+        }
+    }
+
+    /**!\brief searches the queries [firstQuery, lastQuery)
+     */
+    void run(size_t _firstQuery, size_t lastQuery) {
+        firstQuery = _firstQuery;
+        for (size_t qidx{firstQuery}; qidx < lastQuery; ++qidx) {
+            for (size_t j{0}; j < searches.size(); ++j) {
+                emit<'M', 'M'>(cursor_t{index}, qidx, j, 0, 0, 0);
+            }
+        }
+
+        while (!next.empty()) {
+            sortFrontier();
+            depthFirst = false;
+
+            constexpr size_t PrefetchDistance = 8;
+            for (size_t i{0}; i < current.size(); ++i) {
+                if (i + PrefetchDistance < current.size()) {
+                    prefetch(current[i + PrefetchDistance]);
+                }
+                auto const& entry = current[i];
+                (this->*entry.func)(entry);
+            }
+        }
+        current.clear();
+    }
+
+    /**!\brief moves the frontier from `next` to `current`, ordered by the rows of the next rank query
+     *
+     * Counting sort into (about) one bucket per entry, a bucket covers neighboring rows of one
+     * direction. Entries inside a bucket are not sorted.
+     */
+    void sortFrontier() {
+        auto shift = size_t(std::bit_width(index.size()));
+        auto width = size_t(std::bit_width(next.size()));
+        shift = (shift > width) ? shift - width : 0;
+        auto bucketOf = [&](Entry const& entry) {
+            return (key(entry.cursor, entry.dir) >> shift) * 2 + (entry.dir == Dir::Right);
+        };
+
+        buckets.assign(((index.size() >> shift) + 1) * 2 + 1, 0);
+        for (auto const& entry : next) {
+            buckets[bucketOf(entry) + 1] += 1;
+        }
+        std::partial_sum(buckets.begin(), buckets.end(), buckets.begin());
+
+        current.resize(next.size());
+        for (auto const& entry : next) {
+            current[buckets[bucketOf(entry)]++] = entry;
+        }
+        next.clear();
+    }
+
+    /**!\brief prefetches the rows of the next rank query of `entry`
+     */
+    void prefetch(Entry const& entry) const {
+        auto row = key(entry.cursor, entry.dir);
+        auto prefetchRows = [&](auto const& occ) {
+            if constexpr (OccTablePrefetch<std::decay_t<decltype(occ)>>) {
+                occ.prefetch(row);
+                occ.prefetch(row + entry.cursor.len);
+            }
+        };
+        if constexpr (requires { index.occRev; }) {
+            if (entry.dir == Dir::Right) {
+                prefetchRows(index.occRev);
+                return;
+            }
+        }
+        prefetchRows(index.occ);
+    }
+
+    /**!\brief row of the next rank query, this is the interval that will be extended in direction dir
+     */
+    static size_t key(cursor_t const& cur, Dir dir) {
+        if (dir == Dir::Right) {
+            if constexpr (requires { cur.lbRev; }) {
+                return cur.lbRev;
+            } else if constexpr (requires { cur.lbRc; }) {
+                return cur.lbRc;
+            }
+        }
+        return cur.lb;
+    }
+
+    template <bool Right>
+    static auto extend(cursor_t const& cur, uint64_t symb) noexcept {
+        if constexpr (Right) {
+            return cur.extendRight(symb);
+        } else {
+            return cur.extendLeft(symb);
+        }
+    }
+    template <bool Right>
+    static auto extend(cursor_t const& cur) noexcept {
+        if constexpr (Right) {
+            return cur.extendRight();
+        } else {
+            return cur.extendLeft();
+        }
+    }
+
+    /**!\brief reports finished searches, all others are added to the next frontier (or searched depth first)
+     */
+    template <char LInfo, char RInfo>
+    void emit(cursor_t const& cur, size_t qidx, size_t j, size_t pos, size_t e, size_t lastRank) {
+        if (cur.count() == 0) {
+            return;
+        }
+
+        auto const& search = searches[j];
+        if (pos == search.size()) {
+            if constexpr ((LInfo == 'M' or LInfo == 'I') and (RInfo == 'M' or RInfo == 'I')) {
+                delegate(qidx, cur, e);
+            }
+            return;
+        }
+
+        auto entry = Entry{cur, &Search::step<LInfo, RInfo>, static_cast<uint32_t>(qidx - firstQuery), static_cast<uint16_t>(j),
+                           static_cast<uint16_t>(pos), static_cast<uint8_t>(e), static_cast<uint8_t>(lastRank), search[pos].dir};
+        if (depthFirst) {
+            step<LInfo, RInfo>(entry);
+            return;
+        }
+        next.push_back(entry);
+        depthFirst = next.size() >= maxFrontier;
+    }
+
+    template <char LInfo, char RInfo>
+    void step(Entry const& entry) {
+        if (entry.dir == Dir::Right) {
+            step_dir<LInfo, RInfo, true>(entry);
+        } else {
+            step_dir<LInfo, RInfo, false>(entry);
+        }
+    }
+
+    template <char LInfo, char RInfo, bool Right>
+    void step_dir(Entry const& entry) {
+        static constexpr char TInfo = Right ? RInfo : LInfo;
+
+        constexpr bool Deletion     = TInfo == 'M' or TInfo == 'D';
+        constexpr bool Insertion    = TInfo == 'M' or TInfo == 'I';
+
+        constexpr char OnMatchL      = Right ? LInfo : 'M';
+        constexpr char OnMatchR      = Right ? 'M'   : RInfo;
+        constexpr char OnSubstituteL = Right ? LInfo : 'S';
+        constexpr char OnSubstituteR = Right ? 'S'   : RInfo;
+        constexpr char OnDeletionL   = Right ? LInfo : 'D';
+        constexpr char OnDeletionR   = Right ? 'D'   : RInfo;
+        constexpr char OnInsertionL  = Right ? LInfo : 'I';
+        constexpr char OnInsertionR  = Right ? 'I'   : RInfo;
+
+        auto const& cur   = entry.cursor;
+        size_t qidx     = firstQuery + entry.qidx;
+        auto const& query = queries[qidx];
+        auto const& pi    = search_scheme[entry.search].pi;
+        auto const& block = searches[entry.search][entry.pos];
+        size_t j        = entry.search;
+        size_t pos      = entry.pos;
+        size_t e        = entry.e;
+        size_t lastRank = entry.lastRank;
+
+        size_t symb = query[pi[pos]];
+
+        bool matchAllowed    = block.l <= e and e <= block.u
+                               and (TInfo != 'I' or symb != query[pi[pos-1]])
+                               and (TInfo != 'D' or symb != lastRank);
+        bool mismatchAllowed = block.l <= e+1 and e+1 <= block.u;
+
+        if (mismatchAllowed) {
+            auto cursors = extend<Right>(cur);
+
+            if (matchAllowed) {
+                emit<OnMatchL, OnMatchR>(cursors[symb], qidx, j, pos+1, e, symb);
+            }
+
+            for (size_t i{1}; i < Sigma; ++i) {
+                if (i == symb) continue;
+                if constexpr (Deletion) {
+                    emit<OnDeletionL, OnDeletionR>(cursors[i], qidx, j, pos, e+1, i); // deletion occurred in query
+                }
+                emit<OnSubstituteL, OnSubstituteR>(cursors[i], qidx, j, pos+1, e+1, i); // as substitution
+            }
+
+            if constexpr (Insertion) {
+                emit<OnInsertionL, OnInsertionR>(cur, qidx, j, pos+1, e+1, lastRank); // insertion occurred in query
+            }
+        } else if (matchAllowed) {
+            emit<OnMatchL, OnMatchR>(extend<Right>(cur, symb), qidx, j, pos+1, e, symb);
+        }
+    }
+};
+
+/**!\brief Same as `search_ng21::search`, but breadth first
+ *
+ * Queries are processed in batches of `batchSize`, all queries of a batch share one frontier.
+ * Hits are reported in no particular order.
+ *
+ * \param maxFrontier maximal number of entries in the frontier, beyond that the search continues depth first
+ */
+template <typename index_t, typename queries_t, typename search_scheme_t, typename delegate_t>
+void search(index_t const & index, queries_t && queries, search_scheme_t const & search_scheme, delegate_t && delegate, size_t batchSize = 256, size_t maxFrontier = size_t{1}<<16) {
+    if (search_scheme.empty()) return;
+
+    auto search = Search{index, queries, search_scheme, delegate, maxFrontier};
+    for (size_t qidx{0}; qidx < queries.size(); qidx += batchSize) {
+        search.run(qidx, std::min(qidx + batchSize, queries.size()));
+    }
+}
+
+/**!\brief Same as `search`, but distributes the batches over `threadNbr` threads
+ *
+ * Each thread has its own frontier. The delegate is never called concurrently.
+ * `index` can also be `numa::Replicas`, each thread then searches the copy of its NUMA node.
+ */
+template <typename index_t, typename queries_t, typename search_scheme_t, typename delegate_t>
+void search_parallel(index_t const & index, queries_t && queries, search_scheme_t const & search_scheme, size_t threadNbr, delegate_t && delegate, size_t batchSize = 256, size_t maxFrontier = size_t{1}<<16) {
+    using cursor_t = select_cursor_t<numa::replicated_t<index_t>>;
+    if (search_scheme.empty()) return;
+
+    parallelQueries<std::tuple<size_t, cursor_t, size_t>>(queries.size(), threadNbr, [&](auto& results) {
+        auto const& localIndex = numa::bindLocal(index);
+        return [&](size_t begin, size_t end) {
+            auto report = [&](size_t qidx, auto const& cur, size_t e) {
+                results.emplace_back(qidx, cur, e);
+            };
+            Search{localIndex, queries, search_scheme, report, maxFrontier}.run(begin, end);
+        };
+    }, delegate, batchSize);
+}
+
+}
@@ -4,8 +4,13 @@
 #pragma once
 
 #include "../concepts.h"
+#include "../numa.h"
+#include "KmerTable.h"
+#include "ParallelQueries.h"
 #include "SelectCursor.h"
 
+#include <tuple>
+
 
 namespace fmindex_collection::search_no_errors {
 
@@ -35,4 +40,52 @@ void search(index_t const & index, queries_t && queries, delegate_t && delegate)
     }
 }
 
+/**!\brief Same as `search`, but the last k characters of the query are looked up in `kmerTable`
+ *
+ * Queries shorter than k are searched without the table.
+ */
+template <typename index_t, Sequence query_t>
+auto search(index_t const & index, KmerTable<index_t> const & kmerTable, query_t && query) {
+    using cursor_t = select_left_cursor_t<index_t>;
+    static_assert(not cursor_t::Reversed, "reversed fmindex is not supported");
+
+    if (query.size() < kmerTable.k) {
+        return search(index, query);
+    }
+    auto cur = kmerTable.template lookup<cursor_t>(index, query, query.size() - kmerTable.k);
+    for (size_t i{kmerTable.k}; i < query.size() and !cur.empty(); ++i) {
+        auto r = query[query.size() - i - 1];
+        cur = cur.extendLeft(r);
+    }
+    return cur;
+}
+
+template <typename index_t, Sequences queries_t, typename delegate_t>
+void search(index_t const & index, KmerTable<index_t> const & kmerTable, queries_t && queries, delegate_t && delegate) {
+    for (size_t qidx{0}; qidx < queries.size(); ++qidx) {
+        auto const& query = queries[qidx];
+        auto cursor = search(index, kmerTable, query);
+        delegate(qidx, cursor);
+    }
+}
+
+/**!\brief Same as `search`, but distributes the queries over `threadNbr` threads
+ *
+ * The delegate is never called concurrently and is called in ascending query order.
+ * `index` can also be `numa::Replicas`, each thread then searches the copy of its NUMA node.
+ */
+template <typename index_t, Sequences queries_t, typename delegate_t>
+void search_parallel(index_t const & index, queries_t && queries, size_t threadNbr, delegate_t && delegate) {
+    using cursor_t = select_left_cursor_t<numa::replicated_t<index_t>>;
+
+    parallelQueries<std::tuple<size_t, cursor_t>>(queries.size(), threadNbr, [&](auto& results) {
+        auto const& localIndex = numa::bindLocal(index);
+        return [&](size_t begin, size_t end) {
+            for (size_t qidx{begin}; qidx < end; ++qidx) {
+                results.emplace_back(qidx, search(localIndex, queries[qidx]));
+            }
+        };
+    }, delegate);
+}
+
 }
@@ -7,8 +7,12 @@
 
 #include "../concepts.h"
 #include "../fmindex/BiFMIndexCursor.h"
+#include "../numa.h"
+#include "ParallelQueries.h"
 #include "SelectCursor.h"
 
+#include <tuple>
+
 namespace fmindex_collection::search_pseudo {
 
 template <bool EditDistance, typename index_t, typename search_scheme_t, Sequence query_t, typename delegate_t>
@@ -192,5 +196,28 @@ void search(index_t const & index, query_t && query, search_schemes_t const & se
     }
 }
 
+/**!\brief Same as `search`, but distributes the queries over `threadNbr` threads
+ *
+ * The delegate is never called concurrently and receives the results in
+ * the same order as `search` would report them.
+ * `index` can also be `numa::Replicas`, each thread then searches the copy of its NUMA node.
+ */
+template <bool EditDistance, typename index_t, Sequences queries_t, typename search_schemes_t, typename delegate_t>
+void search_parallel(index_t const & index, queries_t && queries, search_schemes_t const & search_scheme, size_t threadNbr, delegate_t && delegate)
+{
+    using cursor_t = select_cursor_t<numa::replicated_t<index_t>>;
+    static_assert(not cursor_t::Reversed, "reversed fmindex is not supported");
+
+    parallelQueries<std::tuple<size_t, cursor_t, size_t>>(queries.size(), threadNbr, [&](auto& results) {
+        auto const& localIndex = numa::bindLocal(index);
+        return [&](size_t begin, size_t end) {
+            for (size_t qidx{begin}; qidx < end; ++qidx) {
+                search<EditDistance>(localIndex, queries[qidx], search_scheme, [&](auto const& cur, size_t e) {
+                    results.emplace_back(qidx, cur, e);
+                });
+            }
+        };
+    }, delegate);
+}
 
 }
@@ -0,0 +1,330 @@
+// SPDX-FileCopyrightText: 2006-2023, Knut Reinert & Freie Universität Berlin
+// SPDX-FileCopyrightText: 2016-2023, Knut Reinert & MPI für molekulare Genetik
+// SPDX-License-Identifier: BSD-3-Clause
+#pragma once
+
+#include "SearchNg21.h"
+
+#include <search_schemes/expand.h>
+#include <search_schemes/generator/all.h>
+#include <search_schemes/isComplete.h>
+#include <search_schemes/weightedNodeCount.h>
+
+#include <compare>
+#include <cstddef>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace fmindex_collection {
+
+struct CachedSearchScheme;
+
+/**!\brief Search schemes expanded to the length of the queries
+ *
+ * A search scheme must be expanded to the length of a query before it can be used.
+ * The cache expands each configuration (generator, number of errors, query length and
+ * edit/hamming distance) only once and keeps the reordered search scheme of search_ng21
+ * next to it. The cache can be shared between threads.
+ *
+ * For each length, the expansion with the lowest weighted node count is used, either the
+ * uniform expansion (`expand`) or the expansion guided by the weighted node count (`expandByWNC`).
+ * With an empty generator name, all generators are tried and the complete search scheme
+ * with the lowest weighted node count is used.
+ */
+struct SearchSchemeCache {
+    struct Key {
+        std::string generator;
+        size_t      minK;
+        size_t      maxK;
+        size_t      length;
+        bool        edit;
+
+        auto operator<=>(Key const&) const = default;
+    };
+
+    struct Entry {
+        std::string                                          generator; // generator that created the search scheme
+        search_schemes::Scheme                               scheme{};    // empty if the query is too short for the search scheme
+        std::vector<std::vector<search_ng21::Block<size_t>>> reordered{};
+        long double                                          weightedNodeCount{};
+    };
+
+    size_t sigma;    // size of the alphabet, without delimiter
+    size_t textSize;
+
+    mutable std::mutex           mutex;
+    mutable std::map<Key, Entry> entries; // entries are never removed, references stay valid
+
+    SearchSchemeCache(size_t _sigma, size_t _textSize)
+        : sigma   {_sigma}
+        , textSize{_textSize}
+    {}
+
+    /**!\brief cache for the alphabet and the text size of an index
+     */
+    template <typename index_t>
+    explicit SearchSchemeCache(index_t const& index)
+        : SearchSchemeCache{index_t::Sigma-1, index.size()}
+    {}
+
+    SearchSchemeCache(SearchSchemeCache const&) = delete;
+    auto operator=(SearchSchemeCache const&) -> SearchSchemeCache& = delete;
+
+    /**!\brief search scheme for queries of length `key.length`, expanded on first use
+     */
+    auto get(Key const& key) const -> Entry const& {
+        {
+            auto g = std::lock_guard{mutex};
+            if (auto iter = entries.find(key); iter != entries.end()) {
+                return iter->second;
+            }
+        }
+        // expanding is expensive, other threads are not blocked meanwhile
+        auto entry = create(key);
+
+        auto g = std::lock_guard{mutex};
+        return entries.try_emplace(key, std::move(entry)).first->second;
+    }
+
+    auto get(std::string const& generator, size_t minK, size_t maxK, size_t length, bool edit = true) const -> Entry const& {
+        return get(Key{generator, minK, maxK, length, edit});
+    }
+
+    /**!\brief a configuration of this cache, that can be passed to the search functions instead of a search scheme
+     */
+    auto scheme(std::string generator, size_t minK, size_t maxK, bool edit = true) const -> CachedSearchScheme;
+
+    /**!\brief weighted node count of a search scheme for the alphabet and text size of this cache
+     */
+    auto weightedNodeCount(search_schemes::Scheme const& ss, bool edit) const -> long double {
+        if (edit) {
+            return search_schemes::weightedNodeCount</*Edit=*/true>(ss, sigma, textSize);
+        }
+        return search_schemes::weightedNodeCount</*Edit=*/false>(ss, sigma, textSize);
+    }
+
+private:
+    auto create(Key const& key) const -> Entry {
+        if (!key.generator.empty()) {
+            auto iter = search_schemes::generator::all.find(key.generator);
+            if (iter == search_schemes::generator::all.end()) {
+                throw std::runtime_error{"fmindex-collection - unknown search scheme generator \"" + key.generator + "\""};
+            }
+            return create(key, key.generator, iter->second.generator);
+        }
+
+        auto best = std::optional<Entry>{};
+        for (auto const& [name, entry] : search_schemes::generator::all) {
+            auto candidate = [&]() -> std::optional<Entry> {
+                try {
+                    return create(key, name, entry.generator);
+                } catch (std::exception const&) {
+                    return std::nullopt; // generator does not support this number of errors
+                }
+            }();
+            if (!candidate || candidate->scheme.empty()) continue;
+            if (!best || candidate->weightedNodeCount < best->weightedNodeCount) {
+                best = std::move(candidate);
+            }
+        }
+        if (!best) {
+            return Entry{};
+        }
+        return *best;
+    }
+
+    template <typename generator_t>
+    auto create(Key const& key, std::string const& name, generator_t const& generator) const -> Entry {
+        auto oss = generator(static_cast<int>(key.minK), static_cast<int>(key.maxK), 0, 0); // last two parameters are not being used by the generators
+        if (oss.empty() || !search_schemes::isComplete(oss, key.minK, key.maxK)) {
+            return Entry{name};
+        }
+        if (key.length < std::max<size_t>(2, oss[0].pi.size())) {
+            return Entry{name}; // query too short
+        }
+
+        auto ess = search_schemes::expand(oss, key.length);
+        auto dss = key.edit ? search_schemes::expandByWNC</*Edit=*/true>(oss, key.length, sigma, textSize)
+                            : search_schemes::expandByWNC</*Edit=*/false>(oss, key.length, sigma, textSize);
+        auto essCount = weightedNodeCount(ess, key.edit);
+        auto dssCount = weightedNodeCount(dss, key.edit);
+
+        auto& best = (essCount <= dssCount) ? ess : dss;
+        auto reordered = search_ng21::prepare_reorder(best);
+        return Entry{name, std::move(best), std::move(reordered), std::min(essCount, dssCount)};
+    }
+};
+
+/**!\brief A configuration of a SearchSchemeCache
+ *
+ * Can be passed to the search functions of search_ng21 instead of a search scheme,
+ * the queries can then have different lengths.
+ */
+struct CachedSearchScheme {
+    SearchSchemeCache const* cache;
+    std::string              generator;
+    size_t                   minK;
+    size_t                   maxK;
+    bool                     edit{true};
+
+    /**!\brief search scheme for queries of the given length
+     */
+    auto get(size_t length) const -> SearchSchemeCache::Entry const& {
+        return cache->get(generator, minK, maxK, length, edit);
+    }
+
+    /**!\brief same configuration, but a different number of errors
+     */
+    auto withErrors(size_t _minK, size_t _maxK) const -> CachedSearchScheme {
+        return {cache, generator, _minK, _maxK, edit};
+    }
+};
+
+inline auto SearchSchemeCache::scheme(std::string generator, size_t minK, size_t maxK, bool edit) const -> CachedSearchScheme {
+    return {this, std::move(generator), minK, maxK, edit};
+}
+
+namespace search_ng21 {
+
+/**!\brief Reordered search schemes of a CachedSearchScheme, by query length
+ *
+ * search_reordered writes the query into the reordered search scheme, each thread requires
+ * its own copy. The copy of each length is created once.
+ */
+struct ReorderedCache {
+    struct Local {
+        search_schemes::Scheme const*           scheme;
+        std::vector<std::vector<Block<size_t>>> reordered;
+    };
+
+    CachedSearchScheme const& search_scheme;
+    std::map<std::tuple<size_t, size_t, size_t>, Local> entries{};
+
+    /**!\brief search scheme with `minK` to `maxK` errors for the given length
+     */
+    auto get(size_t length, size_t minK, size_t maxK) -> Local& {
+        auto key = std::make_tuple(length, minK, maxK);
+        if (auto iter = entries.find(key); iter != entries.end()) {
+            return iter->second;
+        }
+        auto const& entry = search_scheme.withErrors(minK, maxK).get(length);
+        return entries.try_emplace(key, Local{&entry.scheme, entry.reordered}).first->second;
+    }
+
+    auto get(size_t length) -> Local& {
+        return get(length, search_scheme.minK, search_scheme.maxK);
+    }
+};
+
+/**!\brief Same as `search`, but each query uses the search scheme expanded to its length
+ */
+template <typename index_t, typename queries_t, typename delegate_t>
+void search(index_t const & index, queries_t && queries, CachedSearchScheme const & search_scheme, delegate_t && delegate) {
+    auto cache = ReorderedCache{search_scheme};
+
+    for (size_t qidx{}; qidx < queries.size(); ++qidx) {
+        auto& [scheme, reordered] = cache.get(queries[qidx].size());
+        if (scheme->empty()) continue;
+        search_reordered(index, queries[qidx], *scheme, reordered, [&](auto const& cur, size_t e) {
+            delegate(qidx, cur, e);
+        });
+    }
+}
+
+/**!\brief Same as `search_n`, but each query uses the search scheme expanded to its length
+ */
+template <typename index_t, typename queries_t, typename delegate_t>
+void search_n(index_t const & index, queries_t && queries, CachedSearchScheme const & search_scheme, size_t n, delegate_t && delegate) {
+    auto cache = ReorderedCache{search_scheme};
+
+    for (size_t qidx{}; qidx < queries.size(); ++qidx) {
+        auto& [scheme, reordered] = cache.get(queries[qidx].size());
+        if (scheme->empty()) continue;
+        size_t ct{};
+        search_reordered(index, queries[qidx], *scheme, reordered, [&] (auto cur, size_t e) {
+            if (cur.count() + ct > n) {
+                cur.len = n-ct;
+            }
+            ct += cur.count();
+            delegate(qidx, cur, e);
+            return ct == n;
+        });
+    }
+}
+
+/**!\brief Same as `search_best`, each query searches with `minK` to `maxK` errors, one number of errors at a time
+ */
+template <typename index_t, typename queries_t, typename delegate_t>
+void search_best(index_t const & index, queries_t && queries, CachedSearchScheme const & search_scheme, delegate_t && delegate) {
+    auto cache = ReorderedCache{search_scheme};
+
+    for (size_t qidx{}; qidx < queries.size(); ++qidx) {
+        for (size_t k{search_scheme.minK}; k <= search_scheme.maxK; ++k) {
+            auto& [scheme, reordered] = cache.get(queries[qidx].size(), k, k);
+            if (scheme->empty()) continue;
+            size_t ct{};
+            search_reordered(index, queries[qidx], *scheme, reordered, [&] (auto const& cur, size_t e) {
+                ct += cur.count();
+                delegate(qidx, cur, e);
+            });
+            if (ct > 0) break;
+        }
+    }
+}
+
+/**!\brief Same as `search_best_n`, each query searches with `minK` to `maxK` errors, one number of errors at a time
+ */
+template <typename index_t, typename queries_t, typename delegate_t>
+void search_best_n(index_t const & index, queries_t && queries, CachedSearchScheme const & search_scheme, size_t n, delegate_t && delegate) {
+    using cursor_t = select_cursor_t<index_t>;
+    static_assert(not cursor_t::Reversed, "reversed fmindex is not supported");
+
+    auto cache = ReorderedCache{search_scheme};
+
+    for (size_t qidx{}; qidx < queries.size(); ++qidx) {
+        for (size_t k{search_scheme.minK}; k <= search_scheme.maxK; ++k) {
+            auto& [scheme, reordered] = cache.get(queries[qidx].size(), k, k);
+            if (scheme->empty()) continue;
+            size_t ct{};
+            search_reordered(index, queries[qidx], *scheme, reordered, [&] (auto cur, size_t e) {
+                if (cur.count() + ct > n) {
+                    cur.len = n-ct;
+                }
+                ct += cur.count();
+                delegate(qidx, cur, e);
+                return ct == n;
+            });
+            if (ct > 0) break;
+        }
+    }
+}
+
+/**!\brief Same as `search_parallel`, but each query uses the search scheme expanded to its length
+ *
+ * The threads share the search scheme cache.
+ */
+template <typename index_t, typename queries_t, typename delegate_t>
+void search_parallel(index_t const & index, queries_t && queries, CachedSearchScheme const & search_scheme, size_t threadNbr, delegate_t && delegate) {
+    using cursor_t = select_cursor_t<numa::replicated_t<index_t>>;
+
+    parallelQueries<std::tuple<size_t, cursor_t, size_t>>(queries.size(), threadNbr, [&](auto& results) {
+        auto const& localIndex = numa::bindLocal(index);
+        return [&, cache = ReorderedCache{search_scheme}](size_t begin, size_t end) mutable {
+            for (size_t qidx{begin}; qidx < end; ++qidx) {
+                auto& [scheme, reordered] = cache.get(queries[qidx].size());
+                if (scheme->empty()) continue;
+                search_reordered(localIndex, queries[qidx], *scheme, reordered, [&](auto const& cur, size_t e) {
+                    results.emplace_back(qidx, cur, e);
+                });
+            }
+        };
+    }, delegate);
+}
+
+}
+}
@@ -6,6 +6,8 @@
 #include "../fmindex/BiFMIndexCursor.h"
 #include "../fmindex/FMIndexCursor.h"
 #include "../fmindex/RBiFMIndexCursor.h"
+#include "../fmindex/RCBiFMIndexCursor.h"
+#include "../fmindex/RIndexCursor.h"
 #include "../fmindex/ReverseFMIndexCursor.h"
 
 
@@ -29,11 +31,21 @@ struct SelectIndexCursor<RBiFMIndex<OccTable, TCSA>> {
     using cursor_t = RBiFMIndexCursor<RBiFMIndex<OccTable, TCSA>>;
 };
 
+template <typename OccTable, typename TCSA>
+struct SelectIndexCursor<RCBiFMIndex<OccTable, TCSA>> {
+    using cursor_t = RCBiFMIndexCursor<RCBiFMIndex<OccTable, TCSA>>;
+};
+
 template <typename OccTable, typename TCSA>
 struct SelectIndexCursor<ReverseFMIndex<OccTable, TCSA>> {
     using cursor_t = ReverseFMIndexCursor<ReverseFMIndex<OccTable, TCSA>>;
 };
 
+template <typename OccTable>
+struct SelectIndexCursor<RIndex<OccTable>> {
+    using cursor_t = RIndexCursor<RIndex<OccTable>>;
+};
+
 
 template <typename Index>
 struct SelectLeftIndexCursor;
@@ -53,6 +65,16 @@ struct SelectLeftIndexCursor<RBiFMIndex<OccTable, TCSA>> {
     using cursor_t = LeftRBiFMIndexCursor<RBiFMIndex<OccTable, TCSA>>;
 };
 
+template <typename OccTable, typename TCSA>
+struct SelectLeftIndexCursor<RCBiFMIndex<OccTable, TCSA>> {
+    using cursor_t = FMIndexCursor<RCBiFMIndex<OccTable, TCSA>>;
+};
+
+template <typename OccTable>
+struct SelectLeftIndexCursor<RIndex<OccTable>> {
+    using cursor_t = RIndexCursor<RIndex<OccTable>>;
+};
+
 
 template <typename Index>
 using select_cursor_t      = typename SelectIndexCursor<Index>::cursor_t;
@@ -5,6 +5,7 @@
 
 #include "Backtracking.h"
 #include "BacktrackingWithBuffers.h"
+#include "KmerTable.h"
 #include "SearchNg12.h"
 #include "SearchNg14.h"
 #include "SearchNg15.h"
@@ -19,8 +20,11 @@
 #include "SearchNg21V5.h"
 #include "SearchNg21V6.h"
 #include "SearchNg21V7.h"
+#include "SearchNg21V8.h"
 #include "SearchNg21ea.h"
 #include "SearchNg22.h"
+#include "SearchInterleaved.h"
 #include "SearchPseudo.h"
+#include "SearchSchemeCache.h"
 #include "SearchNoErrors.h"
 #include "SearchOneError.h"
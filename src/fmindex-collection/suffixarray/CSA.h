@@ -5,6 +5,8 @@
 
 
 #include "../BitStack.h"
+#include "../builtins.h"
+#include "../MMapAllocator.h"
 #include "../bitvector/Bitvector.h"
 #include "../bitvector/CompactBitvector.h"
 #include "concepts.h"
@@ -19,7 +21,7 @@
 namespace fmindex_collection {
 
 struct CSA {
-    std::vector<uint64_t> ssa;
+    MMapVector<uint64_t> ssa;
     bitvector::CompactBitvector bv;
     size_t   bitsForPosition;   // bits reserved for position
     uint64_t bitPositionMask;   // Bit mask, to extract the position from ssa
@@ -36,6 +38,7 @@ struct CSA {
 
         csa.bitsForPosition = bitsForPosition;
         csa.bitPositionMask = (1ull<<bitsForPosition)-1;
+        csa.seqCount        = lhs.seqCount + rhs.seqCount;
         return csa;
     }
 
@@ -63,7 +66,7 @@ struct CSA {
         }
     }
 
-    CSA(std::vector<uint64_t> _ssa, BitStack const& bitstack, size_t _bitsForPosition, size_t _seqCount)
+    CSA(MMapVector<uint64_t> _ssa, BitStack const& bitstack, size_t _bitsForPosition, size_t _seqCount)
         : ssa{std::move(_ssa)}
         , bv{bitstack.size, [&](size_t idx) {
             return bitstack.value(idx);
@@ -73,8 +76,16 @@ struct CSA {
         , seqCount{_seqCount}
     {}
 
+    /**!\brief Same as above, the sampled suffix array is copied once into the index memory
+     */
+    CSA(std::vector<uint64_t> const& _ssa, BitStack const& bitstack, size_t _bitsForPosition, size_t _seqCount)
+        : CSA{MMapVector<uint64_t>(_ssa.begin(), _ssa.end()), bitstack, _bitsForPosition, _seqCount}
+    {}
+
+    /**!\brief Samples the suffix array directly, sa is not modified
+     */
     template <typename T>
-    CSA(std::vector<T> sa, size_t samplingRate, std::span<size_t const> _inputSizes, bool reverse=false)
+    CSA(std::vector<T> const& sa, size_t samplingRate, std::span<size_t const> _inputSizes, bool reverse=false)
         : bv {sa.size(), [&](size_t idx) {
             return (sa[idx] % samplingRate) == 0;
         }}
@@ -99,7 +110,7 @@ struct CSA {
         }
 
         // Construct sampled suffix array
-        size_t ssaI{}; // Index of the ssa that is inside of sa
+        ssa.reserve(bv.rank(bv.size()));
         for (size_t i{0}; i < sa.size(); ++i) {
             bool sample = (sa[i] % samplingRate) == 0;
             if (sample) {
@@ -115,17 +126,7 @@ struct CSA {
                         subjPos = len;
                     }
                 }
-                sa[ssaI] = subjPos | (subjId << bitsForPosition);
-                ++ssaI;
-            }
-        }
-        sa.resize(ssaI);
-        if constexpr (std::same_as<T, uint64_t>) {
-            ssa = std::move(sa);
-        } else {
-            ssa.resize(sa.size());
-            for (size_t i{0}; i < sa.size(); ++i) {
-                ssa[i] = sa[i];
+                ssa.push_back(subjPos | (subjId << bitsForPosition));
             }
         }
     }
@@ -148,6 +149,31 @@ struct CSA {
         return std::make_tuple(chr, pos);
     }
 
+    /**!\brief value of the sampleIdx-th sample, e.g. `value(idx)` for sampleIdx = bv.rank(idx)
+     */
+    auto sampleValue(size_t sampleIdx) const -> std::tuple<uint64_t, uint64_t> {
+        auto v = ssa[sampleIdx];
+        return {v >> bitsForPosition, v & bitPositionMask};
+    }
+
+    /**!\brief prefetches the memory required by `hasValue(idx)`
+     */
+    void prefetch(size_t idx) const {
+        bv.prefetch(idx);
+    }
+
+    /**!\brief checks if row idx is sampled, same as `value(idx).has_value()`
+     */
+    bool hasValue(size_t idx) const {
+        return bv.symbol(idx);
+    }
+
+    /**!\brief prefetches the sample of a row, only valid if `hasValue(idx)` is true
+     */
+    void prefetchValue(size_t idx) const {
+        __builtin_prefetch(reinterpret_cast<void const*>(&ssa[bv.rank(idx)]), 0, 0);
+    }
+
     void push_back(std::optional<std::tuple<size_t, size_t>> value) {
         bv.push_back(value.has_value());
         if (value) {
@@ -161,6 +187,6 @@ struct CSA {
         ar(ssa, bv, bitsForPosition, bitPositionMask, seqCount);
     }
 };
-static_assert(SuffixArray_c<CSA>);
+static_assert(SuffixArraySampleValue<CSA>);
 
 }
@@ -143,6 +143,32 @@ struct DenseCSA {
         return std::make_tuple(ssaSeq[rank], ssaPos[rank]);
     }
 
+    /**!\brief value of the sampleIdx-th sample, e.g. `value(idx)` for sampleIdx = bv.rank(idx)
+     */
+    auto sampleValue(size_t sampleIdx) const -> std::tuple<uint64_t, uint64_t> {
+        return {ssaSeq[sampleIdx], ssaPos[sampleIdx]};
+    }
+
+    /**!\brief prefetches the memory required by `hasValue(idx)`
+     */
+    void prefetch(size_t idx) const {
+        bv.prefetch(idx);
+    }
+
+    /**!\brief checks if row idx is sampled, same as `value(idx).has_value()`
+     */
+    bool hasValue(size_t idx) const {
+        return bv.symbol(idx);
+    }
+
+    /**!\brief prefetches the sample of a row, only valid if `hasValue(idx)` is true
+     */
+    void prefetchValue(size_t idx) const {
+        auto rank = bv.rank(idx);
+        ssaSeq.prefetch(rank);
+        ssaPos.prefetch(rank);
+    }
+
     void push_back(std::optional<std::tuple<size_t, size_t>> value) {
         bv.push_back(value.has_value());
         if (value) {
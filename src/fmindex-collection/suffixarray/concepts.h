@@ -40,4 +40,15 @@ concept SuffixArray_c = requires(T t, T t2, size_t idx) {
     { t.push_back(std::optional<std::tuple<size_t, size_t>>{}) };
 };
 
+/* Suffix array that gives direct access to its samples
+ */
+template <typename T>
+concept SuffixArraySampleValue = SuffixArray_c<T> && requires(T t, size_t sampleIdx) {
+    /* Returns the value of the sampleIdx-th sample, counted in order of the rows
+     *
+     * \return - tuple, first value is the sequence number, the second the position inside the sequence
+     */
+    { t.sampleValue(sampleIdx) } -> std::same_as<std::tuple<uint64_t, uint64_t>>;
+};
+
 }
@@ -4,6 +4,7 @@
 #pragma once
 
 #include "concepts.h"
+#include "occtable/concepts.h"
 
 #include <algorithm>
 #include <cassert>
@@ -77,6 +78,22 @@ inline auto createBWT32(std::span<uint8_t const> input, std::span<uint32_t const
     return bwt;
 }
 
+/**!\brief Computes the bwt into the memory of the suffix array
+ *
+ * Byte i of the bwt overwrites parts of sa[i/sizeof(T)], which was already read.
+ * The suffix array is destroyed, the returned span points into its memory.
+ */
+template <typename T>
+auto createBWTInplace(std::span<uint8_t const> input, std::span<T> sa) -> std::span<uint8_t const> {
+    assert(input.size() == sa.size());
+    auto bwt = reinterpret_cast<uint8_t*>(sa.data());
+    for (size_t i{0}; i < sa.size(); ++i) {
+        auto v = sa[i];
+        bwt[i] = input[(v + input.size() - 1) % input.size()];
+    }
+    return {bwt, sa.size()};
+}
+
 auto createSequences(Sequences auto const& _input, bool reverse=false) -> std::tuple<size_t, std::vector<uint8_t>, std::vector<size_t>> {
     // compute total numbers of bytes of the text including delimiters "$"
     size_t totalSize{};
@@ -154,6 +171,20 @@ auto createSequencesAndReverse(Sequences auto const& _input) -> std::tuple<size_
     return {totalSize, inputText, inputSizes};
 }
 
+/**!\brief Same as createSequencesAndReverse, but the reversed text is also complemented
+ *
+ * The resulting text is its own reverse complement.
+ * \param _complement maps a symbol to its complement, the delimiter "$" must map to itself
+ */
+template <typename CB>
+auto createSequencesAndReverseComplement(Sequences auto const& _input, CB const& _complement) -> std::tuple<size_t, std::vector<uint8_t>, std::vector<size_t>> {
+    auto [totalSize, inputText, inputSizes] = createSequencesAndReverse(_input);
+    for (size_t i{totalSize/2}; i < totalSize; ++i) {
+        inputText[i] = _complement(inputText[i]);
+    }
+    return {totalSize, std::move(inputText), std::move(inputSizes)};
+}
+
 
 
 inline auto createSA_32(std::span<uint32_t const> input, size_t threadNbr) -> std::vector<int32_t> {
@@ -246,11 +277,10 @@ template <typename Index>
 auto reconstructText(Index const& index, size_t seqNbr) -> std::vector<uint8_t> {
     auto r = std::vector<uint8_t>{};
 
-    uint8_t c{};
+    uint64_t c{};
     size_t idx = seqNbr;
     do {
-        c = index.occ.symbol(idx);
-        idx = index.occ.rank(idx, c);
+        std::tie(idx, c) = rankAndSymbol(index.occ, idx);
         r.push_back(c);
     } while (c != 0);
     r.pop_back(); // remove last zero
@@ -21,5 +21,6 @@
     fmindex_collection::bitvector::DoubleL1_512Bitvector, \
     fmindex_collection::bitvector::SparseBLEBitvector<2>, \
     fmindex_collection::bitvector::SparseBLEBitvector<-2>, \
+    fmindex_collection::bitvector::SparseBitvector, \
     (fmindex_collection::bitvector::SparseBLEBitvector<3, fmindex_collection::bitvector::SparseBLEBitvector<2>>), \
     (fmindex_collection::bitvector::SparseBLEBitvector<3, fmindex_collection::bitvector::Bitvector, fmindex_collection::bitvector::SparseBLEBitvector<2>>)
@@ -21,3 +21,54 @@ TEST_CASE("check if lshift_and_count works", "[leftshift_and_count]") {
         CHECK(fmc::signed_rshift_and_count(b, i) == i-64);
     }
 }
+
+TEST_CASE("check popcount kernels of each cpu dispatch level", "[popcount][dispatch]") {
+    namespace cpu_dispatch = fmc::cpu_dispatch;
+    auto rng = ankerl::nanobench::Rng{};
+    auto a = std::vector<uint64_t>{};
+    auto b = std::vector<uint64_t>{};
+    for (size_t i{0}; i < 20; ++i) {
+        a.push_back(rng());
+        b.push_back(rng());
+    }
+    auto level = GENERATE(cpu_dispatch::Level::Generic, cpu_dispatch::Level::Popcnt, cpu_dispatch::Level::AVX2, cpu_dispatch::Level::AVX512);
+    auto const& kernels = cpu_dispatch::kernelsFor(std::min(level, cpu_dispatch::detected()));
+    INFO("level " << cpu_dispatch::name(kernels.level));
+    for (size_t n{0}; n <= a.size(); ++n) {
+        INFO(n);
+        CHECK(kernels.popcount(a.data(), n) == cpu_dispatch::kernels::popcount_generic(a.data(), n));
+        CHECK(kernels.popcount_and(a.data(), b.data(), n) == cpu_dispatch::kernels::popcount_and_generic(a.data(), b.data(), n));
+    }
+    for (size_t n{1}; n <= 5; ++n) {
+        INFO(n);
+        auto counts = std::array<uint64_t, 8>{};
+        kernels.symbol_counts3(a.data(), a.data()+5, a.data()+10, b.data(), n, counts.data());
+        auto expected = std::array<uint64_t, 8>{};
+        for (size_t i{0}; i < n; ++i) {
+            for (size_t bit{0}; bit < 64; ++bit) {
+                if (b[i] & (uint64_t{1} << bit)) {
+                    auto symb = ((a[i] >> bit) & 1) | (((a[i+5] >> bit) & 1) << 1) | (((a[i+10] >> bit) & 1) << 2);
+                    expected[symb] += 1;
+                }
+            }
+        }
+        CHECK(counts == expected);
+    }
+
+    auto bs = std::bitset<512>{};
+    for (size_t i{0}; i < 512; i += 3) {
+        bs.set(i);
+    }
+    CHECK(fmc::popcount(bs, &kernels) == bs.count());
+    for (size_t i{0}; i < 513; ++i) {
+        CHECK(fmc::lshift_and_count(bs, i, &kernels) == (bs & fmc::leftshift_masks<512>[i]).count());
+    }
+}
+
+TEST_CASE("check cpu dispatch selection", "[popcount][dispatch]") {
+    namespace cpu_dispatch = fmc::cpu_dispatch;
+    CHECK(cpu_dispatch::current().level == cpu_dispatch::detected());
+    CHECK(cpu_dispatch::select(cpu_dispatch::Level::Generic) == cpu_dispatch::Level::Generic);
+    CHECK(cpu_dispatch::current().level == cpu_dispatch::Level::Generic);
+    CHECK(cpu_dispatch::select(cpu_dispatch::Level::AVX512) == cpu_dispatch::detected());
+}
@@ -208,3 +208,42 @@ TEMPLATE_TEST_CASE("checking bidirectional fm index on longer text (more than 25
         }
     }
 }
+
+TEMPLATE_TEST_CASE("checking bidirectional fm index constructed from sequences", "[BiFMIndex]", ALLTABLES) {
+    using OccTable = TestType;
+
+    auto input = std::vector<std::vector<uint8_t>>{{}, {}, {}};
+    for (size_t i{0}; i < 1000; ++i) {
+        input[0].push_back((i * 7 + i / 13) % 4 + 1);
+    }
+    for (size_t i{0}; i < 700; ++i) {
+        input[1].push_back((i * 11 + i / 5) % 4 + 1);
+    }
+    for (size_t i{0}; i < 20; ++i) {
+        input[2].push_back(i % 4 + 1);
+    }
+
+    auto samplingRate = GENERATE(size_t{1}, size_t{4}, size_t{7});
+    INFO("samplingRate " << samplingRate);
+
+    // index constructed step by step from the bwts
+    auto [totalSize, text, inputSizes] = fmindex_collection::createSequences(input);
+    auto sa     = fmindex_collection::createSA64(text, 1);
+    auto bwt    = fmindex_collection::createBWT64(text, sa);
+    std::ranges::reverse(text);
+    auto saRev  = fmindex_collection::createSA64(text, 1);
+    auto bwtRev = fmindex_collection::createBWT64(text, saRev);
+    auto csa    = fmindex_collection::CSA{sa, samplingRate, inputSizes};
+    auto expected = fmindex_collection::BiFMIndex<OccTable>{bwt, bwtRev, std::move(csa)};
+
+    auto index = fmindex_collection::BiFMIndex<OccTable>{input, samplingRate, /*threadNbr*/2};
+
+    REQUIRE(index.size() == expected.size());
+    for (size_t i{0}; i < index.size(); ++i) {
+        INFO("row " << i);
+        CHECK(index.occ.symbol(i) == bwt[i]);
+        CHECK(index.occRev.symbol(i) == bwtRev[i]);
+        CHECK(index.locate(i) == expected.locate(i));
+        CHECK(index.single_locate_step(i) == expected.single_locate_step(i));
+    }
+}
@@ -101,3 +101,56 @@ TEST_CASE("checking bidirectional fm index cursor", "[BiFMIndexCursor]") {
         CHECK(entries.empty());
     }
 }
+
+TEST_CASE("checking bidirectional fm index cursor on a table with 32bit rows", "[BiFMIndexCursor][size32]") {
+    using OccTable   = fmindex_collection::occtable::Interleaved_16<5>;
+    using OccTable32 = fmindex_collection::occtable::Size32<OccTable>;
+    using Index      = fmindex_collection::BiFMIndex<OccTable>;
+    using Index32    = fmindex_collection::BiFMIndex<OccTable32>;
+
+    static_assert(std::same_as<fmindex_collection::index_size_t<Index>, size_t>);
+    static_assert(std::same_as<fmindex_collection::index_size_t<Index32>, uint32_t>);
+    static_assert(sizeof(fmindex_collection::BiFMIndexCursor<Index32>) < sizeof(fmindex_collection::BiFMIndexCursor<Index>));
+    static_assert(sizeof(fmindex_collection::LeftBiFMIndexCursor<Index32>) == 16);
+
+    auto data = std::vector<std::vector<uint8_t>>{
+        std::vector<uint8_t>{1, 2, 3, 4, 1, 1, 2, 4, 3, 3, 1, 2, 2, 4},
+        std::vector<uint8_t>{4, 4, 1, 2, 3, 1, 2, 3},
+    };
+    auto index   = Index{data, 1, 1};
+    auto index32 = Index32{data, 1, 1};
+
+    auto check = [](auto const& cursor, auto const& cursor32) {
+        CHECK(cursor.lb    == cursor32.lb);
+        CHECK(cursor.lbRev == cursor32.lbRev);
+        CHECK(cursor.len   == cursor32.len);
+    };
+
+    // extend by all patterns of length 3, alternating left and right
+    auto cursors   = std::vector{fmindex_collection::BiFMIndexCursor{index}};
+    auto cursors32 = std::vector{fmindex_collection::BiFMIndexCursor{index32}};
+    for (size_t depth{0}; depth < 3; ++depth) {
+        auto next   = std::vector<fmindex_collection::BiFMIndexCursor<Index>>{};
+        auto next32 = std::vector<fmindex_collection::BiFMIndexCursor<Index32>>{};
+        for (size_t i{0}; i < cursors.size(); ++i) {
+            auto all   = (depth % 2 == 0) ? cursors[i].extendLeft() : cursors[i].extendRight();
+            auto all32 = (depth % 2 == 0) ? cursors32[i].extendLeft() : cursors32[i].extendRight();
+            for (size_t s{1}; s < OccTable::Sigma; ++s) {
+                auto single32 = (depth % 2 == 0) ? cursors32[i].extendLeft(s) : cursors32[i].extendRight(s);
+                check(all[s], all32[s]);
+                check(all[s], single32);
+                next.push_back(all[s]);
+                next32.push_back(all32[s]);
+            }
+        }
+        cursors   = std::move(next);
+        cursors32 = std::move(next32);
+    }
+    for (size_t i{0}; i < cursors.size(); ++i) {
+        auto positions   = std::vector<size_t>{};
+        auto positions32 = std::vector<size_t>{};
+        for (auto pos : cursors[i]) positions.push_back(pos);
+        for (auto pos : cursors32[i]) positions32.push_back(pos);
+        CHECK(positions == positions32);
+    }
+}
@@ -0,0 +1,87 @@
+// SPDX-FileCopyrightText: 2006-2023, Knut Reinert & Freie Universität Berlin
+// SPDX-FileCopyrightText: 2016-2023, Knut Reinert & MPI für molekulare Genetik
+// SPDX-License-Identifier: CC0-1.0
+#include <catch2/catch_all.hpp>
+#include <algorithm>
+#include <filesystem>
+#include <fmindex-collection/fmindex/BiFMIndex.h>
+#include <fmindex-collection/fmindex/FMIndex.h>
+#include <fmindex-collection/fmindex/createExternal.h>
+#include <fmindex-collection/occtable/all.h>
+#include <fmindex-collection/search/SearchNoErrors.h>
+#include <fmindex-collection/suffixarray/DenseCSA.h>
+
+namespace {
+auto generateInput() -> std::vector<std::vector<uint8_t>> {
+    // sequences (including delimiter) are a multiple of the sampling rate, so each sequence start is sampled
+    auto input = std::vector<std::vector<uint8_t>>{};
+    for (size_t j{0}; j < 7; ++j) {
+        auto& seq = input.emplace_back();
+        for (size_t i{0}; i < 299 + j * 52; ++i) {
+            seq.push_back((i * (7 + j) + i / (13 + j)) % 4 + 1);
+        }
+    }
+    return input;
+}
+
+template <typename Index>
+auto locateAll(Index const& index, std::vector<uint8_t> const& query) -> std::vector<std::tuple<size_t, size_t>> {
+    auto cursor = fmindex_collection::search_no_errors::search(index, query);
+    auto res = std::vector<std::tuple<size_t, size_t>>{};
+    for (size_t i{cursor.lb}; i < cursor.lb + cursor.len; ++i) {
+        res.emplace_back(index.locate(i));
+    }
+    std::ranges::sort(res);
+    return res;
+}
+
+template <typename Index>
+void checkExternalConstruction(size_t partitionSize) {
+    auto input = generateInput();
+    auto path  = std::filesystem::temp_directory_path() / "fmindex-collection-checkCreateExternal.index";
+
+    fmindex_collection::createExternal<Index>(input, /*samplingRate*/ 4, /*threadNbr*/ 2, path, partitionSize);
+    auto index    = fmindex_collection::loadMMap<Index>(path);
+    auto expected = Index{input, /*samplingRate*/ 4, /*threadNbr*/ 1};
+
+    REQUIRE(index.size() == expected.size());
+    CHECK(reconstructText(index) == input);
+
+    for (size_t symb{0}; symb < Index::Sigma; ++symb) {
+        CHECK(index.occ.rank(index.size(), symb) == expected.occ.rank(expected.size(), symb));
+    }
+
+    auto queries = std::vector<std::vector<uint8_t>>{{1}, {1, 2}, {4, 4, 1}, {2, 3, 1, 1}};
+    for (auto const& seq : input) {
+        queries.emplace_back(seq.begin() + 100, seq.begin() + 120);
+        queries.emplace_back(seq.end() - 10, seq.end());
+    }
+    for (size_t qidx{0}; qidx < queries.size(); ++qidx) {
+        INFO("query " << qidx);
+        CHECK(locateAll(index, queries[qidx]) == locateAll(expected, queries[qidx]));
+    }
+    std::filesystem::remove(path);
+}
+}
+
+TEST_CASE("creating a bidirectional fm index with external memory", "[BiFMIndex][external]") {
+    using OccTable = fmindex_collection::occtable::Interleaved_16<5>;
+
+    SECTION("with CSA") {
+        using Index = fmindex_collection::BiFMIndex<OccTable>;
+        auto partitionSize = GENERATE(size_t{1}, size_t{800}, size_t{2000}, size_t{100'000});
+        INFO("partitionSize " << partitionSize);
+        checkExternalConstruction<Index>(partitionSize);
+    }
+    SECTION("with DenseCSA") {
+        using Index = fmindex_collection::BiFMIndex<OccTable, fmindex_collection::DenseCSA>;
+        checkExternalConstruction<Index>(800);
+    }
+}
+
+TEST_CASE("creating a fm index with external memory", "[FMIndex][external]") {
+    using Index = fmindex_collection::FMIndex<fmindex_collection::occtable::EprV2_16<5>>;
+    auto partitionSize = GENERATE(size_t{1}, size_t{800}, size_t{100'000});
+    INFO("partitionSize " << partitionSize);
+    checkExternalConstruction<Index>(partitionSize);
+}
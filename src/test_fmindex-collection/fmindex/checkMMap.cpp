@@ -0,0 +1,236 @@
+// SPDX-FileCopyrightText: 2006-2023, Knut Reinert & Freie Universität Berlin
+// SPDX-FileCopyrightText: 2016-2023, Knut Reinert & MPI für molekulare Genetik
+// SPDX-License-Identifier: CC0-1.0
+#include "../occtables/allTables.h"
+
+#include <catch2/catch_all.hpp>
+#include <filesystem>
+#include <fmindex-collection/MMapArchive.h>
+#include <fmindex-collection/fmindex/BiFMIndex.h>
+#include <fmindex-collection/fmindex/FMIndex.h>
+#include <fmindex-collection/rankvector/DoubleNEPRV8.h>
+#include <fmindex-collection/search/SearchNoErrors.h>
+#include <fmindex-collection/suffixarray/DenseCSA.h>
+#include <fstream>
+
+// memory mapping is only available on posix systems
+#if FMC_MMAP
+namespace {
+auto tempFile() -> std::filesystem::path {
+    return std::filesystem::temp_directory_path() / "fmindex-collection-checkMMap.index";
+}
+
+auto generateInput() -> std::vector<std::vector<uint8_t>> {
+    auto input = std::vector<std::vector<uint8_t>>{{}, {}};
+    for (size_t i{0}; i < 1000; ++i) {
+        input[0].push_back((i * 7 + i / 13) % 4 + 1);
+    }
+    for (size_t i{0}; i < 700; ++i) {
+        input[1].push_back((i * 11 + i / 5) % 4 + 1);
+    }
+    return input;
+}
+
+template <typename Index>
+void checkSameIndex(Index const& expected, Index const& loaded) {
+    REQUIRE(loaded.size() == expected.size());
+    for (size_t i{0}; i < expected.size(); ++i) {
+        INFO("row " << i);
+        CHECK(loaded.locate(i) == expected.locate(i));
+        CHECK(loaded.occ.symbol(i) == expected.occ.symbol(i));
+    }
+
+    auto queries = std::vector<std::vector<uint8_t>>{{1, 2}, {4, 4, 1}, {2, 3, 1, 1}};
+    auto results = std::vector<std::tuple<size_t, size_t, size_t>>{};
+    fmindex_collection::search_no_errors::search(expected, queries, [&](size_t qidx, auto cursor) {
+        results.emplace_back(qidx, cursor.lb, cursor.len);
+    });
+    size_t i{0};
+    fmindex_collection::search_no_errors::search(loaded, queries, [&](size_t qidx, auto cursor) {
+        REQUIRE(i < results.size());
+        CHECK(results[i] == std::make_tuple(qidx, cursor.lb, cursor.len));
+        ++i;
+    });
+    CHECK(i == results.size());
+}
+}
+
+TEMPLATE_TEST_CASE("saving and loading indices in the mmap format", "[mmap]", ALLTABLES) {
+    using OccTable = TestType;
+
+    auto input = generateInput();
+    auto path  = tempFile();
+
+    SECTION("BiFMIndex") {
+        using Index = fmindex_collection::BiFMIndex<OccTable>;
+        auto index = Index{input, /*samplingRate*/4, /*threadNbr*/1};
+        fmindex_collection::saveMMap(index, path);
+        auto loaded = fmindex_collection::loadMMap<Index>(path);
+        checkSameIndex(index, loaded);
+    }
+
+    SECTION("FMIndex") {
+        using Index = fmindex_collection::FMIndex<OccTable>;
+        auto index = Index{input, /*samplingRate*/16, /*threadNbr*/1};
+        fmindex_collection::saveMMap(index, path);
+        auto loaded = fmindex_collection::loadMMap<Index>(path);
+        checkSameIndex(index, loaded);
+    }
+
+    SECTION("BiFMIndex with DenseCSA") {
+        using Index = fmindex_collection::BiFMIndex<OccTable, fmindex_collection::DenseCSA>;
+        auto index = Index{input, /*samplingRate*/7, /*threadNbr*/1};
+        fmindex_collection::saveMMap(index, path);
+        auto loaded = fmindex_collection::loadMMap<Index>(path);
+        checkSameIndex(index, loaded);
+    }
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("mmap format doesn't copy the occ table and the suffix array", "[mmap]") {
+    using OccTable = fmindex_collection::occtable::EprV2_16<5>;
+    using Index    = fmindex_collection::BiFMIndex<OccTable>;
+
+    auto input = generateInput();
+    auto path  = tempFile();
+    auto index = Index{input, /*samplingRate*/4, /*threadNbr*/1};
+    fmindex_collection::saveMMap(index, path);
+
+    auto loaded = fmindex_collection::loadMMap<Index>(path);
+    auto const& blocks = loaded.occ.vector.blocks;
+    CHECK(blocks.get_allocator().isAdopted(blocks.data()));
+    CHECK(loaded.csa.ssa.get_allocator().isAdopted(loaded.csa.ssa.data()));
+    CHECK(reinterpret_cast<uintptr_t>(blocks.data()) % 64 == 0);
+
+    // a copy owns its memory and can be modified
+    auto copy = loaded.occ.vector.superBlocks;
+    CHECK(!copy.get_allocator().isAdopted(copy.data()));
+    copy.push_back({});
+    CHECK(copy.size() == loaded.occ.vector.superBlocks.size() + 1);
+
+    // index stays valid after the file was removed
+    std::filesystem::remove(path);
+    checkSameIndex(index, loaded);
+}
+
+TEMPLATE_TEST_CASE("mmap format doesn't copy the level counts of the rank vectors", "[mmap]",
+    fmindex_collection::rankvector::EPRV4<5>,
+    fmindex_collection::rankvector::EPRV5<5>,
+    fmindex_collection::rankvector::DenseEPRV6<5>,
+    fmindex_collection::rankvector::InterleavedEPRV7<5>,
+    fmindex_collection::rankvector::Double64EPRV8<5>) {
+    using RankVector = TestType;
+
+    auto input = generateInput()[0];
+    auto path  = tempFile();
+    auto vec   = RankVector{input};
+    fmindex_collection::saveMMap(vec, path);
+    auto loaded = fmindex_collection::loadMMap<RankVector>(path);
+    std::filesystem::remove(path);
+
+    auto isAdopted = [](auto const& level) {
+        return level.get_allocator().isAdopted(level.data());
+    };
+    if constexpr (requires() { loaded.level0; }) {
+        CHECK(isAdopted(loaded.level0));
+    }
+    CHECK(isAdopted(loaded.level1));
+    if constexpr (requires() { loaded.level2; }) {
+        CHECK(isAdopted(loaded.level2));
+    }
+
+    REQUIRE(loaded.size() == vec.size());
+    for (size_t i{0}; i <= vec.size(); ++i) {
+        for (size_t symb{0}; symb < 5; ++symb) {
+            CHECK(loaded.rank(i, symb) == vec.rank(i, symb));
+        }
+    }
+}
+
+#if FMC_HUGE_PAGES
+TEST_CASE("index containers on huge pages", "[mmap][hugepages]") {
+    using OccTable = fmindex_collection::occtable::Interleaved_16<5>;
+    using Index    = fmindex_collection::BiFMIndex<OccTable>;
+
+    auto input    = generateInput();
+    auto expected = Index{input, /*samplingRate*/4, /*threadNbr*/1};
+
+    auto policy = GENERATE(fmindex_collection::PagePolicy::Transparent,
+                           fmindex_collection::PagePolicy::Huge2MB,
+                           fmindex_collection::PagePolicy::Huge1GB);
+    INFO("policy " << fmindex_collection::huge_pages::name(policy));
+
+    // small containers are placed on huge pages as well
+    auto oldMinSize = fmindex_collection::huge_pages::minSize.load();
+    fmindex_collection::huge_pages::minSize = 1;
+    fmindex_collection::huge_pages::select(policy);
+    {
+        auto index = Index{input, /*samplingRate*/4, /*threadNbr*/1};
+        auto const& blocks = index.occ.vector.blocks;
+        CHECK(reinterpret_cast<uintptr_t>(blocks.data()) % fmindex_collection::huge_pages::PageSize2MB == 0);
+        CHECK(reinterpret_cast<uintptr_t>(index.csa.ssa.data()) % fmindex_collection::huge_pages::PageSize2MB == 0);
+        checkSameIndex(expected, index);
+
+        // storing and loading works as usual
+        auto path = tempFile();
+        fmindex_collection::saveMMap(index, path);
+        auto loaded = fmindex_collection::loadMMap<Index>(path);
+        std::filesystem::remove(path);
+        checkSameIndex(expected, loaded);
+
+        // memory is released correctly, even if the policy changed after it was allocated
+        fmindex_collection::huge_pages::select(fmindex_collection::PagePolicy::Default);
+        fmindex_collection::huge_pages::minSize = oldMinSize;
+    }
+}
+#endif
+
+TEST_CASE("mmap format of DoubleNEPRV8", "[mmap]") {
+    using RankVector = fmindex_collection::rankvector::Double64EPRV8<5>;
+
+    auto input = generateInput()[0];
+    auto path  = tempFile();
+    auto vec   = RankVector{input};
+    fmindex_collection::saveMMap(vec, path);
+    auto loaded = fmindex_collection::loadMMap<RankVector>(path);
+    std::filesystem::remove(path);
+
+    REQUIRE(loaded.size() == vec.size());
+    for (size_t i{0}; i <= vec.size(); ++i) {
+        for (size_t symb{0}; symb < 5; ++symb) {
+            CHECK(loaded.rank(i, symb) == vec.rank(i, symb));
+        }
+    }
+}
+
+TEST_CASE("loading incompatible mmap files", "[mmap]") {
+    using Index = fmindex_collection::FMIndex<fmindex_collection::occtable::EprV5<5>>;
+
+    auto path  = tempFile();
+    auto index = Index{generateInput(), /*samplingRate*/16, /*threadNbr*/1};
+    fmindex_collection::saveMMap(index, path);
+
+    SECTION("different index type") {
+        using Other = fmindex_collection::FMIndex<fmindex_collection::occtable::EprV4<5>>;
+        CHECK_THROWS_AS(fmindex_collection::loadMMap<Other>(path), std::runtime_error);
+    }
+
+    SECTION("truncated file") {
+        std::filesystem::resize_file(path, std::filesystem::file_size(path) / 2);
+        CHECK_THROWS_AS(fmindex_collection::loadMMap<Index>(path), std::runtime_error);
+    }
+
+    SECTION("not a mmap file") {
+        auto ofs = std::ofstream{path, std::ios::binary};
+        ofs << "not an index";
+        ofs.close();
+        CHECK_THROWS_AS(fmindex_collection::loadMMap<Index>(path), std::runtime_error);
+    }
+
+    SECTION("missing file") {
+        std::filesystem::remove(path);
+        CHECK_THROWS_AS(fmindex_collection::loadMMap<Index>(path), std::runtime_error);
+    }
+    std::filesystem::remove(path);
+}
+#endif
@@ -239,3 +239,72 @@ TEST_CASE("checking merging of fmindices", "[BiFMIndex][merge]") {
         }
     }
 }
+
+namespace {
+auto generateSequences(size_t count, size_t seed) -> std::vector<std::vector<uint8_t>> {
+    auto data = std::vector<std::vector<uint8_t>>{};
+    for (size_t j{0}; j < count; ++j) {
+        auto& seq = data.emplace_back();
+        for (size_t i{0}; i < 40 + (seed + j) * 17 % 60; ++i) {
+            seq.push_back((i * (seed + 3) + i / (j + 2) + seed) % 4 + 1);
+        }
+    }
+    return data;
+}
+
+template <typename Index>
+void checkSameIndex(Index const& expected, Index const& index) {
+    REQUIRE(index.size() == expected.size());
+    for (size_t i{0}; i < index.size(); ++i) {
+        INFO(i);
+        CHECK(index.occ.symbol(i) == expected.occ.symbol(i));
+        CHECK(index.locate(i) == expected.locate(i));
+        if constexpr (requires() { index.occRev; }) {
+            CHECK(index.occRev.symbol(i) == expected.occRev.symbol(i));
+        }
+    }
+}
+}
+
+TEST_CASE("checking k-way merging of fmindices", "[FMIndex][merge]") {
+    using OccTable = fmindex_collection::occtable::Interleaved_16<5>;
+    using Index = fmindex_collection::FMIndex<OccTable>;
+
+    auto data    = std::vector<std::vector<uint8_t>>{};
+    auto indices = std::vector<Index>{};
+    for (size_t i{0}; i < 4; ++i) {
+        auto d = generateSequences(1 + i % 3, i);
+        indices.emplace_back(d, /*.samplingRate =*/ 2, /*.threadNbr =*/ 1);
+        data.insert(data.end(), d.begin(), d.end());
+    }
+    auto expected = merge(merge(merge(indices[0], indices[1]), indices[2]), indices[3]);
+
+    auto threadNbr = GENERATE(size_t{1}, size_t{3});
+    auto index = merge(indices, threadNbr);
+    checkSameIndex(expected, index);
+    CHECK(reconstructText(index) == data);
+}
+
+TEST_CASE("checking k-way merging of bidirectional fmindices", "[BiFMIndex][merge]") {
+    using OccTable = fmindex_collection::occtable::Interleaved_16<5>;
+    using Index = fmindex_collection::BiFMIndex<OccTable, fmindex_collection::DenseCSA>;
+
+    auto data    = std::vector<std::vector<uint8_t>>{};
+    auto indices = std::vector<Index>{};
+    for (size_t i{0}; i < 5; ++i) {
+        auto d = generateSequences(1 + i % 3, i);
+        indices.emplace_back(d, /*.samplingRate =*/ 2, /*.threadNbr =*/ 1);
+        data.insert(data.end(), d.begin(), d.end());
+    }
+    auto expected = merge(merge(merge(merge(indices[0], indices[1]), indices[2]), indices[3]), indices[4]);
+
+    auto threadNbr = GENERATE(size_t{1}, size_t{2}, size_t{4});
+    auto index = merge(indices, threadNbr);
+    checkSameIndex(expected, index);
+    CHECK(reconstructText(index) == data);
+
+    SECTION("two indices") {
+        indices.resize(2);
+        checkSameIndex(merge(indices[0], indices[1]), merge(indices, threadNbr));
+    }
+}
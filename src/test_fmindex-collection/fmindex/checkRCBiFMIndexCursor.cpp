@@ -0,0 +1,212 @@
+// SPDX-FileCopyrightText: 2006-2023, Knut Reinert & Freie Universität Berlin
+// SPDX-FileCopyrightText: 2016-2023, Knut Reinert & MPI für molekulare Genetik
+// SPDX-License-Identifier: CC0-1.0
+#include "../occtables/allTables.h"
+
+#include <catch2/catch_all.hpp>
+#include <fmindex-collection/fmindex/RCBiFMIndex.h>
+#include <fmindex-collection/fmindex/RCBiFMIndexCursor.h>
+#include <random>
+
+TEST_CASE("checking reverse complement bidirectional fm index cursor", "[RCBiFMIndexCursor]") {
+
+    // T = AAACC$GGTTT$
+    auto data = std::vector<std::vector<uint8_t>>{std::vector<uint8_t>{1, 1, 1, 2, 2}};
+    using OccTable = fmindex_collection::occtable::Interleaved_16<5>;
+    using Index = fmindex_collection::RCBiFMIndex<OccTable>;
+    auto index = Index{data, 1, 1};
+
+    auto cursor = fmindex_collection::RCBiFMIndexCursor{index};
+    REQUIRE(cursor.count() == index.size());
+    REQUIRE(index.size() == 12);
+    REQUIRE(!cursor.empty());
+    REQUIRE(cursor.lb == 0);
+    REQUIRE(cursor.len == index.size());
+
+    SECTION("extending to the left") {
+        auto expectedLb  = std::vector<size_t>{0, 2, 5, 7, 9};
+        auto expectedLen = std::vector<size_t>{2, 3, 2, 2, 3};
+        for (size_t i{0}; i < 5; ++i) {
+            INFO(i);
+            auto cursor2 = cursor.extendLeft(i);
+            CHECK(cursor2.lb == expectedLb[i]);
+            CHECK(cursor2.len == expectedLen[i]);
+        }
+
+        auto allCursor = cursor.extendLeft();
+        for (size_t i{0}; i < 5; ++i) {
+            INFO(i);
+            auto cursor2 = cursor.extendLeft(i);
+            CHECK(cursor2.lb == allCursor[i].lb);
+            CHECK(cursor2.lbRc == allCursor[i].lbRc);
+            CHECK(cursor2.len == allCursor[i].len);
+        }
+    }
+
+    SECTION("extending to the right") {
+        auto allCursor = cursor.extendRight();
+        for (size_t i{0}; i < 5; ++i) {
+            INFO(i);
+            auto cursor2 = cursor.extendRight(i);
+            CHECK(cursor2.lb == cursor.extendLeft(i).lb);
+            CHECK(cursor2.len == cursor.extendLeft(i).len);
+            CHECK(cursor2.lb == allCursor[i].lb);
+            CHECK(cursor2.lbRc == allCursor[i].lbRc);
+            CHECK(cursor2.len == allCursor[i].len);
+        }
+    }
+
+    SECTION("left and right extensions result in the same cursor") {
+        // search for "ACC"
+        auto cursor1 = cursor.extendLeft(2).extendLeft(2).extendLeft(1);
+        auto cursor2 = cursor.extendRight(1).extendRight(2).extendRight(2);
+        auto cursor3 = cursor.extendLeft(2).extendRight(2).extendLeft(1);
+        CHECK(cursor1.len == 1);
+        CHECK(cursor1 == cursor2);
+        CHECK(cursor1.lbRc == cursor2.lbRc);
+        CHECK(cursor1 == cursor3);
+        CHECK(cursor1.lbRc == cursor3.lbRc);
+    }
+
+    SECTION("reverse complement") {
+        // "AAC" and its reverse complement "GTT"
+        auto cursor1 = cursor.extendLeft(2).extendLeft(1).extendLeft(1);
+        auto cursor2 = cursor.extendLeft(4).extendLeft(4).extendLeft(3);
+        CHECK(cursor1.len == 1);
+        CHECK(cursor1.reverseComplement() == cursor2);
+        CHECK(cursor2.reverseComplement() == cursor1);
+
+        // "AC" occurs on the forward and "GT" on the reverse strand
+        auto [seqId1, pos1] = index.locate(cursor.extendLeft(2).extendLeft(1).lb);
+        auto [seqId2, pos2] = index.locate(cursor.extendLeft(2).extendLeft(1).reverseComplement().lb);
+        CHECK(seqId1 == 0);
+        CHECK(pos1 == 2);
+        CHECK(seqId2 == 1);
+        CHECK(pos2 == 1);
+    }
+}
+
+namespace {
+template <typename Index>
+auto reverseComplement(std::vector<uint8_t> seq) -> std::vector<uint8_t> {
+    std::ranges::reverse(seq);
+    for (auto& c : seq) {
+        c = Index::complement(c);
+    }
+    return seq;
+}
+
+/* all occurrences (seqId, pos) of a pattern in the sequences and their reverse complements,
+ * sequence id `2*n-1-i` is the reverse complement of sequence i
+ */
+template <typename Index>
+auto findAll(std::vector<std::vector<uint8_t>> const& data, std::vector<uint8_t> const& pattern) -> std::vector<std::tuple<size_t, size_t>> {
+    auto result = std::vector<std::tuple<size_t, size_t>>{};
+    auto search = [&](std::vector<uint8_t> const& seq, size_t seqId) {
+        for (size_t pos{0}; pos + pattern.size() <= seq.size(); ++pos) {
+            if (std::equal(pattern.begin(), pattern.end(), seq.begin() + pos)) {
+                result.emplace_back(seqId, pos);
+            }
+        }
+    };
+    for (size_t i{0}; i < data.size(); ++i) {
+        search(data[i], i);
+        search(reverseComplement<Index>(data[i]), 2*data.size()-1-i);
+    }
+    std::ranges::sort(result);
+    return result;
+}
+
+template <typename Index, typename Cursor>
+auto locateAll(Index const& index, Cursor const& cursor) -> std::vector<std::tuple<size_t, size_t>> {
+    auto result = std::vector<std::tuple<size_t, size_t>>{};
+    for (size_t i{cursor.lb}; i < cursor.lb + cursor.len; ++i) {
+        result.emplace_back(index.locate(i));
+    }
+    std::ranges::sort(result);
+    return result;
+}
+}
+
+TEMPLATE_TEST_CASE("checking reverse complement bidirectional fm index cursor on random data", "[RCBiFMIndexCursor]",
+    fmindex_collection::occtable::Interleaved_16<5>,
+    fmindex_collection::occtable::Interleaved_16<6>) {
+    using OccTable = TestType;
+    using Index = fmindex_collection::RCBiFMIndex<OccTable>;
+    static constexpr size_t Sigma = Index::Sigma;
+
+    auto rng = std::mt19937_64{Sigma};
+
+    // multiple sequences, with N (5) being rare
+    auto data = std::vector<std::vector<uint8_t>>{};
+    for (size_t i{0}; i < 5; ++i) {
+        auto& seq = data.emplace_back();
+        auto length = 50 + rng() % 100;
+        for (size_t j{0}; j < length; ++j) {
+            auto c = rng() % 4 + 1;
+            if (Sigma == 6 && rng() % 10 == 0) c = 5;
+            seq.push_back(c);
+        }
+    }
+    auto index = Index{data, /*.samplingRate=*/1, /*.threadNbr=*/1};
+
+    // checks the intervals of pattern and its reverse complement against a brute force search
+    auto checkCursor = [&](auto const& cursor, std::vector<uint8_t> const& pattern) {
+        INFO("pattern size " << pattern.size());
+        auto expected   = findAll<Index>(data, pattern);
+        auto expectedRc = findAll<Index>(data, reverseComplement<Index>(pattern));
+        CHECK(cursor.len == expected.size());
+        CHECK(locateAll(index, cursor) == expected);
+        CHECK(locateAll(index, cursor.reverseComplement()) == expectedRc);
+
+        // extending all symbols at once must match extending each symbol
+        auto allLeft  = cursor.extendLeft();
+        auto allRight = cursor.extendRight();
+        for (size_t symb{1}; symb < Sigma; ++symb) {
+            INFO("symb " << symb);
+            auto left  = cursor.extendLeft(symb);
+            auto right = cursor.extendRight(symb);
+            CHECK(left.lb   == allLeft[symb].lb);
+            CHECK(left.lbRc == allLeft[symb].lbRc);
+            CHECK(left.len  == allLeft[symb].len);
+            CHECK(right.lb   == allRight[symb].lb);
+            CHECK(right.lbRc == allRight[symb].lbRc);
+            CHECK(right.len  == allRight[symb].len);
+        }
+    };
+
+    for (size_t q{0}; q < 200; ++q) {
+        INFO("query " << q);
+        // substrings of the text (including reverse complements) and random patterns
+        auto pattern = std::vector<uint8_t>{};
+        auto length  = 1 + rng() % 8;
+        if (q % 4 != 0) {
+            auto const& seq = data[rng() % data.size()];
+            auto start = rng() % (seq.size() - length);
+            pattern = std::vector<uint8_t>(seq.begin() + start, seq.begin() + start + length);
+            if (q % 2 == 0) {
+                pattern = reverseComplement<Index>(pattern);
+            }
+        } else {
+            for (size_t j{0}; j < length; ++j) {
+                pattern.push_back(rng() % (Sigma-1) + 1);
+            }
+        }
+
+        // start in the middle of the pattern and extend in random directions
+        auto l = rng() % length;
+        auto r = l;
+        auto cursor = fmindex_collection::RCBiFMIndexCursor{index};
+        checkCursor(cursor, {});
+        while (l > 0 || r < length) {
+            if (r < length && (l == 0 || rng() % 2 == 0)) {
+                cursor = cursor.extendRight(pattern[r]);
+                r += 1;
+            } else {
+                l -= 1;
+                cursor = cursor.extendLeft(pattern[l]);
+            }
+            checkCursor(cursor, std::vector<uint8_t>(pattern.begin() + l, pattern.begin() + r));
+        }
+    }
+}
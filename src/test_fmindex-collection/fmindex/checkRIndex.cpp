@@ -0,0 +1,95 @@
+// SPDX-FileCopyrightText: 2006-2023, Knut Reinert & Freie Universität Berlin
+// SPDX-FileCopyrightText: 2016-2023, Knut Reinert & MPI für molekulare Genetik
+// SPDX-License-Identifier: CC0-1.0
+#include <catch2/catch_all.hpp>
+#include <algorithm>
+#include <fmindex-collection/fmindex/FMIndex.h>
+#include <fmindex-collection/fmindex/RIndex.h>
+#include <fmindex-collection/fmindex/RIndexCursor.h>
+#include <fmindex-collection/occtable/all.h>
+#include <fmindex-collection/search/SearchNoErrors.h>
+
+namespace {
+// near identical copies of a single sequence
+auto generateHaplotypes(size_t count, size_t length) -> std::vector<std::vector<uint8_t>> {
+    auto base = std::vector<uint8_t>{};
+    for (size_t i{0}; i < length; ++i) {
+        base.push_back((i * 7 + i / 5) % 4 + 1);
+    }
+    auto haplotypes = std::vector<std::vector<uint8_t>>{};
+    for (size_t j{0}; j < count; ++j) {
+        auto& seq = haplotypes.emplace_back(base);
+        seq[(j * 37) % length] = (seq[(j * 37) % length] % 4) + 1;
+        seq.resize(length - j % 3);
+    }
+    return haplotypes;
+}
+
+auto findAll(std::vector<std::vector<uint8_t>> const& input, std::vector<uint8_t> const& query) -> std::vector<std::tuple<size_t, size_t>> {
+    auto res = std::vector<std::tuple<size_t, size_t>>{};
+    for (size_t seq{0}; seq < input.size(); ++seq) {
+        auto const& s = input[seq];
+        for (size_t pos{0}; pos + query.size() <= s.size(); ++pos) {
+            if (std::equal(query.begin(), query.end(), s.begin() + pos)) {
+                res.emplace_back(seq, pos);
+            }
+        }
+    }
+    return res;
+}
+}
+
+TEMPLATE_TEST_CASE("checking r-index", "[RIndex]", fmindex_collection::occtable::Interleaved_16<5>, fmindex_collection::occtable::Wavelet<5>) {
+    using OccTable = TestType;
+    using Index    = fmindex_collection::RIndex<OccTable>;
+
+    auto input = generateHaplotypes(10, 200);
+    input.emplace_back(); // empty sequence
+    auto index = Index{input, /*threadNbr*/ 1};
+    auto ref   = fmindex_collection::FMIndex<OccTable>{input, /*samplingRate*/ 1, /*threadNbr*/ 1};
+    REQUIRE(index.size() == ref.size());
+
+    // less samples than with a sampling rate of 16
+    CHECK(index.phiKeys.size() < index.size() / 16);
+
+    SECTION("locate all rows") {
+        auto cursor = fmindex_collection::RIndexCursor{index};
+        size_t row{0};
+        for (auto pos : fmindex_collection::LocateRIndex{index, cursor}) {
+            INFO(row);
+            CHECK(pos == ref.locate(row));
+            row += 1;
+        }
+        CHECK(row == index.size());
+    }
+
+    SECTION("toehold of extendLeft() and extendLeft(symb) are equal") {
+        auto cursor = fmindex_collection::RIndexCursor{index}.extendLeft(2).extendLeft(3);
+        auto cursors = cursor.extendLeft();
+        for (size_t symb{0}; symb < Index::Sigma; ++symb) {
+            INFO(symb);
+            auto c = cursor.extendLeft(symb);
+            CHECK(c.lb == cursors[symb].lb);
+            CHECK(c.len == cursors[symb].len);
+            if (!c.empty()) {
+                CHECK(c.toehold == cursors[symb].toehold);
+                CHECK(index.textPosition(c.toehold) == ref.locate(c.lb + c.len - 1));
+            }
+        }
+    }
+
+    SECTION("search and locate") {
+        auto queries = std::vector<std::vector<uint8_t>>{{1}, {2, 3}, {1, 1, 2}, {4, 3, 2, 1}};
+        queries.emplace_back(input[3].begin() + 10, input[3].begin() + 40);
+        queries.emplace_back(input[7].begin() + 50, input[7].begin() + 90);
+        for (auto const& query : queries) {
+            auto cursor = fmindex_collection::search_no_errors::search(index, query);
+            auto res = std::vector<std::tuple<size_t, size_t>>{};
+            for (auto pos : fmindex_collection::LocateRIndex{index, cursor}) {
+                res.push_back(pos);
+            }
+            std::ranges::sort(res);
+            CHECK(res == findAll(input, query));
+        }
+    }
+}
@@ -0,0 +1,117 @@
+// SPDX-FileCopyrightText: 2006-2023, Knut Reinert & Freie Universität Berlin
+// SPDX-FileCopyrightText: 2016-2023, Knut Reinert & MPI für molekulare Genetik
+// SPDX-License-Identifier: CC0-1.0
+#include <catch2/catch_all.hpp>
+#include <algorithm>
+#include <fmindex-collection/fmindex/BiFMIndex.h>
+#include <fmindex-collection/fmindex/FMIndex.h>
+#include <fmindex-collection/fmindex/SegmentedIndex.h>
+#include <fmindex-collection/occtable/all.h>
+#include <fmindex-collection/search/SearchNoErrors.h>
+
+namespace {
+// sequences (including delimiter) are a multiple of the sampling rate, so each sequence start is sampled
+auto generateBatch(size_t count, size_t seed) -> std::vector<std::vector<uint8_t>> {
+    auto batch = std::vector<std::vector<uint8_t>>{};
+    for (size_t j{0}; j < count; ++j) {
+        auto& seq = batch.emplace_back();
+        for (size_t i{0}; i < 31 + (seed * 3 + j) % 5 * 16; ++i) {
+            seq.push_back((i * (seed + j + 3) + i / 7 + seed) % 4 + 1);
+        }
+    }
+    return batch;
+}
+
+auto findAll(std::vector<std::vector<uint8_t>> const& input, std::vector<uint8_t> const& query) -> std::vector<std::tuple<size_t, size_t>> {
+    auto res = std::vector<std::tuple<size_t, size_t>>{};
+    for (size_t seq{0}; seq < input.size(); ++seq) {
+        auto const& s = input[seq];
+        for (size_t pos{0}; pos + query.size() <= s.size(); ++pos) {
+            if (std::equal(query.begin(), query.end(), s.begin() + pos)) {
+                res.emplace_back(seq, pos);
+            }
+        }
+    }
+    return res;
+}
+
+template <typename Index>
+auto locateAll(fmindex_collection::SegmentedIndex<Index> const& index, std::vector<uint8_t> const& query) -> std::vector<std::tuple<size_t, size_t>> {
+    auto res = std::vector<std::tuple<size_t, size_t>>{};
+    index.forEachSegment([&](auto const& segment, auto const& segmentIndex) {
+        auto cursor = fmindex_collection::search_no_errors::search(segmentIndex, query);
+        for (size_t i{cursor.lb}; i < cursor.lb + cursor.len; ++i) {
+            res.emplace_back(index.locate(segment, i));
+        }
+    });
+    std::ranges::sort(res);
+    return res;
+}
+
+template <typename Index>
+void checkSegmentedIndex() {
+    auto index = fmindex_collection::SegmentedIndex<Index>{/*samplingRate*/ 4, /*threadNbr*/ 2};
+    CHECK(index.size() == 0);
+    CHECK(index.sequenceCount() == 0);
+
+    auto input   = std::vector<std::vector<uint8_t>>{};
+    auto queries = std::vector<std::vector<uint8_t>>{{1}, {2, 3}, {1, 1, 2}, {4, 3, 2, 1}};
+    size_t maxSegments{};
+    for (size_t round{0}; round < 20; ++round) {
+        INFO("round " << round);
+        auto batch = generateBatch(1 + round % 3, round);
+        index.append(batch);
+        input.insert(input.end(), batch.begin(), batch.end());
+        queries.emplace_back(batch.back().begin() + 5, batch.back().begin() + 17);
+
+        // queries don't wait for the background merge
+        CHECK(index.sequenceCount() == input.size());
+        for (auto const& query : queries) {
+            CHECK(locateAll(index, query) == findAll(input, query));
+        }
+
+        index.wait();
+        auto segments = index.snapshot();
+        maxSegments = std::max(maxSegments, segments->size());
+        size_t totalSize{};
+        for (auto const& s : input) {
+            totalSize += s.size() + 1;
+        }
+        CHECK(index.size() == totalSize);
+
+        // each segment is larger than mergeRatio times all newer segments
+        size_t newer{};
+        for (size_t i{segments->size()}; i > 0; --i) {
+            auto s = (*segments)[i-1]->index.size();
+            if (i < segments->size()) {
+                CHECK(s > index.mergeRatio * newer);
+            }
+            newer += s;
+        }
+    }
+    CHECK(maxSegments > 2);
+
+    // a snapshot stays valid, while segments are merged
+    auto before = index.snapshot();
+    index.compact();
+    CHECK(index.snapshot()->size() == 1);
+    CHECK(before->size() > 1);
+    for (auto const& segment : *before) {
+        CHECK(reconstructText(segment->index).size() > 0);
+    }
+    for (auto const& query : queries) {
+        CHECK(locateAll(index, query) == findAll(input, query));
+    }
+    CHECK(reconstructText(index.snapshot()->front()->index) == input);
+}
+}
+
+TEST_CASE("checking segmented bidirectional fm index", "[SegmentedIndex]") {
+    using Index = fmindex_collection::BiFMIndex<fmindex_collection::occtable::Interleaved_16<5>>;
+    checkSegmentedIndex<Index>();
+}
+
+TEST_CASE("checking segmented fm index", "[SegmentedIndex]") {
+    using Index = fmindex_collection::FMIndex<fmindex_collection::occtable::EprV2_16<5>>;
+    checkSegmentedIndex<Index>();
+}
@@ -84,7 +84,11 @@
     fmindex_collection::occtable::RunBlockEncoded2<256>, \
     fmindex_collection::occtable::RunBlockEncoded3<256>, \
     fmindex_collection::occtable::RunBlockEncoded4<256>, \
-    fmindex_collection::occtable::RecursiveRunBlockEncodedD2<256>
+    fmindex_collection::occtable::RunLengthEncoded<256>, \
+    fmindex_collection::occtable::RecursiveRunBlockEncodedD2<256>, \
+    fmindex_collection::occtable::Size32<fmindex_collection::occtable::Interleaved_16<256>>, \
+    fmindex_collection::occtable::SampleMarked<fmindex_collection::occtable::Interleaved_16<256>>, \
+    fmindex_collection::occtable::SampleMarked<fmindex_collection::occtable::EprV7<256>>
 
 #if FMC_USE_SDSL
 #define ALLTABLES \
@@ -389,3 +389,75 @@ TEMPLATE_TEST_CASE("check occ table construction on text longer than 256 charact
         }
     }
 }
+
+TEMPLATE_TEST_CASE("check parallel construction of occ tables", "[OccTable][parallel]", ALLTABLES) {
+    using OccTable = TestType;
+    INFO(typeid(OccTable).name());
+
+    auto text = std::vector<uint8_t>{};
+    for (size_t i{0}; i < 140'000; ++i) {
+        text.push_back((i * 7919 + i / 13) % 256);
+    }
+
+    auto expected = OccTable{text};
+    auto table    = fmindex_collection::createOccTable<OccTable>(text, /*threadNbr*/4);
+    REQUIRE(table.size() == expected.size());
+
+    for (size_t idx{0}; idx <= table.size(); ++idx) {
+        INFO(idx);
+        if (idx % 1009 == 0 || idx == table.size()) {
+            for (size_t symb{0}; symb < 256; ++symb) {
+                INFO(symb);
+                CHECK(table.rank(idx, symb) == expected.rank(idx, symb));
+                CHECK(table.prefix_rank(idx, symb) == expected.prefix_rank(idx, symb));
+            }
+        }
+        if (idx < table.size()) {
+            CHECK(table.symbol(idx) == text[idx]);
+            CHECK(table.rank(idx, text[idx]) == expected.rank(idx, text[idx]));
+        }
+    }
+}
+
+TEMPLATE_TEST_CASE("check all_ranks_interval() is equal to all_ranks() of both ends", "[OccTable][interval]", ALLTABLES) {
+    using OccTable = TestType;
+    INFO(typeid(OccTable).name());
+
+    auto text = std::vector<uint8_t>{};
+    for (size_t i{0}; i < 1'000; ++i) {
+        text.push_back((i * 7919 + i / 13) % 7 + 'a');
+    }
+    auto table = OccTable{text};
+
+    for (size_t lb{0}; lb <= table.size(); ++lb) {
+        for (size_t len : {0, 1, 2, 5, 63, 64, 65, 300}) {
+            auto rb = lb + len;
+            if (rb > table.size()) continue;
+            INFO(lb);
+            INFO(rb);
+            auto [rs1, prs1, rs2, prs2] = fmindex_collection::allRanksInterval(table, lb, rb);
+            auto [e_rs1, e_prs1] = table.all_ranks(lb);
+            auto [e_rs2, e_prs2] = table.all_ranks(rb);
+            CHECK(rs1  == e_rs1);
+            CHECK(prs1 == e_prs1);
+            CHECK(rs2  == e_rs2);
+            CHECK(prs2 == e_prs2);
+        }
+    }
+}
+
+TEMPLATE_TEST_CASE("check rank_symbol() is equal to rank() of symbol()", "[OccTable][rank_symbol]", ALLTABLES) {
+    using OccTable = TestType;
+    INFO(typeid(OccTable).name());
+
+    auto text = std::vector<uint8_t>{};
+    for (size_t i{0}; i < 1'000; ++i) {
+        text.push_back((i * 7919 + i / 13) % 7 + 'a');
+    }
+    auto table = OccTable{text};
+
+    for (size_t idx{0}; idx < table.size(); ++idx) {
+        INFO(idx);
+        CHECK(table.rank_symbol(idx) == table.rank(idx, text[idx]));
+    }
+}
@@ -54,6 +54,7 @@
     fmindex_collection::rankvector::InterleavedEPRV7<Sigma>, \
     fmindex_collection::rankvector::InterleavedWavelet<Sigma>, \
     fmindex_collection::rankvector::Wavelet<Sigma>, \
+    fmindex_collection::rankvector::RLEBwt<Sigma>, \
     (fmindex_collection::rankvector::Wavelet<Sigma, fmindex_collection::bitvector::SparseBLEBitvector<>>), \
     fmindex_collection::rankvector::Double64ShortEPRV8<Sigma>, \
     fmindex_collection::rankvector::Double128ShortEPRV8<Sigma>, \
@@ -69,5 +70,16 @@
 #define ALLRANKVECTORS(Sigma) ALLRANKVECTORS_IMPL(Sigma)
 #endif
 
+// rank vectors storing sample markers, see RankVectorSampleMarker
+#define MARKEDRANKVECTORS(Sigma) \
+    fmindex_collection::rankvector::InterleavedBitvector16<Sigma>::WithSampleMarkers, \
+    fmindex_collection::rankvector::InterleavedBitvector16Aligned<Sigma>::WithSampleMarkers, \
+    fmindex_collection::rankvector::EPRV3_16<Sigma>::WithSampleMarkers, \
+    fmindex_collection::rankvector::EPRV4<Sigma>::WithSampleMarkers, \
+    fmindex_collection::rankvector::EPRV5<Sigma>::WithSampleMarkers, \
+    fmindex_collection::rankvector::InterleavedEPRV7<Sigma>::WithSampleMarkers, \
+    fmindex_collection::rankvector::Double64ShortEPRV8<Sigma>::WithSampleMarkers, \
+    fmindex_collection::rankvector::Double128EPRV8<Sigma>::WithSampleMarkers
+
 //!wt_epr is not working as expected
 //    fmindex_collection::rankvector::Sdsl_wt_epr<255>,
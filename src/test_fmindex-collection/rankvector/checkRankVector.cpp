@@ -2,6 +2,7 @@
 // SPDX-FileCopyrightText: 2016-2023, Knut Reinert & MPI für molekulare Genetik
 // SPDX-License-Identifier: CC0-1.0
 #include <catch2/catch_all.hpp>
+#include <fmindex-collection/cpu_dispatch.h>
 #include <fmindex-collection/utils.h>
 #include <fstream>
 #include <nanobench.h>
@@ -372,6 +373,243 @@ TEMPLATE_TEST_CASE("check symbol vectors construction on text longer than 256 ch
     }
 }
 
+namespace {
+template <typename Vector>
+void checkParallelConstruction(size_t length, size_t threadNbr, size_t sigma) {
+    auto rng  = ankerl::nanobench::Rng{};
+    auto text = std::vector<uint8_t>{};
+    text.reserve(length);
+    for (size_t i{0}; i < length; ++i) {
+        text.push_back(rng.bounded(sigma));
+    }
+
+    auto vector = Vector{std::span{text}, threadNbr};
+    REQUIRE(vector.size() == text.size());
+
+    auto counts = std::array<size_t, Vector::Sigma>{};
+    for (size_t idx{0}; idx <= text.size(); ++idx) {
+        INFO(idx);
+        if (idx % 509 == 0 || idx == text.size()) {
+            for (size_t symb{0}; symb < sigma; ++symb) {
+                INFO(symb);
+                CHECK(vector.rank(idx, symb) == counts[symb]);
+            }
+        }
+        if (idx == text.size()) break;
+        CHECK(vector.symbol(idx) == text[idx]);
+        CHECK(vector.rank(idx, text[idx]) == counts[text[idx]]);
+        counts[text[idx]] += 1;
+    }
+}
+}
+
+TEMPLATE_TEST_CASE("check parallel construction of symbol vectors", "[RankVector][parallel]", ALLRANKVECTORS(256)) {
+    using Vector = TestType;
+    if constexpr (fmindex_collection::RankVectorParallelConstruction<Vector>) {
+        auto vector_name = getName<Vector>();
+        INFO(vector_name);
+
+        auto length    = GENERATE(size_t{768}, size_t{131'072}, size_t{200'003});
+        auto threadNbr = GENERATE(size_t{1}, size_t{4});
+        INFO("length " << length << ", threadNbr " << threadNbr);
+        checkParallelConstruction<Vector>(length, threadNbr, Vector::Sigma);
+    }
+}
+
+TEMPLATE_TEST_CASE("check parallel construction of symbol vectors, dna4 like", "[RankVector][parallel]", ALLRANKVECTORS(5)) {
+    using Vector = TestType;
+    if constexpr (fmindex_collection::RankVectorParallelConstruction<Vector>) {
+        auto vector_name = getName<Vector>();
+        INFO(vector_name);
+
+        auto length    = GENERATE(size_t{768}, size_t{131'072}, size_t{200'003});
+        auto threadNbr = GENERATE(size_t{1}, size_t{4});
+        INFO("length " << length << ", threadNbr " << threadNbr);
+        checkParallelConstruction<Vector>(length, threadNbr, Vector::Sigma);
+    }
+}
+
+TEMPLATE_TEST_CASE("check symbol vectors with each cpu dispatch level, dna4 like", "[RankVector][dispatch]", ALLRANKVECTORS(5)) {
+    using Vector = TestType;
+    namespace cpu_dispatch = fmindex_collection::cpu_dispatch;
+    auto vector_name = getName<Vector>();
+    INFO(vector_name);
+
+    auto rng  = ankerl::nanobench::Rng{};
+    auto text = std::vector<uint8_t>{};
+    for (size_t i{0}; i < 2'000; ++i) {
+        text.push_back(rng.bounded(5));
+    }
+    auto level = GENERATE(cpu_dispatch::Level::Generic, cpu_dispatch::Level::Popcnt, cpu_dispatch::Level::AVX2, cpu_dispatch::Level::AVX512);
+    INFO("level " << cpu_dispatch::name(cpu_dispatch::select(level)));
+    auto vector = Vector{std::span{text}}; // kernels are selected when the vector is created
+
+    auto counts = std::array<uint64_t, 5>{};
+    for (size_t idx{0}; idx <= text.size(); ++idx) {
+        INFO(idx);
+        auto rs = vector.all_ranks(idx);
+        uint64_t prefix{};
+        for (size_t symb{0}; symb < 5; ++symb) {
+            INFO(symb);
+            prefix += counts[symb];
+            CHECK(vector.rank(idx, symb) == counts[symb]);
+            CHECK(vector.prefix_rank(idx, symb) == prefix);
+            CHECK(rs[symb] == counts[symb]);
+        }
+        if (idx < text.size()) {
+            if constexpr (fmindex_collection::RankVectorRankAndSymbol<Vector>) {
+                auto [rank, symb] = vector.rank_and_symbol(idx);
+                CHECK(symb == text[idx]);
+                CHECK(rank == counts[text[idx]]);
+            }
+            counts[text[idx]] += 1;
+        }
+    }
+    cpu_dispatch::select(cpu_dispatch::Level::AVX512);
+}
+
+TEMPLATE_TEST_CASE("check rank_and_symbol, dna4 like", "[RankVector][rank_symbol]", ALLRANKVECTORS(5)) {
+    using Vector = TestType;
+    if constexpr (fmindex_collection::RankVectorRankAndSymbol<Vector>) {
+        auto vector_name = getName<Vector>();
+        INFO(vector_name);
+
+        auto rng  = ankerl::nanobench::Rng{};
+        auto text = std::vector<uint8_t>{};
+        for (size_t i{0}; i < 2'000; ++i) {
+            text.push_back(rng.bounded(5));
+        }
+        auto vector = Vector{std::span{text}};
+
+        auto counts = std::array<uint64_t, 5>{};
+        for (size_t idx{0}; idx < text.size(); ++idx) {
+            INFO(idx);
+            auto [rank, symb] = vector.rank_and_symbol(idx);
+            CHECK(symb == text[idx]);
+            CHECK(rank == counts[text[idx]]);
+            CHECK(vector.rank_symbol(idx) == rank);
+            CHECK(fmindex_collection::rankAndSymbol(vector, idx) == std::make_tuple(rank, symb));
+            counts[text[idx]] += 1;
+        }
+    }
+}
+
+TEMPLATE_TEST_CASE("check runCount", "[RankVector][runs]", ALLRANKVECTORS(5)) {
+    using Vector = TestType;
+    if constexpr (fmindex_collection::RankVectorRunCount<Vector>) {
+        auto vector_name = getName<Vector>();
+        INFO(vector_name);
+
+        auto text = std::vector<uint8_t>{0, 0, 1, 1, 1, 4, 2, 2, 0, 0, 0, 0, 3};
+        auto vector = Vector{std::span{text}};
+        CHECK(vector.runCount() == 6);
+        CHECK(Vector{}.runCount() == 0);
+    }
+}
+
+TEMPLATE_TEST_CASE("check sample marker, dna4 like", "[RankVector][samples]", MARKEDRANKVECTORS(5)) {
+    using Vector = TestType;
+    static_assert(fmindex_collection::RankVectorSampleMarker<Vector>);
+    static_assert(!fmindex_collection::RankVectorSampleMarker<typename Vector::WithoutSampleMarkers>);
+
+    auto vector_name = getName<Vector>();
+    INFO(vector_name);
+
+    auto rng  = ankerl::nanobench::Rng{};
+    auto text = std::vector<uint8_t>{};
+    for (size_t i{0}; i < 2'000; ++i) {
+        text.push_back(rng.bounded(5));
+    }
+    auto vector = Vector{std::span{text}};
+
+    auto sampled = std::vector<bool>{};
+    for (size_t i{0}; i < text.size(); ++i) {
+        sampled.push_back(rng.bounded(3) == 0);
+    }
+    vector.markSamples([&](size_t idx) { return sampled[idx]; });
+
+    auto check = [&](Vector const& vector) {
+        uint64_t count{};
+        for (size_t idx{0}; idx < text.size(); ++idx) {
+            INFO(idx);
+            CHECK(vector.isSampled(idx) == sampled[idx]);
+            CHECK(vector.sampleRank(idx) == count);
+            CHECK(vector.symbol(idx) == text[idx]);
+            count += sampled[idx]?1:0;
+        }
+    };
+    check(vector);
+
+    SECTION("serialization keeps the markers") {
+        auto ss = std::stringstream{};
+        {
+            auto archive = cereal::BinaryOutputArchive{ss};
+            archive(vector);
+        }
+        auto loaded = Vector{};
+        {
+            auto archive = cereal::BinaryInputArchive{ss};
+            archive(loaded);
+        }
+        check(loaded);
+    }
+
+    SECTION("vectors stored without markers are rejected") {
+        auto unmarked = typename Vector::WithoutSampleMarkers{std::span{text}};
+        auto ss = std::stringstream{};
+        {
+            auto archive = cereal::BinaryOutputArchive{ss};
+            archive(unmarked);
+        }
+        auto loaded = Vector{};
+        auto archive = cereal::BinaryInputArchive{ss};
+        CHECK_THROWS_AS(archive(loaded), std::runtime_error);
+    }
+}
+
+TEMPLATE_TEST_CASE("check all_ranks_and_prefix_ranks of intervals, dna4 like", "[RankVector][interval]", ALLRANKVECTORS(5)) {
+    using Vector = TestType;
+    if constexpr (fmindex_collection::RankVectorIntervalRanks<Vector>) {
+        auto vector_name = getName<Vector>();
+        INFO(vector_name);
+
+        auto rng  = ankerl::nanobench::Rng{};
+        auto text = std::vector<uint8_t>{};
+        for (size_t i{0}; i < 2'000; ++i) {
+            text.push_back(rng.bounded(5));
+        }
+        auto vector = Vector{std::span{text}};
+
+        // expected ranks and prefix ranks of each position
+        auto expected = std::vector<std::tuple<std::array<uint64_t, 5>, std::array<uint64_t, 5>>>{};
+        auto counts   = std::array<uint64_t, 5>{};
+        for (size_t idx{0}; idx <= text.size(); ++idx) {
+            auto prefix = counts;
+            for (size_t symb{1}; symb < 5; ++symb) {
+                prefix[symb] += prefix[symb-1];
+            }
+            expected.emplace_back(counts, prefix);
+            if (idx < text.size()) {
+                counts[text[idx]] += 1;
+            }
+        }
+
+        for (size_t lb{0}; lb <= text.size(); ++lb) {
+            for (size_t len : {0, 1, 2, 3, 17, 63, 64, 65, 200, 700}) {
+                auto rb = lb + len;
+                if (rb > text.size()) continue;
+                INFO(lb);
+                INFO(rb);
+                auto [rs1, prs1, rs2, prs2] = vector.all_ranks_and_prefix_ranks_interval(lb, rb);
+                CHECK(rs1  == std::get<0>(expected[lb]));
+                CHECK(prs1 == std::get<1>(expected[lb]));
+                CHECK(rs2  == std::get<0>(expected[rb]));
+                CHECK(prs2 == std::get<1>(expected[rb]));
+            }
+        }
+    }
+}
+
 namespace {
 struct Bench : ankerl::nanobench::Bench {
     std::stringstream output{};
@@ -840,3 +1078,94 @@ TEMPLATE_TEST_CASE("benchmark vectors size, on human dna5 data", "[RankVector][b
         });
     }
 }
+
+static auto benchs_dispatch = Benchs{};
+static auto bench_rank_symbol_dispatch = Bench{"rank_symbol()"};
+
+TEMPLATE_TEST_CASE("benchmark cpu dispatch levels, dna4 like", "[RankVector][!benchmark][5][time][dispatch][.]",
+    fmindex_collection::rankvector::InterleavedEPRV2_16<5>,
+    fmindex_collection::rankvector::EPRV3_16<5>,
+    fmindex_collection::rankvector::EPRV4<5>,
+    fmindex_collection::rankvector::EPRV5<5>,
+    fmindex_collection::rankvector::InterleavedEPRV7<5>,
+    fmindex_collection::rankvector::Double64EPRV8<5>,
+    fmindex_collection::rankvector::Double256EPRV8<5>,
+    fmindex_collection::rankvector::Double512EPRV8<5>) {
+    using Vector = TestType;
+    namespace cpu_dispatch = fmindex_collection::cpu_dispatch;
+    auto& [bench_rank, bench_prefix_rank, bench_all_ranks, bench_all_prefix_ranks, bench_symbol, bench_ctor] = benchs_dispatch;
+
+    auto rng  = ankerl::nanobench::Rng{};
+    auto text = std::vector<uint8_t>{};
+    for (size_t i{0}; i < 1'000'000; ++i) {
+        text.push_back(rng.bounded(4)+1);
+    }
+    for (auto level : {cpu_dispatch::Level::Generic, cpu_dispatch::Level::Popcnt, cpu_dispatch::Level::AVX2, cpu_dispatch::Level::AVX512}) {
+        if (cpu_dispatch::select(level) != level) continue;
+        auto vec  = Vector{text}; // kernels are selected when the vector is created
+        auto name = getName<Vector>() + " (" + std::string{cpu_dispatch::name(level)} + ")";
+
+        bench_rank.run(name, [&]() {
+            auto v = vec.rank(rng.bounded(text.size()), rng.bounded(4)+1);
+            ankerl::nanobench::doNotOptimizeAway(v);
+        });
+
+        bench_prefix_rank.run(name, [&]() {
+            auto v = vec.prefix_rank(rng.bounded(text.size()), rng.bounded(4)+1);
+            ankerl::nanobench::doNotOptimizeAway(v);
+        });
+
+        bench_all_ranks.run(name, [&]() {
+            auto v = vec.all_ranks(rng.bounded(text.size()));
+            ankerl::nanobench::doNotOptimizeAway(v);
+        });
+
+        bench_all_prefix_ranks.run(name, [&]() {
+            auto v = vec.all_ranks_and_prefix_ranks(rng.bounded(text.size()));
+            ankerl::nanobench::doNotOptimizeAway(v);
+        });
+
+        bench_rank_symbol_dispatch.run(name, [&]() {
+            auto v = vec.rank_symbol(rng.bounded(text.size()));
+            ankerl::nanobench::doNotOptimizeAway(v);
+        });
+    }
+    cpu_dispatch::select(cpu_dispatch::Level::AVX512);
+}
+
+static auto benchs_hugepages = Benchs{};
+
+TEMPLATE_TEST_CASE("benchmark page policies on a large random access workload, dna4 like", "[RankVector][!benchmark][5][time][hugepages][.]",
+    fmindex_collection::rankvector::InterleavedBitvector16<5>,
+    fmindex_collection::rankvector::InterleavedEPRV2_16<5>) {
+    using Vector = TestType;
+    auto& [bench_rank, bench_prefix_rank, bench_all_ranks, bench_all_prefix_ranks, bench_symbol, bench_ctor] = benchs_hugepages;
+
+    auto rng  = ankerl::nanobench::Rng{};
+    auto text = std::vector<uint8_t>{};
+    #ifdef NDEBUG
+    text.resize(1'000'000'000);
+    #else
+    text.resize(1'000'000);
+    #endif
+    for (auto& c : text) {
+        c = rng.bounded(4)+1;
+    }
+
+    for (auto policy : {fmindex_collection::PagePolicy::Default, fmindex_collection::PagePolicy::Transparent, fmindex_collection::PagePolicy::Huge2MB, fmindex_collection::PagePolicy::Huge1GB}) {
+        fmindex_collection::huge_pages::select(policy);
+        auto vec  = Vector{text};
+        auto name = getName<Vector>() + " (" + std::string{fmindex_collection::huge_pages::name(policy)} + ")";
+
+        bench_rank.run(name, [&]() {
+            auto v = vec.rank(rng.bounded(text.size()), rng.bounded(4)+1);
+            ankerl::nanobench::doNotOptimizeAway(v);
+        });
+
+        bench_all_ranks.run(name, [&]() {
+            auto v = vec.all_ranks(rng.bounded(text.size()));
+            ankerl::nanobench::doNotOptimizeAway(v);
+        });
+    }
+    fmindex_collection::huge_pages::select(fmindex_collection::PagePolicy::Default);
+}
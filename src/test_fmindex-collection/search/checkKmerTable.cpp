@@ -0,0 +1,173 @@
+// SPDX-FileCopyrightText: 2006-2023, Knut Reinert & Freie Universität Berlin
+// SPDX-FileCopyrightText: 2016-2023, Knut Reinert & MPI für molekulare Genetik
+// SPDX-License-Identifier: CC0-1.0
+
+#include "generateText.h"
+
+#include <catch2/catch_all.hpp>
+#include <cmath>
+#include <fmindex-collection/fmindex/BiFMIndex.h>
+#include <fmindex-collection/fmindex/FMIndex.h>
+#include <fmindex-collection/occtable/all.h>
+#include <fmindex-collection/search/KmerTable.h>
+#include <fmindex-collection/search/SearchNg21.h>
+#include <fmindex-collection/search/SearchNoErrors.h>
+#include <iostream>
+#include <nanobench.h>
+#include <search_schemes/expand.h>
+#include <search_schemes/generator/all.h>
+
+TEMPLATE_TEST_CASE("kmer table reports same cursors as searching step by step", "[search][kmertable]",
+    fmindex_collection::occtable::Interleaved_16<5>,
+    fmindex_collection::occtable::EprV2_16<5>,
+    fmindex_collection::occtable::EprV5<5>) {
+
+    using OccTable = TestType;
+    using Index    = fmindex_collection::BiFMIndex<OccTable>;
+    using Result   = std::tuple<size_t, size_t, size_t, size_t>;
+
+    auto rng     = ankerl::nanobench::Rng{};
+    auto text    = generateText(10'000, rng);
+    auto index   = Index{std::vector<std::vector<uint8_t>>{text, generateText(1'000, rng)}, /*samplingRate*/1, /*threadNbr*/1};
+    auto queries = generateQueries(text, 200, 20, rng);
+    queries.push_back({1, 2}); // shorter than k
+    queries.push_back({1, 2, 0, 3, 4, 1}); // contains a delimiter
+
+    auto k = GENERATE(size_t{1}, size_t{3}, size_t{6});
+    INFO("k " << k);
+    auto kmerTable = fmindex_collection::KmerTable<Index>{index, k};
+    CHECK(kmerTable.entries.size() == size_t(std::pow(4, k)));
+
+    SECTION("lookup of all k-mers") {
+        auto kmer = std::vector<uint8_t>(k, 1);
+        for (size_t i{0}; i < kmerTable.entries.size(); ++i) {
+            size_t v = i;
+            for (size_t j{k}; j > 0; --j) {
+                kmer[j-1] = v % 4 + 1;
+                v = v / 4;
+            }
+            auto expected = fmindex_collection::select_cursor_t<Index>{index};
+            for (size_t j{k}; j > 0; --j) {
+                expected = expected.extendLeft(kmer[j-1]);
+            }
+            auto cur = kmerTable.lookup(index, kmer, 0);
+            CHECK(cur.len == expected.len);
+            if (!expected.empty()) {
+                CHECK(cur.lb == expected.lb);
+                CHECK(cur.lbRev == expected.lbRev);
+            }
+        }
+    }
+
+    SECTION("search_no_errors") {
+        auto expected = std::vector<Result>{};
+        fmindex_collection::search_no_errors::search(index, queries, [&](size_t qidx, auto cursor) {
+            if (cursor.empty()) return;
+            expected.emplace_back(qidx, cursor.lb, cursor.len, 0);
+        });
+        auto results = std::vector<Result>{};
+        fmindex_collection::search_no_errors::search(index, kmerTable, queries, [&](size_t qidx, auto cursor) {
+            if (cursor.empty()) return;
+            results.emplace_back(qidx, cursor.lb, cursor.len, 0);
+        });
+        CHECK(results == expected);
+    }
+
+    SECTION("search ng21") {
+        queries.resize(200); // search schemes are expanded for a fixed length
+        auto scheme = GENERATE(search_schemes::generator::pigeon_opt(0, 2),
+                               search_schemes::generator::h2(3, 0, 2));
+        auto search_scheme = search_schemes::expand(scheme, queries[0].size());
+
+        auto expected = std::vector<Result>{};
+        fmindex_collection::search_ng21::search(index, queries, search_scheme, [&](size_t qidx, auto cursor, size_t errors) {
+            expected.emplace_back(qidx, cursor.lb, cursor.len, errors);
+        });
+        auto results = std::vector<Result>{};
+        fmindex_collection::search_ng21::search(index, kmerTable, queries, search_scheme, [&](size_t qidx, auto cursor, size_t errors) {
+            results.emplace_back(qidx, cursor.lb, cursor.len, errors);
+        });
+        CHECK(results == expected);
+    }
+}
+
+TEST_CASE("kmer table with unidirectional FMIndex", "[search][kmertable]") {
+    using Index = fmindex_collection::FMIndex<fmindex_collection::occtable::EprV2_16<5>>;
+
+    auto rng     = ankerl::nanobench::Rng{};
+    auto text    = generateText(10'000, rng);
+    auto index   = Index{std::vector<std::vector<uint8_t>>{text}, /*samplingRate*/1, /*threadNbr*/1};
+    auto queries = generateQueries(text, 200, 20, rng);
+
+    auto kmerTable = fmindex_collection::KmerTable<Index>{index, 4};
+
+    for (size_t qidx{0}; qidx < queries.size(); ++qidx) {
+        INFO("qidx " << qidx);
+        auto expected = fmindex_collection::search_no_errors::search(index, queries[qidx]);
+        auto cursor   = fmindex_collection::search_no_errors::search(index, kmerTable, queries[qidx]);
+        CHECK(cursor.len == expected.len);
+        if (!expected.empty()) {
+            CHECK(cursor.lb == expected.lb);
+        }
+    }
+}
+
+TEST_CASE("benchmark kmer table", "[search][kmertable][!benchmark][time][.]") {
+    using OccTable = fmindex_collection::occtable::EprV2_16<5>;
+    using Index    = fmindex_collection::BiFMIndex<OccTable>;
+
+    auto rng = ankerl::nanobench::Rng{};
+    #ifdef NDEBUG
+    auto text = generateText(64'000'000, rng);
+    #else
+    auto text = generateText(100'000, rng);
+    #endif
+    auto index   = Index{std::vector<std::vector<uint8_t>>{text}, /*samplingRate*/16, /*threadNbr*/1};
+    auto queries = generateQueries(text, 100'000, 50, rng);
+    text.clear();
+
+    auto search_scheme = search_schemes::expand(search_schemes::generator::pigeon_opt(0, 2), queries[0].size());
+
+    auto output = std::stringstream{};
+    auto bench  = ankerl::nanobench::Bench{};
+    bench.title("search with kmer table, 50 chars long queries")
+         .relative(true)
+         .batch(queries.size())
+         .minEpochIterations(1)
+         .output(&output);
+
+    bench.run("search_no_errors, no table", [&]() {
+        size_t hits{};
+        fmindex_collection::search_no_errors::search(index, queries, [&](size_t, auto cursor) {
+            hits += cursor.count();
+        });
+        ankerl::nanobench::doNotOptimizeAway(hits);
+    });
+    bench.run("search_ng21 (2 errors), no table", [&]() {
+        size_t hits{};
+        fmindex_collection::search_ng21::search(index, queries, search_scheme, [&](size_t, auto cursor, size_t) {
+            hits += cursor.count();
+        });
+        ankerl::nanobench::doNotOptimizeAway(hits);
+    });
+
+    for (size_t k : {4, 8, 10, 12}) {
+        auto kmerTable = fmindex_collection::KmerTable<Index>{index, k};
+        auto mb = std::to_string(kmerTable.memoryUsage() / 1024 / 1024);
+        bench.run("search_no_errors, k=" + std::to_string(k) + " (" + mb + "MB)", [&]() {
+            size_t hits{};
+            fmindex_collection::search_no_errors::search(index, kmerTable, queries, [&](size_t, auto cursor) {
+                hits += cursor.count();
+            });
+            ankerl::nanobench::doNotOptimizeAway(hits);
+        });
+        bench.run("search_ng21 (2 errors), k=" + std::to_string(k) + " (" + mb + "MB)", [&]() {
+            size_t hits{};
+            fmindex_collection::search_ng21::search(index, kmerTable, queries, search_scheme, [&](size_t, auto cursor, size_t) {
+                hits += cursor.count();
+            });
+            ankerl::nanobench::doNotOptimizeAway(hits);
+        });
+    }
+    std::cout << output.str() << '\n';
+}
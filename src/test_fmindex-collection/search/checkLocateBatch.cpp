@@ -0,0 +1,126 @@
+// SPDX-FileCopyrightText: 2006-2023, Knut Reinert & Freie Universität Berlin
+// SPDX-FileCopyrightText: 2016-2023, Knut Reinert & MPI für molekulare Genetik
+// SPDX-License-Identifier: CC0-1.0
+
+#include "../occtables/allTables.h"
+#include "generateText.h"
+
+#include <catch2/catch_all.hpp>
+#include <fmindex-collection/fmindex/BiFMIndex.h>
+#include <fmindex-collection/fmindex/FMIndex.h>
+#include <fmindex-collection/locate.h>
+#include <fmindex-collection/search/SearchNoErrors.h>
+#include <fmindex-collection/suffixarray/DenseCSA.h>
+#include <iostream>
+#include <nanobench.h>
+
+namespace {
+template <typename Index>
+void checkLocateBatch(Index const& index) {
+    auto rows = std::vector<size_t>(index.size());
+    for (size_t i{0}; i < rows.size(); ++i) {
+        rows[i] = i;
+    }
+    // unordered and repeated rows
+    auto rng = ankerl::nanobench::Rng{};
+    for (size_t i{0}; i < 100; ++i) {
+        rows.push_back(rng.bounded(index.size()));
+    }
+
+    for (size_t batchSize : {1, 5, 32}) {
+        INFO("batchSize " << batchSize);
+        auto out = std::vector<std::tuple<size_t, size_t>>(rows.size());
+        index.locateBatch(rows, out, batchSize);
+        for (size_t i{0}; i < rows.size(); ++i) {
+            INFO("row " << rows[i]);
+            CHECK(out[i] == index.locate(rows[i]));
+        }
+    }
+}
+}
+
+TEMPLATE_TEST_CASE("checking locateBatch against locate", "[locate][batch]", ALLTABLES) {
+    using OccTable = TestType;
+
+    auto rng   = ankerl::nanobench::Rng{};
+    auto input = std::vector<std::vector<uint8_t>>{generateText(500, rng), generateText(300, rng)};
+
+    SECTION("BiFMIndex") {
+        auto index = fmindex_collection::BiFMIndex<OccTable>{input, /*samplingRate*/4, /*threadNbr*/1};
+        checkLocateBatch(index);
+    }
+
+    SECTION("FMIndex") {
+        auto index = fmindex_collection::FMIndex<OccTable>{input, /*samplingRate*/16, /*threadNbr*/1};
+        checkLocateBatch(index);
+    }
+
+    SECTION("BiFMIndex with DenseCSA") {
+        auto index = fmindex_collection::BiFMIndex<OccTable, fmindex_collection::DenseCSA>{input, /*samplingRate*/7, /*threadNbr*/1};
+        checkLocateBatch(index);
+    }
+}
+
+TEST_CASE("checking LocateBatch against LocateLinear", "[locate][batch]") {
+    using OccTable = fmindex_collection::occtable::EprV2_16<256>;
+    using Index    = fmindex_collection::BiFMIndex<OccTable>;
+
+    auto input  = std::vector<std::vector<uint8_t>>{{'A', 'A', 'A', 'C', 'A', 'A', 'A', 'B', 'A', 'A', 'A'},
+                                                    {'A', 'A', 'A', 'B', 'A', 'A', 'A', 'C', 'A', 'A', 'A'}};
+    auto index = Index{input, /*samplingRate*/4, /*threadNbr*/1};
+
+    auto queries = std::vector<std::vector<uint8_t>>{{'A'}, {'A', 'A'}, {'C', 'A'}, {'B'}};
+    fmindex_collection::search_no_errors::search(index, queries, [&](size_t qidx, auto cursor) {
+        INFO("qidx " << qidx);
+        auto expected = std::vector<std::tuple<size_t, size_t>>{};
+        for (auto [sid, spos] : fmindex_collection::LocateLinear{index, cursor}) {
+            expected.emplace_back(sid, spos);
+        }
+        auto results = std::vector<std::tuple<size_t, size_t>>{};
+        for (auto [sid, spos] : fmindex_collection::LocateBatch{index, cursor}) {
+            results.emplace_back(sid, spos);
+        }
+        CHECK(results == expected);
+    });
+}
+
+TEST_CASE("benchmark locateBatch", "[locate][batch][!benchmark][time][.]") {
+    using OccTable = fmindex_collection::occtable::EprV2_16<5>;
+
+    auto rng = ankerl::nanobench::Rng{};
+    #ifdef NDEBUG
+    auto text = generateText(64'000'000, rng);
+    #else
+    auto text = generateText(100'000, rng);
+    #endif
+    auto index = fmindex_collection::BiFMIndex<OccTable>{std::vector<std::vector<uint8_t>>{text}, /*samplingRate*/16, /*threadNbr*/1};
+    text.clear();
+
+    auto rows = std::vector<size_t>{};
+    for (size_t i{0}; i < 1'000'000; ++i) {
+        rows.push_back(rng.bounded(index.size()));
+    }
+    auto out = std::vector<std::tuple<size_t, size_t>>(rows.size());
+
+    auto output = std::stringstream{};
+    auto bench  = ankerl::nanobench::Bench{};
+    bench.title("locate, samplingRate 16")
+         .relative(true)
+         .batch(rows.size())
+         .minEpochIterations(1)
+         .output(&output);
+
+    bench.run("locate", [&]() {
+        for (size_t i{0}; i < rows.size(); ++i) {
+            out[i] = index.locate(rows[i]);
+        }
+        ankerl::nanobench::doNotOptimizeAway(out);
+    });
+    for (size_t batchSize : {8, 16, 32, 64}) {
+        bench.run("locateBatch, batch " + std::to_string(batchSize), [&]() {
+            index.locateBatch(rows, out, batchSize);
+            ankerl::nanobench::doNotOptimizeAway(out);
+        });
+    }
+    std::cout << output.str() << '\n';
+}
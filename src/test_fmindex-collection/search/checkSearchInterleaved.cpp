@@ -0,0 +1,132 @@
+// SPDX-FileCopyrightText: 2006-2023, Knut Reinert & Freie Universität Berlin
+// SPDX-FileCopyrightText: 2016-2023, Knut Reinert & MPI für molekulare Genetik
+// SPDX-License-Identifier: CC0-1.0
+
+#include "generateText.h"
+
+#include <algorithm>
+#include <catch2/catch_all.hpp>
+#include <fmindex-collection/fmindex/BiFMIndex.h>
+#include <fmindex-collection/fmindex/FMIndex.h>
+#include <fmindex-collection/occtable/all.h>
+#include <fmindex-collection/search/SearchInterleaved.h>
+#include <fmindex-collection/search/SearchNoErrors.h>
+#include <fmindex-collection/search/SearchPseudo.h>
+#include <iostream>
+#include <nanobench.h>
+#include <search_schemes/expand.h>
+#include <search_schemes/generator/all.h>
+
+TEMPLATE_TEST_CASE("interleaved search reports same results as search_no_errors and search_pseudo", "[search][interleaved]",
+    fmindex_collection::occtable::Interleaved_16<5>,
+    fmindex_collection::occtable::EprV5<5>,
+    fmindex_collection::occtable::EprV6<5>,
+    fmindex_collection::occtable::eprV8::OccTable<5>) {
+
+    using OccTable = TestType;
+    using Result   = std::tuple<size_t, size_t, size_t, size_t>;
+
+    auto rng     = ankerl::nanobench::Rng{};
+    auto text    = generateText(10'000, rng);
+    auto index   = fmindex_collection::BiFMIndex<OccTable>{std::vector<std::vector<uint8_t>>{text}, /*samplingRate*/1, /*threadNbr*/1};
+    auto queries = generateQueries(text, 200, 20, rng);
+    queries.emplace_back(); // empty query
+
+    auto batchSize = GENERATE(size_t{1}, size_t{7}, size_t{64});
+    INFO("batchSize " << batchSize);
+
+    SECTION("no errors") {
+        auto expected = std::vector<Result>{};
+        fmindex_collection::search_no_errors::search(index, queries, [&](size_t qidx, auto cursor) {
+            expected.emplace_back(qidx, cursor.lb, cursor.len, 0);
+        });
+        auto results = std::vector<Result>{};
+        fmindex_collection::search_interleaved::search_no_errors(index, queries, [&](size_t qidx, auto cursor) {
+            results.emplace_back(qidx, cursor.lb, cursor.len, 0);
+        }, batchSize);
+        std::ranges::sort(results);
+        CHECK(results == expected);
+    }
+
+    SECTION("no errors, unidirectional FMIndex") {
+        auto fmindex = fmindex_collection::FMIndex<OccTable>{std::vector<std::vector<uint8_t>>{text}, /*samplingRate*/1, /*threadNbr*/1};
+        auto expected = std::vector<Result>{};
+        fmindex_collection::search_no_errors::search(fmindex, queries, [&](size_t qidx, auto cursor) {
+            expected.emplace_back(qidx, cursor.lb, cursor.len, 0);
+        });
+        auto results = std::vector<Result>{};
+        fmindex_collection::search_interleaved::search_no_errors(fmindex, queries, [&](size_t qidx, auto cursor) {
+            results.emplace_back(qidx, cursor.lb, cursor.len, 0);
+        }, batchSize);
+        std::ranges::sort(results);
+        CHECK(results == expected);
+    }
+
+    SECTION("search scheme") {
+        auto search_scheme = search_schemes::expand(search_schemes::generator::pigeon_opt(0, 2), queries[0].size());
+        queries.pop_back(); // search schemes are expanded for a fixed length
+
+        auto expected = std::vector<Result>{};
+        fmindex_collection::search_pseudo::search<false>(index, queries, search_scheme, [&](size_t qidx, auto cursor, size_t errors) {
+            expected.emplace_back(qidx, cursor.lb, cursor.len, errors);
+        });
+        auto results = std::vector<Result>{};
+        fmindex_collection::search_interleaved::search(index, queries, search_scheme, [&](size_t qidx, auto cursor, size_t errors) {
+            results.emplace_back(qidx, cursor.lb, cursor.len, errors);
+        }, batchSize);
+        std::ranges::sort(expected);
+        std::ranges::sort(results);
+        CHECK(results == expected);
+    }
+
+    SECTION("empty search scheme") {
+        auto search_scheme = decltype(search_schemes::expand(search_schemes::generator::pigeon_opt(0, 2), 0)){};
+        size_t reported{};
+        fmindex_collection::search_interleaved::search(index, queries, search_scheme, [&](size_t, auto, size_t) {
+            reported += 1;
+        }, batchSize);
+        CHECK(reported == 0);
+    }
+}
+
+TEST_CASE("benchmark interleaved search", "[search][interleaved][!benchmark][time][.]") {
+    using OccTable = fmindex_collection::occtable::eprV8::OccTable<5>;
+
+    auto rng = ankerl::nanobench::Rng{};
+    #ifdef NDEBUG
+    // large enough, so the occ tables don't fit into the cache
+    auto text = generateText(256'000'000, rng);
+    #else
+    auto text = generateText(100'000, rng);
+    #endif
+    auto index   = fmindex_collection::BiFMIndex<OccTable>{std::vector<std::vector<uint8_t>>{text}, /*samplingRate*/16, /*threadNbr*/1};
+    auto queries = generateQueries(text, 100'000, 50, rng);
+    text.clear();
+
+    auto output = std::stringstream{};
+    auto bench  = ankerl::nanobench::Bench{};
+    bench.title("exact search of 50 chars long queries")
+         .relative(true)
+         .batch(queries.size())
+         .minEpochIterations(1)
+         .output(&output);
+
+    bench.run("search_no_errors::search", [&]() {
+        size_t hits{};
+        fmindex_collection::search_no_errors::search(index, queries, [&](size_t, auto cursor) {
+            hits += cursor.count();
+        });
+        ankerl::nanobench::doNotOptimizeAway(hits);
+    });
+
+    for (size_t batchSize : {4, 8, 16, 32, 64}) {
+        bench.run("search_interleaved::search_no_errors, batch " + std::to_string(batchSize), [&]() {
+            size_t hits{};
+            fmindex_collection::search_interleaved::search_no_errors(index, queries, [&](size_t, auto cursor) {
+                hits += cursor.count();
+            }, batchSize);
+            ankerl::nanobench::doNotOptimizeAway(hits);
+        });
+    }
+    std::cout << output.str() << '\n';
+}
@@ -0,0 +1,214 @@
+// SPDX-FileCopyrightText: 2006-2023, Knut Reinert & Freie Universität Berlin
+// SPDX-FileCopyrightText: 2016-2023, Knut Reinert & MPI für molekulare Genetik
+// SPDX-License-Identifier: CC0-1.0
+
+#include "generateText.h"
+
+#include <catch2/catch_all.hpp>
+#include <fmindex-collection/fmindex/BiFMIndex.h>
+#include <fmindex-collection/numa.h>
+#include <fmindex-collection/occtable/all.h>
+#include <fmindex-collection/search/all.h>
+#include <search_schemes/expand.h>
+#include <search_schemes/generator/all.h>
+
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
+TEST_CASE("parallel search reports same results as single threaded search", "[search][parallel]") {
+    using OccTable = fmindex_collection::occtable::Interleaved_16<5>;
+    using Index = fmindex_collection::BiFMIndex<OccTable>;
+
+    auto rng     = ankerl::nanobench::Rng{};
+    auto text    = generateText(10'000, rng);
+    auto index   = Index{std::vector<std::vector<uint8_t>>{text}, /*samplingRate*/1, /*threadNbr*/1};
+    auto queries = generateQueries(text, 200, 20, rng);
+
+    using Result = std::tuple<size_t, size_t, size_t, size_t>;
+
+    auto search_scheme = search_schemes::expand(search_schemes::generator::pigeon_opt(0, 1), queries[0].size());
+    auto best_schemes = std::vector{
+        search_schemes::expand(search_schemes::generator::pigeon_opt(0, 0), queries[0].size()),
+        search_schemes::expand(search_schemes::generator::pigeon_opt(1, 1), queries[0].size()),
+    };
+
+    auto threadNbr = GENERATE(size_t{1}, size_t{2}, size_t{5});
+    INFO("threadNbr " << threadNbr);
+    SECTION("search ng21") {
+        auto expected = std::vector<Result>{};
+        fmindex_collection::search_ng21::search(index, queries, search_scheme, [&](size_t qidx, auto cursor, size_t errors) {
+            expected.emplace_back(qidx, cursor.lb, cursor.len, errors);
+        });
+        auto results = std::vector<Result>{};
+        fmindex_collection::search_ng21::search_parallel(index, queries, search_scheme, threadNbr, [&](size_t qidx, auto cursor, size_t errors) {
+            results.emplace_back(qidx, cursor.lb, cursor.len, errors);
+        });
+        CHECK(results == expected);
+    }
+
+    SECTION("search ng21, search_n") {
+        auto expected = std::vector<Result>{};
+        fmindex_collection::search_ng21::search_n(index, queries, search_scheme, 3, [&](size_t qidx, auto cursor, size_t errors) {
+            expected.emplace_back(qidx, cursor.lb, cursor.len, errors);
+        });
+        auto results = std::vector<Result>{};
+        fmindex_collection::search_ng21::search_n_parallel(index, queries, search_scheme, 3, threadNbr, [&](size_t qidx, auto cursor, size_t errors) {
+            results.emplace_back(qidx, cursor.lb, cursor.len, errors);
+        });
+        CHECK(results == expected);
+    }
+
+    SECTION("search ng21, search_best and search_best_n") {
+        auto expected = std::vector<Result>{};
+        fmindex_collection::search_ng21::search_best(index, queries, best_schemes, [&](size_t qidx, auto cursor, size_t errors) {
+            expected.emplace_back(qidx, cursor.lb, cursor.len, errors);
+        });
+        auto results = std::vector<Result>{};
+        fmindex_collection::search_ng21::search_best_parallel(index, queries, best_schemes, threadNbr, [&](size_t qidx, auto cursor, size_t errors) {
+            results.emplace_back(qidx, cursor.lb, cursor.len, errors);
+        });
+        CHECK(results == expected);
+
+        expected.clear();
+        results.clear();
+        fmindex_collection::search_ng21::search_best_n(index, queries, best_schemes, 2, [&](size_t qidx, auto cursor, size_t errors) {
+            expected.emplace_back(qidx, cursor.lb, cursor.len, errors);
+        });
+        fmindex_collection::search_ng21::search_best_n_parallel(index, queries, best_schemes, 2, threadNbr, [&](size_t qidx, auto cursor, size_t errors) {
+            results.emplace_back(qidx, cursor.lb, cursor.len, errors);
+        });
+        CHECK(results == expected);
+    }
+
+    SECTION("search ng21V6") {
+        auto expected = std::vector<Result>{};
+        fmindex_collection::search_ng21V6::search(index, queries, search_scheme, [&](size_t qidx, auto cursor, size_t errors) {
+            expected.emplace_back(qidx, cursor.lb, cursor.len, errors);
+        });
+        auto results = std::vector<Result>{};
+        fmindex_collection::search_ng21V6::search_parallel(index, queries, search_scheme, threadNbr, [&](size_t qidx, auto cursor, size_t errors) {
+            results.emplace_back(qidx, cursor.lb, cursor.len, errors);
+        });
+        CHECK(results == expected);
+    }
+
+    SECTION("search ng21V7") {
+        auto expected = std::vector<Result>{};
+        fmindex_collection::search_ng21V7::search(index, queries, search_scheme, [&](size_t qidx, auto cursor, size_t errors) {
+            expected.emplace_back(qidx, cursor.lb, cursor.len, errors);
+        });
+        auto results = std::vector<Result>{};
+        fmindex_collection::search_ng21V7::search_parallel(index, queries, search_scheme, threadNbr, [&](size_t qidx, auto cursor, size_t errors) {
+            results.emplace_back(qidx, cursor.lb, cursor.len, errors);
+        });
+        CHECK(results == expected);
+    }
+
+    SECTION("search pseudo") {
+        auto expected = std::vector<Result>{};
+        fmindex_collection::search_pseudo::search<true>(index, queries, search_scheme, [&](size_t qidx, auto cursor, size_t errors) {
+            expected.emplace_back(qidx, cursor.lb, cursor.len, errors);
+        });
+        auto results = std::vector<Result>{};
+        fmindex_collection::search_pseudo::search_parallel<true>(index, queries, search_scheme, threadNbr, [&](size_t qidx, auto cursor, size_t errors) {
+            results.emplace_back(qidx, cursor.lb, cursor.len, errors);
+        });
+        CHECK(results == expected);
+    }
+
+    SECTION("search no errors") {
+        auto expected = std::vector<Result>{};
+        fmindex_collection::search_no_errors::search(index, queries, [&](size_t qidx, auto cursor) {
+            expected.emplace_back(qidx, cursor.lb, cursor.len, 0);
+        });
+        auto results = std::vector<Result>{};
+        fmindex_collection::search_no_errors::search_parallel(index, queries, threadNbr, [&](size_t qidx, auto cursor) {
+            results.emplace_back(qidx, cursor.lb, cursor.len, 0);
+        });
+        CHECK(results == expected);
+    }
+}
+
+TEST_CASE("parallel search on numa replicas reports same results as single threaded search", "[search][parallel][numa]") {
+    using OccTable = fmindex_collection::occtable::Interleaved_16<5>;
+    using Index = fmindex_collection::BiFMIndex<OccTable>;
+
+    auto rng     = ankerl::nanobench::Rng{};
+    auto text    = generateText(10'000, rng);
+    auto index   = Index{std::vector<std::vector<uint8_t>>{text}, /*samplingRate*/1, /*threadNbr*/1};
+    auto queries = generateQueries(text, 200, 20, rng);
+
+    using Result = std::tuple<size_t, size_t, size_t, size_t>;
+
+    auto search_scheme = search_schemes::expand(search_schemes::generator::pigeon_opt(0, 1), queries[0].size());
+
+    // two copies are enforced, independent of the number of numa nodes of this machine
+    auto replicas = fmindex_collection::numa::Replicas{index, 2};
+    REQUIRE(replicas.size() == 2);
+    CHECK(&replicas[0] != &index);
+    CHECK(replicas[0].size() == index.size());
+    CHECK(replicas[1].size() == index.size());
+
+    auto expected = std::vector<Result>{};
+    fmindex_collection::search_ng21::search(index, queries, search_scheme, [&](size_t qidx, auto cursor, size_t errors) {
+        expected.emplace_back(qidx, cursor.lb, cursor.len, errors);
+    });
+
+    auto threadNbr = GENERATE(size_t{1}, size_t{4});
+    INFO("threadNbr " << threadNbr);
+    auto results = std::vector<Result>{};
+    fmindex_collection::search_ng21::search_parallel(replicas, queries, search_scheme, threadNbr, [&](size_t qidx, auto cursor, size_t errors) {
+        CHECK((cursor.index == &replicas[0] || cursor.index == &replicas[1]));
+        results.emplace_back(qidx, cursor.lb, cursor.len, errors);
+    });
+    CHECK(results == expected);
+}
+
+#if defined(__linux__)
+TEST_CASE("parallel search on numa replicas does not change the binding of the calling thread", "[search][parallel][numa]") {
+    using OccTable = fmindex_collection::occtable::Interleaved_16<5>;
+    using Index = fmindex_collection::BiFMIndex<OccTable>;
+
+    auto rng     = ankerl::nanobench::Rng{};
+    auto text    = generateText(10'000, rng);
+    auto index   = Index{std::vector<std::vector<uint8_t>>{text}, /*samplingRate*/1, /*threadNbr*/1};
+    auto queries = generateQueries(text, 200, 20, rng);
+
+    auto search_scheme = search_schemes::expand(search_schemes::generator::pigeon_opt(0, 1), queries[0].size());
+    auto replicas = fmindex_collection::numa::Replicas{index, fmindex_collection::numa::nodeCount()};
+
+    auto before = cpu_set_t{};
+    CPU_ZERO(&before);
+    REQUIRE(sched_getaffinity(0, sizeof(before), &before) == 0);
+
+    auto threadNbr = GENERATE(size_t{1}, size_t{4});
+    INFO("threadNbr " << threadNbr);
+    size_t hits{0};
+    fmindex_collection::search_ng21::search_parallel(replicas, queries, search_scheme, threadNbr, [&](size_t, auto, size_t) {
+        hits += 1;
+    });
+    CHECK(hits > 0);
+
+    auto after = cpu_set_t{};
+    CPU_ZERO(&after);
+    REQUIRE(sched_getaffinity(0, sizeof(after), &after) == 0);
+    CHECK(CPU_EQUAL(&before, &after));
+}
+#endif
+
+TEST_CASE("parallelQueries forwards exceptions", "[search][parallel]") {
+    using Result = std::tuple<size_t>;
+    auto run = [](size_t threadNbr) {
+        fmindex_collection::parallelQueries<Result>(100, threadNbr, [](auto& results) {
+            return [&](size_t begin, size_t end) {
+                for (size_t i{begin}; i < end; ++i) {
+                    if (i == 50) throw std::runtime_error{"abort"};
+                    results.emplace_back(i);
+                }
+            };
+        }, [](size_t) {}, /*.chunkSize=*/3);
+    };
+    CHECK_THROWS_AS(run(1), std::runtime_error);
+    CHECK_THROWS_AS(run(4), std::runtime_error);
+}
@@ -527,6 +527,163 @@ TEST_CASE("check searches with errors", "[searches]") {
         CHECK(results == expected);
     }
 
+    SECTION("search ng21, all search_stratified") {
+        auto search_scheme = search_schemes::expand(search_schemes::generator::pigeon_opt(0, 1), queries[0].size());
+
+        auto results = std::vector<std::tuple<size_t, size_t, size_t>>{};
+        auto errorsPerQuery = std::vector<std::vector<size_t>>(queries.size());
+        fmindex_collection::search_ng21::search_stratified(index, queries, search_scheme, [&](auto qidx, auto cursor, auto errors) {
+            errorsPerQuery[qidx].push_back(errors);
+            for (auto [sid, spos] : fmindex_collection::LocateLinear{index, cursor}) {
+                results.emplace_back(qidx, sid, spos);
+            }
+        });
+
+        // hits are reported ordered by their number of errors
+        for (auto const& errors : errorsPerQuery) {
+            CHECK(std::ranges::is_sorted(errors));
+        }
+
+        std::ranges::sort(results);
+
+        auto expected = std::vector<std::tuple<size_t, size_t, size_t>> {
+            {0, 0, 3},
+            {0, 0, 3},
+            {0, 1, 7},
+            {0, 1, 7},
+            {1, 0, 7},
+            {1, 0, 7},
+            {1, 1, 3},
+            {1, 1, 3},
+        };
+        CHECK(results == expected);
+    }
+
+    SECTION("search ng21, all search_best_stratified") {
+        auto search_scheme = search_schemes::expand(search_schemes::generator::pigeon_opt(0, 2), queries[0].size());
+
+        auto results = std::vector<std::tuple<size_t, size_t, size_t>>{};
+        fmindex_collection::search_ng21::search_best_stratified(index, queries, search_scheme, [&](auto qidx, auto cursor, auto errors) {
+            CHECK(errors == 1);
+            for (auto [sid, spos] : fmindex_collection::LocateLinear{index, cursor}) {
+                results.emplace_back(qidx, sid, spos);
+            }
+        });
+
+        std::ranges::sort(results);
+
+        auto expected = std::vector<std::tuple<size_t, size_t, size_t>> {
+            {0, 0, 3},
+            {0, 0, 3},
+            {0, 1, 7},
+            {0, 1, 7},
+            {1, 0, 7},
+            {1, 0, 7},
+            {1, 1, 3},
+            {1, 1, 3},
+        };
+        CHECK(results == expected);
+    }
+
+    SECTION("search ng21, all search_best_n_stratified") {
+        auto search_scheme = search_schemes::expand(search_schemes::generator::pigeon_opt(0, 2), queries[0].size());
+
+        auto results = std::vector<std::tuple<size_t, size_t, size_t>>{};
+        fmindex_collection::search_ng21::search_best_n_stratified(index, queries, search_scheme, 3, [&](auto qidx, auto cursor, auto errors) {
+            (void)errors;
+            for (auto [sid, spos] : fmindex_collection::LocateLinear{index, cursor}) {
+                results.emplace_back(qidx, sid, spos);
+            }
+        });
+
+        std::ranges::sort(results);
+
+        auto expected = std::vector<std::tuple<size_t, size_t, size_t>> {
+            {0, 0, 3},
+            {0, 1, 7},
+            {0, 1, 7},
+            {1, 0, 7},
+            {1, 0, 7},
+            {1, 1, 3},
+        };
+        CHECK(results == expected);
+    }
+
+    SECTION("search ng21, all search_batch") {
+        auto search_scheme = search_schemes::expand(search_schemes::generator::pigeon_opt(0, 1), queries[0].size());
+
+        // third query is a duplicate of the first one
+        auto batch = queries;
+        batch.push_back(queries[0]);
+
+        auto results = std::vector<std::tuple<size_t, size_t, size_t>>{};
+        fmindex_collection::search_ng21::search_batch(index, batch, search_scheme, [&](auto qidx, auto cursor, auto errors) {
+            (void)errors;
+            for (auto [sid, spos] : fmindex_collection::LocateLinear{index, cursor}) {
+                results.emplace_back(qidx, sid, spos);
+            }
+        });
+
+        std::ranges::sort(results);
+
+        auto expected = std::vector<std::tuple<size_t, size_t, size_t>> {
+            {0, 0, 3},
+            {0, 0, 3},
+            {0, 1, 7},
+            {0, 1, 7},
+            {1, 0, 7},
+            {1, 0, 7},
+            {1, 1, 3},
+            {1, 1, 3},
+            {2, 0, 3},
+            {2, 0, 3},
+            {2, 1, 7},
+            {2, 1, 7},
+        };
+        CHECK(results == expected);
+    }
+
+    SECTION("search ng21, all search with cached search schemes, queries of different length") {
+        auto cache = fmindex_collection::SearchSchemeCache{index};
+
+        auto mixed = queries;
+        mixed.push_back({'A', 'C', 'C', 'A'});
+
+        auto results = std::vector<std::tuple<size_t, size_t, size_t>>{};
+        fmindex_collection::search_ng21::search(index, mixed, cache.scheme("pigeon_opt", 0, 1), [&](auto qidx, auto cursor, auto errors) {
+            (void)errors;
+            for (auto [sid, spos] : fmindex_collection::LocateLinear{index, cursor}) {
+                results.emplace_back(qidx, sid, spos);
+            }
+        });
+
+        std::ranges::sort(results);
+
+        auto expected = std::vector<std::tuple<size_t, size_t, size_t>> {
+            {0, 0, 3},
+            {0, 0, 3},
+            {0, 1, 7},
+            {0, 1, 7},
+            {1, 0, 7},
+            {1, 0, 7},
+            {1, 1, 3},
+            {1, 1, 3},
+            {2, 0, 1},
+            {2, 0, 2},
+            {2, 0, 2},
+            {2, 0, 2},
+            {2, 1, 5},
+            {2, 1, 6},
+            {2, 1, 6},
+            {2, 1, 6},
+        };
+        CHECK(results == expected);
+
+        // each length is expanded once
+        CHECK(cache.entries.size() == 2);
+        CHECK(cache.get("pigeon_opt", 0, 1, 4).scheme.at(0).pi.size() == 4);
+    }
+
     SECTION("search ng21 V2, all search") {
         auto search_scheme = search_schemes::expand(search_schemes::generator::pigeon_opt(0, 1), queries[0].size());
 
@@ -837,6 +994,65 @@ TEST_CASE("check searches with errors", "[searches]") {
     }
 
 
+    SECTION("search ng21 V8, all search") {
+        auto search_scheme = search_schemes::expand(search_schemes::generator::pigeon_opt(0, 1), queries[0].size());
+
+        auto results = std::vector<std::tuple<size_t, size_t, size_t>>{};
+        fmindex_collection::search_ng21V8::search(index, queries, search_scheme, [&](auto qidx, auto cursor, auto errors) {
+            (void)errors;
+            for (auto [sid, spos] : fmindex_collection::LocateLinear{index, cursor}) {
+                results.emplace_back(qidx, sid, spos);
+            }
+        });
+
+        std::ranges::sort(results);
+
+        auto expected = std::vector<std::tuple<size_t, size_t, size_t>> {
+            {0, 0, 3},
+            {0, 0, 3},
+            {0, 1, 7},
+            {0, 1, 7},
+            {1, 0, 7},
+            {1, 0, 7},
+            {1, 1, 3},
+            {1, 1, 3},
+        };
+        CHECK(results == expected);
+    }
+
+    SECTION("search ng21 V8, all search, depth first fallback") {
+        auto search_scheme = search_schemes::expand(search_schemes::generator::pigeon_opt(0, 1), queries[0].size());
+
+        auto results = std::vector<std::tuple<size_t, size_t, size_t>>{};
+        fmindex_collection::search_ng21V8::search(index, queries, search_scheme, [&](auto qidx, auto cursor, auto errors) {
+            (void)errors;
+            for (auto [sid, spos] : fmindex_collection::LocateLinear{index, cursor}) {
+                results.emplace_back(qidx, sid, spos);
+            }
+        }, /*batchSize*/2, /*maxFrontier*/1);
+
+        std::ranges::sort(results);
+
+        auto expected = std::vector<std::tuple<size_t, size_t, size_t>> {
+            {0, 0, 3},
+            {0, 0, 3},
+            {0, 1, 7},
+            {0, 1, 7},
+            {1, 0, 7},
+            {1, 0, 7},
+            {1, 1, 3},
+            {1, 1, 3},
+        };
+        CHECK(results == expected);
+    }
+
+    SECTION("search ng21 V8, rejects queries longer than 65535") {
+        auto longQueries = std::vector<std::vector<uint8_t>>{std::vector<uint8_t>(70'000, 1)};
+        auto search_scheme = search_schemes::expand(search_schemes::generator::pigeon_opt(0, 0), longQueries[0].size());
+
+        CHECK_THROWS_AS(fmindex_collection::search_ng21V8::search(index, longQueries, search_scheme, [&](auto, auto, auto) {}), std::runtime_error);
+    }
+
     SECTION("search ng22, all search") {
         auto search_scheme = search_schemes::expand(search_schemes::generator::pigeon_opt(0, 1), queries[0].size());
 
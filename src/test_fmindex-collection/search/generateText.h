@@ -0,0 +1,40 @@
+// SPDX-FileCopyrightText: 2006-2023, Knut Reinert & Freie Universität Berlin
+// SPDX-FileCopyrightText: 2016-2023, Knut Reinert & MPI für molekulare Genetik
+// SPDX-License-Identifier: CC0-1.0
+#pragma once
+
+#include <cstdint>
+#include <nanobench.h>
+#include <vector>
+
+/**!\brief random text over the alphabet 1-4 (ACGT)
+ */
+inline auto generateText(size_t length, ankerl::nanobench::Rng& rng) -> std::vector<uint8_t> {
+    auto text = std::vector<uint8_t>{};
+    text.reserve(length);
+    for (size_t i{0}; i < length; ++i) {
+        text.push_back(rng.bounded(4) + 1);
+    }
+    return text;
+}
+
+/**!\brief random substrings of text
+ *
+ * every second query gets a substitution and every fifth query is random
+ */
+inline auto generateQueries(std::vector<uint8_t> const& text, size_t count, size_t length, ankerl::nanobench::Rng& rng) -> std::vector<std::vector<uint8_t>> {
+    auto queries = std::vector<std::vector<uint8_t>>{};
+    for (size_t i{0}; i < count; ++i) {
+        auto start = rng.bounded(text.size() - length);
+        auto query = std::vector<uint8_t>(text.begin() + start, text.begin() + start + length);
+        if (i % 2 == 1) {
+            query[rng.bounded(length)] = rng.bounded(4) + 1;
+        } else if (i % 5 == 2) {
+            for (auto& c : query) {
+                c = rng.bounded(4) + 1;
+            }
+        }
+        queries.push_back(query);
+    }
+    return queries;
+}